@@ -135,6 +135,36 @@ typedef struct libvlc_media_stats_t
     int         i_lost_abuffers;
 } libvlc_media_stats_t;
 
+/**
+ * Latency of one stage of the decoding pipeline, in microseconds
+ *
+ * Percentiles are estimated from a histogram with power-of-two buckets:
+ * they are upper bounds, at most twice the actual value.
+ */
+typedef struct libvlc_latency_stats_t
+{
+    uint64_t    i_count; /**< Number of samples */
+    uint64_t    i_negative; /**< Number of negative samples (early frames) */
+    int64_t     i_mean;
+    int64_t     i_p50;
+    int64_t     i_p90;
+    int64_t     i_p99;
+    int64_t     i_p999;
+} libvlc_latency_stats_t;
+
+typedef struct libvlc_media_latency_t
+{
+    /** Time spent by data in the decoder input queue */
+    libvlc_latency_stats_t queue;
+    /** Time spent decoding */
+    libvlc_latency_stats_t decode;
+    /** Time from the queuing of decoded data to the output, until the
+     * output consumes it */
+    libvlc_latency_stats_t output;
+    /** Rendering delay past the presentation date (negative if early) */
+    libvlc_latency_stats_t lateness;
+} libvlc_media_latency_t;
+
 typedef struct libvlc_audio_track_t
 {
     unsigned    i_channels;
@@ -616,6 +646,22 @@ LIBVLC_API libvlc_state_t libvlc_media_get_state(
 LIBVLC_API bool libvlc_media_get_stats(libvlc_media_t *p_md,
                                        libvlc_media_stats_t *p_stats);
 
+/**
+ * Get the latency statistics of the audio or video tracks of the media
+ *
+ * The latencies are accumulated since the media started playing.
+ *
+ * \param p_md: media descriptor object
+ * \param type: libvlc_track_audio or libvlc_track_video
+ * \param p_latency: structure that contain the latency statistics
+ *                   (this structure must be allocated by the caller)
+ * \retval true statistics are available
+ * \retval false otherwise
+ */
+LIBVLC_API bool libvlc_media_get_latency(libvlc_media_t *p_md,
+                                         libvlc_track_type_t type,
+                                         libvlc_media_latency_t *p_latency);
+
 /* The following method uses libvlc_media_list_t, however, media_list usage is optionnal
  * and this is here for convenience */
 #define VLC_FORWARD_DECLARE_OBJECT(a) struct a
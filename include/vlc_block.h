@@ -163,6 +163,41 @@ VLC_API block_t *block_Init(block_t *block,
  */
 VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
+/**
+ * Block pool statistics.
+ */
+struct vlc_block_pool_stats
+{
+    uint64_t hits; /**< allocations served from the pool */
+    uint64_t misses; /**< poolable allocations that fell back to malloc() */
+    size_t bytes_cached; /**< memory currently held by the pool */
+};
+
+/**
+ * Enables or disables the block pool.
+ *
+ * When the pool is enabled, block_Alloc() serves small and medium blocks
+ * from per-thread caches of power-of-two size classes, backed by a global
+ * depot, instead of allocating each block with malloc().
+ * Block alignment and release semantics are unchanged.
+ *
+ * The pool is process-wide and disabled by default. Disabling it releases
+ * the depot; memory cached by a thread is released when that thread exits.
+ *
+ * @param enable whether block_Alloc() should use the pool
+ */
+VLC_API void block_PoolEnable(bool enable);
+
+/**
+ * Gets the block pool statistics.
+ *
+ * The counters of running threads are read without synchronization, so the
+ * result is only approximate while blocks are being allocated.
+ *
+ * @param stats structure to fill [OUT]
+ */
+VLC_API void block_PoolGetStats(struct vlc_block_pool_stats *stats);
+
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
 /**
@@ -639,6 +674,95 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 
 /** @} */
 
+/**
+ * \defgroup spsc_fifo Single-producer single-consumer block FIFO
+ *
+ * Bounded block queue for exactly one producer thread and one consumer
+ * thread, such as a demuxer feeding a decoder, or a stream output feeding
+ * its sender thread.
+ *
+ * Queuing and dequeuing do not take any lock, unless the queue is full
+ * (producer) or empty (consumer): the thread then sleeps on a condition
+ * variable until the other thread wakes it up. The queue owns the blocks
+ * between vlc_spsc_fifo_Queue() and their dequeuing, as with block_FifoPut()
+ * and block_FifoGet().
+ * @{
+ */
+
+typedef struct vlc_spsc_fifo vlc_spsc_fifo_t;
+
+/**
+ * Creates a single-producer single-consumer FIFO.
+ *
+ * @param capacity maximum number of queued blocks (rounded up to a power of
+ *                 two)
+ * @return the new FIFO, or NULL on memory error
+ */
+VLC_API vlc_spsc_fifo_t *vlc_spsc_fifo_New(size_t capacity) VLC_USED;
+
+/**
+ * Destroys a FIFO created by vlc_spsc_fifo_New().
+ *
+ * Any queued blocks are released. Neither the producer nor the consumer may
+ * be using the FIFO anymore.
+ */
+VLC_API void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *);
+
+/**
+ * Queues a chain of blocks.
+ *
+ * The blocks of the chain are queued one by one. If the FIFO is full, this
+ * function waits until the consumer dequeues a block.
+ *
+ * This function is a cancellation point, but only if it waits. If the thread
+ * is cancelled while waiting, the blocks of the chain not queued yet are
+ * leaked.
+ *
+ * @warning Only the producer thread may call this function.
+ *
+ * @param block chain of blocks to queue (may be NULL)
+ */
+VLC_API void vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *, block_t *block);
+
+/**
+ * Dequeues a block, waiting for one if the FIFO is empty.
+ *
+ * This function is a cancellation point on all platforms: it checks for
+ * cancellation on entry, and its wait is a vlc_cond_wait().
+ *
+ * @warning Only the consumer thread may call this function.
+ *
+ * @return the first block of the FIFO (never NULL)
+ */
+VLC_API block_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Dequeues a block if the FIFO is not empty.
+ *
+ * @warning Only the consumer thread may call this function.
+ *
+ * @return the first block of the FIFO, or NULL if the FIFO is empty
+ */
+VLC_API block_t *vlc_spsc_fifo_TryDequeue(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts the queued blocks.
+ *
+ * This function can be called from any thread. The result is only a snapshot
+ * if the producer or the consumer is running concurrently.
+ */
+VLC_API size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts the queued bytes.
+ *
+ * This function can be called from any thread. The result is only a snapshot
+ * if the producer or the consumer is running concurrently.
+ */
+VLC_API size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *) VLC_USED;
+
+/** @} */
+
 /** @} */
 
 #endif /* VLC_BLOCK_H */
@@ -76,8 +76,10 @@ unsigned vlc_CPU_raw(void);
 
 # ifdef __SSE2__
 #  define vlc_CPU_SSE2() (1)
+#  define VLC_SSE2
 # else
 #  define vlc_CPU_SSE2() ((vlc_CPU() & VLC_CPU_SSE2) != 0)
+#  define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
 # endif
 
 # ifdef __SSE3__
@@ -94,8 +96,10 @@ unsigned vlc_CPU_raw(void);
 
 # ifdef __SSE4_1__
 #  define vlc_CPU_SSE4_1() (1)
+#  define VLC_SSE4_1
 # else
 #  define vlc_CPU_SSE4_1() ((vlc_CPU() & VLC_CPU_SSE4_1) != 0)
+#  define VLC_SSE4_1 __attribute__ ((__target__ ("sse4.1")))
 # endif
 
 # ifdef __SSE4_2__
@@ -118,8 +122,10 @@ unsigned vlc_CPU_raw(void);
 
 # ifdef __AVX2__
 #  define vlc_CPU_AVX2() (1)
+#  define VLC_AVX2
 # else
 #  define vlc_CPU_AVX2() ((vlc_CPU() & VLC_CPU_AVX2) != 0)
+#  define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
 # endif
 
 # ifdef __3dNOW__
@@ -154,6 +154,14 @@ struct filter_t
 
     /** Private structure for the owner of the filter */
     filter_owner_t      owner;
+
+    /** Set by video filters that can write their output into their input
+     * picture (same format, pixels processed independently).
+     *
+     * Such filters still allocate their output with filter_NewPicture(),
+     * which may then return the input picture, with an extra reference, if
+     * the owner does not share it. */
+    bool                b_inplace;
 };
 
 /**
@@ -209,6 +209,18 @@ VLC_API input_item_node_t * input_item_node_Create( input_item_t *p_input ) VLC_
  */
 VLC_API input_item_node_t * input_item_node_AppendItem( input_item_node_t *p_node, input_item_t *p_item );
 
+/**
+ * Add new child nodes to this parent node for several subitems at once.
+ *
+ * It is equivalent to calling input_item_node_AppendItem() for each item,
+ * with a single reallocation of the children of the parent node.
+ *
+ * \return VLC_SUCCESS, or VLC_ENOMEM if some of the items were not added
+ */
+VLC_API int input_item_node_AppendItems( input_item_node_t *p_node,
+                                         input_item_t *const *pp_items,
+                                         size_t i_items );
+
 /**
  * Add an already created node to children of this parent node.
  */
@@ -500,6 +512,69 @@ VLC_API void libvlc_MetadataCancel( libvlc_int_t *, void * );
 /******************
  * Input stats
  ******************/
+
+/**
+ * Number of buckets of a latency histogram.
+ *
+ * Bucket i counts the samples within [2^i, 2^(i+1)) microseconds. The first
+ * bucket also counts shorter samples, and the last one longer samples.
+ * Negative samples are counted apart.
+ */
+#define VLC_LATENCY_BUCKETS 24
+
+/**
+ * Latency histogram
+ */
+struct vlc_latency_histogram
+{
+    uint64_t count; /**< Number of samples */
+    vlc_tick_t sum; /**< Sum of all samples */
+    uint64_t negative; /**< Number of negative samples */
+    uint64_t buckets[VLC_LATENCY_BUCKETS];
+};
+
+/**
+ * Latencies of the decoding pipeline of elementary streams
+ */
+struct vlc_es_latency
+{
+    /** Time spent by blocks in the decoder input queue */
+    struct vlc_latency_histogram queue;
+    /** Time spent decoding a block */
+    struct vlc_latency_histogram decode;
+    /** Time from the queuing of a decoded frame to the output, until the
+     * output consumes it */
+    struct vlc_latency_histogram output;
+    /** Rendering delay past the frame presentation date (negative if early) */
+    struct vlc_latency_histogram lateness;
+};
+
+/**
+ * Estimates a percentile of a latency histogram.
+ *
+ * \param permille percentile in thousandths (e.g. 990 for the 99th)
+ * \return the upper bound of the bucket containing the percentile,
+ * or 0 if the histogram is empty or the percentile is a negative sample
+ */
+static inline vlc_tick_t
+vlc_latency_histogram_Percentile(const struct vlc_latency_histogram *h,
+                                 unsigned permille)
+{
+    uint64_t rank = (h->count * permille + 999) / 1000;
+    uint64_t total = h->negative;
+
+    if (h->count == 0 || (total >= rank && total > 0))
+        return 0;
+
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+    {
+        total += h->buckets[i];
+        if (total >= rank && total > 0)
+            return VLC_TICK_FROM_US(UINT64_C(2) << i);
+    }
+    return VLC_TICK_FROM_US(UINT64_C(1) << VLC_LATENCY_BUCKETS);
+}
+
 struct input_stats_t
 {
     /* Input */
@@ -525,6 +600,10 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Latencies of the video and audio elementary streams */
+    struct vlc_es_latency video_latency;
+    struct vlc_es_latency audio_latency;
 };
 
 /**
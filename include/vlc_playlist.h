@@ -158,7 +158,8 @@ struct vlc_playlist_sort_criterion
  * A client may register a listener using vlc_playlist_AddListener() to listen
  * playlist events.
  *
- * All callbacks are called with the playlist locked (see vlc_playlist_Lock()).
+ * All callbacks are called with the playlist locked (see vlc_playlist_Lock()),
+ * except for listeners registered by vlc_playlist_AddAsyncListener().
  */
 struct vlc_playlist_callbacks
 {
@@ -398,6 +399,59 @@ vlc_playlist_AddListener(vlc_playlist_t *playlist,
 VLC_API void
 vlc_playlist_RemoveListener(vlc_playlist_t *, vlc_playlist_listener_id *);
 
+/**
+ * Add a playlist listener notified asynchronously.
+ *
+ * The callbacks are called from a thread dedicated to this listener, without
+ * the playlist lock. The events are queued in order, and the pending events
+ * are merged (like during a transaction, see vlc_playlist_BeginTransaction())
+ * while the listener is busy. The items passed to the callbacks are held until
+ * the callback returns.
+ *
+ * The callbacks must not lock the playlist (the listener thread is joined by
+ * vlc_playlist_RemoveListener(), which is called with the playlist locked).
+ *
+ * \param playlist             the playlist, locked
+ * \param cbs                  the callbacks (must be valid until the listener
+ *                             is removed)
+ * \param userdata             userdata provided as a parameter in callbacks
+ * \param notify_current_state true to notify the current state via callbacks
+ * \return a listener identifier, or NULL if an error occurred
+ */
+VLC_API VLC_USED vlc_playlist_listener_id *
+vlc_playlist_AddAsyncListener(vlc_playlist_t *playlist,
+                              const struct vlc_playlist_callbacks *cbs,
+                              void *userdata, bool notify_current_state);
+
+/**
+ * Begin a transaction.
+ *
+ * Until the matching vlc_playlist_EndTransaction(), the listeners are not
+ * notified: the changes are recorded, and contiguous changes of the same kind
+ * (e.g. successive insertions of adjacent slices) are merged into a single
+ * range event. The resulting events are delivered at the end of the
+ * transaction.
+ *
+ * The indices of the delivered events are the ones recorded during the
+ * transaction: each event applies to the playlist as left by the previous
+ * events, not to its final state. Listeners must apply them in order.
+ *
+ * Transactions may be nested, the events are delivered at the end of the
+ * outermost one. The playlist must stay locked during the whole transaction.
+ *
+ * \param playlist the playlist, locked
+ */
+VLC_API void
+vlc_playlist_BeginTransaction(vlc_playlist_t *playlist);
+
+/**
+ * End a transaction, and notify the recorded changes.
+ *
+ * \param playlist the playlist, locked
+ */
+VLC_API void
+vlc_playlist_EndTransaction(vlc_playlist_t *playlist);
+
 /**
  * Return the number of items.
  *
@@ -431,6 +485,9 @@ vlc_playlist_Clear(vlc_playlist_t *playlist);
  *
  * The index must be in range (less than or equal to vlc_playlist_Count()).
  *
+ * If the playlist is kept sorted (see vlc_playlist_SetKeepSorted()), the
+ * index is ignored and each media is inserted at its sorted position.
+ *
  * \param playlist the playlist, locked
  * \index index    the index where the media are to be inserted
  * \param media    the array of media to insert
@@ -493,6 +550,8 @@ vlc_playlist_AppendOne(vlc_playlist_t *playlist, input_item_t *media)
  * The slice and the target must be in range (both index+count and target+count
  * less than or equal to vlc_playlist_Count()).
  *
+ * This disables the "keep sorted" mode (see vlc_playlist_SetKeepSorted()).
+ *
  * \param playlist the playlist, locked
  * \param index    the index of the first item to move
  * \param count    the number of items to move
@@ -623,6 +682,8 @@ vlc_playlist_RequestRemove(vlc_playlist_t *playlist,
 /**
  * Shuffle the playlist.
  *
+ * This disables the "keep sorted" mode (see vlc_playlist_SetKeepSorted()).
+ *
  * \param playlist the playlist, locked
  */
 VLC_API void
@@ -631,6 +692,8 @@ vlc_playlist_Shuffle(vlc_playlist_t *playlist);
 /**
  * Sort the playlist by a list of criteria.
  *
+ * This disables the "keep sorted" mode (see vlc_playlist_SetKeepSorted()).
+ *
  * \param playlist the playlist, locked
  * \param criteria the sort criteria (in order)
  * \param count    the number of criteria
@@ -641,6 +704,27 @@ vlc_playlist_Sort(vlc_playlist_t *playlist,
                   const struct vlc_playlist_sort_criterion criteria[],
                   size_t count);
 
+/**
+ * Sort the playlist and keep it sorted.
+ *
+ * The playlist is sorted immediately, then the media inserted later (by
+ * vlc_playlist_Insert() or by the expansion of an item) are inserted directly
+ * at their sorted position. Items whose metadata change once preparsed are
+ * moved to their new position.
+ *
+ * The mode is disabled by vlc_playlist_Move(), vlc_playlist_Shuffle() or
+ * vlc_playlist_Sort(), or by passing count == 0.
+ *
+ * \param playlist the playlist, locked
+ * \param criteria the sort criteria (in order)
+ * \param count    the number of criteria (0 to disable the mode)
+ * \return VLC_SUCCESS on success, another value on error
+ */
+VLC_API int
+vlc_playlist_SetKeepSorted(vlc_playlist_t *playlist,
+                           const struct vlc_playlist_sort_criterion criteria[],
+                           size_t count);
+
 /**
  * Return the index of a given item.
  *
@@ -870,6 +954,10 @@ vlc_playlist_Preparse(vlc_playlist_t *playlist, input_item_t *media);
 /**
  * Export the playlist to a file.
  *
+ * The export works on a snapshot of the playlist content: the playlist lock is
+ * released while the file is written, and acquired again before returning.
+ *
+ * \param playlist the playlist, locked
  * \param filename the location where the exported file will be saved
  * \param type the type of the playlist file to create (m3u, m3u8, xspf, ...)
  * \return VLC_SUCCESS on success, another value on error
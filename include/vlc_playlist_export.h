@@ -28,15 +28,15 @@
 /**
  * Opaque structure giving a read-only view of a playlist.
  *
- * The view is only valid until the playlist lock is released.
+ * The view is a snapshot of the playlist content, taken when the export
+ * starts. It is valid during the whole export, and does not require the
+ * playlist lock (the playlist is not locked while the module runs).
  */
 struct vlc_playlist_view;
 
 /**
  * Return the number of items in the view.
  *
- * The underlying playlist must be locked.
- *
  * \param view the playlist view
  */
 VLC_API size_t
@@ -47,8 +47,6 @@ vlc_playlist_view_Count(struct vlc_playlist_view *view);
  *
  * The index must be in range (less than vlc_playlist_view_Count()).
  *
- * The underlying playlist must be locked.
- *
  * \param view  the playlist view
  * \param index the index
  * \return the playlist item
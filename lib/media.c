@@ -703,6 +703,58 @@ bool libvlc_media_get_stats(libvlc_media_t *p_md,
     return true;
 }
 
+static void latency_stats_Convert(libvlc_latency_stats_t *dst,
+                                  const struct vlc_latency_histogram *src)
+{
+    dst->i_count = src->count;
+    dst->i_negative = src->negative;
+    dst->i_mean = src->count ? US_FROM_VLC_TICK(src->sum / src->count) : 0;
+    dst->i_p50 = US_FROM_VLC_TICK(vlc_latency_histogram_Percentile(src, 500));
+    dst->i_p90 = US_FROM_VLC_TICK(vlc_latency_histogram_Percentile(src, 900));
+    dst->i_p99 = US_FROM_VLC_TICK(vlc_latency_histogram_Percentile(src, 990));
+    dst->i_p999 = US_FROM_VLC_TICK(vlc_latency_histogram_Percentile(src, 999));
+}
+
+bool libvlc_media_get_latency(libvlc_media_t *p_md, libvlc_track_type_t type,
+                              libvlc_media_latency_t *p_latency)
+{
+    input_item_t *item = p_md->p_input_item;
+    const struct vlc_es_latency *latency;
+
+    if( item == NULL )
+        return false;
+
+    vlc_mutex_lock( &item->lock );
+
+    input_stats_t *p_itm_stats = item->p_stats;
+    if( p_itm_stats == NULL )
+    {
+        vlc_mutex_unlock( &item->lock );
+        return false;
+    }
+
+    switch( type )
+    {
+        case libvlc_track_audio:
+            latency = &p_itm_stats->audio_latency;
+            break;
+        case libvlc_track_video:
+            latency = &p_itm_stats->video_latency;
+            break;
+        default:
+            vlc_mutex_unlock( &item->lock );
+            return false;
+    }
+
+    latency_stats_Convert( &p_latency->queue, &latency->queue );
+    latency_stats_Convert( &p_latency->decode, &latency->decode );
+    latency_stats_Convert( &p_latency->output, &latency->output );
+    latency_stats_Convert( &p_latency->lateness, &latency->lateness );
+
+    vlc_mutex_unlock( &item->lock );
+    return true;
+}
+
 // Get event manager from a media descriptor object
 libvlc_event_manager_t *
 libvlc_media_event_manager( libvlc_media_t * p_md )
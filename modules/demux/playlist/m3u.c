@@ -243,7 +243,43 @@ static void entry_meta_Clean( struct entry_meta_s *e )
 
 static void parseEXTINF( char *, char *(*)(const char *), struct entry_meta_s * );
 
-static int CreateEntry( input_item_node_t *p_node, const struct entry_meta_s *meta )
+/* Entries are attached to the subtree node in batches, so that the children
+ * array of the node is not reallocated for every single entry. */
+#define ENTRY_BATCH_SIZE 256
+
+struct entry_batch_s
+{
+    input_item_node_t *p_node;
+    size_t i_items;
+    input_item_t *items[ENTRY_BATCH_SIZE];
+};
+
+static void entry_batch_Init( struct entry_batch_s *b, input_item_node_t *p_node )
+{
+    b->p_node = p_node;
+    b->i_items = 0;
+}
+
+static int entry_batch_Flush( struct entry_batch_s *b )
+{
+    int ret = input_item_node_AppendItems( b->p_node, b->items, b->i_items );
+
+    for( size_t i = 0; i < b->i_items; i++ )
+        input_item_Release( b->items[i] );
+    b->i_items = 0;
+    return ret;
+}
+
+static int entry_batch_Append( struct entry_batch_s *b, input_item_t *p_input )
+{
+    b->items[b->i_items++] = input_item_Hold( p_input );
+    if( b->i_items == ENTRY_BATCH_SIZE )
+        return entry_batch_Flush( b );
+    return VLC_SUCCESS;
+}
+
+static int CreateEntry( struct entry_batch_s *p_batch,
+                        const struct entry_meta_s *meta )
 {
     if( !meta->psz_mrl )
         return VLC_EGENERIC;
@@ -269,102 +305,193 @@ static int CreateEntry( input_item_node_t *p_node, const struct entry_meta_s *me
     if( meta->psz_grouptitle )
         input_item_SetAlbum( p_input, meta->psz_grouptitle );
 
-    input_item_node_AppendItem( p_node, p_input );
+    int ret = entry_batch_Append( p_batch, p_input );
     input_item_Release( p_input );
 
-    return VLC_SUCCESS;
+    return ret;
 }
 
-static int ReadDir( stream_t *p_demux, input_item_node_t *p_subitems )
+static void ParseLine( stream_t *p_demux, struct entry_batch_s *p_batch,
+                       struct entry_meta_s *meta,
+                       char *(*pf_dup) (const char *), char *psz_parse )
 {
-    char       *psz_line;
-    struct entry_meta_s meta;
-    entry_meta_Init( &meta );
-    char *    (*pf_dup) (const char *) = p_demux->p_sys;
+    /* Skip leading tabs and spaces */
+    while( *psz_parse == ' ' || *psz_parse == '\t' ||
+           *psz_parse == '\n' || *psz_parse == '\r' ) psz_parse++;
 
-    psz_line = vlc_stream_ReadLine( p_demux->s );
-    while( psz_line )
+    if( *psz_parse == '#' )
     {
-        char *psz_parse = psz_line;
+        /* Parse extra info */
 
         /* Skip leading tabs and spaces */
         while( *psz_parse == ' ' || *psz_parse == '\t' ||
-               *psz_parse == '\n' || *psz_parse == '\r' ) psz_parse++;
+               *psz_parse == '\n' || *psz_parse == '\r' ||
+               *psz_parse == '#' ) psz_parse++;
 
-        if( *psz_parse == '#' )
-        {
-            /* Parse extra info */
-
-            /* Skip leading tabs and spaces */
-            while( *psz_parse == ' ' || *psz_parse == '\t' ||
-                   *psz_parse == '\n' || *psz_parse == '\r' ||
-                   *psz_parse == '#' ) psz_parse++;
-
-            if( !*psz_parse ) goto nextline;
+        if( !*psz_parse ) return;
 
-            if( !strncasecmp( psz_parse, "EXTINF:", sizeof("EXTINF:") -1 ) )
-            {
-                /* Extended info */
-                psz_parse += sizeof("EXTINF:") - 1;
-                meta.i_duration = INPUT_DURATION_INDEFINITE;
-                parseEXTINF( psz_parse, pf_dup, &meta );
-            }
-            else if( !strncasecmp( psz_parse, "EXTVLCOPT:",
-                                   sizeof("EXTVLCOPT:") -1 ) )
-            {
-                /* VLC Option */
-                char *psz_option;
-                psz_parse += sizeof("EXTVLCOPT:") -1;
-                if( !*psz_parse ) goto nextline;
-
-                psz_option = pf_dup( psz_parse );
-                if( psz_option )
-                    TAB_APPEND( meta.i_options, meta.ppsz_options, psz_option );
-            }
-            /* Special case for jamendo which provide the albumart */
-            else if( !strncasecmp( psz_parse, "EXTALBUMARTURL:",
-                     sizeof( "EXTALBUMARTURL:" ) -1 ) )
-            {
-                psz_parse += sizeof( "EXTALBUMARTURL:" ) - 1;
-                if( *psz_parse )
-                {
-                    free( meta.psz_album_art );
-                    meta.psz_album_art = pf_dup( psz_parse );
-                }
-            }
+        if( !strncasecmp( psz_parse, "EXTINF:", sizeof("EXTINF:") -1 ) )
+        {
+            /* Extended info */
+            psz_parse += sizeof("EXTINF:") - 1;
+            meta->i_duration = INPUT_DURATION_INDEFINITE;
+            parseEXTINF( psz_parse, pf_dup, meta );
         }
-        else if( !strncasecmp( psz_parse, "RTSPtext", sizeof("RTSPtext") -1 ) )
+        else if( !strncasecmp( psz_parse, "EXTVLCOPT:",
+                               sizeof("EXTVLCOPT:") -1 ) )
         {
-            ;/* special case to handle QuickTime RTSPtext redirect files */
+            /* VLC Option */
+            char *psz_option;
+            psz_parse += sizeof("EXTVLCOPT:") -1;
+            if( !*psz_parse ) return;
+
+            psz_option = pf_dup( psz_parse );
+            if( psz_option )
+                TAB_APPEND( meta->i_options, meta->ppsz_options, psz_option );
         }
-        else if( *psz_parse )
+        /* Special case for jamendo which provide the albumart */
+        else if( !strncasecmp( psz_parse, "EXTALBUMARTURL:",
+                 sizeof( "EXTALBUMARTURL:" ) -1 ) )
         {
-            psz_parse = pf_dup( psz_parse );
-            if( !meta.psz_name && psz_parse )
-                /* Use filename as name for relative entries */
-                meta.psz_name = strdup( psz_parse );
+            psz_parse += sizeof( "EXTALBUMARTURL:" ) - 1;
+            if( *psz_parse )
+            {
+                free( meta->psz_album_art );
+                meta->psz_album_art = pf_dup( psz_parse );
+            }
+        }
+    }
+    else if( !strncasecmp( psz_parse, "RTSPtext", sizeof("RTSPtext") -1 ) )
+    {
+        ;/* special case to handle QuickTime RTSPtext redirect files */
+    }
+    else if( *psz_parse )
+    {
+        psz_parse = pf_dup( psz_parse );
+        if( !meta->psz_name && psz_parse )
+            /* Use filename as name for relative entries */
+            meta->psz_name = strdup( psz_parse );
 
-            meta.psz_mrl = ProcessMRL( psz_parse, p_demux->psz_url );
-            free( psz_parse );
+        meta->psz_mrl = ProcessMRL( psz_parse, p_demux->psz_url );
+        free( psz_parse );
 
-            CreateEntry( p_subitems, &meta );
+        CreateEntry( p_batch, meta );
 
-            /* Cleanup state after entry */
-            entry_meta_Clean( &meta );
-            entry_meta_Init( &meta );
-        }
+        /* Cleanup state after entry */
+        entry_meta_Clean( meta );
+        entry_meta_Init( meta );
+    }
+}
+
+/* Playlists bigger than this are read line by line */
+#define M3U_MAX_BUFFER_SIZE (64 << 20)
+
+static char *DupString( const char *str )
+{
+    return strdup( str );
+}
+
+/**
+ * Reads the remaining of the playlist in a single buffer.
+ *
+ * The stream must have a known size, and must not be UTF-16 (which is only
+ * handled by vlc_stream_ReadLine()).
+ *
+ * \return a nul-terminated buffer of *plen bytes, or NULL if the playlist
+ * must be read line by line.
+ */
+static char *ReadAll( stream_t *p_demux, size_t *restrict plen )
+{
+    uint64_t i_size;
+    uint64_t i_pos = vlc_stream_Tell( p_demux->s );
+    const uint8_t *p_peek;
+
+    if( vlc_stream_GetSize( p_demux->s, &i_size ) || i_size <= i_pos
+     || i_size - i_pos > M3U_MAX_BUFFER_SIZE )
+        return NULL;
+
+    if( i_pos == 0 && vlc_stream_Peek( p_demux->s, &p_peek, 2 ) == 2
+     && ( !memcmp( p_peek, "\xFF\xFE", 2 ) || !memcmp( p_peek, "\xFE\xFF", 2 ) ) )
+        return NULL;
+
+    size_t i_len = i_size - i_pos;
+    char *p_buf = malloc( i_len + 1 );
+    if( unlikely(p_buf == NULL) )
+        return NULL;
+
+    ssize_t i_read = vlc_stream_Read( p_demux->s, p_buf, i_len );
+    if( i_read < 0 )
+        i_read = 0; /* Treated as EOF, like vlc_stream_ReadLine() does */
 
- nextline:
-        /* Fetch another line */
-        free( psz_line );
-        psz_line = vlc_stream_ReadLine( p_demux->s );
-        if( !psz_line )
+    p_buf[i_read] = '\0';
+    *plen = i_read;
+    return p_buf;
+}
+
+static void ReadBuffer( stream_t *p_demux, struct entry_batch_s *p_batch,
+                        char *(*pf_dup) (const char *),
+                        char *p_buf, size_t i_len )
+{
+    struct entry_meta_s meta;
+    entry_meta_Init( &meta );
+
+    /* The whole playlist is valid UTF-8: no need to check each string */
+    if( memchr( p_buf, '\0', i_len ) == NULL && IsUTF8( p_buf ) != NULL )
+        pf_dup = DupString;
+
+    /* Old Mac OS files only use CR as line terminator */
+    const int i_eol = memchr( p_buf, '\n', i_len ) ? '\n' : '\r';
+    char *p_end = p_buf + i_len;
+
+    for( char *psz_line = p_buf; psz_line < p_end; )
+    {
+        char *psz_eol = memchr( psz_line, i_eol, p_end - psz_line );
+        if( psz_eol == NULL )
+            psz_eol = p_end;
+
+        /* Remove trailing LF/CR, and terminate the line in place */
+        char *psz_last = psz_eol;
+        while( psz_last > psz_line &&
+               ( psz_last[-1] == '\r' || psz_last[-1] == '\n' ) )
+            psz_last--;
+        *psz_last = '\0';
+
+        ParseLine( p_demux, p_batch, &meta, pf_dup, psz_line );
+        psz_line = psz_eol + 1;
+    }
+
+    entry_meta_Clean( &meta );
+}
+
+static int ReadDir( stream_t *p_demux, input_item_node_t *p_subitems )
+{
+    char *    (*pf_dup) (const char *) = p_demux->p_sys;
+    struct entry_batch_s batch;
+    size_t i_len;
+
+    entry_batch_Init( &batch, p_subitems );
+
+    char *p_buf = ReadAll( p_demux, &i_len );
+    if( p_buf != NULL )
+    {
+        ReadBuffer( p_demux, &batch, pf_dup, p_buf, i_len );
+        free( p_buf );
+    }
+    else
+    {
+        struct entry_meta_s meta;
+        char *psz_line;
+
+        entry_meta_Init( &meta );
+        while( ( psz_line = vlc_stream_ReadLine( p_demux->s ) ) != NULL )
         {
-            /* Cleanup state */
-            entry_meta_Clean( &meta );
-            entry_meta_Init( &meta );
+            ParseLine( p_demux, &batch, &meta, pf_dup, psz_line );
+            free( psz_line );
         }
+        entry_meta_Clean( &meta );
     }
+
+    entry_batch_Flush( &batch );
     return VLC_SUCCESS; /* Needed for correct operation of go back */
 }
 
@@ -723,6 +723,7 @@ int D3D11OpenConverter( vlc_object_t *obj )
 
     if (CopyInitCache(&p_sys->cache, p_filter->fmt_in.video.i_width * pixel_bytes))
         return VLC_ENOMEM;
+    CopySetThreads(&p_sys->cache, var_InheritInteger(p_filter, "copy-threads"));
 
     vlc_mutex_init(&p_sys->staging_lock);
     p_filter->p_sys = p_sys;
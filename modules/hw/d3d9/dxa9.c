@@ -428,6 +428,7 @@ int D3D9OpenConverter( vlc_object_t *obj )
         free(p_sys);
         return VLC_ENOMEM;
     }
+    CopySetThreads(&p_sys->cache, var_InheritInteger(p_filter, "copy-threads"));
 
     p_filter->p_sys = p_sys;
     return VLC_SUCCESS;
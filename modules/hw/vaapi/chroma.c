@@ -393,6 +393,7 @@ vlc_vaapi_OpenChroma(vlc_object_t *obj)
         free(filter_sys);
         return VLC_EGENERIC;
     }
+    CopySetThreads(&filter_sys->cache, var_InheritInteger(obj, "copy-threads"));
 
     filter->p_sys = filter_sys;
     msg_Warn(obj, "Using SW chroma filter for %dx%d %4.4s -> %4.4s",
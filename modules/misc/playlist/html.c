@@ -52,21 +52,26 @@ static void DoExport( struct vlc_playlist_export *p_export )
 
         input_item_t *media = vlc_playlist_item_GetMedia(item);
 
+        /* encode the fields in place, without intermediate copies */
+        vlc_mutex_lock( &media->lock );
+
         char* psz_name = NULL;
-        char *psz_tmp = input_item_GetName(media);
-        if( psz_tmp )
-            psz_name = vlc_xml_encode( psz_tmp );
-        free( psz_tmp );
+        if( media->psz_name )
+            psz_name = vlc_xml_encode( media->psz_name );
+
+        char* psz_artist = NULL;
+        const char *psz_tmp = input_item_GetMetaLocked( media, vlc_meta_Artist );
+        if( psz_name && psz_tmp )
+            psz_artist = vlc_xml_encode( psz_tmp );
+
+        vlc_tick_t i_duration = media->i_duration;
+
+        vlc_mutex_unlock( &media->lock );
 
         if( psz_name )
         {
-            char* psz_artist = NULL;
-            psz_tmp = input_item_GetArtist(media);
-            if( psz_tmp )
-                psz_artist = vlc_xml_encode( psz_tmp );
-            free( psz_tmp );
-
-            vlc_tick_t i_duration = input_item_GetDuration(media);
+            if( i_duration == INPUT_DURATION_INDEFINITE )
+                i_duration = 0;
             int min = SEC_FROM_VLC_TICK( i_duration ) / 60;
             int sec = SEC_FROM_VLC_TICK( i_duration ) - min * 60;
 
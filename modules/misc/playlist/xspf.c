@@ -39,14 +39,79 @@
 
 int xspf_export_playlist( vlc_object_t *p_this );
 
-static char *input_xml( input_item_t *p_item, char *(*func)(input_item_t *) )
+/**
+ * \brief checks whether a string only contains printable ASCII characters
+ *
+ * For such strings, XML escaping is a plain substitution of a few characters,
+ * and no UTF-8 decoding is needed. The check is done a word at a time.
+ */
+static bool is_plain_ascii( const char *str, size_t len )
+{
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+
+    size_t i = 0;
+    for( ; i + 8 <= len; i += 8 )
+    {
+        uint64_t word;
+        memcpy( &word, &str[i], sizeof(word) );
+        /* any byte >= 0x80, or any byte < 0x20 */
+        if( (word & highs) || ((word - ones * 0x20) & ~word & highs) )
+            return false;
+    }
+    for( ; i < len; i++ )
+    {
+        unsigned char c = str[i];
+        if( c < 0x20 || c >= 0x80 )
+            return false;
+    }
+    return true;
+}
+
+/**
+ * \brief writes an XML element, with its value escaped
+ *
+ * The value is written directly to the file, without intermediate copies.
+ * Non-ASCII or control characters are handled by vlc_xml_encode(). The
+ * element is skipped if the value is not valid UTF-8.
+ */
+static void xspf_export_element( FILE *p_file, const char *psz_indent,
+                                 const char *psz_tag, const char *psz_value )
 {
-    char *tmp = func( p_item );
-    if( tmp == NULL )
-        return NULL;
-    char *ret = vlc_xml_encode( tmp );
-    free( tmp );
-    return ret;
+    size_t len = strlen( psz_value );
+    if( !is_plain_ascii( psz_value, len ) )
+    {
+        char *psz_enc = vlc_xml_encode( psz_value );
+        if( psz_enc == NULL )
+            return;
+        fprintf( p_file, "%s<%s>%s</%s>\n", psz_indent, psz_tag, psz_enc,
+                 psz_tag );
+        free( psz_enc );
+        return;
+    }
+
+    fprintf( p_file, "%s<%s>", psz_indent, psz_tag );
+    for( ;; )
+    {
+        size_t n = strcspn( psz_value, "\"&'<>" );
+        fwrite( psz_value, 1, n, p_file );
+        psz_value += n;
+        if( *psz_value == '\0' )
+            break;
+
+        const char *psz_entity;
+        switch( *psz_value )
+        {
+            case '"':  psz_entity = "&quot;"; break;
+            case '&':  psz_entity = "&amp;";  break;
+            case '\'': psz_entity = "&#39;";  break;
+            case '<':  psz_entity = "&lt;";   break;
+            default:   psz_entity = "&gt;";   break;
+        }
+        fputs( psz_entity, p_file );
+        psz_value++;
+    }
+    fprintf( p_file, "</%s>\n", psz_tag );
 }
 
 /**
@@ -57,23 +122,23 @@ static char *input_xml( input_item_t *p_item, char *(*func)(input_item_t *) )
  */
 static void xspf_export_item( input_item_t *p_input, FILE *p_file, uint64_t id)
 {
-    char *psz;
-    vlc_tick_t i_duration;
+    const char *psz;
 
     fputs( "\t\t<track>\n", p_file );
 
+    /* read the fields in place, instead of copying each of them */
+    vlc_mutex_lock( &p_input->lock );
+
     /* -> the location */
 
-    char *psz_uri = input_xml( p_input, input_item_GetURI );
+    const char *psz_uri = p_input->psz_uri;
     if( psz_uri && *psz_uri )
-        fprintf( p_file, "\t\t\t<location>%s</location>\n", psz_uri );
+        xspf_export_element( p_file, "\t\t\t", "location", psz_uri );
 
     /* -> the name/title (only if different from uri)*/
-    psz = input_xml( p_input, input_item_GetTitle );
-    if( psz && strcmp( psz_uri, psz ) )
-        fprintf( p_file, "\t\t\t<title>%s</title>\n", psz );
-    free( psz );
-    free( psz_uri );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_Title );
+    if( psz && (!psz_uri || strcmp( psz_uri, psz )) )
+        xspf_export_element( p_file, "\t\t\t", "title", psz );
 
     if( p_input->p_meta == NULL )
     {
@@ -81,50 +146,42 @@ static void xspf_export_item( input_item_t *p_input, FILE *p_file, uint64_t id)
     }
 
     /* -> the artist/creator */
-    psz = input_xml( p_input, input_item_GetArtist );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_Artist );
     if( psz && *psz )
-        fprintf( p_file, "\t\t\t<creator>%s</creator>\n", psz );
-    free( psz );
+        xspf_export_element( p_file, "\t\t\t", "creator", psz );
 
     /* -> the album */
-    psz = input_xml( p_input, input_item_GetAlbum );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_Album );
     if( psz && *psz )
-        fprintf( p_file, "\t\t\t<album>%s</album>\n", psz );
-    free( psz );
+        xspf_export_element( p_file, "\t\t\t", "album", psz );
 
     /* -> the track number */
-    psz = input_xml( p_input, input_item_GetTrackNum );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_TrackNumber );
     if( psz )
     {
         int i_tracknum = atoi( psz );
-
-        free( psz );
         if( i_tracknum > 0 )
             fprintf( p_file, "\t\t\t<trackNum>%i</trackNum>\n", i_tracknum );
     }
 
     /* -> the description */
-    psz = input_xml( p_input, input_item_GetDescription );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_Description );
     if( psz && *psz )
-        fprintf( p_file, "\t\t\t<annotation>%s</annotation>\n", psz );
-    free( psz );
+        xspf_export_element( p_file, "\t\t\t", "annotation", psz );
 
-    psz = input_xml( p_input, input_item_GetURL );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_URL );
     if( psz && *psz )
-        fprintf( p_file, "\t\t\t<info>%s</info>\n", psz );
-    free( psz );
+        xspf_export_element( p_file, "\t\t\t", "info", psz );
 
-    psz = input_xml( p_input, input_item_GetArtURL );
+    psz = input_item_GetMetaLocked( p_input, vlc_meta_ArtworkURL );
     if( psz && *psz )
-        fprintf( p_file, "\t\t\t<image>%s</image>\n", psz );
-    free( psz );
+        xspf_export_element( p_file, "\t\t\t", "image", psz );
 
 xspfexportitem_end:
     /* -> the duration */
-    i_duration = input_item_GetDuration( p_input );
-    if( i_duration > 0 )
+    if( p_input->i_duration > 0 )
         fprintf( p_file, "\t\t\t<duration>%"PRIu64"</duration>\n",
-                 MS_FROM_VLC_TICK(i_duration) );
+                 MS_FROM_VLC_TICK(p_input->i_duration) );
 
     /* export the intenal id and the input's options (bookmarks, ...)
      * in <extension> */
@@ -136,19 +193,16 @@ xspfexportitem_end:
 
     for( int i = 0; i < p_input->i_options; i++ )
     {
-        char* psz_src = p_input->ppsz_options[i];
-        char* psz_ret = NULL;
+        const char* psz_src = p_input->ppsz_options[i];
 
         if ( psz_src[0] == ':' )
             psz_src++;
 
-        psz_ret = vlc_xml_encode( psz_src );
-        if ( psz_ret == NULL )
-            continue;
-
-        fprintf( p_file, "\t\t\t\t<vlc:option>%s</vlc:option>\n", psz_ret );
-        free( psz_ret );
+        xspf_export_element( p_file, "\t\t\t\t", "vlc:option", psz_src );
     }
+
+    vlc_mutex_unlock( &p_input->lock );
+
     fputs( "\t\t\t</extension>\n", p_file );
     fputs( "\t\t</track>\n", p_file );
 }
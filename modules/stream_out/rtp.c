@@ -311,6 +311,9 @@ typedef struct rtp_sink_t
     rtcp_sender_t *rtcp;
 } rtp_sink_t;
 
+/* Packets waiting for their send date: several seconds at high bit rates */
+#define RTP_QUEUE_SIZE 16384
+
 struct sout_stream_id_sys_t
 {
     sout_stream_t *p_stream;
@@ -346,7 +349,8 @@ struct sout_stream_id_sys_t
         vlc_thread_t  thread;
     } listen;
 
-    block_fifo_t     *p_fifo;
+    vlc_spsc_fifo_t  *p_fifo;
+    unsigned          i_dropped; /**< Packets dropped in the current burst */
     vlc_tick_t        i_caching;
 };
 
@@ -915,6 +919,7 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     id->sinkv = NULL;
     id->rtsp_id = NULL;
     id->p_fifo = NULL;
+    id->i_dropped = 0;
     id->listen.fd = NULL;
 
     id->b_first_packet = true;
@@ -1099,12 +1104,13 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         id->rtsp_id = RtspAddId( p_sys->rtsp, id, GetDWBE( id->ssrc ),
                                  id->rtp_fmt.clock_rate, mcast_fd );
 
-    id->p_fifo = block_FifoNew();
+    /* The packetizer is the only producer and ThreadSend the only consumer */
+    id->p_fifo = vlc_spsc_fifo_New( RTP_QUEUE_SIZE );
     if( unlikely(id->p_fifo == NULL) )
         goto error;
     if( vlc_clone( &id->thread, ThreadSend, id, VLC_THREAD_PRIORITY_HIGHEST ) )
     {
-        block_FifoRelease( id->p_fifo );
+        vlc_spsc_fifo_Delete( id->p_fifo );
         id->p_fifo = NULL;
         goto error;
     }
@@ -1147,7 +1153,7 @@ static void Del( sout_stream_t *p_stream, void *_id )
     {
         vlc_cancel( id->thread );
         vlc_join( id->thread, NULL );
-        block_FifoRelease( id->p_fifo );
+        vlc_spsc_fifo_Delete( id->p_fifo );
     }
 
     free( id->rtp_fmt.fmtp );
@@ -1317,7 +1323,7 @@ static void* ThreadSend( void *data )
 
     for (;;)
     {
-        block_t *out = block_FifoGet( id->p_fifo );
+        block_t *out = vlc_spsc_fifo_Dequeue( id->p_fifo );
         block_cleanup_push (out);
 
 #ifdef HAVE_SRTP
@@ -1549,7 +1555,23 @@ uint16_t rtp_get_extended_sequence( sout_stream_id_sys_t *id )
 
 void rtp_packetize_send( sout_stream_id_sys_t *id, block_t *out )
 {
-    block_FifoPut( id->p_fifo, out );
+    /* Never block the muxing thread on a slow or stalled sender: drop the
+     * packet instead, as the network would. Only the sender thread dequeues,
+     * so the count cannot grow between the check and the queuing. */
+    if( vlc_spsc_fifo_GetCount( id->p_fifo ) >= RTP_QUEUE_SIZE )
+    {
+        /* Warn once per burst of drops, not for every packet */
+        if( id->i_dropped++ == 0 )
+            msg_Warn( id->p_stream, "send queue full, dropping packets" );
+        block_ChainRelease( out );
+        return;
+    }
+    if( id->i_dropped > 0 )
+    {
+        msg_Warn( id->p_stream, "dropped %u packets", id->i_dropped );
+        id->i_dropped = 0;
+    }
+    vlc_spsc_fifo_Queue( id->p_fifo, out );
 }
 
 /**
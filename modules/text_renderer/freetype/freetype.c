@@ -110,6 +110,13 @@ static void Destroy( vlc_object_t * );
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
 
 
+#define GLYPH_CACHE_TEXT N_("Glyph cache size")
+#define GLYPH_CACHE_LONGTEXT N_("Maximum memory used to keep rendered " \
+  "glyphs across subtitles, in KiB. 0 disables the cache." )
+#define LAYOUT_CACHE_TEXT N_("Layout cache size")
+#define LAYOUT_CACHE_LONGTEXT N_("Maximum memory used to keep laid out " \
+  "text across subtitles, in KiB. 0 disables the cache." )
+
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
@@ -211,6 +218,11 @@ vlc_module_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer_with_range( "freetype-glyph-cache", 4096, 0, 262144,
+                            GLYPH_CACHE_TEXT, GLYPH_CACHE_LONGTEXT, true )
+    add_integer_with_range( "freetype-layout-cache", 2048, 0, 262144,
+                            LAYOUT_CACHE_TEXT, LAYOUT_CACHE_LONGTEXT, true )
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1519,6 +1531,8 @@ static int Create( vlc_object_t *p_this )
         goto error;
     }
 
+    CreateLayoutCaches( p_filter );
+
     p_filter->pf_render = Render;
 
     return VLC_SUCCESS;
@@ -1553,6 +1567,9 @@ static void Destroy( vlc_object_t *p_this )
     DumpDictionary( p_filter, &p_sys->fallback_map, true, -1 );
 #endif
 
+    /* Caches, referencing faces and holding glyphs */
+    DeleteLayoutCaches( p_filter );
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
@@ -72,6 +72,7 @@ typedef uint32_t uni_char_t;
  * It describes the freetype specific properties of an output thread.
  *****************************************************************************/
 typedef struct vlc_family_t vlc_family_t;
+typedef struct render_cache_t render_cache_t;
 typedef struct
 {
     FT_Library     p_library;       /* handle to library     */
@@ -112,6 +113,12 @@ typedef struct
 
     int               i_fallback_counter;
 
+    /** Rendered glyphs cache, keyed by face, glyph, style and position */
+    render_cache_t   *p_glyph_cache;
+
+    /** Laid out text cache, keyed by text and style */
+    render_cache_t   *p_layout_cache;
+
     /* Current scaling of the text, default is 100 (%) */
     int               i_scale;
 
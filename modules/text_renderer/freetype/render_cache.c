@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * render_cache.c : Memory bounded LRU cache for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_list.h>
+
+#include "render_cache.h"
+
+typedef struct render_cache_entry_t render_cache_entry_t;
+
+struct render_cache_entry_t
+{
+    struct vlc_list       node;      /* in the LRU list */
+    render_cache_entry_t *p_next;    /* in the hash bucket */
+    uint32_t              i_hash;
+    size_t                i_size;    /* accounted size of the entry */
+    void                 *p_value;
+    size_t                i_key;
+    unsigned char         key[];
+};
+
+struct render_cache_t
+{
+    void                (*pf_release)( void * );
+    render_cache_entry_t **pp_buckets;
+    size_t                i_buckets; /* power of two */
+    size_t                i_entries;
+    size_t                i_size;
+    size_t                i_max_size;
+    struct vlc_list       lru;       /* most recently used first */
+
+    /* Statistics */
+    uint64_t              i_hits;
+    uint64_t              i_misses;
+    uint64_t              i_evictions;
+};
+
+/* FNV-1a */
+static uint32_t Hash( const void *p_key, size_t i_key )
+{
+    const unsigned char *p = p_key;
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619u;
+    return i_hash;
+}
+
+render_cache_t *RenderCacheNew( size_t i_max_size,
+                                void (*pf_release)( void *p_value ) )
+{
+    render_cache_t *p_cache = malloc( sizeof( *p_cache ) );
+    if( unlikely(!p_cache) )
+        return NULL;
+
+    p_cache->i_buckets = 64;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof( *p_cache->pp_buckets ) );
+    if( unlikely(!p_cache->pp_buckets) )
+    {
+        free( p_cache );
+        return NULL;
+    }
+
+    p_cache->pf_release = pf_release;
+    p_cache->i_entries = 0;
+    p_cache->i_size = 0;
+    p_cache->i_max_size = i_max_size;
+    vlc_list_init( &p_cache->lru );
+    p_cache->i_hits = 0;
+    p_cache->i_misses = 0;
+    p_cache->i_evictions = 0;
+    return p_cache;
+}
+
+static void RemoveEntry( render_cache_t *p_cache, render_cache_entry_t *p_entry )
+{
+    render_cache_entry_t **pp =
+        &p_cache->pp_buckets[ p_entry->i_hash & (p_cache->i_buckets - 1) ];
+
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    vlc_list_remove( &p_entry->node );
+    p_cache->i_entries--;
+    p_cache->i_size -= p_entry->i_size;
+
+    p_cache->pf_release( p_entry->p_value );
+    free( p_entry );
+}
+
+void RenderCacheDelete( render_cache_t *p_cache )
+{
+    render_cache_entry_t *p_entry;
+
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+    {
+        p_cache->pf_release( p_entry->p_value );
+        free( p_entry );
+    }
+
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+static render_cache_entry_t *FindEntry( render_cache_t *p_cache,
+                                        const void *p_key, size_t i_key,
+                                        uint32_t i_hash )
+{
+    for( render_cache_entry_t *p_entry =
+             p_cache->pp_buckets[ i_hash & (p_cache->i_buckets - 1) ];
+         p_entry != NULL; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key
+         && !memcmp( p_entry->key, p_key, i_key ) )
+            return p_entry;
+    }
+    return NULL;
+}
+
+void *RenderCacheGet( render_cache_t *p_cache,
+                      const void *p_key, size_t i_key )
+{
+    render_cache_entry_t *p_entry =
+        FindEntry( p_cache, p_key, i_key, Hash( p_key, i_key ) );
+
+    if( p_entry == NULL )
+    {
+        p_cache->i_misses++;
+        return NULL;
+    }
+
+    vlc_list_remove( &p_entry->node );
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->i_hits++;
+    return p_entry->p_value;
+}
+
+static void Grow( render_cache_t *p_cache )
+{
+    const size_t i_buckets = p_cache->i_buckets * 2;
+    render_cache_entry_t **pp_buckets = calloc( i_buckets,
+                                                sizeof( *pp_buckets ) );
+    if( unlikely(!pp_buckets) )
+        return; /* keep the longer chains */
+
+    for( size_t i = 0; i < p_cache->i_buckets; i++ )
+        for( render_cache_entry_t *p_entry = p_cache->pp_buckets[i], *p_next;
+             p_entry != NULL; p_entry = p_next )
+        {
+            render_cache_entry_t **pp =
+                &pp_buckets[ p_entry->i_hash & (i_buckets - 1) ];
+
+            p_next = p_entry->p_next;
+            p_entry->p_next = *pp;
+            *pp = p_entry;
+        }
+
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+bool RenderCachePut( render_cache_t *p_cache, const void *p_key, size_t i_key,
+                     void *p_value, size_t i_size )
+{
+    i_size += sizeof( render_cache_entry_t ) + i_key;
+    if( i_size > p_cache->i_max_size )
+        return false;
+
+    render_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( unlikely(!p_entry) )
+        return false;
+
+    const uint32_t i_hash = Hash( p_key, i_key );
+    render_cache_entry_t *p_old = FindEntry( p_cache, p_key, i_key, i_hash );
+    if( p_old != NULL )
+        RemoveEntry( p_cache, p_old );
+
+    while( p_cache->i_size + i_size > p_cache->i_max_size )
+    {
+        render_cache_entry_t *p_last =
+            vlc_list_last_entry_or_null( &p_cache->lru, render_cache_entry_t,
+                                         node );
+        RemoveEntry( p_cache, p_last );
+        p_cache->i_evictions++;
+    }
+
+    if( p_cache->i_entries >= p_cache->i_buckets )
+        Grow( p_cache );
+
+    p_entry->i_hash = i_hash;
+    p_entry->i_size = i_size;
+    p_entry->p_value = p_value;
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    render_cache_entry_t **pp =
+        &p_cache->pp_buckets[ p_entry->i_hash & (p_cache->i_buckets - 1) ];
+    p_entry->p_next = *pp;
+    *pp = p_entry;
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->i_entries++;
+    p_cache->i_size += i_size;
+    return true;
+}
+
+void RenderCacheDumpStats( vlc_object_t *p_obj, const render_cache_t *p_cache,
+                           const char *psz_name )
+{
+    const uint64_t i_lookups = p_cache->i_hits + p_cache->i_misses;
+
+    msg_Dbg( p_obj, "%s cache: %"PRIu64" lookups, %.1f%% hits, "
+             "%"PRIu64" evictions, %zu entries, %zu/%zu KiB",
+             psz_name, i_lookups,
+             i_lookups ? 100. * p_cache->i_hits / i_lookups : 0.,
+             p_cache->i_evictions, p_cache->i_entries,
+             p_cache->i_size / 1024, p_cache->i_max_size / 1024 );
+}
@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * render_cache.h : Memory bounded LRU cache for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_RENDER_CACHE_H
+#define VLC_FREETYPE_RENDER_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache of rendering results, keyed by byte strings.
+ *
+ * The cache owns the values inserted into it, and releases them when they
+ * are evicted to keep the total size of the entries below the limit, or
+ * when the cache is deleted. Values returned by RenderCacheGet() remain
+ * valid until the next call to RenderCachePut().
+ */
+
+typedef struct render_cache_t render_cache_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max_size maximum total size of the entries, in bytes
+ * \param pf_release callback releasing a value
+ * \return the cache, or NULL on error
+ */
+render_cache_t *RenderCacheNew( size_t i_max_size,
+                                void (*pf_release)( void *p_value ) );
+
+/**
+ * Releases all values and deletes the cache.
+ */
+void RenderCacheDelete( render_cache_t *p_cache );
+
+/**
+ * Looks a value up, and marks it as the most recently used one.
+ *
+ * \return the value, or NULL if the key is not in the cache
+ */
+void *RenderCacheGet( render_cache_t *p_cache,
+                      const void *p_key, size_t i_key );
+
+/**
+ * Inserts a value, evicting the least recently used ones as needed.
+ *
+ * If the key is in the cache already, its previous value is released and
+ * replaced.
+ *
+ * \param i_size approximate memory usage of the value, in bytes
+ * \return true if the cache took ownership of the value, false if the
+ * value is too large or on memory error
+ */
+bool RenderCachePut( render_cache_t *p_cache, const void *p_key, size_t i_key,
+                     void *p_value, size_t i_size );
+
+/**
+ * Prints the hit rate and memory usage of the cache.
+ */
+void RenderCacheDumpStats( vlc_object_t *p_obj, const render_cache_t *p_cache,
+                           const char *psz_name );
+
+/** @} */
+
+#endif
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * render_cache_test.c : Test of the text renderer LRU cache
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "render_cache.h"
+
+const char vlc_module_name[] = "test_render_cache";
+
+/* Sizes of the values, large enough to dwarf the entry overhead */
+#define VALUE_SIZE 1000
+
+struct value
+{
+    unsigned releases;
+};
+
+static void Release( void *p_value )
+{
+    struct value *p = p_value;
+
+    p->releases++;
+}
+
+static void *Get( render_cache_t *p_cache, const char *psz_key )
+{
+    return RenderCacheGet( p_cache, psz_key, strlen( psz_key ) );
+}
+
+static bool Put( render_cache_t *p_cache, const char *psz_key,
+                 struct value *p_value, size_t i_size )
+{
+    return RenderCachePut( p_cache, psz_key, strlen( psz_key ), p_value,
+                           i_size );
+}
+
+static void test_lru( void )
+{
+    struct value a = { 0 }, b = { 0 }, c = { 0 }, a2 = { 0 }, big = { 0 };
+
+    /* Room for two values and their entries */
+    render_cache_t *p_cache = RenderCacheNew( 5 * VALUE_SIZE / 2, Release );
+    assert( p_cache != NULL );
+
+    assert( Get( p_cache, "a" ) == NULL );
+    assert( Put( p_cache, "a", &a, VALUE_SIZE ) );
+    assert( Put( p_cache, "b", &b, VALUE_SIZE ) );
+    assert( Get( p_cache, "a" ) == &a );
+    assert( Get( p_cache, "b" ) == &b );
+
+    /* Keys are compared on their whole length */
+    assert( Get( p_cache, "" ) == NULL );
+    assert( Get( p_cache, "ab" ) == NULL );
+
+    /* "a" becomes the most recently used value: "b" is evicted */
+    assert( Get( p_cache, "a" ) == &a );
+    assert( Put( p_cache, "c", &c, VALUE_SIZE ) );
+    assert( b.releases == 1 );
+    assert( a.releases == 0 && c.releases == 0 );
+    assert( Get( p_cache, "b" ) == NULL );
+    assert( Get( p_cache, "a" ) == &a );
+    assert( Get( p_cache, "c" ) == &c );
+
+    /* A value larger than the cache is refused, and nothing is evicted */
+    assert( !Put( p_cache, "big", &big, 3 * VALUE_SIZE ) );
+    assert( big.releases == 0 );
+    assert( Get( p_cache, "a" ) == &a );
+    assert( Get( p_cache, "c" ) == &c );
+
+    /* Replacing a value releases the previous one, and only that one, even
+     * if it is the most recently used */
+    assert( Get( p_cache, "a" ) == &a );
+    assert( Put( p_cache, "a", &a2, VALUE_SIZE ) );
+    assert( a.releases == 1 );
+    assert( c.releases == 0 );
+    assert( Get( p_cache, "a" ) == &a2 );
+    assert( Get( p_cache, "c" ) == &c );
+
+    /* Deleting the cache releases the remaining values */
+    RenderCacheDelete( p_cache );
+    assert( a.releases == 1 && b.releases == 1 );
+    assert( a2.releases == 1 && c.releases == 1 );
+    assert( big.releases == 0 );
+}
+
+static void test_many( unsigned count )
+{
+    struct value values[count], fresh[count];
+    char key[16];
+
+    memset( values, 0, sizeof( values ) );
+    memset( fresh, 0, sizeof( fresh ) );
+
+    /* Room for all the values: the hash table grows */
+    render_cache_t *p_cache = RenderCacheNew( count * 2 * VALUE_SIZE,
+                                              Release );
+    assert( p_cache != NULL );
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        snprintf( key, sizeof( key ), "%u", i );
+        assert( Put( p_cache, key, &values[i], VALUE_SIZE ) );
+    }
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        snprintf( key, sizeof( key ), "%u", i );
+        assert( Get( p_cache, key ) == &values[i] );
+        assert( values[i].releases == 0 );
+    }
+
+    /* New values, larger than the whole cache together: all the old ones are
+     * evicted before any new one */
+    for( unsigned i = 0; i < count; i++ )
+    {
+        snprintf( key, sizeof( key ), "new%u", i );
+        assert( Put( p_cache, key, &fresh[i], 2 * VALUE_SIZE ) );
+    }
+    for( unsigned i = 0; i < count; i++ )
+    {
+        snprintf( key, sizeof( key ), "%u", i );
+        assert( Get( p_cache, key ) == NULL );
+        assert( values[i].releases == 1 );
+    }
+    snprintf( key, sizeof( key ), "new%u", count - 1 );
+    assert( Get( p_cache, key ) == &fresh[count - 1] );
+
+    RenderCacheDelete( p_cache );
+    for( unsigned i = 0; i < count; i++ )
+        assert( values[i].releases == 1 && fresh[i].releases == 1 );
+}
+
+int main( void )
+{
+    test_lru();
+    test_many( 3 );
+    test_many( 1000 );
+    return 0;
+}
@@ -41,6 +41,7 @@
 #include <vlc_common.h>
 #include <vlc_filter.h>
 #include <vlc_text_style.h>
+#include <vlc_memstream.h>
 
 /* Freetype */
 #include <ft2build.h>
@@ -64,8 +65,10 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "render_cache.h"
 
 #include <stdlib.h>
+#include <assert.h>
 
 /* Win32 */
 #ifdef _WIN32
@@ -131,6 +134,12 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+
+    /* Glyph cache key, valid if p_face is set */
+    FT_Face  p_face;
+    FT_UInt  i_glyph_index;
+    FT_Fixed i_stroke_radius;
+    int      i_synthetic;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -163,17 +172,23 @@ typedef struct paragraph_t
 
 } paragraph_t;
 
+static void ReleaseCachedLayout( void *p_value );
+
 static void FreeLine( line_desc_t *p_line )
 {
-    for( int i = 0; i < p_line->i_character_count; i++ )
-    {
-        line_character_t *ch = &p_line->p_character[i];
-        FT_Done_Glyph( (FT_Glyph)ch->p_glyph );
-        if( ch->p_outline )
-            FT_Done_Glyph( (FT_Glyph)ch->p_outline );
-        if( ch->p_shadow )
-            FT_Done_Glyph( (FT_Glyph)ch->p_shadow );
-    }
+    /* Shared glyphs are freed with the last reference to their owner */
+    if( p_line->p_glyphs_owner )
+        ReleaseCachedLayout( p_line->p_glyphs_owner );
+    else
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            line_character_t *ch = &p_line->p_character[i];
+            FT_Done_Glyph( (FT_Glyph)ch->p_glyph );
+            if( ch->p_outline )
+                FT_Done_Glyph( (FT_Glyph)ch->p_outline );
+            if( ch->p_shadow )
+                FT_Done_Glyph( (FT_Glyph)ch->p_shadow );
+        }
 
 //    if( p_line->p_ruby )
 //        FreeLine( p_line->p_ruby );
@@ -206,6 +221,7 @@ line_desc_t *NewLine( int i_count )
     p_line->i_character_count = 0;
     p_line->i_first_visible_char_index = -1;
     p_line->i_last_visible_char_index = -2;
+    p_line->p_glyphs_owner = NULL;
 
     BBoxInit( &p_line->bbox );
 
@@ -997,6 +1013,230 @@ static int ZeroNsmAdvance( paragraph_t *p_paragraph )
 #endif
 #endif
 
+/*
+ * Glyph cache
+ *
+ * Loaded (and stroked) outlines, and the bitmaps rendered from them, are kept
+ * across calls. Faces are never unloaded before the module is destroyed, and
+ * each face has a fixed size, so the face pointer identifies the font and its
+ * size.
+ */
+#define GLYPH_EMBOLDEN  0x01
+#define GLYPH_OBLIQUE   0x02
+#define GLYPH_STROKED   0x04
+
+enum
+{
+    GLYPH_CACHE_LOADED,         /* glyph and outline, with the advance */
+    GLYPH_CACHE_GLYPH_BITMAP,
+    GLYPH_CACHE_OUTLINE_BITMAP,
+};
+
+typedef struct
+{
+    FT_Face  p_face;
+    FT_UInt  i_glyph_index;
+    FT_Fixed i_stroke_radius;
+    uint8_t  i_synthetic;
+    uint8_t  i_type;
+    uint8_t  i_origin_x;        /* subpixel origin of the bitmaps */
+    uint8_t  i_origin_y;
+} glyph_cache_key_t;
+
+typedef struct
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;
+    FT_Vector advance;
+} cached_glyph_t;
+
+static void GlyphCacheKey( glyph_cache_key_t *p_key,
+                           const glyph_bitmaps_t *p_bitmaps, int i_type,
+                           const FT_Vector *p_origin )
+{
+    /* The key is compared as bytes, clear the padding */
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->p_face = p_bitmaps->p_face;
+    p_key->i_glyph_index = p_bitmaps->i_glyph_index;
+    p_key->i_stroke_radius = p_bitmaps->i_stroke_radius;
+    p_key->i_synthetic = p_bitmaps->i_synthetic;
+    p_key->i_type = i_type;
+    if( p_origin )
+    {
+        p_key->i_origin_x = p_origin->x;
+        p_key->i_origin_y = p_origin->y;
+    }
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)p_glyph)->bitmap;
+        return sizeof( FT_BitmapGlyphRec )
+             + (size_t)p_bitmap->rows * abs( p_bitmap->pitch );
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph)p_glyph)->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+static void ReleaseCachedGlyph( void *p_value )
+{
+    cached_glyph_t *p_cached = p_value;
+
+    FT_Done_Glyph( p_cached->p_glyph );
+    FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+/* Stores copies of the glyphs */
+static void CacheGlyph( render_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                        FT_Glyph p_glyph, FT_Glyph p_outline,
+                        const FT_Vector *p_advance )
+{
+    cached_glyph_t *p_cached = calloc( 1, sizeof( *p_cached ) );
+    if( unlikely(!p_cached) )
+        return;
+
+    if( FT_Glyph_Copy( p_glyph, &p_cached->p_glyph )
+     || ( p_outline && FT_Glyph_Copy( p_outline, &p_cached->p_outline ) ) )
+    {
+        ReleaseCachedGlyph( p_cached );
+        return;
+    }
+    if( p_advance )
+        p_cached->advance = *p_advance;
+
+    if( !RenderCachePut( p_cache, p_key, sizeof( *p_key ), p_cached,
+                         sizeof( *p_cached ) + GlyphSize( p_cached->p_glyph )
+                         + GlyphSize( p_cached->p_outline ) ) )
+        ReleaseCachedGlyph( p_cached );
+}
+
+/**
+ * Loads a glyph with its synthetic styles, and strokes its outline with the
+ * current stroker settings, using the glyph cache if there is one.
+ */
+static int LoadGlyph( filter_t *p_filter, glyph_bitmaps_t *p_bitmaps,
+                      FT_Vector *p_advance )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    FT_Face p_face = p_bitmaps->p_face;
+    glyph_cache_key_t key;
+
+    p_bitmaps->p_glyph = NULL;
+    p_bitmaps->p_outline = NULL;
+    GlyphCacheKey( &key, p_bitmaps, GLYPH_CACHE_LOADED, NULL );
+
+    if( p_sys->p_glyph_cache )
+    {
+        const cached_glyph_t *p_cached =
+            RenderCacheGet( p_sys->p_glyph_cache, &key, sizeof( key ) );
+        if( p_cached )
+        {
+            if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
+                return VLC_ENOMEM;
+            if( p_cached->p_outline
+             && FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+                p_bitmaps->p_outline = NULL;
+            *p_advance = p_cached->advance;
+            return VLC_SUCCESS;
+        }
+    }
+
+    if( FT_Load_Glyph( p_face, p_bitmaps->i_glyph_index,
+                       FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+     && FT_Load_Glyph( p_face, p_bitmaps->i_glyph_index, FT_LOAD_DEFAULT ) )
+        return VLC_EGENERIC;
+
+    if( p_bitmaps->i_synthetic & GLYPH_EMBOLDEN )
+        FT_GlyphSlot_Embolden( p_face->glyph );
+    if( p_bitmaps->i_synthetic & GLYPH_OBLIQUE )
+        FT_GlyphSlot_Oblique( p_face->glyph );
+
+    if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+    {
+        p_bitmaps->p_glyph = NULL;
+        return VLC_EGENERIC;
+    }
+
+    if( p_bitmaps->i_synthetic & GLYPH_STROKED )
+    {
+        p_bitmaps->p_outline = p_bitmaps->p_glyph;
+        if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                   p_sys->p_stroker, 0, 0 ) )
+            p_bitmaps->p_outline = NULL;
+    }
+
+    *p_advance = p_face->glyph->advance;
+
+    if( p_sys->p_glyph_cache )
+        CacheGlyph( p_sys->p_glyph_cache, &key, p_bitmaps->p_glyph,
+                    p_bitmaps->p_outline, p_advance );
+    return VLC_SUCCESS;
+}
+
+/**
+ * Same as FT_Glyph_To_Bitmap(), using the glyph cache if there is one.
+ */
+static FT_Error GlyphToBitmap( filter_t *p_filter,
+                               const glyph_bitmaps_t *p_bitmaps, int i_type,
+                               FT_Glyph *pp_glyph, const FT_Vector *p_origin,
+                               FT_Bool b_destroy )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    render_cache_t *p_cache = p_sys->p_glyph_cache;
+    FT_Vector origin = *p_origin;
+
+    if( !p_cache || !p_bitmaps->p_face
+     || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   &origin, b_destroy );
+
+    /* Moving a glyph by whole pixels only moves its bitmap: render at the
+     * subpixel part of the origin, and move the bitmap afterwards. */
+    FT_Vector subpixel = { .x = origin.x & 63, .y = origin.y & 63 };
+    glyph_cache_key_t key;
+    FT_Glyph p_bitmap;
+
+    GlyphCacheKey( &key, p_bitmaps, i_type, &subpixel );
+
+    const cached_glyph_t *p_cached =
+        RenderCacheGet( p_cache, &key, sizeof( key ) );
+    if( p_cached )
+    {
+        FT_Error i_error = FT_Glyph_Copy( p_cached->p_glyph, &p_bitmap );
+        if( i_error )
+            return i_error;
+    }
+    else
+    {
+        p_bitmap = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                               &subpixel, 0 );
+        if( i_error )
+            return i_error;
+        CacheGlyph( p_cache, &key, p_bitmap, NULL, NULL );
+    }
+
+    ((FT_BitmapGlyph)p_bitmap)->left += FT_FLOOR( origin.x );
+    ((FT_BitmapGlyph)p_bitmap)->top  += FT_FLOOR( origin.y );
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 /**
  * Load the glyphs of a paragraph. When shaping with HarfBuzz the glyph indices
  * have already been determined at this point, as well as the advance values.
@@ -1039,12 +1279,23 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_synthetic = 0;
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            i_synthetic |= GLYPH_EMBOLDEN;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            i_synthetic |= GLYPH_OBLIQUE;
+
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
+            i_synthetic |= GLYPH_STROKED;
+
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -1101,39 +1352,25 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
-
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            p_bitmaps->p_face = p_face;
+            p_bitmaps->i_glyph_index = i_glyph_index;
+            p_bitmaps->i_stroke_radius = i_radius;
+            p_bitmaps->i_synthetic = i_synthetic;
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+            FT_Vector advance;
+            if( LoadGlyph( p_filter, p_bitmaps, &advance ) )
                 SKIP_GLYPH( p_bitmaps )
 
 #undef SKIP_GLYPH
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
-            }
-
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1240,8 +1477,11 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            const int i_shadow_type = p_bitmaps->p_shadow == p_bitmaps->p_outline
+                                    ? GLYPH_CACHE_OUTLINE_BITMAP
+                                    : GLYPH_CACHE_GLYPH_BITMAP;
+            if( GlyphToBitmap( p_filter, p_bitmaps, i_shadow_type,
+                               &p_bitmaps->p_shadow, &pen_shadow, 0 ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1249,8 +1489,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_filter, p_bitmaps, GLYPH_CACHE_GLYPH_BITMAP,
+                               &p_bitmaps->p_glyph, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1265,8 +1505,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_filter, p_bitmaps, GLYPH_CACHE_OUTLINE_BITMAP,
+                               &p_bitmaps->p_outline, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
@@ -1715,10 +1955,350 @@ static int LayoutRubyText( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
-int LayoutTextBlock( filter_t *p_filter,
-                     const layout_text_block_t *p_textblock,
-                     line_desc_t **pp_lines, FT_BBox *p_bbox,
-                     int *pi_max_face_height )
+/*
+ * Layout cache
+ *
+ * Laid out lines are kept across calls, keyed by the text, the properties of
+ * its styles that affect the layout, and the renderer settings. Colors and
+ * opacities are not part of the key: the characters of the cached lines
+ * refer to the styles of the request by their position in the text, so that
+ * text only changing colors, like karaoke, keeps hitting the cache.
+ */
+typedef struct
+{
+    FT_Face  p_default_face;
+    unsigned i_video_height;
+    int      i_scale;
+    int      i_outline_thickness;
+    int      i_direction;
+    float    f_shadow_vector_x;
+    float    f_shadow_vector_y;
+    unsigned i_max_width;
+    unsigned i_max_height;
+    uint8_t  b_grid;
+    uint8_t  b_balanced;
+    size_t   i_count;
+} layout_cache_header_t;
+
+typedef struct
+{
+    float    f_font_relsize;
+    int      i_font_size;
+    uint16_t i_style_flags;
+    uint8_t  b_shadow;
+    uint8_t  e_wrapinfo;
+} layout_cache_style_t;
+
+typedef struct cached_layout_t
+{
+    line_desc_t *p_lines;
+    unsigned    *pi_sources;    /* text position of each character */
+    FT_BBox      bbox;
+    int          i_max_face_height;
+    unsigned     i_refs;        /* the cache, and the lines sharing glyphs */
+} cached_layout_t;
+
+static void ReleaseCachedLayout( void *p_value )
+{
+    cached_layout_t *p_cached = p_value;
+
+    if( --p_cached->i_refs > 0 )
+        return;
+
+    FreeLines( p_cached->p_lines );
+    free( p_cached->pi_sources );
+    free( p_cached );
+}
+
+static bool LayoutStyleEquals( const text_style_t *p_style1,
+                               const text_style_t *p_style2 )
+{
+    return p_style1->f_font_relsize == p_style2->f_font_relsize
+        && p_style1->i_font_size == p_style2->i_font_size
+        && p_style1->i_style_flags == p_style2->i_style_flags
+        && ( p_style1->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
+           == ( p_style2->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
+        && p_style1->e_wrapinfo == p_style2->e_wrapinfo
+        && !strcmp( p_style1->psz_fontname ? p_style1->psz_fontname : "",
+                    p_style2->psz_fontname ? p_style2->psz_fontname : "" )
+        && !strcmp( p_style1->psz_monofontname ? p_style1->psz_monofontname : "",
+                    p_style2->psz_monofontname ? p_style2->psz_monofontname : "" );
+}
+
+static void WriteLayoutStyle( struct vlc_memstream *p_stream,
+                              const text_style_t *p_style )
+{
+    layout_cache_style_t style;
+
+    memset( &style, 0, sizeof( style ) );
+    style.f_font_relsize = p_style->f_font_relsize;
+    style.i_font_size = p_style->i_font_size;
+    style.i_style_flags = p_style->i_style_flags;
+    style.b_shadow = p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT;
+    style.e_wrapinfo = p_style->e_wrapinfo;
+
+    vlc_memstream_write( p_stream, &style, sizeof( style ) );
+    vlc_memstream_puts( p_stream, p_style->psz_fontname
+                                ? p_style->psz_fontname : "" );
+    vlc_memstream_putc( p_stream, '\0' );
+    vlc_memstream_puts( p_stream, p_style->psz_monofontname
+                                ? p_style->psz_monofontname : "" );
+    vlc_memstream_putc( p_stream, '\0' );
+}
+
+/**
+ * Builds the cache key of a text block. Text with ruby is not cached, as
+ * the ruby blocks hold their own laid out lines.
+ */
+static int LayoutCacheKey( filter_t *p_filter,
+                           const layout_text_block_t *p_textblock,
+                           struct vlc_memstream *p_stream )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_textblock->pp_ruby )
+        for( size_t i = 0; i < p_textblock->i_count; i++ )
+            if( p_textblock->pp_ruby[i] )
+                return VLC_EGENERIC;
+
+    /* Styles differing only by their colors share the same index */
+    const text_style_t **pp_styles = vlc_alloc( p_textblock->i_count + 1,
+                                                sizeof( *pp_styles ) );
+    unsigned *pi_styles = vlc_alloc( p_textblock->i_count,
+                                     sizeof( *pi_styles ) );
+    if( !pp_styles || !pi_styles )
+    {
+        free( pp_styles );
+        free( pi_styles );
+        return VLC_ENOMEM;
+    }
+
+    /* The default style is used when no face is found */
+    pp_styles[0] = p_sys->p_default_style;
+    unsigned i_styles = 1;
+
+    const text_style_t *p_last = NULL;
+    unsigned i_last = 0;
+    for( size_t i = 0; i < p_textblock->i_count; i++ )
+    {
+        const text_style_t *p_style = p_textblock->pp_styles[i];
+        if( p_style != p_last )
+        {
+            for( i_last = 1; i_last < i_styles; i_last++ )
+                if( LayoutStyleEquals( pp_styles[i_last], p_style ) )
+                    break;
+            if( i_last == i_styles )
+                pp_styles[i_styles++] = p_style;
+            p_last = p_style;
+        }
+        pi_styles[i] = i_last;
+    }
+
+    layout_cache_header_t header;
+    memset( &header, 0, sizeof( header ) );
+    header.p_default_face = p_sys->p_face;
+    header.i_video_height = p_filter->fmt_out.video.i_height;
+    header.i_scale = p_sys->i_scale;
+    header.i_outline_thickness =
+        var_InheritInteger( p_filter, "freetype-outline-thickness" );
+#ifdef HAVE_FRIBIDI
+    header.i_direction = var_InheritInteger( p_filter, "freetype-text-direction" );
+#endif
+    header.f_shadow_vector_x = p_sys->f_shadow_vector_x;
+    header.f_shadow_vector_y = p_sys->f_shadow_vector_y;
+    header.i_max_width = p_textblock->i_max_width;
+    header.i_max_height = p_textblock->i_max_height;
+    header.b_grid = p_textblock->b_grid;
+    header.b_balanced = p_textblock->b_balanced;
+    header.i_count = p_textblock->i_count;
+
+    vlc_memstream_open( p_stream );
+    vlc_memstream_write( p_stream, &header, sizeof( header ) );
+    vlc_memstream_write( p_stream, p_textblock->p_uchars,
+                         p_textblock->i_count * sizeof( *p_textblock->p_uchars ) );
+    vlc_memstream_write( p_stream, pi_styles,
+                         p_textblock->i_count * sizeof( *pi_styles ) );
+    for( unsigned i = 0; i < i_styles; i++ )
+        WriteLayoutStyle( p_stream, pp_styles[i] );
+
+    free( pp_styles );
+    free( pi_styles );
+    return vlc_memstream_close( p_stream ) ? VLC_ENOMEM : VLC_SUCCESS;
+}
+
+/**
+ * Duplicates lines and their glyphs, without the character styles.
+ */
+static line_desc_t *CopyLines( const line_desc_t *p_lines, size_t *pi_size )
+{
+    line_desc_t *p_first = NULL;
+    line_desc_t **pp_next = &p_first;
+    size_t i_size = 0;
+
+    for( const line_desc_t *p_src = p_lines; p_src; p_src = p_src->p_next )
+    {
+        line_desc_t *p_line = NewLine( __MAX( p_src->i_character_count, 1 ) );
+        if( !p_line )
+            goto error;
+        *pp_next = p_line;
+        pp_next = &p_line->p_next;
+
+        p_line->i_width = p_src->i_width;
+        p_line->i_height = p_src->i_height;
+        p_line->i_base_line = p_src->i_base_line;
+        p_line->i_first_visible_char_index = p_src->i_first_visible_char_index;
+        p_line->i_last_visible_char_index = p_src->i_last_visible_char_index;
+        p_line->bbox = p_src->bbox;
+        i_size += sizeof( *p_line )
+                + p_src->i_character_count * sizeof( *p_line->p_character );
+
+        for( int i = 0; i < p_src->i_character_count; i++ )
+        {
+            const line_character_t *p_ch_src = &p_src->p_character[i];
+            line_character_t *p_ch = &p_line->p_character[i];
+            FT_Glyph p_glyph = NULL, p_outline = NULL, p_shadow = NULL;
+
+            if( ( p_ch_src->p_glyph
+               && FT_Glyph_Copy( (FT_Glyph)p_ch_src->p_glyph, &p_glyph ) )
+             || ( p_ch_src->p_outline
+               && FT_Glyph_Copy( (FT_Glyph)p_ch_src->p_outline, &p_outline ) )
+             || ( p_ch_src->p_shadow
+               && FT_Glyph_Copy( (FT_Glyph)p_ch_src->p_shadow, &p_shadow ) ) )
+            {
+                FT_Done_Glyph( p_glyph );
+                FT_Done_Glyph( p_outline );
+                goto error;
+            }
+
+            *p_ch = *p_ch_src;
+            p_ch->p_glyph = (FT_BitmapGlyph)p_glyph;
+            p_ch->p_outline = (FT_BitmapGlyph)p_outline;
+            p_ch->p_shadow = (FT_BitmapGlyph)p_shadow;
+            p_ch->p_style = NULL;
+            p_ch->p_ruby = NULL;
+            p_line->i_character_count++;
+
+            i_size += GlyphSize( p_glyph ) + GlyphSize( p_outline )
+                    + GlyphSize( p_shadow );
+        }
+    }
+
+    *pi_size = i_size;
+    return p_first;
+
+error:
+    FreeLines( p_first );
+    return NULL;
+}
+
+/**
+ * Duplicates the lines of a cached layout, sharing its glyphs instead of
+ * copying them. The style of each character is taken from pp_styles at its
+ * position in the text.
+ */
+static line_desc_t *ShareLines( cached_layout_t *p_cached,
+                                text_style_t *const *pp_styles )
+{
+    const unsigned *pi_sources = p_cached->pi_sources;
+    line_desc_t *p_first = NULL;
+    line_desc_t **pp_next = &p_first;
+
+    for( const line_desc_t *p_src = p_cached->p_lines; p_src;
+         p_src = p_src->p_next )
+    {
+        line_desc_t *p_line = NewLine( __MAX( p_src->i_character_count, 1 ) );
+        if( !p_line )
+        {
+            FreeLines( p_first );
+            return NULL;
+        }
+
+        line_character_t *p_character = p_line->p_character;
+
+        *p_line = *p_src;
+        p_line->p_next = NULL;
+        p_line->p_character = p_character;
+        p_line->p_glyphs_owner = p_cached;
+        p_cached->i_refs++;
+        *pp_next = p_line;
+        pp_next = &p_line->p_next;
+
+        for( int i = 0; i < p_src->i_character_count; i++ )
+        {
+            p_character[i] = p_src->p_character[i];
+            p_character[i].p_style = pp_styles[*(pi_sources++)];
+        }
+    }
+    return p_first;
+}
+
+static int GetCachedLayout( filter_t *p_filter,
+                            const struct vlc_memstream *p_key,
+                            const layout_text_block_t *p_textblock,
+                            line_desc_t **pp_lines, FT_BBox *p_bbox,
+                            int *pi_max_face_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    cached_layout_t *p_cached =
+        RenderCacheGet( p_sys->p_layout_cache, p_key->ptr, p_key->length );
+    if( !p_cached )
+        return VLC_EGENERIC;
+
+    /* An empty layout has no lines to share */
+    line_desc_t *p_lines = NULL;
+    if( p_cached->p_lines )
+    {
+        p_lines = ShareLines( p_cached, p_textblock->pp_styles );
+        if( !p_lines )
+            return VLC_ENOMEM;
+    }
+
+    *pp_lines = p_lines;
+    *p_bbox = p_cached->bbox;
+    *pi_max_face_height = p_cached->i_max_face_height;
+    return VLC_SUCCESS;
+}
+
+static void CacheLayout( filter_t *p_filter, const struct vlc_memstream *p_key,
+                         const line_desc_t *p_lines, unsigned *pi_sources,
+                         size_t i_count, const FT_BBox *p_bbox,
+                         int i_max_face_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    cached_layout_t *p_cached = malloc( sizeof( *p_cached ) );
+    if( unlikely(!p_cached) )
+    {
+        free( pi_sources );
+        return;
+    }
+
+    size_t i_size = 0;
+    p_cached->p_lines = NULL;
+    p_cached->pi_sources = pi_sources;
+    p_cached->bbox = *p_bbox;
+    p_cached->i_max_face_height = i_max_face_height;
+    p_cached->i_refs = 1;
+
+    if( p_lines )
+    {
+        p_cached->p_lines = CopyLines( p_lines, &i_size );
+        if( !p_cached->p_lines )
+        {
+            ReleaseCachedLayout( p_cached );
+            return;
+        }
+    }
+
+    if( !RenderCachePut( p_sys->p_layout_cache, p_key->ptr, p_key->length,
+                         p_cached, sizeof( *p_cached ) + i_size
+                         + i_count * sizeof( *pi_sources ) ) )
+        ReleaseCachedLayout( p_cached );
+}
+
+static int LayoutTextBlockUncached( filter_t *p_filter,
+                                    const layout_text_block_t *p_textblock,
+                                    line_desc_t **pp_lines, FT_BBox *p_bbox,
+                                    int *pi_max_face_height )
 {
     line_desc_t *p_first_line = 0;
     line_desc_t **pp_line = &p_first_line;
@@ -1828,3 +2408,127 @@ int LayoutTextBlock( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
+
+/**
+ * Lays text out with a copy of each style, so that the characters of the
+ * lines can be traced back to their position in the text, then caches the
+ * lines.
+ */
+static int LayoutAndCacheTextBlock( filter_t *p_filter,
+                                    const struct vlc_memstream *p_key,
+                                    const layout_text_block_t *p_textblock,
+                                    line_desc_t **pp_lines, FT_BBox *p_bbox,
+                                    int *pi_max_face_height )
+{
+    const size_t i_count = p_textblock->i_count;
+    text_style_t *p_styles = vlc_alloc( i_count, sizeof( *p_styles ) );
+    text_style_t **pp_styles = vlc_alloc( i_count, sizeof( *pp_styles ) );
+    if( !p_styles || !pp_styles )
+    {
+        free( p_styles );
+        free( pp_styles );
+        return LayoutTextBlockUncached( p_filter, p_textblock, pp_lines,
+                                        p_bbox, pi_max_face_height );
+    }
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        p_styles[i] = *p_textblock->pp_styles[i];
+        pp_styles[i] = &p_styles[i];
+    }
+
+    layout_text_block_t textblock = *p_textblock;
+    textblock.pp_styles = pp_styles;
+
+    int i_ret = LayoutTextBlockUncached( p_filter, &textblock, pp_lines,
+                                         p_bbox, pi_max_face_height );
+    if( i_ret == VLC_SUCCESS )
+    {
+        size_t i_chars = 0;
+        for( line_desc_t *p_line = *pp_lines; p_line; p_line = p_line->p_next )
+            i_chars += p_line->i_character_count;
+
+        unsigned *pi_sources = vlc_alloc( __MAX( i_chars, 1 ),
+                                          sizeof( *pi_sources ) );
+
+        /* Give the characters the styles of the request back */
+        size_t j = 0;
+        for( line_desc_t *p_line = *pp_lines; p_line; p_line = p_line->p_next )
+            for( int i = 0; i < p_line->i_character_count; i++ )
+            {
+                line_character_t *p_ch = &p_line->p_character[i];
+                const size_t i_source = p_ch->p_style - p_styles;
+
+                assert( i_source < i_count );
+                p_ch->p_style = p_textblock->pp_styles[i_source];
+                if( pi_sources )
+                    pi_sources[j++] = i_source;
+            }
+
+        if( pi_sources )
+            CacheLayout( p_filter, p_key, *pp_lines, pi_sources, i_chars,
+                         p_bbox, *pi_max_face_height );
+    }
+
+    free( pp_styles );
+    free( p_styles );
+    return i_ret;
+}
+
+int LayoutTextBlock( filter_t *p_filter,
+                     const layout_text_block_t *p_textblock,
+                     line_desc_t **pp_lines, FT_BBox *p_bbox,
+                     int *pi_max_face_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct vlc_memstream key;
+
+    if( !p_sys->p_layout_cache
+     || LayoutCacheKey( p_filter, p_textblock, &key ) )
+        return LayoutTextBlockUncached( p_filter, p_textblock, pp_lines,
+                                        p_bbox, pi_max_face_height );
+
+    int i_ret = GetCachedLayout( p_filter, &key, p_textblock, pp_lines,
+                                 p_bbox, pi_max_face_height );
+    if( i_ret )
+        i_ret = LayoutAndCacheTextBlock( p_filter, &key, p_textblock,
+                                         pp_lines, p_bbox, pi_max_face_height );
+
+    free( key.ptr );
+    return i_ret;
+}
+
+void CreateLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    size_t i_size = var_InheritInteger( p_filter, "freetype-glyph-cache" );
+    if( i_size > 0 )
+        p_sys->p_glyph_cache = RenderCacheNew( i_size << 10,
+                                               ReleaseCachedGlyph );
+
+    i_size = var_InheritInteger( p_filter, "freetype-layout-cache" );
+    if( i_size > 0 )
+        p_sys->p_layout_cache = RenderCacheNew( i_size << 10,
+                                                ReleaseCachedLayout );
+}
+
+void DeleteLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_layout_cache )
+    {
+        RenderCacheDumpStats( VLC_OBJECT(p_filter), p_sys->p_layout_cache,
+                              "layout" );
+        RenderCacheDelete( p_sys->p_layout_cache );
+        p_sys->p_layout_cache = NULL;
+    }
+    if( p_sys->p_glyph_cache )
+    {
+        RenderCacheDumpStats( VLC_OBJECT(p_filter), p_sys->p_glyph_cache,
+                              "glyph" );
+        RenderCacheDelete( p_sys->p_glyph_cache );
+        p_sys->p_glyph_cache = NULL;
+    }
+}
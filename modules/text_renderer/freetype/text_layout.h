@@ -58,6 +58,8 @@ struct line_desc_t
     int              i_last_visible_char_index;
     line_character_t *p_character;
     FT_BBox          bbox;
+    /* Layout cache entry owning the glyphs, or NULL if the line owns them */
+    struct cached_layout_t *p_glyphs_owner;
 };
 
 void FreeLines( line_desc_t *p_lines );
@@ -105,3 +107,19 @@ typedef struct
  */
 int LayoutTextBlock( filter_t *p_filter, const layout_text_block_t *p_textblock,
                      line_desc_t **pp_lines, FT_BBox *p_bbox, int *pi_max_face_height );
+
+/**
+ * Creates the caches of glyphs and laid out text, sized by the
+ * freetype-glyph-cache and freetype-layout-cache options. Text is laid out
+ * without caching if a cache is disabled or cannot be created.
+ *
+ * \param p_filter the FreeType module object [IN]
+ */
+void CreateLayoutCaches( filter_t *p_filter );
+
+/**
+ * Prints the statistics of the caches and deletes them.
+ *
+ * \param p_filter the FreeType module object [IN]
+ */
+void DeleteLayoutCaches( filter_t *p_filter );
@@ -51,6 +51,327 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
 #define ASSERT_3PLANES ASSERT_2PLANES; \
     ASSERT_PLANE(2)
 
+/* Slice-parallel copies
+ *
+ * If the cache allows more than one thread, copies of large surfaces are split
+ * into slices of lines, copied at once by the calling thread and by a pool of
+ * worker threads. Slice boundaries are aligned on cache lines of the
+ * destination planes, so that no two threads write to the same cache line. If
+ * the pool is busy with another copy, the caller copies on its own. */
+
+#define COPY_MAX_THREADS    8
+#define COPY_SLICE_MIN_SIZE (2 << 20) /* bytes of the first plane */
+
+enum copy_kind
+{
+    COPY_PACKED,
+    COPY_420_SP_TO_SP,
+    COPY_420_SP_TO_P,
+    COPY_420_16_SP_TO_P,
+    COPY_420_P_TO_SP,
+    COPY_420_16_P_TO_SP,
+    COPY_420_P_TO_P,
+};
+
+static const struct
+{
+    uint8_t src_planes;
+    uint8_t dst_planes;
+} copy_kinds[] = {
+    [COPY_PACKED]         = { 1, 1 },
+    [COPY_420_SP_TO_SP]   = { 2, 2 },
+    [COPY_420_SP_TO_P]    = { 2, 3 },
+    [COPY_420_16_SP_TO_P] = { 2, 3 },
+    [COPY_420_P_TO_SP]    = { 3, 2 },
+    [COPY_420_16_P_TO_SP] = { 3, 2 },
+    [COPY_420_P_TO_P]     = { 3, 3 },
+};
+
+struct copy_slice
+{
+    enum copy_kind kind;
+    plane_t dst[3];
+    const uint8_t *src[3];
+    size_t src_pitch[3];
+    unsigned height;
+    int bitshift;
+};
+
+struct copy_batch
+{
+    const struct copy_slice *slices;
+    unsigned count;
+    unsigned next; /* first slice not taken yet */
+    unsigned pending; /* slices not copied yet */
+};
+
+struct copy_worker
+{
+    vlc_thread_t thread;
+    copy_cache_t cache;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* a batch was posted, or the pool is stopping */
+    vlc_cond_t done; /* the last slice of the batch was copied */
+    struct copy_batch *batch;
+    unsigned users; /* initialized caches */
+    unsigned threads; /* started workers */
+    bool started;
+    bool quit;
+    struct copy_worker workers[COPY_MAX_THREADS - 1];
+} copy_pool = {
+    .lock = VLC_STATIC_MUTEX,
+    .wait = VLC_STATIC_COND,
+    .done = VLC_STATIC_COND,
+};
+
+static void CopySliceRun(const struct copy_slice *s, const copy_cache_t *cache)
+{
+    picture_t pic;
+    const uint8_t *src[3];
+
+    memcpy(pic.p, s->dst, sizeof (s->dst));
+    memcpy(src, s->src, sizeof (src));
+
+    switch (s->kind)
+    {
+        case COPY_PACKED:
+            CopyPacked(&pic, src[0], s->src_pitch[0], s->height, cache);
+            break;
+        case COPY_420_SP_TO_SP:
+            Copy420_SP_to_SP(&pic, src, s->src_pitch, s->height, cache);
+            break;
+        case COPY_420_SP_TO_P:
+            Copy420_SP_to_P(&pic, src, s->src_pitch, s->height, cache);
+            break;
+        case COPY_420_16_SP_TO_P:
+            Copy420_16_SP_to_P(&pic, src, s->src_pitch, s->height,
+                               s->bitshift, cache);
+            break;
+        case COPY_420_P_TO_SP:
+            Copy420_P_to_SP(&pic, src, s->src_pitch, s->height, cache);
+            break;
+        case COPY_420_16_P_TO_SP:
+            Copy420_16_P_to_SP(&pic, src, s->src_pitch, s->height,
+                               s->bitshift, cache);
+            break;
+        case COPY_420_P_TO_P:
+            Copy420_P_to_P(&pic, src, s->src_pitch, s->height, cache);
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#ifdef CAN_COMPILE_SSE2
+    /* Non-temporal stores are weakly ordered: complete them before the slice
+     * is reported as copied to another thread. */
+    if (vlc_CPU_SSE2())
+        asm volatile ("sfence" ::: "memory");
+#endif
+}
+
+static void *CopyWorker(void *data)
+{
+    struct copy_worker *worker = data;
+
+    vlc_mutex_lock(&copy_pool.lock);
+    while (!copy_pool.quit)
+    {
+        struct copy_batch *batch = copy_pool.batch;
+
+        if (batch == NULL || batch->next == batch->count)
+        {
+            vlc_cond_wait(&copy_pool.wait, &copy_pool.lock);
+            continue;
+        }
+
+        const struct copy_slice *slice = &batch->slices[batch->next++];
+
+        vlc_mutex_unlock(&copy_pool.lock);
+        CopySliceRun(slice, &worker->cache);
+        vlc_mutex_lock(&copy_pool.lock);
+
+        if (--batch->pending == 0)
+            vlc_cond_signal(&copy_pool.done);
+    }
+    vlc_mutex_unlock(&copy_pool.lock);
+    return NULL;
+}
+
+/* Called with the pool lock held, while the workers are idle.
+ * Returns the number of threads, including the caller, to copy with. */
+static unsigned CopyPoolStart(unsigned threads)
+{
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    threads = __MIN(threads, COPY_MAX_THREADS);
+    copy_pool.started = true;
+
+    while (copy_pool.threads + 1 < threads)
+    {
+        struct copy_worker *worker = &copy_pool.workers[copy_pool.threads];
+
+        memset(&worker->cache, 0, sizeof (worker->cache));
+        worker->cache.threads = 1;
+        if (vlc_clone(&worker->thread, CopyWorker, worker,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        copy_pool.threads++;
+    }
+    return __MIN(threads, copy_pool.threads + 1);
+}
+
+/* Called with the pool lock held, while the workers are idle */
+static int CopyPoolReserve(const copy_cache_t *cache)
+{
+#ifdef CAN_COMPILE_SSE2
+    for (unsigned i = 0; i < copy_pool.threads; i++)
+    {
+        copy_cache_t *wcache = &copy_pool.workers[i].cache;
+
+        if (wcache->size >= cache->size)
+            continue;
+
+        uint8_t *buffer = aligned_alloc(64, cache->size);
+        if (unlikely(buffer == NULL))
+            return VLC_ENOMEM;
+        aligned_free(wcache->buffer);
+        wcache->buffer = buffer;
+        wcache->size = cache->size;
+    }
+#else
+    (void) cache;
+#endif
+    return VLC_SUCCESS;
+}
+
+static void CopyPoolRelease(void)
+{
+    vlc_mutex_lock(&copy_pool.lock);
+    assert(copy_pool.users > 0);
+    if (--copy_pool.users > 0 || !copy_pool.started || copy_pool.quit)
+    {
+        vlc_mutex_unlock(&copy_pool.lock);
+        return;
+    }
+
+    copy_pool.quit = true;
+    vlc_cond_broadcast(&copy_pool.wait);
+
+    const unsigned threads = copy_pool.threads;
+    vlc_mutex_unlock(&copy_pool.lock);
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        struct copy_worker *worker = &copy_pool.workers[i];
+
+        vlc_join(worker->thread, NULL);
+#ifdef CAN_COMPILE_SSE2
+        aligned_free(worker->cache.buffer);
+#endif
+    }
+
+    vlc_mutex_lock(&copy_pool.lock);
+    copy_pool.threads = 0;
+    copy_pool.started = false;
+    copy_pool.quit = false;
+    vlc_mutex_unlock(&copy_pool.lock);
+}
+
+/**
+ * Copies a large surface in slices with the thread pool.
+ *
+ * \return true if the surface was copied, false if the caller shall copy it
+ */
+static bool CopySliced(enum copy_kind kind, picture_t *dst,
+                       const uint8_t *const src[], const size_t src_pitch[],
+                       unsigned height, int bitshift,
+                       const copy_cache_t *cache)
+{
+    if (cache->threads == 1 || src_pitch[0] * height < 2 * COPY_SLICE_MIN_SIZE)
+        return false;
+
+    const unsigned src_planes = copy_kinds[kind].src_planes;
+    const unsigned dst_planes = copy_kinds[kind].dst_planes;
+
+    /* Slices start on an even line of the first plane, and on a cache line
+     * in every destination plane */
+    unsigned align = 2;
+    for (unsigned i = 0; i < dst_planes; i++)
+        while (((size_t)dst->p[i].i_pitch * (i ? align / 2 : align)) % 64)
+            align *= 2;
+
+    vlc_mutex_lock(&copy_pool.lock);
+    if (copy_pool.quit || copy_pool.batch != NULL)
+        goto busy;
+
+    const unsigned threads = CopyPoolStart(cache->threads);
+    unsigned count = src_pitch[0] * height / COPY_SLICE_MIN_SIZE;
+    count = __MIN(count, threads);
+
+    const unsigned step = ((height + count - 1) / count + align - 1)
+                        / align * align;
+    count = (height + step - 1) / step;
+    if (count < 2 || CopyPoolReserve(cache))
+        goto busy;
+
+    struct copy_slice slices[COPY_MAX_THREADS];
+
+    for (unsigned n = 0; n < count; n++)
+    {
+        struct copy_slice *s = &slices[n];
+        const unsigned y = n * step;
+
+        s->kind = kind;
+        for (unsigned i = 0; i < dst_planes; i++)
+        {
+            s->dst[i] = dst->p[i];
+            s->dst[i].p_pixels += (size_t)(i ? y / 2 : y) * dst->p[i].i_pitch;
+        }
+        for (unsigned i = 0; i < src_planes; i++)
+        {
+            s->src[i] = src[i] + (i ? y / 2 : y) * src_pitch[i];
+            s->src_pitch[i] = src_pitch[i];
+        }
+        s->height = __MIN(step, height - y);
+        s->bitshift = bitshift;
+    }
+
+    struct copy_batch batch = {
+        .slices = slices,
+        .count = count,
+        .pending = count,
+    };
+    copy_cache_t slice_cache = *cache;
+
+    slice_cache.threads = 1;
+    copy_pool.batch = &batch;
+    vlc_cond_broadcast(&copy_pool.wait);
+
+    /* Copy along with the workers */
+    while (batch.next < batch.count)
+    {
+        const struct copy_slice *slice = &slices[batch.next++];
+
+        vlc_mutex_unlock(&copy_pool.lock);
+        CopySliceRun(slice, &slice_cache);
+        vlc_mutex_lock(&copy_pool.lock);
+        batch.pending--;
+    }
+
+    while (batch.pending > 0)
+        vlc_cond_wait(&copy_pool.done, &copy_pool.lock);
+    copy_pool.batch = NULL;
+    vlc_mutex_unlock(&copy_pool.lock);
+    return true;
+
+busy:
+    vlc_mutex_unlock(&copy_pool.lock);
+    return false;
+}
+
 int CopyInitCache(copy_cache_t *cache, unsigned width)
 {
 #ifdef CAN_COMPILE_SSE2
@@ -59,8 +380,13 @@ int CopyInitCache(copy_cache_t *cache, unsigned width)
     if (!cache->buffer)
         return VLC_EGENERIC;
 #else
-    (void) cache; (void) width;
+    (void) width;
 #endif
+    cache->threads = 1;
+
+    vlc_mutex_lock(&copy_pool.lock);
+    copy_pool.users++;
+    vlc_mutex_unlock(&copy_pool.lock);
     return VLC_SUCCESS;
 }
 
@@ -73,6 +399,7 @@ void CopyCleanCache(copy_cache_t *cache)
 #else
     (void) cache;
 #endif
+    CopyPoolRelease();
 }
 
 #ifdef CAN_COMPILE_SSE2
@@ -652,6 +979,9 @@ void CopyPacked(picture_t *dst, const uint8_t *src, const size_t src_pitch,
     assert(src); assert(src_pitch);
     assert(height);
 
+    if (CopySliced(COPY_PACKED, dst, &src, &src_pitch, height, 0, cache))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE4_1())
         return SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch, src, src_pitch,
@@ -668,6 +998,8 @@ void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
                       const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    if (CopySliced(COPY_420_SP_TO_SP, dst, src, src_pitch, height, 0, cache))
+        return;
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_SP(dst, src, src_pitch, height, cache);
@@ -745,6 +1077,8 @@ void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
                      const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    if (CopySliced(COPY_420_SP_TO_P, dst, src, src_pitch, height, 0, cache))
+        return;
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 1, 0, cache);
@@ -765,6 +1099,9 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 {
     ASSERT_2PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    if (CopySliced(COPY_420_16_SP_TO_P, dst, src, src_pitch, height,
+                   bitshift, cache))
+        return;
 
 #ifdef CAN_COMPILE_SSE3
     if (vlc_CPU_SSSE3())
@@ -821,6 +1158,8 @@ void Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
                      const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    if (CopySliced(COPY_420_P_TO_SP, dst, src, src_pitch, height, 0, cache))
+        return;
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 1, 0, cache);
@@ -852,6 +1191,9 @@ void Copy420_16_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 {
     ASSERT_3PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    if (CopySliced(COPY_420_16_P_TO_SP, dst, src, src_pitch, height,
+                   bitshift, cache))
+        return;
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSSE3())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 2, bitshift, cache);
@@ -886,6 +1228,8 @@ void Copy420_P_to_P(picture_t *dst, const uint8_t *src[static 3],
                     const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    if (CopySliced(COPY_420_P_TO_P, dst, src, src_pitch, height, 0, cache))
+        return;
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_P_to_P(dst, src, src_pitch, height, cache);
@@ -1009,6 +1353,7 @@ static const struct test_size sizes[] = {
     { 1274, 721, 1200, 720 },
     { 1920, 1088, 1920, 1080 },
     { 3840, 2160, 3840, 2160 },
+    { 4096, 2161, 4096, 2161 },
 #if 0 /* too long */
     { 8192, 8192, 8192, 8192 },
 #endif
@@ -1144,6 +1489,8 @@ int main(void)
             int ret = CopyInitCache(&cache, src->format.i_width
                                     * src_dsc->pixel_size);
             assert(ret == VLC_SUCCESS);
+            /* Copy the 4K sizes in slices, even with a single CPU */
+            CopySetThreads(&cache, 3);
 
             for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
             {
@@ -1186,3 +1533,119 @@ int main(void)
 }
 
 #endif
+
+#ifdef COPY_BENCH
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const struct
+{
+    const char *name;
+    vlc_fourcc_t src_chroma;
+    vlc_fourcc_t dst_chroma;
+    int bitshift;
+    union
+    {
+        void (*conv)(picture_t *, const uint8_t *[], const size_t [], unsigned,
+                     const copy_cache_t *);
+        void (*conv16)(picture_t *, const uint8_t *[], const size_t [], unsigned,
+                       int, const copy_cache_t *);
+    };
+} methods[] = {
+    { "NV12 to NV12", VLC_CODEC_NV12, VLC_CODEC_NV12, 0,
+      .conv = Copy420_SP_to_SP },
+    { "NV12 to I420", VLC_CODEC_NV12, VLC_CODEC_I420, 0,
+      .conv = Copy420_SP_to_P },
+    { "I420 to I420", VLC_CODEC_I420, VLC_CODEC_I420, 0,
+      .conv = Copy420_P_to_P },
+    { "I420 to NV12", VLC_CODEC_I420, VLC_CODEC_NV12, 0,
+      .conv = Copy420_P_to_SP },
+    { "P010 to I42A", VLC_CODEC_P010, VLC_CODEC_I420_10L, 6,
+      .conv16 = Copy420_16_SP_to_P },
+    { "I42A to P010", VLC_CODEC_I420_10L, VLC_CODEC_P010, -6,
+      .conv16 = Copy420_16_P_to_SP },
+};
+
+static void Bench(size_t m, unsigned width, unsigned height, unsigned threads,
+                  unsigned frames)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(methods[m].src_chroma);
+    video_format_t fmt;
+
+    video_format_Init(&fmt, 0);
+    video_format_Setup(&fmt, methods[m].src_chroma, width, height,
+                       width, height, 1, 1);
+
+    picture_t *src = picture_NewFromFormat(&fmt);
+    fmt.i_chroma = methods[m].dst_chroma;
+    picture_t *dst = picture_NewFromFormat(&fmt);
+    if (src == NULL || dst == NULL)
+        abort();
+
+    const uint8_t *src_planes[3];
+    size_t src_pitches[3];
+    size_t size = 0;
+
+    for (int i = 0; i < src->i_planes; i++)
+    {
+        src_planes[i] = src->p[i].p_pixels;
+        src_pitches[i] = src->p[i].i_pitch;
+        size += (size_t)src->p[i].i_pitch * src->p[i].i_lines;
+        memset(src->p[i].p_pixels, 0x42, src->p[i].i_pitch * src->p[i].i_lines);
+    }
+
+    copy_cache_t cache;
+    if (CopyInitCache(&cache, width * dsc->pixel_size))
+        abort();
+    CopySetThreads(&cache, threads);
+
+    vlc_tick_t start = 0;
+
+    /* The first frame warms the pool and the page tables up */
+    for (unsigned i = 0; i <= frames; i++)
+    {
+        if (i == 1)
+            start = vlc_tick_now();
+        if (methods[m].bitshift == 0)
+            methods[m].conv(dst, src_planes, src_pitches, height, &cache);
+        else
+            methods[m].conv16(dst, src_planes, src_pitches, height,
+                              methods[m].bitshift, &cache);
+    }
+
+    const vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    printf("%s %ux%u, %u thread(s): %6.2f GB/s\n", methods[m].name,
+           width, height, threads,
+           (double)size * frames / (1e3 * US_FROM_VLC_TICK(elapsed)));
+
+    CopyCleanCache(&cache);
+    picture_Release(dst);
+    picture_Release(src);
+}
+
+/* Usage: chroma_copy_bench [width [height [frames]]] */
+int main(int argc, char *argv[])
+{
+    unsigned width = argc > 1 ? strtoul(argv[1], NULL, 0) : 7680;
+    unsigned height = argc > 2 ? strtoul(argv[2], NULL, 0) : 4320;
+    unsigned frames = argc > 3 ? strtoul(argv[3], NULL, 0) : 60;
+    unsigned max_threads = __MIN(vlc_GetCPUCount(), COPY_MAX_THREADS);
+
+    if (width == 0 || height == 0 || frames == 0)
+        return 1;
+
+    for (size_t m = 0; m < ARRAY_SIZE(methods); m++)
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+        {
+            Bench(m, width, height, threads, frames);
+            /* Also bench all the CPUs if they are not a power of two */
+            if (threads < max_threads && threads * 2 > max_threads)
+                Bench(m, width, height, max_threads, frames);
+        }
+    return 0;
+}
+
+#endif
@@ -29,14 +29,24 @@ typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
-# else
-    char dummy;
 # endif
+    unsigned threads; /* threads copying a large surface, 0 for one per CPU */
 } copy_cache_t;
 
+/* Large surfaces can be copied in slices of lines by a pool of threads shared
+ * by all the caches. The pool is started by the first sliced copy, and
+ * stopped when the last cache is cleaned. */
 int  CopyInitCache(copy_cache_t *cache, unsigned width);
 void CopyCleanCache(copy_cache_t *cache);
 
+/* Sets the number of threads, including the caller, copying large surfaces
+ * with the cache: 0 for one per CPU. A new cache copies on the calling thread
+ * only (1), as the "copy-threads" option defaults to. */
+static inline void CopySetThreads(copy_cache_t *cache, unsigned threads)
+{
+    cache->threads = threads;
+}
+
 /* YUVY/RGB copies */
 void CopyPacked(picture_t *dst, const uint8_t *src,
                 const size_t src_pitch, unsigned height,
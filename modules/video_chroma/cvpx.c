@@ -316,6 +316,8 @@ static int Open(vlc_object_t *obj)
     int ret = CopyInitCache(&p_sys->sw.cache, i_cache_width);
     if (ret != VLC_SUCCESS)
         goto error;
+    CopySetThreads(&p_sys->sw.cache,
+                   var_InheritInteger(p_filter, "copy-threads"));
 
     if (b_need_pool)
     {
@@ -345,7 +347,10 @@ static int Open(vlc_object_t *obj)
     {
         if (p_filter->vctx_in == NULL ||
             vlc_video_context_GetType(p_filter->vctx_in) != VLC_VIDEO_CONTEXT_CVPX)
-            return VLC_EGENERIC;
+        {
+            ret = VLC_EGENERIC;
+            goto error;
+        }
     }
 
     return VLC_SUCCESS;
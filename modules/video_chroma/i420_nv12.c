@@ -217,6 +217,8 @@ static int Create( vlc_object_t *p_this )
     if( CopyInitCache( &p_sys->cache, ( p_filter->fmt_in.video.i_x_offset +
                        p_filter->fmt_in.video.i_visible_width ) * pixel_bytes ) )
         return VLC_ENOMEM;
+    CopySetThreads( &p_sys->cache,
+                    var_InheritInteger( p_filter, "copy-threads" ) );
 
     p_filter->p_sys = p_sys;
 
@@ -31,7 +31,10 @@
 #include <vlc_cpu.h>
 
 #include "i420_rgb.h"
-#ifdef SSE2
+#if defined (AVX2)
+# include "i420_rgb_avx2.h"
+# define VLC_TARGET VLC_AVX2
+#elif defined (SSE2)
 # include "i420_rgb_sse2.h"
 # define VLC_TARGET VLC_SSE
 #else
@@ -117,7 +120,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint16_t *  p_pic_start;       /* beginning of the current line for copy */
 
     /* Conversion buffer pointer */
@@ -161,7 +164,76 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_15
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_15
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_15 );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_15 );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 2 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -357,7 +429,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint16_t *  p_pic_start;       /* beginning of the current line for copy */
 
     /* Conversion buffer pointer */
@@ -401,7 +473,76 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_16
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_16
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_16 );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_16 );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 2 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -598,7 +739,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint32_t *  p_pic_start;       /* beginning of the current line for copy */
     /* Conversion buffer pointer */
     uint32_t *  p_buffer_start;
@@ -641,7 +782,76 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ARGB
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ARGB
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_32_ARGB );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_32_ARGB );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -837,7 +1047,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint32_t *  p_pic_start;       /* beginning of the current line for copy */
     /* Conversion buffer pointer */
     uint32_t *  p_buffer_start;
@@ -880,7 +1090,76 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_RGBA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_RGBA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_32_RGBA );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_32_RGBA );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -1076,7 +1355,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint32_t *  p_pic_start;       /* beginning of the current line for copy */
     /* Conversion buffer pointer */
     uint32_t *  p_buffer_start;
@@ -1119,7 +1398,76 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_BGRA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_BGRA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_32_BGRA );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_32_BGRA );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -1315,7 +1663,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     int         i_right_margin;
     int         i_rewind;
     int         i_scale_count;                       /* scale modulo counter */
-    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 2; /* chroma width */
+    int         i_chroma_width = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width + 1) / 2; /* chroma width */
     uint32_t *  p_pic_start;       /* beginning of the current line for copy */
     /* Conversion buffer pointer */
     uint32_t *  p_buffer_start;
@@ -1358,7 +1706,76 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 31;
+
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ABGR
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels. The last vector starts on an even
+         * pixel to keep the chroma samples paired, so the last pixel of an
+         * odd line is finished alone, as are lines shorter than a vector. */
+        if( i_rewind && (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+        {
+            p_y -= (i_rewind + 1) & ~1;
+            p_u -= (i_rewind + 1) >> 1;
+            p_v -= (i_rewind + 1) >> 1;
+            p_buffer -= (i_rewind + 1) & ~1;
+            AVX2_CALL (
+                AVX2_INIT_32
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ABGR
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            if( i_rewind & 1 )
+            {
+                p_buffer += 32;
+                AVX2_TAIL( 1, AVX2_PIXEL_32_ABGR );
+                p_y++;
+                p_u++;
+                p_v++;
+            }
+        }
+        else if( i_rewind )
+        {
+            AVX2_TAIL( 32 - i_rewind, AVX2_PIXEL_32_ABGR );
+            p_y += 32 - i_rewind;
+            p_u += (33 - i_rewind) >> 1;
+            p_v += (33 - i_rewind) >> 1;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -0,0 +1,224 @@
+/*****************************************************************************
+ * i420_rgb_avx2.h: AVX2 YUV transformation intrinsics
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * These are the SSE2 conversions widened to 32 pixels, with the very same
+ * arithmetic, so that all x86 converters produce identical pictures.
+ *
+ * 256-bits unpacking works within 128-bits lanes: the chroma samples are
+ * widened so that lane 0 holds pixels 0-15 and lane 1 pixels 16-31, and the
+ * packed pixels are put back in order with cross-lane permutations before
+ * being stored.
+ */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)        \
+    do {                                    \
+        __m256i ymm0, ymm1, ymm2, ymm3,     \
+                ymm4, ymm5, ymm6, ymm7;     \
+        AVX2_INSTRUCTIONS                   \
+    } while(0)
+
+#define AVX2_INIT_32                                                    \
+    ymm0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)p_u));       \
+    ymm1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)p_v));       \
+    ymm6 = _mm256_loadu_si256((__m256i *)p_y);
+
+#define AVX2_YUV_MUL                                \
+    ymm5 = _mm256_set1_epi16(0x0080);               \
+    ymm0 = _mm256_subs_epi16(ymm0, ymm5);           \
+    ymm1 = _mm256_subs_epi16(ymm1, ymm5);           \
+    ymm0 = _mm256_slli_epi16(ymm0, 3);              \
+    ymm1 = _mm256_slli_epi16(ymm1, 3);              \
+    ymm2 = _mm256_mulhi_epi16(ymm0, _mm256_set1_epi16(0xf37d)); \
+    ymm3 = _mm256_mulhi_epi16(ymm1, _mm256_set1_epi16(0xe5fc)); \
+    ymm0 = _mm256_mulhi_epi16(ymm0, _mm256_set1_epi16(0x4093)); \
+    ymm1 = _mm256_mulhi_epi16(ymm1, _mm256_set1_epi16(0x3312)); \
+    ymm2 = _mm256_adds_epi16(ymm2, ymm3);           \
+    \
+    ymm6 = _mm256_subs_epu8(ymm6, _mm256_set1_epi8(0x10)); \
+    ymm7 = _mm256_srli_epi16(ymm6, 8);              \
+    ymm6 = _mm256_and_si256(ymm6, _mm256_set1_epi16(0x00ff)); \
+    ymm6 = _mm256_slli_epi16(ymm6, 3);              \
+    ymm7 = _mm256_slli_epi16(ymm7, 3);              \
+    ymm5 = _mm256_set1_epi16(0x253f);               \
+    ymm6 = _mm256_mulhi_epi16(ymm6, ymm5);          \
+    ymm7 = _mm256_mulhi_epi16(ymm7, ymm5);
+
+/* Leaves B, R and G in ymm0, ymm1 and ymm2, pixels 0-15 in lane 0 */
+#define AVX2_YUV_ADD                                \
+    ymm3 = _mm256_adds_epi16(ymm0, ymm7);           \
+    ymm4 = _mm256_adds_epi16(ymm1, ymm7);           \
+    ymm5 = _mm256_adds_epi16(ymm2, ymm7);           \
+    ymm0 = _mm256_adds_epi16(ymm0, ymm6);           \
+    ymm1 = _mm256_adds_epi16(ymm1, ymm6);           \
+    ymm2 = _mm256_adds_epi16(ymm2, ymm6);           \
+    \
+    ymm0 = _mm256_packus_epi16(ymm0, ymm0);         \
+    ymm1 = _mm256_packus_epi16(ymm1, ymm1);         \
+    ymm2 = _mm256_packus_epi16(ymm2, ymm2);         \
+    ymm3 = _mm256_packus_epi16(ymm3, ymm3);         \
+    ymm4 = _mm256_packus_epi16(ymm4, ymm4);         \
+    ymm5 = _mm256_packus_epi16(ymm5, ymm5);         \
+    \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm3);        \
+    ymm1 = _mm256_unpacklo_epi8(ymm1, ymm4);        \
+    ymm2 = _mm256_unpacklo_epi8(ymm2, ymm5);
+
+/* Stores two registers holding pixels 0-7|16-23 and 8-15|24-31 */
+#define AVX2_STORE_16(lo, hi)                                           \
+    _mm256_storeu_si256((__m256i *)p_buffer,                            \
+                        _mm256_permute2x128_si256(lo, hi, 0x20));       \
+    _mm256_storeu_si256((__m256i *)(p_buffer + 16),                     \
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+
+#define AVX2_UNPACK_15                                  \
+    ymm5 = _mm256_set1_epi8(0xf8);                      \
+    ymm0 = _mm256_and_si256(ymm0, ymm5);                \
+    ymm0 = _mm256_srli_epi16(ymm0, 3);                  \
+    ymm2 = _mm256_and_si256(ymm2, ymm5);                \
+    ymm1 = _mm256_and_si256(ymm1, ymm5);                \
+    ymm1 = _mm256_srli_epi16(ymm1, 1);                  \
+    ymm4 = _mm256_setzero_si256();                      \
+    \
+    ymm3 = _mm256_unpacklo_epi8(ymm2, ymm4);            \
+    ymm5 = _mm256_unpacklo_epi8(ymm0, ymm1);            \
+    ymm3 = _mm256_slli_epi16(ymm3, 2);                  \
+    ymm5 = _mm256_or_si256(ymm5, ymm3);                 \
+    \
+    ymm2 = _mm256_unpackhi_epi8(ymm2, ymm4);            \
+    ymm0 = _mm256_unpackhi_epi8(ymm0, ymm1);            \
+    ymm2 = _mm256_slli_epi16(ymm2, 2);                  \
+    ymm0 = _mm256_or_si256(ymm0, ymm2);                 \
+    AVX2_STORE_16(ymm5, ymm0)
+
+#define AVX2_UNPACK_16                                  \
+    ymm5 = _mm256_set1_epi8(0xf8);                      \
+    ymm0 = _mm256_and_si256(ymm0, ymm5);                \
+    ymm1 = _mm256_and_si256(ymm1, ymm5);                \
+    ymm2 = _mm256_and_si256(ymm2, _mm256_set1_epi8(0xfc)); \
+    ymm0 = _mm256_srli_epi16(ymm0, 3);                  \
+    ymm4 = _mm256_setzero_si256();                      \
+    \
+    ymm3 = _mm256_unpacklo_epi8(ymm2, ymm4);            \
+    ymm5 = _mm256_unpacklo_epi8(ymm0, ymm1);            \
+    ymm3 = _mm256_slli_epi16(ymm3, 3);                  \
+    ymm5 = _mm256_or_si256(ymm5, ymm3);                 \
+    \
+    ymm2 = _mm256_unpackhi_epi8(ymm2, ymm4);            \
+    ymm0 = _mm256_unpackhi_epi8(ymm0, ymm1);            \
+    ymm2 = _mm256_slli_epi16(ymm2, 3);                  \
+    ymm0 = _mm256_or_si256(ymm0, ymm2);                 \
+    AVX2_STORE_16(ymm5, ymm0)
+
+/* Interleaves the bytes of four registers (first byte of each pixel first)
+ * into 32 pixels of 4 bytes, and stores them in order */
+#define AVX2_UNPACK_32(c0, c1, c2, c3)                                  \
+    ymm4 = _mm256_unpacklo_epi8(c0, c1);                                \
+    ymm5 = _mm256_unpacklo_epi8(c2, c3);                                \
+    ymm6 = _mm256_unpackhi_epi8(c0, c1);                                \
+    ymm7 = _mm256_unpackhi_epi8(c2, c3);                                \
+    c0 = _mm256_unpacklo_epi16(ymm4, ymm5);  /* pixels  0-3 | 16-19 */  \
+    c1 = _mm256_unpackhi_epi16(ymm4, ymm5);  /* pixels  4-7 | 20-23 */  \
+    c2 = _mm256_unpacklo_epi16(ymm6, ymm7);  /* pixels 8-11 | 24-27 */  \
+    c3 = _mm256_unpackhi_epi16(ymm6, ymm7);  /* pixels 12-15 | 28-31 */ \
+    _mm256_storeu_si256((__m256i *)p_buffer,                            \
+                        _mm256_permute2x128_si256(c0, c1, 0x20));       \
+    _mm256_storeu_si256((__m256i *)(p_buffer + 8),                      \
+                        _mm256_permute2x128_si256(c2, c3, 0x20));       \
+    _mm256_storeu_si256((__m256i *)(p_buffer + 16),                     \
+                        _mm256_permute2x128_si256(c0, c1, 0x31));       \
+    _mm256_storeu_si256((__m256i *)(p_buffer + 24),                     \
+                        _mm256_permute2x128_si256(c2, c3, 0x31));
+
+#define AVX2_UNPACK_32_ARGB                             \
+    ymm3 = _mm256_setzero_si256();                      \
+    AVX2_UNPACK_32(ymm0, ymm2, ymm1, ymm3)
+
+#define AVX2_UNPACK_32_RGBA                             \
+    ymm3 = _mm256_setzero_si256();                      \
+    AVX2_UNPACK_32(ymm3, ymm0, ymm2, ymm1)
+
+#define AVX2_UNPACK_32_BGRA                             \
+    ymm3 = _mm256_setzero_si256();                      \
+    AVX2_UNPACK_32(ymm3, ymm1, ymm2, ymm0)
+
+#define AVX2_UNPACK_32_ABGR                             \
+    ymm3 = _mm256_setzero_si256();                      \
+    AVX2_UNPACK_32(ymm1, ymm2, ymm0, ymm3)
+
+/*
+ * Scalar version of the arithmetic above, for lines that are too short for
+ * a whole vector.
+ */
+static inline uint8_t AVX2_Clip( int v )
+{
+    return v > 255 ? 255 : v < 0 ? 0 : v;
+}
+
+static inline int AVX2_MulHigh( int a, int b )
+{
+    return (a * b) >> 16;
+}
+
+static inline int AVX2_AddSat( int a, int b )
+{
+    int sum = a + b;
+    return sum > INT16_MAX ? INT16_MAX : sum < INT16_MIN ? INT16_MIN : sum;
+}
+
+static inline void AVX2_YUVToRGB( uint8_t y, uint8_t u, uint8_t v,
+                                  uint8_t *r, uint8_t *g, uint8_t *b )
+{
+    int cu = (u - 128) * 8, cv = (v - 128) * 8;
+    int cb = AVX2_MulHigh( cu, 0x4093 );
+    int cr = AVX2_MulHigh( cv, 0x3312 );
+    int cg = AVX2_AddSat( AVX2_MulHigh( cu, (int16_t)0xf37d ),
+                          AVX2_MulHigh( cv, (int16_t)0xe5fc ) );
+    int cy = AVX2_MulHigh( (y > 16 ? y - 16 : 0) * 8, 0x253f );
+
+    *r = AVX2_Clip( AVX2_AddSat( cr, cy ) );
+    *g = AVX2_Clip( AVX2_AddSat( cg, cy ) );
+    *b = AVX2_Clip( AVX2_AddSat( cb, cy ) );
+}
+
+#define AVX2_PIXEL_15( r, g, b ) \
+    ( (((r) & 0xf8) << 7) | (((g) & 0xf8) << 2) | ((b) >> 3) )
+#define AVX2_PIXEL_16( r, g, b ) \
+    ( (((r) & 0xf8) << 8) | (((g) & 0xfc) << 3) | ((b) >> 3) )
+#define AVX2_PIXEL_32_ARGB( r, g, b ) \
+    ( ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b) )
+#define AVX2_PIXEL_32_RGBA( r, g, b ) \
+    ( ((uint32_t)(r) << 24) | ((uint32_t)(g) << 16) | ((uint32_t)(b) << 8) )
+#define AVX2_PIXEL_32_BGRA( r, g, b ) \
+    ( ((uint32_t)(b) << 24) | ((uint32_t)(g) << 16) | ((uint32_t)(r) << 8) )
+#define AVX2_PIXEL_32_ABGR( r, g, b ) \
+    ( ((uint32_t)(b) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(r) )
+
+/* Converts the first i_count pixels of the line one by one */
+#define AVX2_TAIL( i_count, PIXEL )                                     \
+    for( unsigned i_tail = 0; i_tail < (unsigned)(i_count); i_tail++ )  \
+    {                                                                   \
+        uint8_t r, g, b;                                                \
+        AVX2_YUVToRGB( p_y[i_tail], p_u[i_tail / 2], p_v[i_tail / 2],   \
+                       &r, &g, &b );                                    \
+        p_buffer[i_tail] = PIXEL( r, g, b );                            \
+    }
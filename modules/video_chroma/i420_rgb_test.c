@@ -0,0 +1,248 @@
+/*****************************************************************************
+ * i420_rgb_test.c: x86 I420 to RGB conversions conformance test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Built once for each of the MMX, SSE2 and AVX2 variants of i420_rgb16_x86.c.
+ * Every output format is compared bit for bit against a plain C
+ * implementation of the fixed-point arithmetic that all variants share.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "i420_rgb.h"
+
+#if defined (AVX2)
+# define TEST_CPU_CAPABLE() vlc_CPU_AVX2()
+# define TEST_NAME "AVX2"
+/* Lines shorter than a vector are converted by the scalar tail */
+# define TEST_MIN_WIDTH 2
+# define TEST_ODD_WIDTH true
+#elif defined (SSE2)
+# define TEST_CPU_CAPABLE() vlc_CPU_SSE2()
+# define TEST_NAME "SSE2"
+# define TEST_MIN_WIDTH 16
+# define TEST_ODD_WIDTH false
+#else
+# define TEST_CPU_CAPABLE() vlc_CPU_MMX()
+# define TEST_NAME "MMX"
+# define TEST_MIN_WIDTH 8
+# define TEST_ODD_WIDTH false
+#endif
+
+static const struct
+{
+    const char *name;
+    vlc_fourcc_t chroma;
+    uint32_t rmask, gmask, bmask;
+    unsigned bytespp;
+    void (*convert)(filter_t *, picture_t *, picture_t *);
+} formats[] = {
+    { "R5G5B5",   VLC_CODEC_RGB15, 0x7c00, 0x03e0, 0x001f, 2, I420_R5G5B5 },
+    { "R5G6B5",   VLC_CODEC_RGB16, 0xf800, 0x07e0, 0x001f, 2, I420_R5G6B5 },
+    { "A8R8G8B8", VLC_CODEC_RGB32, 0x00ff0000, 0x0000ff00, 0x000000ff, 4,
+      I420_A8R8G8B8 },
+    { "R8G8B8A8", VLC_CODEC_RGB32, 0xff000000, 0x00ff0000, 0x0000ff00, 4,
+      I420_R8G8B8A8 },
+    { "B8G8R8A8", VLC_CODEC_RGB32, 0x0000ff00, 0x00ff0000, 0xff000000, 4,
+      I420_B8G8R8A8 },
+    { "A8B8G8R8", VLC_CODEC_RGB32, 0x000000ff, 0x0000ff00, 0x00ff0000, 4,
+      I420_A8B8G8R8 },
+};
+
+static const struct
+{
+    unsigned width, height;
+} sizes[] = {
+    { 2, 2 }, { 6, 1 }, { 8, 3 }, { 14, 5 }, { 16, 2 }, { 18, 3 },
+    { 30, 4 }, { 32, 2 }, { 34, 5 }, { 48, 4 }, { 62, 7 }, { 64, 3 },
+    { 96, 1 }, { 200, 9 }, { 720, 3 }, { 1922, 3 },
+    /* Odd widths, and widths that are not a multiple of any vector size */
+    { 3, 3 }, { 7, 2 }, { 15, 3 }, { 17, 4 }, { 31, 1 }, { 33, 5 },
+    { 47, 2 }, { 63, 3 }, { 65, 7 }, { 99, 2 }, { 201, 3 }, { 719, 5 },
+    { 1921, 2 }, { 22, 3 }, { 42, 2 }, { 70, 5 }, { 202, 4 }, { 1926, 1 },
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/* Signed 16-bits multiplication keeping the high half, as pmulhw */
+static int MulHigh(int a, int b)
+{
+    return (a * b) >> 16;
+}
+
+static int AddSat(int a, int b)
+{
+    return VLC_CLIP(a + b, INT16_MIN, INT16_MAX);
+}
+
+static uint32_t Reference(uint8_t y, uint8_t u, uint8_t v,
+                          uint32_t rmask, uint32_t gmask, uint32_t bmask)
+{
+    int cb = MulHigh((u - 128) * 8, 16531);
+    int cr = MulHigh((v - 128) * 8, 13074);
+    int cg = AddSat(MulHigh((u - 128) * 8, -3203),
+                    MulHigh((v - 128) * 8, -6660));
+    int cy = MulHigh((y >= 16 ? y - 16 : 0) * 8, 9535);
+
+    unsigned r = VLC_CLIP(AddSat(cr, cy), 0, 255);
+    unsigned g = VLC_CLIP(AddSat(cg, cy), 0, 255);
+    unsigned b = VLC_CLIP(AddSat(cb, cy), 0, 255);
+
+    return ((r >> (8 - vlc_popcount(rmask))) << ctz(rmask))
+         | ((g >> (8 - vlc_popcount(gmask))) << ctz(gmask))
+         | ((b >> (8 - vlc_popcount(bmask))) << ctz(bmask));
+}
+
+static int Test(size_t f, unsigned width, unsigned height)
+{
+    video_format_t fmt_in, fmt_out;
+
+    video_format_Init(&fmt_in, VLC_CODEC_I420);
+    video_format_Setup(&fmt_in, VLC_CODEC_I420, width, height, width, height,
+                       1, 1);
+    video_format_Init(&fmt_out, formats[f].chroma);
+    video_format_Setup(&fmt_out, formats[f].chroma, width, height,
+                       width, height, 1, 1);
+    fmt_out.i_rmask = formats[f].rmask;
+    fmt_out.i_gmask = formats[f].gmask;
+    fmt_out.i_bmask = formats[f].bmask;
+
+    picture_t *src = picture_NewFromFormat(&fmt_in);
+    picture_t *dst = picture_NewFromFormat(&fmt_out);
+    assert(src != NULL && dst != NULL);
+
+    for (int i = 0; i < src->i_planes; i++)
+    {
+        const plane_t *p = &src->p[i];
+
+        for (int j = 0; j < p->i_pitch * p->i_lines; j++)
+            p->p_pixels[j] = Random();
+    }
+    memset(dst->p[0].p_pixels, 0xA5, dst->p[0].i_pitch * dst->p[0].i_lines);
+
+    filter_sys_t sys = {
+        .i_bytespp = formats[f].bytespp,
+        .p_offset = malloc(width * sizeof (int)),
+    };
+    filter_t filter = { .p_sys = &sys };
+
+    assert(sys.p_offset != NULL);
+    filter.fmt_in.video = fmt_in;
+    filter.fmt_out.video = fmt_out;
+
+    formats[f].convert(&filter, src, dst);
+
+    int ret = 0;
+
+    for (unsigned y = 0; y < height && ret == 0; y++)
+    {
+        const uint8_t *py = src->p[0].p_pixels + y * src->p[0].i_pitch;
+        const uint8_t *pu = src->p[1].p_pixels + (y / 2) * src->p[1].i_pitch;
+        const uint8_t *pv = src->p[2].p_pixels + (y / 2) * src->p[2].i_pitch;
+        const uint8_t *out = dst->p[0].p_pixels + y * dst->p[0].i_pitch;
+
+        for (unsigned x = 0; x < width; x++)
+        {
+            uint32_t expected = Reference(py[x], pu[x / 2], pv[x / 2],
+                                          formats[f].rmask, formats[f].gmask,
+                                          formats[f].bmask);
+            uint32_t value;
+
+            if (formats[f].bytespp == 2)
+                value = ((const uint16_t *)out)[x];
+            else
+                value = ((const uint32_t *)out)[x];
+
+            if (value != expected)
+            {
+                fprintf(stderr, "%s %s %ux%u: pixel (%u,%u) is 0x%08"PRIx32
+                        " instead of 0x%08"PRIx32"\n", TEST_NAME,
+                        formats[f].name, width, height, x, y, value,
+                        expected);
+                ret = -1;
+                break;
+            }
+        }
+
+        /* Nothing may be written past the end of the line */
+        for (int x = width * formats[f].bytespp; x < dst->p[0].i_pitch; x++)
+            if (out[x] != 0xA5)
+            {
+                fprintf(stderr, "%s %s %ux%u: line %u overflows\n", TEST_NAME,
+                        formats[f].name, width, height, y);
+                ret = -1;
+                break;
+            }
+    }
+
+    free(sys.p_offset);
+    free(sys.p_buffer);
+    picture_Release(dst);
+    picture_Release(src);
+    video_format_Clean(&fmt_out);
+    video_format_Clean(&fmt_in);
+    return ret;
+}
+
+int main(void)
+{
+    alarm(10);
+
+    if (!TEST_CPU_CAPABLE())
+    {
+        fprintf(stderr, "WARNING: could not test %s\n", TEST_NAME);
+        return 77;
+    }
+
+    for (size_t f = 0; f < ARRAY_SIZE(formats); f++)
+        for (size_t s = 0; s < ARRAY_SIZE(sizes); s++)
+        {
+            /* The SSE2 and MMX converters rewind over the line start */
+            if (sizes[s].width < TEST_MIN_WIDTH)
+                continue;
+            /* and they pair the chroma samples wrongly on odd lines */
+            if ((sizes[s].width & 1) && !TEST_ODD_WIDTH)
+                continue;
+            if (Test(f, sizes[s].width, sizes[s].height))
+                return 1;
+        }
+
+    return 0;
+}
@@ -218,6 +218,8 @@ static int Create( vlc_object_t *p_this )
     var_AddCallback( p_filter, "brightness-threshold", BoolCallback,
                      &p_sys->b_brightness_threshold );
 
+    p_filter->b_inplace = video_format_IsSimilar( &p_filter->fmt_in.video,
+                                                  &p_filter->fmt_out.video );
     return VLC_SUCCESS;
 }
 
@@ -27,15 +27,31 @@
 # include "config.h"
 #endif
 
+#ifdef BLEND_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#ifndef BLEND_TEST
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
@@ -44,6 +60,7 @@ vlc_module_begin()
     set_capability("video blending", 100)
     set_callbacks(Open, Close)
 vlc_module_end()
+#endif
 
 static inline unsigned div255(unsigned v)
 {
@@ -558,6 +575,725 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
     }
 }
 
+/*****************************************************************************
+ * Line kernels
+ *
+ * The most common blends go through kernels working on whole lines of 8-bits
+ * samples. They give exactly the same results as the per-pixel code above.
+ *****************************************************************************/
+namespace {
+
+struct CBlendKernels {
+    /* Merges n samples of src, taken every step samples, with their alpha,
+     * into dst */
+    void (*plane)(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                  unsigned step, unsigned n, int alpha);
+    /* Merges n samples of srcu and srcv, taken every 2 samples, with their
+     * alpha, into the interleaved dst */
+    void (*planeUV)(uint8_t *dst, const uint8_t *srcu, const uint8_t *srcv,
+                    const uint8_t *srca, unsigned n, int alpha);
+    /* Merges n RGBA pixels into 32-bits RGB pixels, the red, green and blue
+     * components going at the given byte offsets */
+    void (*rgbx)(uint8_t *dst, const uint8_t *src, unsigned n, int alpha,
+                 const unsigned offsets[3]);
+    /* Converts n RGBA pixels into planar YUVA */
+    void (*rgbaToYuva)(uint8_t *const yuva[4], const uint8_t *src,
+                       unsigned n);
+};
+
+static void BlendPlane_c(uint8_t *dst, const uint8_t *src,
+                         const uint8_t *srca, unsigned step, unsigned n,
+                         int alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+        merge(&dst[i], src[i * step], div255(alpha * srca[i * step]));
+}
+
+static void BlendPlaneUV_c(uint8_t *dst, const uint8_t *srcu,
+                           const uint8_t *srcv, const uint8_t *srca,
+                           unsigned n, int alpha)
+{
+    for (unsigned i = 0; i < n; i++) {
+        const unsigned a = div255(alpha * srca[2 * i]);
+
+        merge(&dst[2 * i + 0], srcu[2 * i], a);
+        merge(&dst[2 * i + 1], srcv[2 * i], a);
+    }
+}
+
+static void BlendRGBX_c(uint8_t *dst, const uint8_t *src, unsigned n,
+                        int alpha, const unsigned offsets[3])
+{
+    for (unsigned i = 0; i < n; i++, dst += 4, src += 4) {
+        const unsigned a = div255(alpha * src[3]);
+
+        merge(&dst[offsets[0]], src[0], a);
+        merge(&dst[offsets[1]], src[1], a);
+        merge(&dst[offsets[2]], src[2], a);
+    }
+}
+
+static void RGBAToYUVA_c(uint8_t *const yuva[4], const uint8_t *src,
+                         unsigned n)
+{
+    for (unsigned i = 0; i < n; i++, src += 4) {
+        rgb_to_yuv(&yuva[0][i], &yuva[1][i], &yuva[2][i],
+                   src[0], src[1], src[2]);
+        yuva[3][i] = src[3];
+    }
+}
+
+static const CBlendKernels blend_kernels_c = {
+    BlendPlane_c, BlendPlaneUV_c, BlendRGBX_c, RGBAToYUVA_c,
+};
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* div255() of 16-bits lanes holding at most 255 * 255 */
+VLC_SSE2
+static inline __m128i Div255_sse2(__m128i v)
+{
+    v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)),
+                      _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+/* merge() of 16 samples, with their alpha before scaling */
+VLC_SSE2
+static inline __m128i Merge_sse2(__m128i dst, __m128i src, __m128i a,
+                                 __m128i alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    __m128i out[2];
+
+    for (int i = 0; i < 2; i++) {
+        __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+        __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+        __m128i f = i ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+
+        f = Div255_sse2(_mm_mullo_epi16(f, alpha));
+        out[i] = Div255_sse2(_mm_add_epi16(
+                    _mm_mullo_epi16(_mm_sub_epi16(full, f), d),
+                    _mm_mullo_epi16(s, f)));
+    }
+    return _mm_packus_epi16(out[0], out[1]);
+}
+
+/* Even bytes of 32 bytes */
+VLC_SSE2
+static inline __m128i LoadEven_sse2(const uint8_t *p)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+
+    return _mm_packus_epi16(
+        _mm_and_si128(_mm_loadu_si128((const __m128i *)p), mask),
+        _mm_and_si128(_mm_loadu_si128((const __m128i *)(p + 16)), mask));
+}
+
+VLC_SSE2
+static void BlendPlane_sse2(uint8_t *dst, const uint8_t *src,
+                            const uint8_t *srca, unsigned step, unsigned n,
+                            int alpha)
+{
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    if (step == 1) {
+        for (; i + 16 <= n; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i a = _mm_loadu_si128((const __m128i *)&srca[i]);
+
+            _mm_storeu_si128((__m128i *)&dst[i], Merge_sse2(d, s, a, valpha));
+        }
+    } else {
+        assert(step == 2);
+        /* Do not read past the last sample */
+        for (; i + 16 < n; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s = LoadEven_sse2(&src[2 * i]);
+            __m128i a = LoadEven_sse2(&srca[2 * i]);
+
+            _mm_storeu_si128((__m128i *)&dst[i], Merge_sse2(d, s, a, valpha));
+        }
+    }
+    BlendPlane_c(&dst[i], &src[i * step], &srca[i * step], step, n - i,
+                 alpha);
+}
+
+VLC_SSE2
+static void BlendPlaneUV_sse2(uint8_t *dst, const uint8_t *srcu,
+                              const uint8_t *srcv, const uint8_t *srca,
+                              unsigned n, int alpha)
+{
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 < n; i += 16) {
+        __m128i u = LoadEven_sse2(&srcu[2 * i]);
+        __m128i v = LoadEven_sse2(&srcv[2 * i]);
+        __m128i a = LoadEven_sse2(&srca[2 * i]);
+
+        for (int h = 0; h < 2; h++) {
+            uint8_t *p = &dst[2 * i + 16 * h];
+            __m128i s = h ? _mm_unpackhi_epi8(u, v) : _mm_unpacklo_epi8(u, v);
+            __m128i f = h ? _mm_unpackhi_epi8(a, a) : _mm_unpacklo_epi8(a, a);
+            __m128i d = _mm_loadu_si128((const __m128i *)p);
+
+            _mm_storeu_si128((__m128i *)p, Merge_sse2(d, s, f, valpha));
+        }
+    }
+    BlendPlaneUV_c(&dst[2 * i], &srcu[2 * i], &srcv[2 * i], &srca[2 * i],
+                   n - i, alpha);
+}
+
+VLC_SSE2
+static void BlendRGBX_sse2(uint8_t *dst, const uint8_t *src, unsigned n,
+                           int alpha, const unsigned offsets[3])
+{
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    const __m128i byte = _mm_set1_epi32(0xff);
+    __m128i shift[3], keep = _mm_setzero_si128();
+    unsigned i = 0;
+
+    for (int c = 0; c < 3; c++) {
+        shift[c] = _mm_cvtsi32_si128(8 * offsets[c]);
+        keep = _mm_or_si128(keep, _mm_sll_epi32(byte, shift[c]));
+    }
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+
+        /* Move the components to their destination bytes */
+        __m128i p = _mm_or_si128(
+            _mm_or_si128(
+                _mm_sll_epi32(_mm_and_si128(s, byte), shift[0]),
+                _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(s, 8), byte),
+                              shift[1])),
+            _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(s, 16), byte),
+                          shift[2]));
+        __m128i a = _mm_srli_epi32(s, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+        __m128i m = Merge_sse2(d, p, a, valpha);
+        _mm_storeu_si128((__m128i *)&dst[4 * i],
+                         _mm_or_si128(_mm_and_si128(m, keep),
+                                      _mm_andnot_si128(keep, d)));
+    }
+    BlendRGBX_c(&dst[4 * i], &src[4 * i], n - i, alpha, offsets);
+}
+
+/* rgb_to_yuv() of 4 pixels, the red and blue components being in the 16-bits
+ * lanes of rb, the green ones in the low lanes of g */
+VLC_SSE2
+static inline __m128i RGBToYUV_sse2(__m128i rb, __m128i g,
+                                    int cr, int cg, int cb, int offset)
+{
+    __m128i v = _mm_add_epi32(
+        _mm_madd_epi16(rb, _mm_set1_epi32((cr & 0xffff) | ((unsigned)cb << 16))),
+        _mm_madd_epi16(g, _mm_set1_epi32(cg & 0xffff)));
+
+    v = _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(128)), 8);
+    return _mm_add_epi32(v, _mm_set1_epi32(offset));
+}
+
+VLC_SSE2
+static void RGBAToYUVA_sse2(uint8_t *const yuva[4], const uint8_t *src,
+                            unsigned n)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i y[4], u[4], v[4], a[4];
+
+        for (int j = 0; j < 4; j++) {
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * (i + 4 * j)]);
+            __m128i rb = _mm_and_si128(s, mask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(s, 8),
+                                      _mm_set1_epi32(0xff));
+
+            y[j] = RGBToYUV_sse2(rb, g,  66, 129,  25,  16);
+            u[j] = RGBToYUV_sse2(rb, g, -38, -74, 112, 128);
+            v[j] = RGBToYUV_sse2(rb, g, 112, -94, -18, 128);
+            a[j] = _mm_srli_epi32(s, 24);
+        }
+
+        __m128i *const planes[4] = { y, u, v, a };
+        for (int p = 0; p < 4; p++) {
+            __m128i *w = planes[p];
+            _mm_storeu_si128((__m128i *)&yuva[p][i],
+                             _mm_packus_epi16(_mm_packs_epi32(w[0], w[1]),
+                                              _mm_packs_epi32(w[2], w[3])));
+        }
+    }
+
+    uint8_t *const tail[4] = {
+        &yuva[0][i], &yuva[1][i], &yuva[2][i], &yuva[3][i],
+    };
+    RGBAToYUVA_c(tail, &src[4 * i], n - i);
+}
+
+static const CBlendKernels blend_kernels_sse2 = {
+    BlendPlane_sse2, BlendPlaneUV_sse2, BlendRGBX_sse2, RGBAToYUVA_sse2,
+};
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline __m256i Div255_avx2(__m256i v)
+{
+    v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)),
+                         _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+/* Unpacking and packing within lanes keep the order of the samples */
+VLC_AVX2
+static inline __m256i Merge_avx2(__m256i dst, __m256i src, __m256i a,
+                                 __m256i alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    __m256i out[2];
+
+    for (int i = 0; i < 2; i++) {
+        __m256i d = i ? _mm256_unpackhi_epi8(dst, zero) : _mm256_unpacklo_epi8(dst, zero);
+        __m256i s = i ? _mm256_unpackhi_epi8(src, zero) : _mm256_unpacklo_epi8(src, zero);
+        __m256i f = i ? _mm256_unpackhi_epi8(a, zero) : _mm256_unpacklo_epi8(a, zero);
+
+        f = Div255_avx2(_mm256_mullo_epi16(f, alpha));
+        out[i] = Div255_avx2(_mm256_add_epi16(
+                    _mm256_mullo_epi16(_mm256_sub_epi16(full, f), d),
+                    _mm256_mullo_epi16(s, f)));
+    }
+    return _mm256_packus_epi16(out[0], out[1]);
+}
+
+/* Even bytes of 64 bytes, as 8 bytes blocks in the order 0 2 1 3 */
+VLC_AVX2
+static inline __m256i LoadEvenLanes_avx2(const uint8_t *p)
+{
+    const __m256i mask = _mm256_set1_epi16(0xff);
+
+    return _mm256_packus_epi16(
+        _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p), mask),
+        _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(p + 32)), mask));
+}
+
+VLC_AVX2
+static inline __m256i LoadEven_avx2(const uint8_t *p)
+{
+    return _mm256_permute4x64_epi64(LoadEvenLanes_avx2(p), 0xD8);
+}
+
+VLC_AVX2
+static void BlendPlane_avx2(uint8_t *dst, const uint8_t *src,
+                            const uint8_t *srca, unsigned step, unsigned n,
+                            int alpha)
+{
+    const __m256i valpha = _mm256_set1_epi16(alpha);
+    unsigned i = 0;
+
+    if (step == 1) {
+        for (; i + 32 <= n; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i a = _mm256_loadu_si256((const __m256i *)&srca[i]);
+
+            _mm256_storeu_si256((__m256i *)&dst[i],
+                                Merge_avx2(d, s, a, valpha));
+        }
+    } else {
+        assert(step == 2);
+        for (; i + 32 < n; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s = LoadEven_avx2(&src[2 * i]);
+            __m256i a = LoadEven_avx2(&srca[2 * i]);
+
+            _mm256_storeu_si256((__m256i *)&dst[i],
+                                Merge_avx2(d, s, a, valpha));
+        }
+    }
+    BlendPlane_c(&dst[i], &src[i * step], &srca[i * step], step, n - i,
+                 alpha);
+}
+
+VLC_AVX2
+static void BlendPlaneUV_avx2(uint8_t *dst, const uint8_t *srcu,
+                              const uint8_t *srcv, const uint8_t *srca,
+                              unsigned n, int alpha)
+{
+    const __m256i valpha = _mm256_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 32 < n; i += 32) {
+        /* Interleaving within lanes reads the blocks 0 and 2 then 1 and 3,
+         * which is where LoadEvenLanes_avx2() leaves the samples 0-15 and
+         * 16-31 */
+        __m256i u = LoadEvenLanes_avx2(&srcu[2 * i]);
+        __m256i v = LoadEvenLanes_avx2(&srcv[2 * i]);
+        __m256i a = LoadEvenLanes_avx2(&srca[2 * i]);
+
+        for (int h = 0; h < 2; h++) {
+            uint8_t *p = &dst[2 * i + 32 * h];
+            __m256i s = h ? _mm256_unpackhi_epi8(u, v) : _mm256_unpacklo_epi8(u, v);
+            __m256i f = h ? _mm256_unpackhi_epi8(a, a) : _mm256_unpacklo_epi8(a, a);
+            __m256i d = _mm256_loadu_si256((const __m256i *)p);
+
+            _mm256_storeu_si256((__m256i *)p, Merge_avx2(d, s, f, valpha));
+        }
+    }
+    BlendPlaneUV_c(&dst[2 * i], &srcu[2 * i], &srcv[2 * i], &srca[2 * i],
+                   n - i, alpha);
+}
+
+VLC_AVX2
+static void BlendRGBX_avx2(uint8_t *dst, const uint8_t *src, unsigned n,
+                           int alpha, const unsigned offsets[3])
+{
+    const __m256i valpha = _mm256_set1_epi16(alpha);
+    const __m256i byte = _mm256_set1_epi32(0xff);
+    __m128i shift[3];
+    __m256i keep = _mm256_setzero_si256();
+    unsigned i = 0;
+
+    for (int c = 0; c < 3; c++) {
+        shift[c] = _mm_cvtsi32_si128(8 * offsets[c]);
+        keep = _mm256_or_si256(keep, _mm256_sll_epi32(byte, shift[c]));
+    }
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+
+        __m256i p = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_sll_epi32(_mm256_and_si256(s, byte), shift[0]),
+                _mm256_sll_epi32(_mm256_and_si256(_mm256_srli_epi32(s, 8),
+                                                  byte), shift[1])),
+            _mm256_sll_epi32(_mm256_and_si256(_mm256_srli_epi32(s, 16), byte),
+                             shift[2]));
+        __m256i a = _mm256_srli_epi32(s, 24);
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 8));
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+
+        __m256i m = Merge_avx2(d, p, a, valpha);
+        _mm256_storeu_si256((__m256i *)&dst[4 * i],
+                            _mm256_or_si256(_mm256_and_si256(m, keep),
+                                            _mm256_andnot_si256(keep, d)));
+    }
+    BlendRGBX_c(&dst[4 * i], &src[4 * i], n - i, alpha, offsets);
+}
+
+VLC_AVX2
+static inline __m256i RGBToYUV_avx2(__m256i rb, __m256i g,
+                                    int cr, int cg, int cb, int offset)
+{
+    __m256i v = _mm256_add_epi32(
+        _mm256_madd_epi16(rb, _mm256_set1_epi32((cr & 0xffff) | ((unsigned)cb << 16))),
+        _mm256_madd_epi16(g, _mm256_set1_epi32(cg & 0xffff)));
+
+    v = _mm256_srai_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(128)), 8);
+    return _mm256_add_epi32(v, _mm256_set1_epi32(offset));
+}
+
+VLC_AVX2
+static void RGBAToYUVA_avx2(uint8_t *const yuva[4], const uint8_t *src,
+                            unsigned n)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00ff00ff);
+    /* Packing within lanes leaves the 4 pixels groups as 0 2 4 6 1 3 5 7 */
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    unsigned i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i y[4], u[4], v[4], a[4];
+
+        for (int j = 0; j < 4; j++) {
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * (i + 8 * j)]);
+            __m256i rb = _mm256_and_si256(s, mask);
+            __m256i g = _mm256_and_si256(_mm256_srli_epi32(s, 8),
+                                         _mm256_set1_epi32(0xff));
+
+            y[j] = RGBToYUV_avx2(rb, g,  66, 129,  25,  16);
+            u[j] = RGBToYUV_avx2(rb, g, -38, -74, 112, 128);
+            v[j] = RGBToYUV_avx2(rb, g, 112, -94, -18, 128);
+            a[j] = _mm256_srli_epi32(s, 24);
+        }
+
+        __m256i *const planes[4] = { y, u, v, a };
+        for (int p = 0; p < 4; p++) {
+            __m256i *w = planes[p];
+            __m256i b = _mm256_packus_epi16(_mm256_packs_epi32(w[0], w[1]),
+                                            _mm256_packs_epi32(w[2], w[3]));
+            _mm256_storeu_si256((__m256i *)&yuva[p][i],
+                                _mm256_permutevar8x32_epi32(b, order));
+        }
+    }
+
+    uint8_t *const tail[4] = {
+        &yuva[0][i], &yuva[1][i], &yuva[2][i], &yuva[3][i],
+    };
+    RGBAToYUVA_c(tail, &src[4 * i], n - i);
+}
+
+static const CBlendKernels blend_kernels_avx2 = {
+    BlendPlane_avx2, BlendPlaneUV_avx2, BlendRGBX_avx2, RGBAToYUVA_avx2,
+};
+#endif
+
+/* Sources of lines of planar YUVA samples */
+class CLineYUVA : public CPicture {
+public:
+    static const bool buffered = false;
+
+    CLineYUVA(const CPicture &cfg, uint8_t *, unsigned) : CPicture(cfg)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = CPicture::getLine<1>(i) + x;
+    }
+    const uint8_t *const *get(const CBlendKernels *, unsigned) const
+    {
+        return data;
+    }
+    void nextLine()
+    {
+        y++;
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+private:
+    const uint8_t *data[4];
+};
+
+class CLineRGBA : public CPicture {
+public:
+    static const bool buffered = true;
+
+    CLineRGBA(const CPicture &cfg, uint8_t *buffer, unsigned width) : CPicture(cfg)
+    {
+        data = CPicture::getLine<1>(0) + 4 * x;
+        for (unsigned i = 0; i < 4; i++)
+            yuva[i] = &buffer[i * width];
+    }
+    const uint8_t *const *get(const CBlendKernels *kernels, unsigned width)
+    {
+        kernels->rgbaToYuva(yuva, data, width);
+        return yuva;
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    const uint8_t *data;
+    uint8_t *yuva[4];
+};
+
+class CLineYUVP : public CPicture {
+public:
+    static const bool buffered = true;
+
+    CLineYUVP(const CPicture &cfg, uint8_t *buffer, unsigned width) : CPicture(cfg)
+    {
+        const video_palette_t *palette = fmt->p_palette;
+
+        data = CPicture::getLine<1>(0) + x;
+        for (unsigned i = 0; i < 4; i++)
+            yuva[i] = &buffer[i * width];
+        for (unsigned i = 0; i < 256; i++)
+            entries[i] = palette->palette[i][0]
+                       | (palette->palette[i][1] << 8)
+                       | (palette->palette[i][2] << 16)
+                       | ((uint32_t)palette->palette[i][3] << 24);
+    }
+    const uint8_t *const *get(const CBlendKernels *, unsigned width)
+    {
+        const uint8_t *src = data;
+        uint8_t *y = yuva[0], *u = yuva[1], *v = yuva[2], *a = yuva[3];
+
+        for (unsigned i = 0; i < width; i++) {
+            const uint32_t entry = entries[src[i]];
+
+            y[i] = entry;
+            u[i] = entry >> 8;
+            v[i] = entry >> 16;
+            a[i] = entry >> 24;
+        }
+        return yuva;
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    const uint8_t *data;
+    uint8_t *yuva[4];
+    uint32_t entries[256];
+};
+
+/* Source of lines of packed pixels */
+class CLinePacked : public CPicture {
+public:
+    static const bool buffered = false;
+
+    CLinePacked(const CPicture &cfg, uint8_t *, unsigned) : CPicture(cfg)
+    {
+        data = CPicture::getLine<1>(0) + 4 * x;
+    }
+    const uint8_t *const *get(const CBlendKernels *, unsigned) const
+    {
+        return &data;
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    const uint8_t *data;
+};
+
+template <bool swap_uv>
+class CBlendI420 : public CPicture {
+public:
+    CBlendI420(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine<1>(0) + x;
+        data[1] = CPicture::getLine<2>(swap_uv ? 2 : 1);
+        data[2] = CPicture::getLine<2>(swap_uv ? 1 : 2);
+    }
+    void blend(const CBlendKernels *kernels, const uint8_t *const *yuva,
+               unsigned width, int alpha)
+    {
+        kernels->plane(data[0], yuva[0], yuva[3], 1, width, alpha);
+
+        /* Chroma is merged from the pixels on even lines and columns */
+        const unsigned first = x % 2;
+        if ((y % 2) != 0 || width <= first)
+            return;
+
+        const unsigned n = (width - first + 1) / 2;
+        for (unsigned i = 1; i <= 2; i++)
+            kernels->plane(&data[i][(x + first) / 2], &yuva[i][first],
+                           &yuva[3][first], 2, n, alpha);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0) {
+            data[1] += picture->p[swap_uv ? 2 : 1].i_pitch;
+            data[2] += picture->p[swap_uv ? 1 : 2].i_pitch;
+        }
+    }
+private:
+    uint8_t *data[3];
+};
+
+template <bool swap_uv>
+class CBlendNV12 : public CPicture {
+public:
+    CBlendNV12(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine<1>(0) + x;
+        data[1] = CPicture::getLine<2>(1);
+    }
+    void blend(const CBlendKernels *kernels, const uint8_t *const *yuva,
+               unsigned width, int alpha)
+    {
+        kernels->plane(data[0], yuva[0], yuva[3], 1, width, alpha);
+
+        const unsigned first = x % 2;
+        if ((y % 2) != 0 || width <= first)
+            return;
+
+        kernels->planeUV(&data[1][x + first],
+                         &yuva[swap_uv ? 2 : 1][first],
+                         &yuva[swap_uv ? 1 : 2][first],
+                         &yuva[3][first], (width - first + 1) / 2, alpha);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0)
+            data[1] += picture->p[1].i_pitch;
+    }
+private:
+    uint8_t *data[2];
+};
+
+class CBlendRGBX : public CPicture {
+public:
+    CBlendRGBX(const CPicture &cfg) : CPicture(cfg)
+    {
+        int r, g, b;
+
+        if (GetPackedRgbIndexes(fmt, &r, &g, &b) != VLC_SUCCESS) {
+            r = 0;
+            g = 1;
+            b = 2;
+        }
+        offsets[0] = r;
+        offsets[1] = g;
+        offsets[2] = b;
+        data = CPicture::getLine<1>(0) + 4 * x;
+    }
+    void blend(const CBlendKernels *kernels, const uint8_t *const *lines,
+               unsigned width, int alpha)
+    {
+        kernels->rgbx(data, lines[0], width, alpha, offsets);
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    unsigned offsets[3];
+    uint8_t *data;
+};
+
+} // namespace
+
+template <class TDst, class TSrc>
+bool BlendLines(const CBlendKernels *kernels,
+                const CPicture &dst_data, const CPicture &src_data,
+                unsigned width, unsigned height, int alpha)
+{
+    uint8_t *buffer = NULL;
+
+    if (TSrc::buffered) {
+        buffer = (uint8_t *)malloc(4 * width);
+        if (unlikely(buffer == NULL))
+            return false;
+    }
+
+    TSrc src(src_data, buffer, width);
+    TDst dst(dst_data);
+
+    for (unsigned y = 0; y < height; y++) {
+        dst.blend(kernels, src.get(kernels, width), width, alpha);
+        src.nextLine();
+        dst.nextLine();
+    }
+
+    free(buffer);
+    return true;
+}
+
+typedef bool (*blend_lines_function_t)(const CBlendKernels *kernels,
+                                       const CPicture &dst_data,
+                                       const CPicture &src_data,
+                                       unsigned width, unsigned height,
+                                       int alpha);
+
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
@@ -637,15 +1373,53 @@ static const struct {
 #undef YUV
 };
 
+static const struct {
+    vlc_fourcc_t           dst;
+    vlc_fourcc_t           src;
+    blend_lines_function_t blend;
+} blends_lines[] = {
+#define YUV(csp, picture) \
+    { csp, VLC_CODEC_YUVA, BlendLines<picture, CLineYUVA> }, \
+    { csp, VLC_CODEC_RGBA, BlendLines<picture, CLineRGBA> }, \
+    { csp, VLC_CODEC_YUVP, BlendLines<picture, CLineYUVP> }
+
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendLines<CBlendRGBX, CLinePacked> },
+
+    YUV(VLC_CODEC_YV12,     CBlendI420<true>),
+    YUV(VLC_CODEC_NV12,     CBlendNV12<false>),
+    YUV(VLC_CODEC_NV21,     CBlendNV12<true>),
+    YUV(VLC_CODEC_J420,     CBlendI420<false>),
+    YUV(VLC_CODEC_I420,     CBlendI420<false>),
+
+#undef YUV
+};
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), blend_lines(NULL), kernels(NULL)
     {
     }
     blend_function_t blend;
+    /* Faster version of blend, if any */
+    blend_lines_function_t blend_lines;
+    const CBlendKernels *kernels;
 };
 
 } // namespace
 
+#ifndef BLEND_TEST
+static const CBlendKernels *GetBlendKernels()
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return &blend_kernels_avx2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return &blend_kernels_sse2;
+#endif
+    return NULL;
+}
+
 /**
  * It blends 2 picture together.
  */
@@ -671,13 +1445,17 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+
+    if (sys->blend_lines == NULL
+     || !sys->blend_lines(sys->kernels, dst_data, src_data,
+                          width, height, alpha))
+        sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -699,6 +1477,14 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
+    sys->kernels = GetBlendKernels();
+    if (sys->kernels != NULL) {
+        for (size_t i = 0; i < sizeof(blends_lines) / sizeof(*blends_lines); i++) {
+            if (blends_lines[i].src == src && blends_lines[i].dst == dst)
+                sys->blend_lines = blends_lines[i].blend;
+        }
+    }
+
     filter->pf_video_blend = Blend;
     filter->p_sys          = sys;
     return VLC_SUCCESS;
@@ -711,3 +1497,183 @@ static void Close(vlc_object_t *object)
     delete p_sys;
 }
 
+#else /* BLEND_TEST */
+/*
+ * The line kernels are compared bit for bit against the per-pixel code, for
+ * each pair of chromas they support, at odd and even offsets.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height, const uint32_t masks[3])
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, chroma);
+    video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+    if (masks != NULL) {
+        fmt.i_rmask = masks[0];
+        fmt.i_gmask = masks[1];
+        fmt.i_bmask = masks[2];
+    }
+    if (chroma == VLC_CODEC_YUVP) {
+        /* Pictures do not own their palette */
+        static video_palette_t palette;
+
+        palette.i_entries = 256;
+        for (int i = 0; i < 256; i++)
+            for (int c = 0; c < 4; c++)
+                palette.palette[i][c] = Random();
+        fmt.p_palette = &palette;
+    }
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_pitch * pic->p[i].i_lines; j++) {
+            uint8_t v = Random();
+            /* Favour fully transparent and opaque pixels */
+            if (v < 32)
+                v = 0;
+            else if (v >= 224)
+                v = 255;
+            pic->p[i].p_pixels[j] = v;
+        }
+    return pic;
+}
+
+static bool PictureEqual(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+        if (memcmp(a->p[i].p_pixels, b->p[i].p_pixels,
+                   a->p[i].i_pitch * a->p[i].i_lines))
+            return false;
+    return true;
+}
+
+static const struct {
+    const char *name;
+    const CBlendKernels *kernels;
+    unsigned cpu;
+} kernels[] = {
+    { "C", &blend_kernels_c, 0 },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", &blend_kernels_sse2, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", &blend_kernels_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static void CopyBuffers(picture_t *dst, const picture_t *src)
+{
+    for (int i = 0; i < src->i_planes; i++)
+        memcpy(dst->p[i].p_pixels, src->p[i].p_pixels,
+               src->p[i].i_pitch * src->p[i].i_lines);
+}
+
+static int Test(size_t l, const uint32_t masks[3],
+                unsigned width, unsigned height, unsigned x, unsigned y,
+                int alpha)
+{
+    const vlc_fourcc_t dst_chroma = blends_lines[l].dst;
+    const vlc_fourcc_t src_chroma = blends_lines[l].src;
+    blend_function_t blend = NULL;
+    int ret = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(blends); i++)
+        if (blends[i].dst == dst_chroma && blends[i].src == src_chroma)
+            blend = blends[i].blend;
+    assert(blend != NULL);
+
+    picture_t *src = NewPicture(src_chroma, width, height, NULL);
+    picture_t *ref = NewPicture(dst_chroma, width + x + 5, height + y + 3,
+                                masks);
+    picture_t *dst = NewPicture(dst_chroma, width + x + 5, height + y + 3,
+                                masks);
+
+    video_format_FixRgb(&ref->format);
+    video_format_FixRgb(&dst->format);
+    CopyBuffers(dst, ref);
+
+    blend(CPicture(ref, &ref->format, x, y), CPicture(src, &src->format, 0, 0),
+          width, height, alpha);
+
+    /* Each version blends onto a copy of the original destination */
+    picture_t *orig = NewPicture(dst_chroma, width + x + 5, height + y + 3,
+                                 masks);
+    CopyBuffers(orig, dst);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels) && ret == 0; k++) {
+        if ((vlc_CPU() & kernels[k].cpu) != kernels[k].cpu)
+            continue;
+
+        CopyBuffers(dst, orig);
+        if (!blends_lines[l].blend(kernels[k].kernels,
+                                   CPicture(dst, &dst->format, x, y),
+                                   CPicture(src, &src->format, 0, 0),
+                                   width, height, alpha)
+         || !PictureEqual(ref, dst)) {
+            fprintf(stderr, "%s %4.4s -> %4.4s %ux%u at %u,%u alpha %d: "
+                    "mismatch\n", kernels[k].name, (const char *)&src_chroma,
+                    (const char *)&dst_chroma, width, height, x, y, alpha);
+            ret = -1;
+        }
+    }
+
+    picture_Release(orig);
+    picture_Release(dst);
+    picture_Release(ref);
+    picture_Release(src);
+    return ret;
+}
+
+int main(void)
+{
+    static const uint32_t rgb_masks[][3] = {
+        { 0x00ff0000, 0x0000ff00, 0x000000ff },
+        { 0x000000ff, 0x0000ff00, 0x00ff0000 },
+        { 0x0000ff00, 0x00ff0000, 0xff000000 },
+    };
+    static const unsigned sizes[][2] = {
+        { 1, 1 }, { 2, 3 }, { 7, 2 }, { 16, 4 }, { 33, 5 }, { 64, 2 },
+        { 65, 3 }, { 129, 4 }, { 300, 3 },
+    };
+
+    alarm(60);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+        if ((vlc_CPU() & kernels[k].cpu) != kernels[k].cpu)
+            fprintf(stderr, "WARNING: could not test %s\n", kernels[k].name);
+
+    for (size_t l = 0; l < ARRAY_SIZE(blends_lines); l++)
+        for (size_t m = 0; m < ARRAY_SIZE(rgb_masks); m++) {
+            const bool rgb = blends_lines[l].dst == VLC_CODEC_RGB32;
+
+            if (!rgb && m > 0)
+                break;
+
+            for (size_t s = 0; s < ARRAY_SIZE(sizes); s++)
+                for (unsigned x = 0; x < 3; x++)
+                    for (unsigned y = 0; y < 2; y++)
+                        for (int alpha = 1; alpha <= 256; alpha *= 4)
+                            if (Test(l, rgb ? rgb_masks[m] : NULL,
+                                     sizes[s][0], sizes[s][1], x, y,
+                                     __MIN(alpha, 255)))
+                                return 1;
+        }
+
+    return 0;
+}
+#endif
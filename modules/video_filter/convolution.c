@@ -0,0 +1,993 @@
+/*****************************************************************************
+ * convolution.c: fixed-point convolutions of 8-bits planes
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef CONVOLUTION_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
+#include "slice_pool.h"
+#include "convolution.h"
+
+/* The horizontal pass of separable kernels keeps CONV_INTER_BITS fractional
+ * bits in its 16-bits output */
+#define CONV_INTER_BITS 4
+#define CONV_HSHIFT (CONV_BITS - CONV_INTER_BITS)
+#define CONV_VSHIFT (CONV_BITS + CONV_INTER_BITS)
+
+/* Line functions. All versions give the same results.
+ *
+ * Separable kernels are passed as pairs of taps, the last one of odd kernels
+ * being paired with a null coefficient. The horizontal function reads
+ * w + 2 * pairs - 1 pixels from pad. The vertical function reads 2 * pairs
+ * rows.
+ *
+ * The 3x3 function reads w + 2 pixels from each of the 3 rows. */
+struct conv_funcs
+{
+    void (*hline)(int16_t *dst, const uint8_t *pad, int w,
+                  const int16_t *coefs, unsigned pairs);
+    void (*vline)(uint8_t *dst, const int16_t *const *rows, int w,
+                  const int16_t *coefs, unsigned pairs);
+    void (*line3x3)(uint8_t *dst, const uint8_t *const *rows, int w,
+                    const struct conv_3x3 *kernel);
+};
+
+static void HLine_c(int16_t *dst, const uint8_t *pad, int w,
+                    const int16_t *coefs, unsigned pairs)
+{
+    for (int x = 0; x < w; x++)
+    {
+        int32_t sum = 1 << (CONV_HSHIFT - 1);
+
+        for (unsigned i = 0; i < 2 * pairs; i++)
+            sum += coefs[i] * pad[x + i];
+        dst[x] = VLC_CLIP(sum >> CONV_HSHIFT, INT16_MIN, INT16_MAX);
+    }
+}
+
+static void VLine_c(uint8_t *dst, const int16_t *const *rows, int w,
+                    const int16_t *coefs, unsigned pairs)
+{
+    for (int x = 0; x < w; x++)
+    {
+        int32_t sum = 1 << (CONV_VSHIFT - 1);
+
+        for (unsigned i = 0; i < 2 * pairs; i++)
+            sum += coefs[i] * rows[i][x];
+        dst[x] = VLC_CLIP(sum >> CONV_VSHIFT, 0, 255);
+    }
+}
+
+static void Line3x3_c(uint8_t *dst, const uint8_t *const *rows, int w,
+                      const struct conv_3x3 *kernel)
+{
+    for (int x = 0; x < w; x++)
+    {
+        int r[2] = { 0, 0 };
+
+        for (unsigned n = 0; n < kernel->count; n++)
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    r[n] += kernel->coefs[n][3 * i + j] * rows[i][x + j];
+
+        int v = kernel->count == 2 ? abs(r[0]) + abs(r[1]) : r[0];
+
+        v = (VLC_CLIP(v, -255, 255) * kernel->gain) >> CONV_BITS;
+        if (kernel->add_source)
+            v += rows[1][x + 1];
+        dst[x] = VLC_CLIP(v, 0, 255);
+    }
+}
+
+static const struct conv_funcs conv_c = { HLine_c, VLine_c, Line3x3_c };
+
+/* Filters the pixels left over by the SIMD loops, from x to w */
+static void VLineTail(uint8_t *dst, const int16_t *const *rows, int x, int w,
+                      const int16_t *coefs, unsigned pairs)
+{
+    const int16_t *tail[2 * CONV_MAX_RADIUS + 2];
+
+    for (unsigned i = 0; i < 2 * pairs; i++)
+        tail[i] = &rows[i][x];
+    VLine_c(&dst[x], tail, w - x, coefs, pairs);
+}
+
+static inline int32_t CoefPair(const int16_t *coefs)
+{
+    return (uint16_t)coefs[0] | ((uint32_t)(uint16_t)coefs[1] << 16);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void HLine_sse2(int16_t *dst, const uint8_t *pad, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (CONV_HSHIFT - 1));
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m128i c = _mm_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m128i a = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)&pad[x + 2 * i]), zero);
+            __m128i b = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)&pad[x + 2 * i + 1]), zero);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+        }
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm_packs_epi32(_mm_srai_epi32(lo, CONV_HSHIFT),
+                                         _mm_srai_epi32(hi, CONV_HSHIFT)));
+    }
+
+    if (x < w)
+        HLine_c(&dst[x], &pad[x], w - x, coefs, pairs);
+}
+
+VLC_SSE2
+static void VLine_sse2(uint8_t *dst, const int16_t *const *rows, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m128i round = _mm_set1_epi32(1 << (CONV_VSHIFT - 1));
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m128i c = _mm_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m128i a = _mm_loadu_si128((const __m128i *)&rows[2 * i][x]);
+            __m128i b = _mm_loadu_si128((const __m128i *)&rows[2 * i + 1][x]);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+        }
+
+        __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, CONV_VSHIFT),
+                                    _mm_srai_epi32(hi, CONV_VSHIFT));
+        _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(v, v));
+    }
+
+    if (x < w)
+        VLineTail(dst, rows, x, w, coefs, pairs);
+}
+
+VLC_SSE2
+static void Line3x3_sse2(uint8_t *dst, const uint8_t *const *rows, int w,
+                         const struct conv_3x3 *kernel)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i gain = _mm_set1_epi16(kernel->gain);
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i p[3][3];
+        __m128i r[2] = { zero, zero };
+
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                p[i][j] = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)&rows[i][x + j]), zero);
+
+        for (unsigned n = 0; n < kernel->count; n++)
+            for (int k = 0; k < 9; k++)
+                if (kernel->coefs[n][k] != 0)
+                    r[n] = _mm_add_epi16(r[n], _mm_mullo_epi16(p[k / 3][k % 3],
+                                         _mm_set1_epi16(kernel->coefs[n][k])));
+
+        __m128i v = r[0];
+        if (kernel->count == 2)
+            v = _mm_adds_epi16(
+                _mm_max_epi16(r[0], _mm_sub_epi16(zero, r[0])),
+                _mm_max_epi16(r[1], _mm_sub_epi16(zero, r[1])));
+
+        v = _mm_min_epi16(_mm_max_epi16(v, _mm_set1_epi16(-255)),
+                          _mm_set1_epi16(255));
+        /* (v * gain) >> CONV_BITS, as v << 4 fits in 16 bits */
+        v = _mm_mulhi_epi16(_mm_slli_epi16(v, 16 - CONV_BITS), gain);
+        if (kernel->add_source)
+            v = _mm_add_epi16(v, p[1][1]);
+        _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(v, v));
+    }
+
+    if (x < w)
+    {
+        const uint8_t *const tail[3] = {
+            &rows[0][x], &rows[1][x], &rows[2][x],
+        };
+        Line3x3_c(&dst[x], tail, w - x, kernel);
+    }
+}
+
+static const struct conv_funcs conv_sse2 = {
+    HLine_sse2, VLine_sse2, Line3x3_sse2,
+};
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void HLine_avx2(int16_t *dst, const uint8_t *pad, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (CONV_HSHIFT - 1));
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m256i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m256i c = _mm256_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m256i a = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)&pad[x + 2 * i]));
+            __m256i b = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)&pad[x + 2 * i + 1]));
+
+            lo = _mm256_add_epi32(lo,
+                    _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+            hi = _mm256_add_epi32(hi,
+                    _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+        }
+        /* Unpacking and packing within lanes preserve the order */
+        _mm256_storeu_si256((__m256i *)&dst[x],
+                            _mm256_packs_epi32(
+                                _mm256_srai_epi32(lo, CONV_HSHIFT),
+                                _mm256_srai_epi32(hi, CONV_HSHIFT)));
+    }
+
+    if (x < w)
+        HLine_c(&dst[x], &pad[x], w - x, coefs, pairs);
+}
+
+VLC_AVX2
+static inline void StoreU8_avx2(uint8_t *dst, __m256i v)
+{
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+    _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(v));
+}
+
+VLC_AVX2
+static void VLine_avx2(uint8_t *dst, const int16_t *const *rows, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (CONV_VSHIFT - 1));
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m256i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m256i c = _mm256_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m256i a = _mm256_loadu_si256((const __m256i *)&rows[2 * i][x]);
+            __m256i b = _mm256_loadu_si256(
+                (const __m256i *)&rows[2 * i + 1][x]);
+
+            lo = _mm256_add_epi32(lo,
+                    _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+            hi = _mm256_add_epi32(hi,
+                    _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+        }
+
+        StoreU8_avx2(&dst[x],
+                     _mm256_packs_epi32(_mm256_srai_epi32(lo, CONV_VSHIFT),
+                                        _mm256_srai_epi32(hi, CONV_VSHIFT)));
+    }
+
+    if (x < w)
+        VLineTail(dst, rows, x, w, coefs, pairs);
+}
+
+VLC_AVX2
+static void Line3x3_avx2(uint8_t *dst, const uint8_t *const *rows, int w,
+                         const struct conv_3x3 *kernel)
+{
+    const __m256i gain = _mm256_set1_epi16(kernel->gain);
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m256i p[3][3];
+        __m256i r[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                p[i][j] = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)&rows[i][x + j]));
+
+        for (unsigned n = 0; n < kernel->count; n++)
+            for (int k = 0; k < 9; k++)
+                if (kernel->coefs[n][k] != 0)
+                    r[n] = _mm256_add_epi16(r[n],
+                        _mm256_mullo_epi16(p[k / 3][k % 3],
+                            _mm256_set1_epi16(kernel->coefs[n][k])));
+
+        __m256i v = r[0];
+        if (kernel->count == 2)
+            v = _mm256_adds_epi16(_mm256_abs_epi16(r[0]),
+                                  _mm256_abs_epi16(r[1]));
+
+        v = _mm256_min_epi16(_mm256_max_epi16(v, _mm256_set1_epi16(-255)),
+                             _mm256_set1_epi16(255));
+        v = _mm256_mulhi_epi16(_mm256_slli_epi16(v, 16 - CONV_BITS), gain);
+        if (kernel->add_source)
+            v = _mm256_add_epi16(v, p[1][1]);
+        StoreU8_avx2(&dst[x], v);
+    }
+
+    if (x < w)
+    {
+        const uint8_t *const tail[3] = {
+            &rows[0][x], &rows[1][x], &rows[2][x],
+        };
+        Line3x3_c(&dst[x], tail, w - x, kernel);
+    }
+}
+
+static const struct conv_funcs conv_avx2 = {
+    HLine_avx2, VLine_avx2, Line3x3_avx2,
+};
+#endif
+
+static const struct conv_funcs *ConvGetFuncs(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return &conv_avx2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return &conv_sse2;
+#endif
+    return &conv_c;
+}
+
+void ConvKernelGaussian(struct conv_kernel *kernel, int16_t *coefs,
+                        double sigma)
+{
+    const int radius = __MIN((int)(3. * sigma), CONV_MAX_RADIUS);
+    double weights[2 * CONV_MAX_RADIUS + 1];
+    double sum = 0.;
+    int total = 0;
+
+    for (int x = -radius; x <= radius; x++)
+    {
+        weights[radius + x] = exp(-(x * x) / (2. * sigma * sigma));
+        sum += weights[radius + x];
+    }
+    for (int x = -radius; x <= radius; x++)
+    {
+        coefs[radius + x] = lround(weights[radius + x] / sum
+                                   * (1 << CONV_BITS));
+        total += coefs[radius + x];
+    }
+    /* Round so that the kernel does not change the average brightness */
+    coefs[radius] += (1 << CONV_BITS) - total;
+
+    kernel->radius = radius;
+    kernel->coefs = coefs;
+}
+
+/*****************************************************************************
+ * Slices
+ *
+ * Each slice works on its own band of lines, with its own line buffers.
+ * Source lines above and below the band are filtered again by each slice.
+ *****************************************************************************/
+
+/* Fills a line with its border pixels replicated */
+static void ConvPadLine(uint8_t *pad, const uint8_t *src, int w,
+                        unsigned left, unsigned right)
+{
+    memset(pad, src[0], left);
+    memcpy(pad + left, src, w);
+    memset(pad + left + w, src[w - 1], right);
+}
+
+static const uint8_t *ConvLine(const plane_t *p, int y)
+{
+    return &p->p_pixels[VLC_CLIP(y, 0, p->i_visible_lines - 1) * p->i_pitch];
+}
+
+struct conv_separable
+{
+    const struct conv_funcs *funcs;
+    const plane_t *src;
+    plane_t *dst;
+    unsigned hradius, vradius;
+    int16_t hcoefs[2 * CONV_MAX_RADIUS + 2];
+    int16_t vcoefs[2 * CONV_MAX_RADIUS + 2];
+    uint8_t *scratch;
+    size_t pad_size;   /* bytes of the padded source line */
+    size_t ring_pitch; /* samples of each horizontally filtered line */
+    size_t slice_size; /* bytes of the buffers of each slice */
+};
+
+static void ConvSeparableSlice(void *opaque, unsigned slice, unsigned count)
+{
+    const struct conv_separable *s = opaque;
+    const int w = s->src->i_visible_pitch;
+    const int taps = 2 * s->vradius + 1;
+    const int r = s->vradius;
+    unsigned start, end;
+
+    SliceLines(s->dst->i_visible_lines, slice, count, 1, &start, &end);
+
+    uint8_t *pad = s->scratch + slice * s->slice_size;
+    int16_t *ring = (int16_t *)(pad + s->pad_size);
+    const int16_t *rows[2 * CONV_MAX_RADIUS + 2];
+
+    /* The horizontal output of line v is kept in slot (v + r) % taps,
+     * until the last output line depending on it */
+    for (int v = (int)start - r; v < (int)end + r; v++)
+    {
+        ConvPadLine(pad, ConvLine(s->src, v), w, s->hradius,
+                    s->hradius + 1);
+        s->funcs->hline(&ring[((v + r) % taps) * s->ring_pitch], pad, w,
+                        s->hcoefs, s->hradius + 1);
+
+        const int y = v - r;
+        if (y < (int)start)
+            continue;
+
+        for (int i = 0; i < taps; i++)
+            rows[i] = &ring[((y + i) % taps) * s->ring_pitch];
+        rows[taps] = rows[taps - 1];
+
+        s->funcs->vline(&s->dst->p_pixels[y * s->dst->i_pitch], rows, w,
+                        s->vcoefs, s->vradius + 1);
+    }
+}
+
+static int ConvolveSeparableWith(const struct conv_funcs *funcs,
+                                 struct slice_pool *pool, plane_t *dst,
+                                 const plane_t *src,
+                                 const struct conv_kernel *h,
+                                 const struct conv_kernel *v)
+{
+    const int w = src->i_visible_pitch;
+    struct conv_separable s = {
+        .funcs = funcs, .src = src, .dst = dst,
+        .hradius = h->radius, .vradius = v->radius,
+    };
+
+    assert(h->radius <= CONV_MAX_RADIUS && v->radius <= CONV_MAX_RADIUS);
+    assert(dst->i_visible_pitch == w
+        && dst->i_visible_lines == src->i_visible_lines);
+
+    if (w <= 0 || src->i_visible_lines <= 0)
+        return VLC_SUCCESS;
+
+    /* Odd kernels are padded with a null tap */
+    memcpy(s.hcoefs, h->coefs, (2 * h->radius + 1) * sizeof (int16_t));
+    s.hcoefs[2 * h->radius + 1] = 0;
+    memcpy(s.vcoefs, v->coefs, (2 * v->radius + 1) * sizeof (int16_t));
+    s.vcoefs[2 * v->radius + 1] = 0;
+
+    s.pad_size = (w + 2 * h->radius + 1 + 63) & ~(size_t)63;
+    s.ring_pitch = (w + 31) & ~(size_t)31;
+    s.slice_size = s.pad_size
+                 + (2 * v->radius + 1) * s.ring_pitch * sizeof (int16_t);
+    s.slice_size = (s.slice_size + 63) & ~(size_t)63;
+
+    s.scratch = aligned_alloc(64, SlicePoolCount(pool) * s.slice_size);
+    if (unlikely(s.scratch == NULL))
+        return VLC_ENOMEM;
+
+    SlicePoolRun(pool, ConvSeparableSlice, &s);
+    aligned_free(s.scratch);
+    return VLC_SUCCESS;
+}
+
+int ConvolveSeparable(struct slice_pool *pool, plane_t *dst,
+                      const plane_t *src, const struct conv_kernel *h,
+                      const struct conv_kernel *v)
+{
+    return ConvolveSeparableWith(ConvGetFuncs(), pool, dst, src, h, v);
+}
+
+struct conv_3x3_render
+{
+    const struct conv_funcs *funcs;
+    const plane_t *src;
+    plane_t *dst;
+    const struct conv_3x3 *kernel;
+    uint8_t *scratch;
+    size_t pad_size;   /* bytes of each padded source line */
+};
+
+static void Conv3x3Slice(void *opaque, unsigned slice, unsigned count)
+{
+    const struct conv_3x3_render *s = opaque;
+    const int w = s->src->i_visible_pitch;
+    unsigned start, end;
+
+    SliceLines(s->dst->i_visible_lines, slice, count, 1, &start, &end);
+
+    uint8_t *pad = s->scratch + slice * 3 * s->pad_size;
+    const uint8_t *rows[3];
+
+    /* Source line v is padded in slot (v + 1) % 3 */
+    for (int v = (int)start - 1; v < (int)end + 1; v++)
+    {
+        ConvPadLine(&pad[((v + 1) % 3) * s->pad_size], ConvLine(s->src, v),
+                    w, 1, 1);
+
+        const int y = v - 1;
+        if (y < (int)start)
+            continue;
+
+        for (int i = 0; i < 3; i++)
+            rows[i] = &pad[((y + i) % 3) * s->pad_size];
+
+        s->funcs->line3x3(&s->dst->p_pixels[y * s->dst->i_pitch], rows, w,
+                          s->kernel);
+    }
+}
+
+static int Convolve3x3With(const struct conv_funcs *funcs,
+                           struct slice_pool *pool, plane_t *dst,
+                           const plane_t *src, const struct conv_3x3 *kernel)
+{
+    const int w = src->i_visible_pitch;
+    struct conv_3x3_render s = {
+        .funcs = funcs, .src = src, .dst = dst, .kernel = kernel,
+    };
+
+    assert(kernel->count == 1 || kernel->count == 2);
+    assert(dst->i_visible_pitch == w
+        && dst->i_visible_lines == src->i_visible_lines);
+
+    if (w <= 0 || src->i_visible_lines <= 0)
+        return VLC_SUCCESS;
+
+    s.pad_size = (w + 2 + 63) & ~(size_t)63;
+    s.scratch = aligned_alloc(64, SlicePoolCount(pool) * 3 * s.pad_size);
+    if (unlikely(s.scratch == NULL))
+        return VLC_ENOMEM;
+
+    SlicePoolRun(pool, Conv3x3Slice, &s);
+    aligned_free(s.scratch);
+    return VLC_SUCCESS;
+}
+
+int Convolve3x3(struct slice_pool *pool, plane_t *dst, const plane_t *src,
+                const struct conv_3x3 *kernel)
+{
+    return Convolve3x3With(ConvGetFuncs(), pool, dst, src, kernel);
+}
+
+#ifdef CONVOLUTION_TEST
+/*
+ * The SIMD line functions are compared bit for bit against the C ones, the C
+ * ones against a direct evaluation of the convolution, and slices against
+ * the calling thread alone.
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static unsigned Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static int RandomCoef(int *budget)
+{
+    int max = __MIN(*budget, 2000);
+    int c = (int)(Random() % (2 * max + 1)) - max;
+
+    *budget -= abs(c);
+    return c;
+}
+
+struct test_plane
+{
+    plane_t plane;
+    uint8_t *buf;
+};
+
+static void PlaneInit(struct test_plane *p, int w, int h, bool fill)
+{
+    const int pitch = w + Random() % 40;
+
+    p->buf = malloc(pitch * h + 1);
+    assert(p->buf != NULL);
+    for (int i = 0; i < pitch * h + 1; i++)
+        p->buf[i] = fill ? Random() : 0xA5;
+
+    p->plane.p_pixels = p->buf;
+    p->plane.i_pitch = pitch;
+    p->plane.i_lines = h;
+    p->plane.i_visible_pitch = w;
+    p->plane.i_visible_lines = h;
+    p->plane.i_pixel_pitch = 1;
+}
+
+static bool PlaneEqual(const plane_t *a, const plane_t *b)
+{
+    for (int y = 0; y < a->i_visible_lines; y++)
+        if (memcmp(&a->p_pixels[y * a->i_pitch],
+                   &b->p_pixels[y * b->i_pitch], a->i_visible_pitch))
+            return false;
+    return true;
+}
+
+static uint8_t Pixel(const plane_t *p, int x, int y)
+{
+    return ConvLine(p, y)[VLC_CLIP(x, 0, p->i_visible_pitch - 1)];
+}
+
+static void RefSeparable(plane_t *dst, const plane_t *src,
+                         const struct conv_kernel *h,
+                         const struct conv_kernel *v)
+{
+    const int hr = h->radius, vr = v->radius;
+
+    for (int y = 0; y < src->i_visible_lines; y++)
+        for (int x = 0; x < src->i_visible_pitch; x++)
+        {
+            int32_t sum = 1 << (CONV_VSHIFT - 1);
+
+            for (int i = -vr; i <= vr; i++)
+            {
+                int32_t hsum = 1 << (CONV_HSHIFT - 1);
+
+                for (int j = -hr; j <= hr; j++)
+                    hsum += h->coefs[hr + j] * Pixel(src, x + j, y + i);
+                sum += v->coefs[vr + i]
+                     * VLC_CLIP(hsum >> CONV_HSHIFT, INT16_MIN, INT16_MAX);
+            }
+            dst->p_pixels[y * dst->i_pitch + x] =
+                VLC_CLIP(sum >> CONV_VSHIFT, 0, 255);
+        }
+}
+
+static void Ref3x3(plane_t *dst, const plane_t *src,
+                   const struct conv_3x3 *kernel)
+{
+    for (int y = 0; y < src->i_visible_lines; y++)
+        for (int x = 0; x < src->i_visible_pitch; x++)
+        {
+            int r[2] = { 0, 0 };
+
+            for (unsigned n = 0; n < kernel->count; n++)
+                for (int k = 0; k < 9; k++)
+                    r[n] += kernel->coefs[n][k]
+                          * Pixel(src, x + k % 3 - 1, y + k / 3 - 1);
+
+            int v = kernel->count == 2 ? abs(r[0]) + abs(r[1]) : r[0];
+
+            v = (VLC_CLIP(v, -255, 255) * kernel->gain) >> CONV_BITS;
+            if (kernel->add_source)
+                v += Pixel(src, x, y);
+            dst->p_pixels[y * dst->i_pitch + x] = VLC_CLIP(v, 0, 255);
+        }
+}
+
+static const struct
+{
+    const char *name;
+    const struct conv_funcs *funcs;
+    unsigned cpu;
+} impls[] = {
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", &conv_sse2, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", &conv_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static bool Supported(size_t i)
+{
+    return (vlc_CPU() & impls[i].cpu) == impls[i].cpu;
+}
+
+static int TestSeparable(struct slice_pool *pool, int w, int h,
+                         unsigned hradius, unsigned vradius)
+{
+    int16_t hcoefs[2 * CONV_MAX_RADIUS + 1], vcoefs[2 * CONV_MAX_RADIUS + 1];
+    int hbudget = 8 << CONV_BITS, vbudget = 8 << CONV_BITS;
+    const struct conv_kernel hk = { hradius, hcoefs }, vk = { vradius, vcoefs };
+    struct test_plane src, ref, dst;
+    int ret = 0;
+
+    for (unsigned i = 0; i < 2 * hradius + 1; i++)
+        hcoefs[i] = RandomCoef(&hbudget);
+    for (unsigned i = 0; i < 2 * vradius + 1; i++)
+        vcoefs[i] = RandomCoef(&vbudget);
+
+    PlaneInit(&src, w, h, true);
+    PlaneInit(&ref, w, h, false);
+    PlaneInit(&dst, w, h, false);
+
+    RefSeparable(&ref.plane, &src.plane, &hk, &vk);
+    if (ConvolveSeparableWith(&conv_c, NULL, &dst.plane, &src.plane, &hk,
+                              &vk) != VLC_SUCCESS
+     || !PlaneEqual(&ref.plane, &dst.plane))
+    {
+        fprintf(stderr, "C separable %dx%d radius %u/%u mismatch\n", w, h,
+                hradius, vradius);
+        ret = -1;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls) && ret == 0; i++)
+    {
+        if (!Supported(i))
+            continue;
+        memset(dst.buf, 0xA5, dst.plane.i_pitch * h);
+        ConvolveSeparableWith(impls[i].funcs, pool, &dst.plane, &src.plane,
+                              &hk, &vk);
+        if (!PlaneEqual(&ref.plane, &dst.plane))
+        {
+            fprintf(stderr, "%s separable %dx%d radius %u/%u %u threads "
+                    "mismatch\n", impls[i].name, w, h, hradius, vradius,
+                    SlicePoolCount(pool));
+            ret = -1;
+        }
+    }
+
+    /* Nothing is written outside of the visible area */
+    for (int y = 0; y < h && ret == 0; y++)
+        for (int x = w; x < dst.plane.i_pitch; x++)
+            if (dst.plane.p_pixels[y * dst.plane.i_pitch + x] != 0xA5)
+            {
+                fprintf(stderr, "separable %dx%d overflows\n", w, h);
+                ret = -1;
+                break;
+            }
+
+    free(dst.buf);
+    free(ref.buf);
+    free(src.buf);
+    return ret;
+}
+
+static int Test3x3(struct slice_pool *pool, int w, int h, unsigned count,
+                   bool add_source)
+{
+    struct conv_3x3 kernel = {
+        .count = count,
+        .gain = Random() % (8 << CONV_BITS),
+        .add_source = add_source,
+    };
+    int budget = 128;
+    struct test_plane src, ref, dst;
+    int ret = 0;
+
+    for (unsigned n = 0; n < count; n++)
+        for (int k = 0; k < 9; k++)
+        {
+            int max = __MIN(budget, 20);
+            int c = (int)(Random() % (2 * max + 1)) - max;
+
+            /* Leave some taps out, as the SIMD versions skip them */
+            if (Random() % 4 == 0)
+                c = 0;
+            budget -= abs(c);
+            kernel.coefs[n][k] = c;
+        }
+
+    PlaneInit(&src, w, h, true);
+    PlaneInit(&ref, w, h, false);
+    PlaneInit(&dst, w, h, false);
+
+    Ref3x3(&ref.plane, &src.plane, &kernel);
+    if (Convolve3x3With(&conv_c, NULL, &dst.plane, &src.plane,
+                        &kernel) != VLC_SUCCESS
+     || !PlaneEqual(&ref.plane, &dst.plane))
+    {
+        fprintf(stderr, "C 3x3 %dx%d mismatch\n", w, h);
+        ret = -1;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls) && ret == 0; i++)
+    {
+        if (!Supported(i))
+            continue;
+        memset(dst.buf, 0xA5, dst.plane.i_pitch * h);
+        Convolve3x3With(impls[i].funcs, pool, &dst.plane, &src.plane,
+                        &kernel);
+        if (!PlaneEqual(&ref.plane, &dst.plane))
+        {
+            fprintf(stderr, "%s 3x3 %dx%d count %u %u threads mismatch\n",
+                    impls[i].name, w, h, count, SlicePoolCount(pool));
+            ret = -1;
+        }
+    }
+
+    free(dst.buf);
+    free(ref.buf);
+    free(src.buf);
+    return ret;
+}
+
+int main(void)
+{
+    alarm(60);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls); i++)
+        if (!Supported(i))
+            fprintf(stderr, "WARNING: could not test %s\n", impls[i].name);
+
+    for (unsigned threads = 1; threads <= 4; threads++)
+    {
+        struct slice_pool *pool = SlicePoolNew(threads);
+
+        for (int w = 1; w <= 40; w += 3)
+            for (int h = 1; h <= 9; h += 4)
+            {
+                if (TestSeparable(pool, w, h, Random() % 4, Random() % 4)
+                 || Test3x3(pool, w, h, 1, true)
+                 || Test3x3(pool, w, h, 2, false))
+                    return 1;
+            }
+
+        if (TestSeparable(pool, 333, 47, 6, 6)
+         || TestSeparable(pool, 100, 20, 0, 30)
+         || TestSeparable(pool, 70, 300, CONV_MAX_RADIUS, 1)
+         || Test3x3(pool, 723, 61, 2, false)
+         || Test3x3(pool, 723, 61, 1, false))
+            return 1;
+
+        SlicePoolDelete(pool);
+    }
+
+    /* The Gaussian kernels preserve the brightness */
+    for (double sigma = .1; sigma < 60.; sigma *= 1.7)
+    {
+        int16_t coefs[2 * CONV_MAX_RADIUS + 1];
+        struct conv_kernel kernel;
+        int sum = 0;
+
+        ConvKernelGaussian(&kernel, coefs, sigma);
+        for (unsigned i = 0; i < 2 * kernel.radius + 1; i++)
+            sum += coefs[i];
+        assert(sum == 1 << CONV_BITS);
+        assert(kernel.radius <= CONV_MAX_RADIUS);
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef CONVOLUTION_BENCH
+/*
+ * Measures the frame rate of a Gaussian blur of sigma 2 and of a Sobel
+ * filter on 1080p I420 pictures, for each implementation and an increasing
+ * number of threads.
+ */
+#include <stdio.h>
+#include <vlc_tick.h>
+
+static void Bench(const char *name, const struct conv_funcs *funcs,
+                  unsigned threads, picture_t *src, picture_t *dst)
+{
+    static const struct conv_3x3 sobel = {
+        .coefs = {
+            { -1, 0, 1, -2, 0, 2, -1, 0, 1 },
+            { -1, -2, -1, 0, 0, 0, 1, 2, 1 },
+        },
+        .count = 2,
+        .gain = 1 << CONV_BITS,
+    };
+    struct slice_pool *pool = SlicePoolNew(threads);
+    int16_t coefs[2 * CONV_MAX_RADIUS + 1];
+    struct conv_kernel kernel;
+
+    ConvKernelGaussian(&kernel, coefs, 2.);
+
+    for (int op = 0; op < 2; op++)
+    {
+        vlc_tick_t start = vlc_tick_now(), elapsed;
+        unsigned frames = 0;
+
+        do
+        {
+            for (int i = 0; i < src->i_planes; i++)
+                if (op == 0)
+                    ConvolveSeparableWith(funcs, pool, &dst->p[i],
+                                          &src->p[i], &kernel, &kernel);
+                else
+                    Convolve3x3With(funcs, pool, &dst->p[i], &src->p[i],
+                                    &sobel);
+            frames++;
+            elapsed = vlc_tick_now() - start;
+        }
+        while (elapsed < VLC_TICK_FROM_MS(500));
+
+        printf("%-6s %-5s %7u %9.1f\n", name, op ? "sobel" : "blur",
+               SlicePoolCount(pool), frames / secf_from_vlc_tick(elapsed));
+    }
+
+    SlicePoolDelete(pool);
+}
+
+int main(void)
+{
+    const unsigned max_threads = __MAX(vlc_GetCPUCount(), 1);
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    picture_t *src = picture_NewFromFormat(&fmt);
+    picture_t *dst = picture_NewFromFormat(&fmt);
+    if (src == NULL || dst == NULL)
+        return 1;
+
+    for (int i = 0; i < src->i_planes; i++)
+        for (int j = 0; j < src->p[i].i_pitch * src->p[i].i_lines; j++)
+            src->p[i].p_pixels[j] = j * 7 + (j >> 11);
+
+    printf("%-6s %-5s %7s %9s\n", "impl", "op", "threads", "frames/s");
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        Bench("C", &conv_c, threads, src, dst);
+#ifdef HAVE_SSE2_INTRINSICS
+        if (vlc_CPU_SSE2())
+            Bench("SSE2", &conv_sse2, threads, src, dst);
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        if (vlc_CPU_AVX2())
+            Bench("AVX2", &conv_avx2, threads, src, dst);
+#endif
+    }
+
+    picture_Release(dst);
+    picture_Release(src);
+    return 0;
+}
+#endif
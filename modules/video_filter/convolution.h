@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * convolution.h: fixed-point convolutions of 8-bits planes
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_CONVOLUTION_H
+#define VLC_VIDEO_FILTER_CONVOLUTION_H 1
+
+/**
+ * \file
+ * Convolutions of the visible area of 8-bits planes, with the borders
+ * replicated, in C, SSE2 and AVX2, split in slices over a slice pool.
+ *
+ * The source and destination planes must have the same visible size, and
+ * must not overlap.
+ */
+
+struct slice_pool;
+
+/** Number of fractional bits of the fixed-point coefficients */
+#define CONV_BITS 12
+
+/** Largest radius of a separable kernel */
+#define CONV_MAX_RADIUS 127
+
+/**
+ * One dimension of a separable kernel.
+ *
+ * The sum of the absolute values of the coefficients must not exceed
+ * 8 << CONV_BITS.
+ */
+struct conv_kernel
+{
+    unsigned radius;       /**< the kernel has 2 * radius + 1 taps */
+    const int16_t *coefs;  /**< taps, scaled by 1 << CONV_BITS */
+};
+
+/**
+ * Builds a normalized Gaussian kernel.
+ *
+ * The kernel is truncated at 3 sigma, or at CONV_MAX_RADIUS.
+ *
+ * @param coefs storage for at least 2 * CONV_MAX_RADIUS + 1 taps
+ */
+void ConvKernelGaussian(struct conv_kernel *kernel, int16_t *coefs,
+                        double sigma);
+
+/**
+ * Convolves a plane with the horizontal then the vertical kernel.
+ *
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int ConvolveSeparable(struct slice_pool *pool, plane_t *dst,
+                      const plane_t *src, const struct conv_kernel *h,
+                      const struct conv_kernel *v);
+
+/**
+ * 3x3 kernels and the operation combining their results.
+ *
+ * For each pixel, the response r of the kernel is computed, or |r0| + |r1|
+ * if there are two kernels (gradient magnitude). The response is clipped to
+ * [-255, 255], multiplied by the gain, and optionally added to the source
+ * pixel, before being clipped to [0, 255].
+ *
+ * The sum of the absolute values of all coefficients must not exceed 128.
+ */
+struct conv_3x3
+{
+    int16_t coefs[2][9];  /**< row major, not scaled */
+    unsigned count;       /**< number of kernels, 1 or 2 */
+    int16_t gain;         /**< scaled by 1 << CONV_BITS, below 8 */
+    bool add_source;
+};
+
+/**
+ * Convolves a plane with one or two 3x3 kernels.
+ *
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int Convolve3x3(struct slice_pool *pool, plane_t *dst, const plane_t *src,
+                const struct conv_3x3 *kernel);
+
+#endif
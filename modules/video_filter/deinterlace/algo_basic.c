@@ -35,152 +35,123 @@
 
 #include "merge.h"
 #include "deinterlace.h" /* definition of p_sys, needed for Merge() */
+#include "../slice_pool.h"
 
 #include "algo_basic.h"
 
+/* Arguments of the slice callbacks */
+struct basic_render
+{
+    filter_t  *p_filter;
+    picture_t *p_outpic;
+    picture_t *p_pic;
+    int        i_field;
+    bool       b_linear;
+};
+
+static void RenderBasic( filter_t *p_filter, picture_t *p_outpic,
+                         picture_t *p_pic, int i_field, bool b_linear,
+                         void (*slice)( void *, unsigned, unsigned ) )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct basic_render render = {
+        p_filter, p_outpic, p_pic, i_field, b_linear,
+    };
+
+    SlicePoolRun( p_sys->slices, slice, &render );
+}
+
 /*****************************************************************************
  * RenderDiscard: only keep TOP or BOTTOM field, discard the other.
  *****************************************************************************/
 
-int RenderDiscard( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderDiscardSlice( void *opaque, unsigned slice, unsigned count )
 {
-    VLC_UNUSED(p_filter);
-    int i_plane;
+    const struct basic_render *render = opaque;
 
     /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < render->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
+        const plane_t *p_in = &render->p_pic->p[i_plane];
+        const plane_t *p_out = &render->p_outpic->p[i_plane];
+        unsigned start, end;
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        SliceLines( p_out->i_visible_lines, slice, count, 1, &start, &end );
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
+        for( unsigned y = start ; y < end ; y++ )
+            memcpy( &p_out->p_pixels[y * p_out->i_pitch],
+                    &p_in->p_pixels[2 * y * p_in->i_pitch], p_in->i_pitch );
     }
+}
+
+int RenderDiscard( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderBasic( p_filter, p_outpic, p_pic, 0, false, RenderDiscardSlice );
     return VLC_SUCCESS;
 }
 
 /*****************************************************************************
  * RenderBob: renders a BOB picture - simple copy
+ * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
-               int order, int i_field )
+static void RenderBobSlice( void *opaque, unsigned slice, unsigned count )
 {
-    VLC_UNUSED(p_filter);
-    VLC_UNUSED(order);
-    int i_plane;
+    const struct basic_render *render = opaque;
+    filter_sys_t *p_sys = render->p_filter->p_sys;
+    const int i_field = render->i_field;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < render->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const plane_t *p_in = &render->p_pic->p[i_plane];
+        const plane_t *p_out = &render->p_outpic->p[i_plane];
+        const int i_lines = p_out->i_visible_lines;
 
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        /* Lines of the kept field are copied, and each line of the other
+         * field is interpolated from the lines above and below, except:
+         *  - for BOTTOM field, the first line is copied,
+         *  - the last line of the field is copied,
+         *  - for TOP field, the last line is copied from the input. */
+        int i_last = i_field;
+        if( i_lines - 2 > i_field )
+            i_last += 2 * ( ( i_lines - 1 - i_field ) / 2 );
 
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
+        unsigned start, end;
 
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+        SliceLines( i_last + 1 + ( i_field == 0 ), slice, count, 1,
+                    &start, &end );
 
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
+        for( int y = start ; y < (int)end ; y++ )
         {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            if( y < i_field || y > i_last || ( ( y - i_field ) & 1 ) == 0 )
+                memcpy( p_dst, p_src, p_in->i_pitch );
+            else if( render->b_linear )
+                Merge( p_dst, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                       p_in->i_pitch );
+            else
+                memcpy( p_dst, p_src - p_in->i_pitch, p_in->i_pitch );
         }
     }
-    return VLC_SUCCESS;
+    if( render->b_linear )
+        EndMerge();
 }
 
-/*****************************************************************************
- * RenderLinear: BOB with linear interpolation
- *****************************************************************************/
+int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
+               int order, int i_field )
+{
+    VLC_UNUSED(order);
+    RenderBasic( p_filter, p_outpic, p_pic, i_field, false, RenderBobSlice );
+    return VLC_SUCCESS;
+}
 
 int RenderLinear( filter_t *p_filter,
                   picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
 {
     VLC_UNUSED(order);
-    int i_plane;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
-    }
-    EndMerge();
+    RenderBasic( p_filter, p_outpic, p_pic, i_field, true, RenderBobSlice );
     return VLC_SUCCESS;
 }
 
@@ -188,34 +159,34 @@ int RenderLinear( filter_t *p_filter,
  * RenderMean: Half-resolution blender
  *****************************************************************************/
 
-int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderMeanSlice( void *opaque, unsigned slice, unsigned count )
 {
-    int i_plane;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
+    const struct basic_render *render = opaque;
+    filter_sys_t *p_sys = render->p_filter->p_sys;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < render->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
+        const plane_t *p_in = &render->p_pic->p[i_plane];
+        const plane_t *p_out = &render->p_outpic->p[i_plane];
+        unsigned start, end;
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        SliceLines( p_out->i_visible_lines, slice, count, 1, &start, &end );
 
         /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( unsigned y = start ; y < end ; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            const uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
+            Merge( &p_out->p_pixels[y * p_out->i_pitch], p_src,
+                   p_src + p_in->i_pitch, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderBasic( p_filter, p_outpic, p_pic, 0, false, RenderMeanSlice );
     return VLC_SUCCESS;
 }
 
@@ -223,37 +194,36 @@ int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderBlendSlice( void *opaque, unsigned slice, unsigned count )
 {
-    int i_plane;
+    const struct basic_render *render = opaque;
+    filter_sys_t *p_sys = render->p_filter->p_sys;
 
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < render->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        const plane_t *p_in = &render->p_pic->p[i_plane];
+        const plane_t *p_out = &render->p_outpic->p[i_plane];
+        unsigned start, end;
 
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
+        SliceLines( p_out->i_visible_lines, slice, count, 1, &start, &end );
 
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( unsigned y = start ; y < end ; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
+            uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            /* First line: simple copy, remaining lines: mean value */
+            if( y == 0 )
+                memcpy( p_dst, p_src, p_in->i_pitch );
+            else
+                Merge( p_dst, p_src - p_in->i_pitch, p_src, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderBasic( p_filter, p_outpic, p_pic, 0, false, RenderBlendSlice );
     return VLC_SUCCESS;
 }
@@ -35,6 +35,7 @@
 #include <vlc_picture.h>
 
 #include "deinterlace.h" /* filter_sys_t */
+#include "../slice_pool.h"
 
 #include "algo_x.h"
 
@@ -511,9 +512,17 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+struct x_render
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+};
+
+static void RenderXSlice( void *opaque, unsigned slice, unsigned count )
 {
-    VLC_UNUSED(p_filter);
+    const struct x_render *render = opaque;
+    picture_t *p_outpic = render->p_outpic;
+    picture_t *p_pic = render->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -532,8 +541,13 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_src = p_pic->p[i_plane].i_pitch;
 
         int y, x;
+        unsigned start, end;
 
-        for( y = 0; y < i_mby; y++ )
+        /* Each slice renders whole bands of 8 lines */
+        SliceLines( i_mby + ( i_mody ? 1 : 0 ), slice, count, 1,
+                    &start, &end );
+
+        for( y = start; y < __MIN( (int)end, i_mby ); y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -547,7 +561,7 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && y == i_mby && (int)end > i_mby )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -569,5 +583,13 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct x_render render = { p_outpic, p_pic };
+
+    SlicePoolRun( p_sys->slices, RenderXSlice, &render );
     return VLC_SUCCESS;
 }
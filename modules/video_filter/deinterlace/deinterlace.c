@@ -45,6 +45,7 @@
 #include "deinterlace.h"
 #include "helpers.h"
 #include "merge.h"
+#include "../slice_pool.h"
 
 /*****************************************************************************
  * video filter functions
@@ -313,6 +314,9 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 1, 0, 16,
+                            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
+        change_safe ()
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -328,7 +332,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -347,30 +351,31 @@ struct filter_mode_t
     deinterlace_algo     settings;
     bool                 can_pack;         /**< can handle packed pixel */
     bool                 b_high_bit_depth; /**< can handle high bit depth */
+    bool                 can_slice;        /**< can render slices in threads */
 };
 static struct filter_mode_t filter_mode [] = {
     { "discard", .pf_render_single_pic = RenderDiscard,
-                 { false, false, false, true }, true, true },
+                 { false, false, false, true }, true, true, true },
     { "bob", .pf_render_ordered = RenderBob,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, true },
     { "progressive-scan", .pf_render_ordered = RenderBob,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, true },
     { "linear", .pf_render_ordered = RenderLinear,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, true },
     { "mean", .pf_render_single_pic = RenderMean,
-                 { false, false, false, true }, true, true },
+                 { false, false, false, true }, true, true, true },
     { "blend", .pf_render_single_pic = RenderBlend,
-                 { false, false, false, false }, true, true },
+                 { false, false, false, false }, true, true, true },
     { "yadif", .pf_render_single_pic = RenderYadifSingle,
-                 { false, true, false, false }, false, true },
+                 { false, true, false, false }, false, true, true },
     { "yadif2x", .pf_render_ordered = RenderYadif,
-                 { true, true, false, false }, false, true },
+                 { true, true, false, false }, false, true, true },
     { "x", .pf_render_single_pic = RenderX,
-                 { false, false, false, false }, false, false },
+                 { false, false, false, false }, false, false, true },
     { "phosphor", .pf_render_ordered = RenderPhosphor,
-                 { true, true, false, false }, false, false },
+                 { true, true, false, false }, false, false, false },
     { "ivtc", .pf_render_single_pic = RenderIVTC,
-                 { false, true, true, false }, false, false },
+                 { false, true, true, false }, false, false, false },
 };
 
 /**
@@ -411,6 +416,14 @@ static void SetFilterMethod( filter_t *p_filter, const char *mode, bool pack )
             msg_Dbg( p_filter, "using %s deinterlace method", mode );
             p_sys->context.settings = filter_mode[i].settings;
             p_sys->context.pf_render_ordered = filter_mode[i].pf_render_ordered;
+            if( filter_mode[i].can_slice )
+            {
+                p_sys->slices = SlicePoolNew(
+                    var_GetInteger( p_filter, FILTER_CFG_PREFIX "threads" ) );
+                if( p_sys->slices != NULL )
+                    msg_Dbg( p_filter, "rendering %u slices in parallel",
+                             SlicePoolCount( p_sys->slices ) );
+            }
             return;
         }
     }
@@ -527,6 +540,7 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->slices = NULL;
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -661,7 +675,9 @@ notsupp:
 void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
     Flush( p_filter );
-    free( p_filter->p_sys );
+    SlicePoolDelete( p_sys->slices );
+    free( p_sys );
 }
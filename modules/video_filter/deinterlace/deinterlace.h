@@ -77,6 +77,9 @@ typedef struct
 
     struct deinterlace_ctx   context;
 
+    /** Threads rendering slices of the picture, NULL if single-threaded */
+    struct slice_pool *slices;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
@@ -0,0 +1,343 @@
+/*****************************************************************************
+ * deinterlace_test.c: deinterlacer conformance test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The SIMD Yadif line filters are compared bit for bit against the C
+ * reference, and each algorithm rendered in slices against the same
+ * algorithm rendered by the calling thread alone.
+ *
+ * Built with DEINTERLACE_BENCH, measures the frame rate of each algorithm
+ * instead, for an increasing number of threads.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include "merge.h"
+#include "deinterlace.h"
+#include "yadif.h"
+#include "../slice_pool.h"
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static void Fill(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+
+        for (int j = 0; j < p->i_pitch * p->i_lines; j++)
+            p->p_pixels[j] = Random();
+    }
+}
+
+static int RenderDiscardOrdered(filter_t *filter, picture_t *dst,
+                                picture_t *src, int order, int field)
+{
+    VLC_UNUSED(order); VLC_UNUSED(field);
+    return RenderDiscard(filter, dst, src);
+}
+
+static int RenderMeanOrdered(filter_t *filter, picture_t *dst,
+                             picture_t *src, int order, int field)
+{
+    VLC_UNUSED(order); VLC_UNUSED(field);
+    return RenderMean(filter, dst, src);
+}
+
+static int RenderBlendOrdered(filter_t *filter, picture_t *dst,
+                              picture_t *src, int order, int field)
+{
+    VLC_UNUSED(order); VLC_UNUSED(field);
+    return RenderBlend(filter, dst, src);
+}
+
+static int RenderXOrdered(filter_t *filter, picture_t *dst,
+                          picture_t *src, int order, int field)
+{
+    VLC_UNUSED(order); VLC_UNUSED(field);
+    return RenderX(filter, dst, src);
+}
+
+static const struct
+{
+    const char *name;
+    int (*render)(filter_t *, picture_t *, picture_t *, int, int);
+    bool half_height;
+} algos[] = {
+    { "discard", RenderDiscardOrdered, true  },
+    { "mean",    RenderMeanOrdered,    true  },
+    { "blend",   RenderBlendOrdered,   false },
+    { "bob",     RenderBob,            false },
+    { "linear",  RenderLinear,         false },
+    { "x",       RenderXOrdered,       false },
+    { "yadif",   RenderYadif,          false },
+};
+
+struct context
+{
+    filter_sys_t sys;
+    filter_t filter;
+    picture_t *src[HISTORY_SIZE];
+    picture_t *dst;
+};
+
+static void ContextInit(struct context *ctx, size_t a,
+                        unsigned width, unsigned height)
+{
+    video_format_t fmt_in, fmt_out;
+
+    video_format_Init(&fmt_in, VLC_CODEC_I420);
+    video_format_Setup(&fmt_in, VLC_CODEC_I420, width, height, width, height,
+                       1, 1);
+    if (algos[a].half_height)
+        height /= 2;
+    video_format_Init(&fmt_out, VLC_CODEC_I420);
+    video_format_Setup(&fmt_out, VLC_CODEC_I420, width, height,
+                       width, height, 1, 1);
+
+    memset(ctx, 0, sizeof (*ctx));
+    ctx->sys.chroma = vlc_fourcc_GetChromaDescription(VLC_CODEC_I420);
+    ctx->sys.pf_merge = Merge8BitGeneric;
+    ctx->filter.p_sys = &ctx->sys;
+    ctx->filter.fmt_in.video = fmt_in;
+    ctx->filter.fmt_out.video = fmt_out;
+
+    for (size_t i = 0; i < HISTORY_SIZE; i++)
+    {
+        ctx->src[i] = picture_NewFromFormat(&fmt_in);
+        assert(ctx->src[i] != NULL);
+        ctx->src[i]->i_nb_fields = 2;
+        Fill(ctx->src[i]);
+        ctx->sys.context.pp_history[i] = ctx->src[i];
+    }
+    ctx->dst = picture_NewFromFormat(&fmt_out);
+    assert(ctx->dst != NULL);
+}
+
+static void ContextClean(struct context *ctx)
+{
+    for (size_t i = 0; i < HISTORY_SIZE; i++)
+        picture_Release(ctx->src[i]);
+    picture_Release(ctx->dst);
+}
+
+#ifndef DEINTERLACE_BENCH
+static const struct
+{
+    unsigned width, height;
+} sizes[] = {
+    { 16, 2 }, { 16, 10 }, { 34, 12 }, { 64, 38 }, { 200, 50 },
+    { 722, 482 }, { 1922, 1080 },
+};
+
+static int TestFilterLine(const char *name,
+                          void (*filter)(uint8_t *, uint8_t *, uint8_t *,
+                                         uint8_t *, int, int, int, int, int),
+                          int width)
+{
+    /* Five lines, with margins for the 3 pixels read around each pixel */
+    const int pitch = width + 64;
+    uint8_t *buf = malloc(4 * 5 * pitch + 2 * pitch);
+    int ret = 0;
+
+    assert(buf != NULL);
+
+    for (int i = 0; i < 4 * 5 * pitch + 2 * pitch; i++)
+        buf[i] = Random();
+
+    uint8_t *prev = buf + 2 * pitch + 32;
+    uint8_t *cur  = prev + 5 * pitch;
+    uint8_t *next = cur + 5 * pitch;
+    uint8_t *dst  = next + 5 * pitch;
+
+    for (int parity = 0; parity < 2 && ret == 0; parity++)
+        for (int mode = 0; mode <= 2 && ret == 0; mode += 2)
+            for (int edge = 0; edge < 3 && ret == 0; edge++)
+            {
+                /* The first and last lines are interpolated from mirrored
+                 * references */
+                int prefs = edge == 2 ? -pitch : pitch;
+                int mrefs = edge == 1 ? pitch : -pitch;
+                uint8_t expected[width];
+
+                yadif_filter_line_c(expected, prev, cur, next, width,
+                                    prefs, mrefs, parity, mode);
+                memset(dst - 16, 0xA5, width + 32);
+                filter(dst, prev, cur, next, width, prefs, mrefs, parity,
+                       mode);
+
+                for (int x = 0; x < width; x++)
+                    if (dst[x] != expected[x])
+                    {
+                        fprintf(stderr, "%s width %d parity %d mode %d: "
+                                "pixel %d is %u instead of %u\n", name,
+                                width, parity, mode, x, dst[x],
+                                expected[x]);
+                        ret = -1;
+                        break;
+                    }
+
+                for (int x = -16; x < 0; x++)
+                    if (dst[x] != 0xA5 || dst[width - x - 1] != 0xA5)
+                    {
+                        fprintf(stderr, "%s width %d: line overflows\n",
+                                name, width);
+                        ret = -1;
+                        break;
+                    }
+            }
+
+    free(buf);
+    return ret;
+}
+
+static int TestSlices(size_t a, unsigned width, unsigned height,
+                      unsigned threads)
+{
+    struct context ctx;
+
+    ContextInit(&ctx, a, width, height);
+
+    picture_t *ref = picture_NewFromFormat(&ctx.filter.fmt_out.video);
+    struct slice_pool *pool = SlicePoolNew(threads);
+    int ret = 0;
+
+    assert(ref != NULL && pool != NULL);
+
+    for (int field = 0; field < 2 && ret == 0; field++)
+        for (int order = 0; order < 2 && ret == 0; order++)
+        {
+            for (int i = 0; i < ref->i_planes; i++)
+            {
+                memset(ref->p[i].p_pixels, 0xA5,
+                       ref->p[i].i_pitch * ref->p[i].i_lines);
+                memset(ctx.dst->p[i].p_pixels, 0xA5,
+                       ctx.dst->p[i].i_pitch * ctx.dst->p[i].i_lines);
+            }
+
+            ctx.sys.slices = NULL;
+            algos[a].render(&ctx.filter, ref, ctx.src[2], order, field);
+            ctx.sys.slices = pool;
+            algos[a].render(&ctx.filter, ctx.dst, ctx.src[2], order, field);
+
+            for (int i = 0; i < ref->i_planes; i++)
+                if (memcmp(ref->p[i].p_pixels, ctx.dst->p[i].p_pixels,
+                           ref->p[i].i_pitch * ref->p[i].i_lines))
+                {
+                    fprintf(stderr, "%s %ux%u %u threads field %d order %d: "
+                            "plane %d mismatch\n", algos[a].name, width,
+                            height, threads, field, order, i);
+                    ret = -1;
+                    break;
+                }
+        }
+
+    SlicePoolDelete(pool);
+    picture_Release(ref);
+    ContextClean(&ctx);
+    return ret;
+}
+
+int main(void)
+{
+    alarm(30);
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        for (int w = 1; w <= 70; w++)
+            if (TestFilterLine("AVX2", vlcpriv_yadif_filter_line_avx2, w))
+                return 1;
+        if (TestFilterLine("AVX2", vlcpriv_yadif_filter_line_avx2, 720)
+         || TestFilterLine("AVX2", vlcpriv_yadif_filter_line_avx2, 1921))
+            return 1;
+    }
+    else
+        fprintf(stderr, "WARNING: could not test AVX2\n");
+#endif
+
+    for (size_t a = 0; a < ARRAY_SIZE(algos); a++)
+        for (size_t s = 0; s < ARRAY_SIZE(sizes); s++)
+            for (unsigned threads = 2; threads <= 5; threads++)
+                if (TestSlices(a, sizes[s].width, sizes[s].height, threads))
+                    return 1;
+
+    return 0;
+}
+
+#else /* DEINTERLACE_BENCH */
+int main(void)
+{
+    const unsigned max_threads = __MAX(vlc_GetCPUCount(), 1);
+
+    printf("%-8s %7s %9s\n", "algo", "threads", "frames/s");
+
+    for (size_t a = 0; a < ARRAY_SIZE(algos); a++)
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+        {
+            struct context ctx;
+
+            ContextInit(&ctx, a, 1920, 1080);
+            ctx.sys.slices = SlicePoolNew(threads);
+
+            vlc_tick_t start = vlc_tick_now(), elapsed;
+            unsigned frames = 0;
+
+            do
+            {
+                algos[a].render(&ctx.filter, ctx.dst, ctx.src[2], frames & 1,
+                                frames & 1);
+                frames++;
+                elapsed = vlc_tick_now() - start;
+            }
+            while (elapsed < VLC_TICK_FROM_MS(500));
+
+            printf("%-8s %7u %9.1f\n", algos[a].name,
+                   SlicePoolCount(ctx.sys.slices),
+                   frames / secf_from_vlc_tick(elapsed));
+
+            SlicePoolDelete(ctx.sys.slices);
+            ContextClean(&ctx);
+        }
+
+    return 0;
+}
+#endif
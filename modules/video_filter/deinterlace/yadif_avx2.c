@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * yadif_avx2.c : AVX2 implementation of the Yadif line filter
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "common.h" /* FFMIN3 et al. */
+#include "yadif.h"
+
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+
+/* Pixels are processed 16 at a time, as 16-bits words, which is exactly as
+ * wide as the C implementation needs: it is bit exact. */
+
+#define LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define ABSDIFF(a, b) _mm256_abs_epi16(_mm256_sub_epi16(a, b))
+#define AVG(a, b) _mm256_srli_epi16(_mm256_add_epi16(a, b), 1)
+
+/* Score of the edge direction j, with m and p centered on index 3 */
+#define SCORE(j) \
+    _mm256_add_epi16(_mm256_add_epi16( \
+        ABSDIFF(m[3 + (j) - 1], p[3 - (j) - 1]), \
+        ABSDIFF(m[3 + (j)],     p[3 - (j)])), \
+        ABSDIFF(m[3 + (j) + 1], p[3 - (j) + 1]))
+
+/* Selects the edge direction j where it scores better, and within mask */
+#define CHECK_EDGE(j, mask) do { \
+    __m256i score = SCORE(j); \
+    mask = _mm256_and_si256(_mm256_cmpgt_epi16(spatial_score, score), mask); \
+    spatial_score = _mm256_blendv_epi8(spatial_score, score, mask); \
+    spatial_pred = _mm256_blendv_epi8(spatial_pred, \
+                                      AVG(m[3 + (j)], p[3 - (j)]), mask); \
+} while (0)
+
+VLC_AVX2
+static inline void Filter16(uint8_t *dst, const uint8_t *prev,
+                            const uint8_t *cur, const uint8_t *next,
+                            const uint8_t *prev2, const uint8_t *next2,
+                            int prefs, int mrefs, int mode)
+{
+    __m256i m[7], p[7];
+
+    for (int i = 0; i < 7; i++)
+    {
+        m[i] = LOAD(&cur[mrefs + i - 3]);
+        p[i] = LOAD(&cur[prefs + i - 3]);
+    }
+
+    const __m256i c = m[3];
+    const __m256i e = p[3];
+    const __m256i p2 = LOAD(prev2);
+    const __m256i n2 = LOAD(next2);
+    const __m256i d = AVG(p2, n2);
+
+    __m256i temporal_diff0 = _mm256_srli_epi16(ABSDIFF(p2, n2), 1);
+    __m256i temporal_diff1 = AVG(ABSDIFF(LOAD(&prev[mrefs]), c),
+                                 ABSDIFF(LOAD(&prev[prefs]), e));
+    __m256i temporal_diff2 = AVG(ABSDIFF(LOAD(&next[mrefs]), c),
+                                 ABSDIFF(LOAD(&next[prefs]), e));
+    __m256i diff = _mm256_max_epi16(_mm256_max_epi16(temporal_diff0,
+                                                     temporal_diff1),
+                                    temporal_diff2);
+
+    __m256i spatial_pred = AVG(c, e);
+    __m256i spatial_score = _mm256_sub_epi16(SCORE(0), _mm256_set1_epi16(1));
+    __m256i mask;
+
+    mask = _mm256_set1_epi16(-1);
+    CHECK_EDGE(-1, mask);
+    CHECK_EDGE(-2, mask);
+    mask = _mm256_set1_epi16(-1);
+    CHECK_EDGE(1, mask);
+    CHECK_EDGE(2, mask);
+
+    if (mode < 2)
+    {
+        __m256i b = AVG(LOAD(&prev2[2 * mrefs]), LOAD(&next2[2 * mrefs]));
+        __m256i f = AVG(LOAD(&prev2[2 * prefs]), LOAD(&next2[2 * prefs]));
+        __m256i de = _mm256_sub_epi16(d, e);
+        __m256i dc = _mm256_sub_epi16(d, c);
+        __m256i bc = _mm256_sub_epi16(b, c);
+        __m256i fe = _mm256_sub_epi16(f, e);
+        __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc),
+                                       _mm256_min_epi16(bc, fe));
+        __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc),
+                                       _mm256_max_epi16(bc, fe));
+
+        diff = _mm256_max_epi16(_mm256_max_epi16(diff, min),
+                                _mm256_sub_epi16(_mm256_setzero_si256(), max));
+    }
+
+    /* diff is never negative, so that this is the C clipping */
+    spatial_pred = _mm256_min_epi16(_mm256_max_epi16(spatial_pred,
+                                                     _mm256_sub_epi16(d, diff)),
+                                    _mm256_add_epi16(d, diff));
+
+    _mm_storeu_si128((__m128i *)dst,
+                     _mm_packus_epi16(_mm256_castsi256_si128(spatial_pred),
+                                      _mm256_extracti128_si256(spatial_pred, 1)));
+}
+
+VLC_AVX2
+void vlcpriv_yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                    uint8_t *next, int w, int prefs, int mrefs,
+                                    int parity, int mode)
+{
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur  : next;
+
+    if (w < 16)
+    {
+        yadif_filter_line_c(dst, prev, cur, next, w, prefs, mrefs, parity,
+                            mode);
+        return;
+    }
+
+    int x;
+    for (x = 0; x < w - 16; x += 16)
+        Filter16(&dst[x], &prev[x], &cur[x], &next[x], &prev2[x], &next2[x],
+                 prefs, mrefs, mode);
+
+    /* The last vector overlaps the previous one rather than reading past the
+     * end of the line */
+    x = w - 16;
+    Filter16(&dst[x], &prev[x], &cur[x], &next[x], &prev2[x], &next2[x],
+             prefs, mrefs, mode);
+}
+#endif
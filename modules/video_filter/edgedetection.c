@@ -31,6 +31,8 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include "slice_pool.h"
+#include "convolution.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -40,7 +42,7 @@
 #define EDGE_DETECTION_LONGTEXT N_( \
     "Detects edges in the frame and highlights them in white." )
 
-#define WHITE 255
+#define FILTER_PREFIX "edgedetection-"
 
 /*****************************************************************************
  * Local prototypes
@@ -49,21 +51,28 @@ static int Open( vlc_object_t * );
 static void Close( vlc_object_t * );
 static picture_t *new_frame( filter_t * );
 static picture_t *Filter( filter_t *, picture_t * );
-static uint8_t sobel( const uint8_t *, const int, const int, int, int);
 
-/* Kernel for X axis */
-static const signed char pi_kernel_x[3][3] = {
-    {-1, 0, 1},
-    {-2, 0, 2},
-    {-1, 0, 1}
+/* Sobel operator: kernels for the X and Y axis, and the magnitude of the
+ * gradient clipped to white */
+static const struct conv_3x3 sobel = {
+    .coefs = {
+        { -1, 0, 1,
+          -2, 0, 2,
+          -1, 0, 1 },
+        { -1, -2, -1,
+           0,  0,  0,
+           1,  2,  1 },
+    },
+    .count = 2,
+    .gain = 1 << CONV_BITS,
+    .add_source = false,
 };
 
-/* Kernel for Y axis */
-static const signed char pi_kernel_y[3][3] = {
-    {-1, -2, -1},
-    {0, 0, 0},
-    {1, 2, 1}
-};
+typedef struct
+{
+    filter_chain_t *chain;
+    struct slice_pool *slices;
+} filter_sys_t;
 
 vlc_module_begin ()
 
@@ -73,10 +82,16 @@ vlc_module_begin ()
     set_category( CAT_VIDEO )
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     set_capability( "video filter", 0 )
+    add_integer_with_range( FILTER_PREFIX "threads", 1, 0, 16,
+                            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
     set_callbacks( Open, Close )
 
 vlc_module_end ()
 
+static const char *const ppsz_filter_options[] = {
+    "threads", NULL
+};
+
 static const struct filter_video_callbacks filter_video_edge_cbs =
 {
     new_frame, NULL,
@@ -97,11 +112,15 @@ static int Open( vlc_object_t *p_this )
         .video = &filter_video_edge_cbs,
         .sys = p_filter,
     };
+    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if ( p_sys == NULL )
+        return VLC_ENOMEM;
     /* Store the filter chain in p_sys */
     filter_chain_t *sys = filter_chain_NewVideo( p_filter, true, &owner );
     if ( sys == NULL)
     {
         msg_Err( p_filter, "Could not allocate filter chain" );
+        free( p_sys );
         return VLC_EGENERIC;
     }
     /* Clear filter chain */
@@ -112,19 +131,27 @@ static int Open( vlc_object_t *p_this )
     {
         msg_Err( p_filter, "Could not append filter to filter chain" );
         filter_chain_Delete( sys );
+        free( p_sys );
         return VLC_EGENERIC;
     }
     /* Add gaussian blur to the frame so to remove noise from the frame */
-    i_ret = filter_chain_AppendFromString( sys, "gaussianblur{deviation=1}" );
+    i_ret = filter_chain_AppendFromString( sys, "gaussianblur{sigma=1}" );
     if ( i_ret == -1 )
     {
         msg_Err( p_filter, "Could not append filter to filter chain" );
         filter_chain_Delete( sys );
+        free( p_sys );
         return VLC_EGENERIC;
     }
+    p_sys->chain = sys;
+
+    config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+    p_sys->slices = SlicePoolNew(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "threads" ) );
     /* Set callback function */
     p_filter->pf_video_filter = Filter;
-    p_filter->p_sys = sys;
+    p_filter->p_sys = p_sys;
     return VLC_SUCCESS;
 }
 
@@ -134,7 +161,11 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
-    filter_chain_Delete( (filter_chain_t *)p_filter->p_sys );
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    filter_chain_Delete( p_sys->chain );
+    SlicePoolDelete( p_sys->slices );
+    free( p_sys );
 }
 
 /* *****************************************************************************
@@ -156,8 +187,11 @@ static picture_t *new_frame( filter_t *p_filter )
  ******************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
     picture_t *p_filtered_frame =
-        filter_chain_VideoFilter( (filter_chain_t *)p_filter->p_sys, p_pic );
+        filter_chain_VideoFilter( p_sys->chain, p_pic );
+    if ( p_filtered_frame == NULL )
+        return NULL;
     picture_t *p_out_frame = picture_NewFromFormat( &p_pic->format );
     if ( p_out_frame == NULL )
     {
@@ -165,74 +199,18 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         msg_Err( p_filter, "Could not allocate memory for new frame" );
         return NULL;
     }
-    const int i_lines = p_filtered_frame->p[Y_PLANE].i_visible_lines;
-    const int i_pitch = p_filtered_frame->p[Y_PLANE].i_pitch;
-    /* Loop through every pixel in the frame */
-    for ( int i_line = 0; i_line < i_lines; i_line++ )
+    if ( Convolve3x3( p_sys->slices, &p_out_frame->p[Y_PLANE],
+                      &p_filtered_frame->p[Y_PLANE], &sobel ) )
     {
-        for ( int i_col = 0; i_col < i_pitch; i_col++ )
-        {
-            /* Set the new value for the pixel */
-            *( p_out_frame->p[Y_PLANE].p_pixels + ((i_pitch * i_line) + i_col) ) =
-                sobel( p_filtered_frame->p[Y_PLANE].p_pixels,
-                       i_pitch, i_lines, i_col, i_line );
-        }
+        picture_Release( p_out_frame );
+        picture_Release( p_filtered_frame );
+        return NULL;
     }
+    /* The chroma planes are already neutral */
+    for ( int i_plane = Y_PLANE + 1; i_plane < p_out_frame->i_planes; i_plane++ )
+        plane_CopyPixels( &p_out_frame->p[i_plane],
+                          &p_filtered_frame->p[i_plane] );
+    picture_CopyProperties( p_out_frame, p_filtered_frame );
     picture_Release( p_filtered_frame );
     return p_out_frame;
 }
-
-/******************************************************************************
- * Sobel Operator.
- * Calculates the gradients for both X and Y directions in a frame.
- ******************************************************************************/
-static uint8_t sobel( const uint8_t *p_pixels, const int i_pitch,
-                      const int i_lines, int i_col, int i_line )
-{
-    int i_x_val = 0;
-    int i_y_val = 0;
-    int i_col_offset;
-    int i_line_offset;
-    for ( int i_x = 0; i_x < 3; i_x++ )
-    {
-        /* Check if we are at the first pixel on the scanline */
-        if (i_x == 0 && i_col == 0)
-        {
-            /* Duplicate the first pixel on the scanline */
-            i_col_offset = 0;
-        }
-        /* Check if we are on the last pixel on the scanline */
-        else if (i_x == 2 && i_col == i_pitch - 1)
-        {
-            /* Duplicate the last pixel on the scanline */
-            i_col_offset = i_pitch - 1;
-        }
-        else
-        {
-            i_col_offset = i_col + i_x - 1;
-        }
-        for ( int i_y = 0; i_y < 3; i_y++ )
-        {
-            /* Check if we are at the top scanline */
-            if (i_y == 0 && i_line == 0)
-            {
-                /* Duplicate the top pixel */
-                i_line_offset = 0;
-            }
-            /* Check if we are the bottom scanline */
-            else if (i_y == 2 && i_line == i_lines - 1 )
-            {
-                /* Duplicate the bottom pixel */
-                i_line_offset = i_pitch * (i_lines - 1);
-            }
-            else {
-                i_line_offset = i_pitch * (i_line + i_y - 1);
-            }
-            /* Apply the kernel to the pixel */
-            i_x_val += pi_kernel_x[i_x][i_y] * p_pixels[i_line_offset + i_col_offset];
-            i_y_val += pi_kernel_y[i_x][i_y] * p_pixels[i_line_offset + i_col_offset];
-        }
-    }
-    int i_ret = abs(i_x_val) + abs(i_y_val);
-    return (i_ret > WHITE) ? WHITE : i_ret;
-}
@@ -0,0 +1,1118 @@
+/*****************************************************************************
+ * framediff.c: frame differences and labelling of the changed areas
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef FRAMEDIFF_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+#include <vlc_vector.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
+#include "slice_pool.h"
+#include "framediff.h"
+
+/* Line functions. All versions give the same results.
+ *
+ * The difference functions compare w pixels of one or two samples, the
+ * accumulation adds w differences to 16-bits sums, the reduction computes
+ * the rounded means of w groups of scale sums, and the threshold sets the
+ * bits of the samples above the threshold, clearing the other bits of the
+ * (w + 63) / 64 words. */
+struct framediff_funcs
+{
+    void (*diff1)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                  unsigned w);
+    void (*diff2)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                  unsigned w, unsigned offset);
+    void (*accumulate)(uint16_t *acc, const uint8_t *src, unsigned w);
+    void (*reduce)(uint8_t *dst, const uint16_t *acc, unsigned w,
+                   unsigned scale);
+    void (*threshold)(uint64_t *bits, const uint8_t *src, unsigned w,
+                      uint8_t threshold);
+};
+
+static void Diff1_c(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                    unsigned w)
+{
+    for (unsigned x = 0; x < w; x++)
+        dst[x] = abs(a[x] - b[x]);
+}
+
+static void Diff2_c(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                    unsigned w, unsigned offset)
+{
+    for (unsigned x = 0; x < w; x++)
+        dst[x] = abs(a[2 * x + offset] - b[2 * x + offset]);
+}
+
+static void Accumulate_c(uint16_t *acc, const uint8_t *src, unsigned w)
+{
+    for (unsigned x = 0; x < w; x++)
+        acc[x] += src[x];
+}
+
+static void Reduce_c(uint8_t *dst, const uint16_t *acc, unsigned w,
+                     unsigned scale)
+{
+    const unsigned area = scale * scale;
+    /* Exact division of the sums, below 2^32 / area */
+    const uint64_t inverse = ((UINT64_C(1) << 32) + area - 1) / area;
+
+    for (unsigned x = 0; x < w; x++)
+    {
+        unsigned sum = area / 2;
+
+        for (unsigned i = 0; i < scale; i++)
+            sum += acc[x * scale + i];
+        dst[x] = (sum * inverse) >> 32;
+    }
+}
+
+static void Threshold_c(uint64_t *bits, const uint8_t *src, unsigned w,
+                        uint8_t threshold)
+{
+    memset(bits, 0, ((w + 63) / 64) * sizeof (*bits));
+    for (unsigned x = 0; x < w; x++)
+        if (src[x] > threshold)
+            bits[x / 64] |= UINT64_C(1) << (x % 64);
+}
+
+static const struct framediff_funcs framediff_c = {
+    Diff1_c, Diff2_c, Accumulate_c, Reduce_c, Threshold_c,
+};
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static inline __m128i AbsDiff_sse2(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+VLC_SSE2
+static void Diff1_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                       unsigned w)
+{
+    unsigned x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *)&a[x]);
+        __m128i vb = _mm_loadu_si128((const __m128i *)&b[x]);
+
+        _mm_storeu_si128((__m128i *)&dst[x], AbsDiff_sse2(va, vb));
+    }
+    Diff1_c(&dst[x], &a[x], &b[x], w - x);
+}
+
+VLC_SSE2
+static void Diff2_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                       unsigned w, unsigned offset)
+{
+    const __m128i shift = _mm_cvtsi32_si128(8 * offset);
+    const __m128i mask = _mm_set1_epi16(0xff);
+    unsigned x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i d0 = AbsDiff_sse2(
+            _mm_loadu_si128((const __m128i *)&a[2 * x]),
+            _mm_loadu_si128((const __m128i *)&b[2 * x]));
+        __m128i d1 = AbsDiff_sse2(
+            _mm_loadu_si128((const __m128i *)&a[2 * x + 16]),
+            _mm_loadu_si128((const __m128i *)&b[2 * x + 16]));
+
+        d0 = _mm_and_si128(_mm_srl_epi16(d0, shift), mask);
+        d1 = _mm_and_si128(_mm_srl_epi16(d1, shift), mask);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm_packus_epi16(d0, d1));
+    }
+    Diff2_c(&dst[x], &a[2 * x], &b[2 * x], w - x, offset);
+}
+
+VLC_SSE2
+static void Accumulate_sse2(uint16_t *acc, const uint8_t *src, unsigned w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[x]);
+        __m128i lo = _mm_loadu_si128((const __m128i *)&acc[x]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)&acc[x + 8]);
+
+        lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+        hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i *)&acc[x], lo);
+        _mm_storeu_si128((__m128i *)&acc[x + 8], hi);
+    }
+    Accumulate_c(&acc[x], &src[x], w - x);
+}
+
+/* The sums of pairs of blocks are added pairwise in log2(scale) steps, for
+ * 8 blocks at a time. */
+VLC_SSE2
+static void Reduce_sse2(uint8_t *dst, const uint16_t *acc, unsigned w,
+                        unsigned scale)
+{
+    if (scale & (scale - 1))
+    {
+        Reduce_c(dst, acc, w, scale);
+        return;
+    }
+
+    const unsigned shift = 2 * ctz(scale);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(scale * scale / 2);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i r[FRAMEDIFF_MAX_SCALE];
+
+        for (unsigned i = 0; i < scale; i++)
+            r[i] = _mm_loadu_si128((const __m128i *)&acc[x * scale + 8 * i]);
+        /* The sums are below 2^15 */
+        for (unsigned n = scale; n > 1; n /= 2)
+            for (unsigned i = 0; i < n / 2; i++)
+                r[i] = _mm_packs_epi32(_mm_madd_epi16(r[2 * i], ones),
+                                       _mm_madd_epi16(r[2 * i + 1], ones));
+
+        __m128i v = _mm_srl_epi16(_mm_add_epi16(r[0], round),
+                                  _mm_cvtsi32_si128(shift));
+        _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(v, zero));
+    }
+    Reduce_c(&dst[x], &acc[x * scale], w - x, scale);
+}
+
+VLC_SSE2
+static void Threshold_sse2(uint64_t *bits, const uint8_t *src, unsigned w,
+                           uint8_t threshold)
+{
+    const __m128i t = _mm_set1_epi8(threshold);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+
+    memset(bits, 0, ((w + 63) / 64) * sizeof (*bits));
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[x]);
+        /* Bits of the samples not above the threshold */
+        unsigned below =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(v, t), zero));
+
+        bits[x / 64] |= (uint64_t)(~below & 0xffff) << (x % 64);
+    }
+    for (; x < w; x++)
+        if (src[x] > threshold)
+            bits[x / 64] |= UINT64_C(1) << (x % 64);
+}
+
+static const struct framediff_funcs framediff_sse2 = {
+    Diff1_sse2, Diff2_sse2, Accumulate_sse2, Reduce_sse2, Threshold_sse2,
+};
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline __m256i AbsDiff_avx2(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+VLC_AVX2
+static void Diff1_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                       unsigned w)
+{
+    unsigned x = 0;
+
+    for (; x + 32 <= w; x += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)&a[x]);
+        __m256i vb = _mm256_loadu_si256((const __m256i *)&b[x]);
+
+        _mm256_storeu_si256((__m256i *)&dst[x], AbsDiff_avx2(va, vb));
+    }
+    Diff1_c(&dst[x], &a[x], &b[x], w - x);
+}
+
+VLC_AVX2
+static void Diff2_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                       unsigned w, unsigned offset)
+{
+    const __m128i shift = _mm_cvtsi32_si128(8 * offset);
+    const __m256i mask = _mm256_set1_epi16(0xff);
+    unsigned x = 0;
+
+    for (; x + 32 <= w; x += 32)
+    {
+        __m256i d0 = AbsDiff_avx2(
+            _mm256_loadu_si256((const __m256i *)&a[2 * x]),
+            _mm256_loadu_si256((const __m256i *)&b[2 * x]));
+        __m256i d1 = AbsDiff_avx2(
+            _mm256_loadu_si256((const __m256i *)&a[2 * x + 32]),
+            _mm256_loadu_si256((const __m256i *)&b[2 * x + 32]));
+
+        d0 = _mm256_and_si256(_mm256_srl_epi16(d0, shift), mask);
+        d1 = _mm256_and_si256(_mm256_srl_epi16(d1, shift), mask);
+        /* The packing interleaves the 128-bits lanes */
+        _mm256_storeu_si256((__m256i *)&dst[x],
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(d0, d1), 0xD8));
+    }
+    Diff2_c(&dst[x], &a[2 * x], &b[2 * x], w - x, offset);
+}
+
+VLC_AVX2
+static void Accumulate_avx2(uint16_t *acc, const uint8_t *src, unsigned w)
+{
+    unsigned x = 0;
+
+    for (; x + 32 <= w; x += 32)
+    {
+        __m128i lo8 = _mm_loadu_si128((const __m128i *)&src[x]);
+        __m128i hi8 = _mm_loadu_si128((const __m128i *)&src[x + 16]);
+        __m256i lo = _mm256_loadu_si256((const __m256i *)&acc[x]);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)&acc[x + 16]);
+
+        lo = _mm256_add_epi16(lo, _mm256_cvtepu8_epi16(lo8));
+        hi = _mm256_add_epi16(hi, _mm256_cvtepu8_epi16(hi8));
+        _mm256_storeu_si256((__m256i *)&acc[x], lo);
+        _mm256_storeu_si256((__m256i *)&acc[x + 16], hi);
+    }
+    Accumulate_c(&acc[x], &src[x], w - x);
+}
+
+VLC_AVX2
+static void Threshold_avx2(uint64_t *bits, const uint8_t *src, unsigned w,
+                           uint8_t threshold)
+{
+    const __m256i t = _mm256_set1_epi8(threshold);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned x = 0;
+
+    memset(bits, 0, ((w + 63) / 64) * sizeof (*bits));
+    for (; x + 32 <= w; x += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&src[x]);
+        /* Bits of the samples not above the threshold */
+        uint32_t below = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_subs_epu8(v, t), zero));
+
+        bits[x / 64] |= (uint64_t)(uint32_t)~below << (x % 64);
+    }
+    for (; x < w; x++)
+        if (src[x] > threshold)
+            bits[x / 64] |= UINT64_C(1) << (x % 64);
+}
+
+static const struct framediff_funcs framediff_avx2 = {
+    /* The reduction handles few samples, and gains nothing from AVX2 */
+    Diff1_avx2, Diff2_avx2, Accumulate_avx2, Reduce_sse2, Threshold_avx2,
+};
+#endif
+
+static const struct framediff_funcs *FrameDiffGetFuncs(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return &framediff_avx2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return &framediff_sse2;
+#endif
+    return &framediff_c;
+}
+
+/*****************************************************************************
+ * Difference maps
+ *****************************************************************************/
+struct framediff_render
+{
+    const struct framediff_funcs *funcs;
+    plane_t *map;
+    const plane_t *cur, *old;
+    unsigned width, height; /* of the map */
+    unsigned scale;
+    unsigned size;          /* samples per pixel */
+    unsigned offset;
+    uint8_t *scratch;
+    size_t line_size;       /* bytes of the differences of one line */
+    size_t slice_size;      /* bytes of the buffers of each slice */
+};
+
+static void DiffLine(const struct framediff_render *s, uint8_t *dst,
+                     unsigned y, unsigned w)
+{
+    const uint8_t *a = &s->cur->p_pixels[y * s->cur->i_pitch];
+    const uint8_t *b = &s->old->p_pixels[y * s->old->i_pitch];
+
+    if (s->size == 2)
+        s->funcs->diff2(dst, a, b, w, s->offset);
+    else
+        s->funcs->diff1(dst, a, b, w);
+}
+
+static void DiffSlice(void *opaque, unsigned slice, unsigned count)
+{
+    const struct framediff_render *s = opaque;
+    const unsigned scale = s->scale;
+    const unsigned w = s->width * scale;
+    unsigned start, end;
+
+    SliceLines(s->height, slice, count, 1, &start, &end);
+
+    uint8_t *line = s->scratch + slice * s->slice_size;
+    uint16_t *acc = (uint16_t *)(line + s->line_size);
+
+    for (unsigned y = start; y < end; y++)
+    {
+        uint8_t *dst = &s->map->p_pixels[y * s->map->i_pitch];
+
+        if (scale == 1)
+        {
+            DiffLine(s, dst, y, w);
+            continue;
+        }
+
+        memset(acc, 0, w * sizeof (*acc));
+        for (unsigned i = 0; i < scale; i++)
+        {
+            DiffLine(s, line, y * scale + i, w);
+            s->funcs->accumulate(acc, line, w);
+        }
+        s->funcs->reduce(dst, acc, s->width, scale);
+    }
+}
+
+static int FrameDiffPlaneWith(const struct framediff_funcs *funcs,
+                              struct slice_pool *pool, plane_t *map,
+                              const plane_t *cur, const plane_t *old,
+                              unsigned scale, unsigned offset)
+{
+    const unsigned size = cur->i_pixel_pitch;
+    struct framediff_render s = {
+        .funcs = funcs, .map = map, .cur = cur, .old = old,
+        .scale = scale, .size = size, .offset = offset,
+    };
+
+    assert(size == 1 || size == 2);
+    assert(offset < size);
+    assert(scale >= 1 && scale <= FRAMEDIFF_MAX_SCALE);
+    assert(old->i_pixel_pitch == cur->i_pixel_pitch);
+    assert(old->i_visible_pitch == cur->i_visible_pitch
+        && old->i_visible_lines == cur->i_visible_lines);
+
+    s.width = cur->i_visible_pitch / size / scale;
+    s.height = cur->i_visible_lines / scale;
+    assert((int)s.width <= map->i_visible_pitch
+        && (int)s.height <= map->i_visible_lines);
+
+    if (s.width == 0 || s.height == 0)
+        return VLC_SUCCESS;
+    if (scale == 1)
+    {
+        SlicePoolRun(pool, DiffSlice, &s);
+        return VLC_SUCCESS;
+    }
+
+    s.line_size = (s.width * scale + 63) & ~(size_t)63;
+    s.slice_size = s.line_size + s.line_size * sizeof (uint16_t);
+
+    s.scratch = aligned_alloc(64, SlicePoolCount(pool) * s.slice_size);
+    if (unlikely(s.scratch == NULL))
+        return VLC_ENOMEM;
+
+    SlicePoolRun(pool, DiffSlice, &s);
+    aligned_free(s.scratch);
+    return VLC_SUCCESS;
+}
+
+int FrameDiffPlane(struct slice_pool *pool, plane_t *map, const plane_t *cur,
+                   const plane_t *old, unsigned scale, unsigned offset)
+{
+    return FrameDiffPlaneWith(FrameDiffGetFuncs(), pool, map, cur, old,
+                              scale, offset);
+}
+
+/*****************************************************************************
+ * Labelling
+ *****************************************************************************
+ * The samples above the threshold are gathered in horizontal runs, line by
+ * line. Each run is merged with the runs of the previous line it touches in
+ * a union-find forest, whose roots are the first run of their area. The
+ * number of runs is much lower than the number of samples, and the lines
+ * are scanned a word of bits at a time.
+ *****************************************************************************/
+struct framediff_run
+{
+    unsigned y;
+    unsigned x0, x1;  /* [x0, x1) */
+    uint32_t parent;
+    uint32_t label;   /* index of the region, valid for the roots */
+};
+
+struct framediff_labeller
+{
+    const struct framediff_funcs *funcs;
+    struct VLC_VECTOR(struct framediff_run) runs;
+    struct VLC_VECTOR(struct framediff_region) regions;
+    uint64_t *bits;
+    size_t bits_words;
+};
+
+static struct framediff_labeller *
+FrameDiffLabellerNewWith(const struct framediff_funcs *funcs)
+{
+    struct framediff_labeller *labeller = malloc(sizeof (*labeller));
+    if (unlikely(labeller == NULL))
+        return NULL;
+
+    labeller->funcs = funcs;
+    vlc_vector_init(&labeller->runs);
+    vlc_vector_init(&labeller->regions);
+    labeller->bits = NULL;
+    labeller->bits_words = 0;
+    return labeller;
+}
+
+struct framediff_labeller *FrameDiffLabellerNew(void)
+{
+    return FrameDiffLabellerNewWith(FrameDiffGetFuncs());
+}
+
+void FrameDiffLabellerDelete(struct framediff_labeller *labeller)
+{
+    free(labeller->bits);
+    vlc_vector_destroy(&labeller->regions);
+    vlc_vector_destroy(&labeller->runs);
+    free(labeller);
+}
+
+/* Finds the first sample from x which is (or is not) above the threshold */
+static unsigned NextBit(const uint64_t *bits, unsigned w, unsigned x,
+                        bool set)
+{
+    const uint64_t flip = set ? 0 : ~UINT64_C(0);
+
+    while (x < w)
+    {
+        uint64_t word = (bits[x / 64] ^ flip) >> (x % 64);
+
+        if (word != 0)
+            return __MIN(x + ctz(word), w);
+        x = (x | 63) + 1;
+    }
+    return w;
+}
+
+static uint32_t FindRoot(struct framediff_run *runs, uint32_t i)
+{
+    while (runs[i].parent != i)
+    {
+        runs[i].parent = runs[runs[i].parent].parent; /* path halving */
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+static void Merge(struct framediff_run *runs, uint32_t a, uint32_t b)
+{
+    a = FindRoot(runs, a);
+    b = FindRoot(runs, b);
+    if (a < b)
+        runs[b].parent = a;
+    else if (b < a)
+        runs[a].parent = b;
+}
+
+int FrameDiffLabel(struct framediff_labeller *labeller, const plane_t *map,
+                   uint8_t threshold, const struct framediff_region **regions,
+                   size_t *count)
+{
+    const unsigned w = map->i_visible_pitch, h = map->i_visible_lines;
+    const size_t words = (w + 63) / 64;
+
+    assert(map->i_pixel_pitch == 1);
+    vlc_vector_clear(&labeller->runs);
+    vlc_vector_clear(&labeller->regions);
+
+    if (words > labeller->bits_words)
+    {
+        uint64_t *bits = realloc(labeller->bits, words * sizeof (*bits));
+        if (unlikely(bits == NULL))
+            return VLC_ENOMEM;
+        labeller->bits = bits;
+        labeller->bits_words = words;
+    }
+
+    size_t prev_begin = 0, prev_end = 0;
+
+    for (unsigned y = 0; y < h; y++)
+    {
+        const size_t begin = labeller->runs.size;
+        size_t j = prev_begin;
+        unsigned x = 0;
+
+        labeller->funcs->threshold(labeller->bits,
+                                   &map->p_pixels[y * map->i_pitch], w,
+                                   threshold);
+
+        while ((x = NextBit(labeller->bits, w, x, true)) < w)
+        {
+            const uint32_t index = labeller->runs.size;
+            struct framediff_run run = {
+                .y = y, .x0 = x, .parent = index,
+            };
+
+            run.x1 = x = NextBit(labeller->bits, w, x, false);
+            if (!vlc_vector_push(&labeller->runs, run))
+                return VLC_ENOMEM;
+
+            /* The runs of the previous line touch this one (diagonally
+             * included) if they end after x0 - 1 and start before x1 + 1.
+             * The last of them may also touch the next run of this line. */
+            struct framediff_run *runs = labeller->runs.data;
+
+            while (j < prev_end && runs[j].x1 < run.x0)
+                j++;
+            for (size_t k = j; k < prev_end && runs[k].x0 <= run.x1; k++)
+                Merge(runs, index, k);
+        }
+
+        prev_begin = begin;
+        prev_end = labeller->runs.size;
+    }
+
+    /* The roots come first in their area, so that the regions are created
+     * in raster order before any other run refers to them. */
+    struct framediff_run *runs = labeller->runs.data;
+
+    for (size_t i = 0; i < labeller->runs.size; i++)
+    {
+        const uint32_t root = FindRoot(runs, i);
+        struct framediff_region *region;
+
+        if (root == i)
+        {
+            /* The bounding box is stored as [x, width) x [y, height) until
+             * all runs are added */
+            struct framediff_region r = {
+                .x = runs[i].x0, .y = runs[i].y,
+                .width = runs[i].x1, .height = runs[i].y + 1,
+            };
+
+            runs[i].label = labeller->regions.size;
+            if (!vlc_vector_push(&labeller->regions, r))
+                return VLC_ENOMEM;
+        }
+
+        region = &labeller->regions.data[runs[root].label];
+        region->x = __MIN(region->x, runs[i].x0);
+        region->width = __MAX(region->width, runs[i].x1);
+        region->height = runs[i].y + 1;
+        region->samples += runs[i].x1 - runs[i].x0;
+    }
+
+    for (size_t i = 0; i < labeller->regions.size; i++)
+    {
+        struct framediff_region *region = &labeller->regions.data[i];
+
+        region->width -= region->x;
+        region->height -= region->y;
+    }
+
+    *regions = labeller->regions.data;
+    *count = labeller->regions.size;
+    return VLC_SUCCESS;
+}
+
+#ifdef FRAMEDIFF_TEST
+/*
+ * The SIMD line functions are compared bit for bit against the C ones, the
+ * difference maps against a direct evaluation, and slices against the
+ * calling thread alone. The regions are compared against a flood fill.
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static unsigned Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+struct test_plane
+{
+    plane_t plane;
+    uint8_t *buf;
+};
+
+/* Visible area of w x h pixels, with a margin filled with the fill value,
+ * or random samples if negative */
+static void PlaneInit(struct test_plane *p, int w, int h, unsigned size,
+                      int fill)
+{
+    const int pitch = w * size + 13;
+    const int lines = h + 3;
+
+    p->buf = malloc(pitch * lines);
+    if (p->buf == NULL)
+        abort();
+    for (int i = 0; i < pitch * lines; i++)
+        p->buf[i] = fill < 0 ? (int)(Random() & 0xff) : fill;
+
+    p->plane.p_pixels = p->buf;
+    p->plane.i_lines = lines;
+    p->plane.i_pitch = pitch;
+    p->plane.i_pixel_pitch = size;
+    p->plane.i_visible_lines = h;
+    p->plane.i_visible_pitch = w * size;
+}
+
+static bool PlaneEqual(const plane_t *a, const plane_t *b)
+{
+    for (int y = 0; y < a->i_lines; y++)
+        if (memcmp(&a->p_pixels[y * a->i_pitch],
+                   &b->p_pixels[y * b->i_pitch], a->i_pitch))
+            return false;
+    return true;
+}
+
+static const struct
+{
+    const char *name;
+    const struct framediff_funcs *funcs;
+    unsigned cpu;
+} impls[] = {
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", &framediff_sse2, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", &framediff_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static bool Supported(size_t i)
+{
+    return (vlc_CPU() & impls[i].cpu) == impls[i].cpu;
+}
+
+static int TestLines(const struct framediff_funcs *funcs, const char *name,
+                     unsigned w)
+{
+    uint8_t a[2 * 200], b[2 * 200], ref[200], out[200];
+    uint16_t acc_ref[200], acc_out[200];
+    uint8_t reduce_ref[200], reduce_out[200];
+    uint64_t bits_ref[4], bits_out[4];
+    const uint8_t threshold = Random() & 0xff;
+
+    assert(w <= 200);
+    for (unsigned i = 0; i < 2 * w; i++)
+    {
+        a[i] = Random() & 0xff;
+        b[i] = Random() & 0xff;
+    }
+    for (unsigned i = 0; i < w; i++)
+        acc_ref[i] = acc_out[i] = Random() % (FRAMEDIFF_MAX_SCALE * 255);
+
+    Diff1_c(ref, a, b, w);
+    funcs->diff1(out, a, b, w);
+    if (memcmp(ref, out, w))
+        goto error;
+
+    for (unsigned offset = 0; offset < 2; offset++)
+    {
+        Diff2_c(ref, a, b, w, offset);
+        funcs->diff2(out, a, b, w, offset);
+        if (memcmp(ref, out, w))
+            goto error;
+    }
+
+    Accumulate_c(acc_ref, a, w);
+    funcs->accumulate(acc_out, a, w);
+    if (memcmp(acc_ref, acc_out, w * sizeof (*acc_ref)))
+        goto error;
+
+    for (unsigned scale = 1; scale <= FRAMEDIFF_MAX_SCALE; scale++)
+    {
+        /* Sums of scale lines */
+        for (unsigned i = 0; i < w; i++)
+            acc_ref[i] = Random() % (scale * 255 + 1);
+        Reduce_c(reduce_ref, acc_ref, w / scale, scale);
+        funcs->reduce(reduce_out, acc_ref, w / scale, scale);
+        if (memcmp(reduce_ref, reduce_out, w / scale))
+            goto error;
+    }
+
+    memset(bits_out, 0xA5, sizeof (bits_out));
+    Threshold_c(bits_ref, a, w, threshold);
+    funcs->threshold(bits_out, a, w, threshold);
+    if (memcmp(bits_ref, bits_out, ((w + 63) / 64) * sizeof (*bits_ref)))
+        goto error;
+    return 0;
+
+error:
+    fprintf(stderr, "%s line functions mismatch, width %u\n", name, w);
+    return 1;
+}
+
+static void RefDiff(plane_t *map, const plane_t *cur, const plane_t *old,
+                    unsigned scale, unsigned offset)
+{
+    const unsigned size = cur->i_pixel_pitch;
+    const unsigned w = cur->i_visible_pitch / size / scale;
+    const unsigned h = cur->i_visible_lines / scale;
+
+    for (unsigned y = 0; y < h; y++)
+        for (unsigned x = 0; x < w; x++)
+        {
+            unsigned sum = 0;
+
+            for (unsigned j = y * scale; j < (y + 1) * scale; j++)
+                for (unsigned i = x * scale; i < (x + 1) * scale; i++)
+                {
+                    const size_t a = j * cur->i_pitch + i * size + offset;
+                    const size_t b = j * old->i_pitch + i * size + offset;
+
+                    sum += abs(cur->p_pixels[a] - old->p_pixels[b]);
+                }
+            map->p_pixels[y * map->i_pitch + x] =
+                (sum + scale * scale / 2) / (scale * scale);
+        }
+}
+
+static int TestDiff(struct slice_pool *pool, int w, int h, unsigned size,
+                    unsigned scale)
+{
+    const unsigned offset = Random() % size;
+    struct test_plane cur, old, ref, dst;
+    int ret = 0;
+
+    PlaneInit(&cur, w, h, size, -1);
+    PlaneInit(&old, w, h, size, -1);
+    /* Make some areas identical */
+    for (int i = 0; i < old.plane.i_pitch * old.plane.i_lines; i++)
+        if (Random() % 4 == 0)
+            old.buf[i] = cur.buf[i];
+
+    PlaneInit(&ref, __MAX(w / scale, 1), __MAX(h / scale, 1), 1, 0xA5);
+    PlaneInit(&dst, __MAX(w / scale, 1), __MAX(h / scale, 1), 1, 0xA5);
+
+    RefDiff(&ref.plane, &cur.plane, &old.plane, scale, offset);
+    if (FrameDiffPlaneWith(&framediff_c, NULL, &dst.plane, &cur.plane,
+                           &old.plane, scale, offset) != VLC_SUCCESS)
+        abort();
+    if (!PlaneEqual(&ref.plane, &dst.plane))
+    {
+        fprintf(stderr, "C differences mismatch, %dx%d size %u scale %u\n",
+                w, h, size, scale);
+        ret = 1;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls) && ret == 0; i++)
+    {
+        if (!Supported(i))
+            continue;
+
+        memset(dst.buf, 0xA5, dst.plane.i_pitch * dst.plane.i_lines);
+        if (FrameDiffPlaneWith(impls[i].funcs, pool, &dst.plane, &cur.plane,
+                               &old.plane, scale, offset) != VLC_SUCCESS)
+            abort();
+        if (!PlaneEqual(&ref.plane, &dst.plane))
+        {
+            fprintf(stderr, "%s differences mismatch, %dx%d size %u "
+                    "scale %u, %u threads\n", impls[i].name, w, h, size,
+                    scale, SlicePoolCount(pool));
+            ret = 1;
+        }
+    }
+
+    free(dst.buf);
+    free(ref.buf);
+    free(old.buf);
+    free(cur.buf);
+    return ret;
+}
+
+/* Labels the area of (x, y) with a flood fill, clearing the samples */
+static void RefFill(uint8_t *mask, int w, int h, int x, int y,
+                    struct framediff_region *r, int *stack)
+{
+    unsigned x1 = x + 1, y1 = y + 1;
+    size_t depth = 0;
+
+    *r = (struct framediff_region) { .x = x, .y = y };
+    mask[y * w + x] = 0;
+    stack[depth++] = y * w + x;
+
+    while (depth > 0)
+    {
+        const int i = stack[--depth];
+        const int cx = i % w, cy = i / w;
+
+        r->samples++;
+        r->x = __MIN(r->x, (unsigned)cx);
+        r->y = __MIN(r->y, (unsigned)cy);
+        x1 = __MAX(x1, (unsigned)cx + 1);
+        y1 = __MAX(y1, (unsigned)cy + 1);
+
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                const int nx = cx + dx, ny = cy + dy;
+
+                if (nx < 0 || nx >= w || ny < 0 || ny >= h
+                 || !mask[ny * w + nx])
+                    continue;
+                mask[ny * w + nx] = 0;
+                stack[depth++] = ny * w + nx;
+            }
+    }
+    r->width = x1 - r->x;
+    r->height = y1 - r->y;
+}
+
+static int TestLabel(const struct framediff_funcs *funcs, const char *name,
+                     int w, int h, unsigned density)
+{
+    const uint8_t threshold = 100;
+    struct framediff_labeller *labeller = FrameDiffLabellerNewWith(funcs);
+    struct test_plane map;
+    uint8_t *mask = malloc(w * h);
+    int *stack = malloc(w * h * sizeof (*stack));
+    struct framediff_region *refs = malloc(w * h * sizeof (*refs));
+    const struct framediff_region *regions;
+    size_t count, ref_count = 0;
+    int ret = 0;
+
+    if (labeller == NULL || mask == NULL || stack == NULL || refs == NULL)
+        abort();
+
+    PlaneInit(&map, w, h, 1, 0xff);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            const uint8_t v = Random() % 100 < density
+                            ? threshold + 1 + Random() % 155
+                            : Random() % (threshold + 1);
+
+            map.plane.p_pixels[y * map.plane.i_pitch + x] = v;
+            mask[y * w + x] = v > threshold;
+        }
+
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            if (mask[y * w + x])
+                RefFill(mask, w, h, x, y, &refs[ref_count++], stack);
+
+    /* Twice, to check that the buffers are reset */
+    for (int pass = 0; pass < 2 && ret == 0; pass++)
+    {
+        if (FrameDiffLabel(labeller, &map.plane, threshold, &regions,
+                           &count) != VLC_SUCCESS)
+            abort();
+        if (count != ref_count
+         || (count > 0 && memcmp(regions, refs, count * sizeof (*refs))))
+        {
+            fprintf(stderr, "%s regions mismatch, %dx%d density %u%%: "
+                    "%zu instead of %zu\n", name, w, h, density, count,
+                    ref_count);
+            ret = 1;
+        }
+    }
+
+    free(map.buf);
+    free(refs);
+    free(stack);
+    free(mask);
+    FrameDiffLabellerDelete(labeller);
+    return ret;
+}
+
+int main(void)
+{
+    alarm(60);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls); i++)
+        if (!Supported(i))
+            fprintf(stderr, "WARNING: could not test %s\n", impls[i].name);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls); i++)
+        if (Supported(i))
+            for (unsigned w = 0; w <= 200; w++)
+                if (TestLines(impls[i].funcs, impls[i].name, w))
+                    return 1;
+
+    for (unsigned threads = 1; threads <= 4; threads++)
+    {
+        struct slice_pool *pool = SlicePoolNew(threads);
+
+        for (unsigned size = 1; size <= 2; size++)
+            for (unsigned scale = 1; scale <= FRAMEDIFF_MAX_SCALE; scale++)
+            {
+                for (int i = 0; i < 10; i++)
+                    if (TestDiff(pool, 1 + Random() % 150, 1 + Random() % 40,
+                                 size, scale))
+                        return 1;
+
+                if (TestDiff(pool, 1920 / 4, 17, size, scale))
+                    return 1;
+            }
+
+        SlicePoolDelete(pool);
+    }
+
+    for (unsigned density = 0; density <= 100; density += 10)
+        for (int i = 0; i < 10; i++)
+        {
+            const int w = 1 + Random() % 200, h = 1 + Random() % 60;
+
+            if (TestLabel(&framediff_c, "C", w, h, density))
+                return 1;
+            for (size_t j = 0; j < ARRAY_SIZE(impls); j++)
+                if (Supported(j)
+                 && TestLabel(impls[j].funcs, impls[j].name, w, h, density))
+                    return 1;
+        }
+
+    return 0;
+}
+#endif
+
+#ifdef FRAMEDIFF_BENCH
+/*
+ * Measures the frame rate of the difference and labelling of the luma of
+ * 1080p pictures, for each implementation, block size and an increasing
+ * number of threads.
+ */
+#include <stdio.h>
+#include <vlc_tick.h>
+
+static void PlaneInit(plane_t *p, uint8_t *buf, int w, int h)
+{
+    p->p_pixels = buf;
+    p->i_lines = p->i_visible_lines = h;
+    p->i_pitch = p->i_visible_pitch = w;
+    p->i_pixel_pitch = 1;
+}
+
+static void Bench(const char *name, const struct framediff_funcs *funcs,
+                  unsigned threads, unsigned scale, const plane_t *cur,
+                  const plane_t *old)
+{
+    struct slice_pool *pool = SlicePoolNew(threads);
+    struct framediff_labeller *labeller = FrameDiffLabellerNewWith(funcs);
+    const int w = cur->i_visible_pitch / scale;
+    const int h = cur->i_visible_lines / scale;
+    uint8_t *buf = malloc(w * h);
+    plane_t map;
+    const struct framediff_region *regions;
+    size_t count = 0;
+    vlc_tick_t start = vlc_tick_now(), elapsed;
+    unsigned frames = 0;
+
+    if (labeller == NULL || buf == NULL)
+        abort();
+    PlaneInit(&map, buf, w, h);
+
+    do
+    {
+        if (FrameDiffPlaneWith(funcs, pool, &map, cur, old, scale, 0)
+         || FrameDiffLabel(labeller, &map, 15, &regions, &count))
+            abort();
+        frames++;
+        elapsed = vlc_tick_now() - start;
+    }
+    while (elapsed < VLC_TICK_FROM_MS(500));
+
+    printf("%-6s %5u %7u %9.1f %8zu\n", name, scale, SlicePoolCount(pool),
+           frames / secf_from_vlc_tick(elapsed), count);
+
+    free(buf);
+    FrameDiffLabellerDelete(labeller);
+    SlicePoolDelete(pool);
+}
+
+static void BenchAll(unsigned threads, unsigned scale, const plane_t *cur,
+                     const plane_t *old)
+{
+    Bench("C", &framediff_c, threads, scale, cur, old);
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        Bench("SSE2", &framediff_sse2, threads, scale, cur, old);
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        Bench("AVX2", &framediff_avx2, threads, scale, cur, old);
+#endif
+}
+
+int main(void)
+{
+    const unsigned max_threads = __MAX(vlc_GetCPUCount(), 1);
+    const int w = 1920, h = 1080;
+    uint8_t *a = malloc(w * h), *b = malloc(w * h);
+    plane_t cur, old;
+
+    if (a == NULL || b == NULL)
+        abort();
+
+    /* Noise, and a few moving squares */
+    for (int i = 0; i < w * h; i++)
+        a[i] = b[i] = (i * 7 + (i >> 11)) & 0xff;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            if ((x / 96) % 4 == (y / 96) % 3)
+                b[y * w + x] ^= 0x40;
+    PlaneInit(&cur, a, w, h);
+    PlaneInit(&old, b, w, h);
+
+    printf("%-6s %5s %7s %9s %8s\n", "impl", "scale", "threads", "frames/s",
+           "regions");
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+        for (unsigned scale = 1; scale <= 4; scale *= 2)
+            BenchAll(threads, scale, &cur, &old);
+
+    free(b);
+    free(a);
+    return 0;
+}
+#endif
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * framediff.h: frame differences and labelling of the changed areas
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_FRAMEDIFF_H
+#define VLC_VIDEO_FILTER_FRAMEDIFF_H 1
+
+/**
+ * \file
+ * Difference maps of two pictures, in C, SSE2 and AVX2, split in slices
+ * over a slice pool, and labelling of the connected areas of a map above a
+ * threshold.
+ *
+ * Each sample of a difference map is the mean absolute difference of the
+ * pixels of a square block of the source planes. The planes have either
+ * one sample per pixel, or two interleaved samples of which only one is
+ * compared (the luma of packed YUV 4:2:2).
+ */
+
+struct slice_pool;
+
+/** Largest side of the blocks of a difference map */
+#define FRAMEDIFF_MAX_SCALE 8
+
+/**
+ * Computes the difference map of two planes of the same visible size.
+ *
+ * The map covers the whole blocks of scale x scale pixels of the planes,
+ * the remaining right and bottom pixels are ignored: its visible size
+ * must be at least the width and the height of the planes in pixels divided
+ * by the scale.
+ *
+ * @param scale side of the blocks, from 1 to FRAMEDIFF_MAX_SCALE
+ * @param offset index of the compared sample of each pixel, 0 or 1 for
+ *               planes with two samples per pixel, 0 otherwise
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int FrameDiffPlane(struct slice_pool *pool, plane_t *map, const plane_t *cur,
+                   const plane_t *old, unsigned scale, unsigned offset);
+
+/**
+ * A connected area of a map, with 8-connectivity.
+ */
+struct framediff_region
+{
+    unsigned x, y;          /**< top left corner of the bounding box */
+    unsigned width, height; /**< size of the bounding box */
+    unsigned samples;       /**< number of samples of the area */
+};
+
+struct framediff_labeller;
+
+/**
+ * Creates a labeller, keeping its buffers from one map to the next.
+ *
+ * @return the labeller, or NULL on error
+ */
+struct framediff_labeller *FrameDiffLabellerNew(void);
+
+/**
+ * Deletes a labeller and the regions it returned.
+ */
+void FrameDiffLabellerDelete(struct framediff_labeller *labeller);
+
+/**
+ * Finds the connected areas of the samples of a map above a threshold.
+ *
+ * The regions are ordered by their first sample in raster order, and remain
+ * valid until the next call with the same labeller.
+ *
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int FrameDiffLabel(struct framediff_labeller *labeller, const plane_t *map,
+                   uint8_t threshold, const struct framediff_region **regions,
+                   size_t *count);
+
+#endif
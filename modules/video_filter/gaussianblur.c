@@ -33,8 +33,8 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
-
-#include <math.h>                                          /* exp(), sqrt() */
+#include "slice_pool.h"
+#include "convolution.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -65,6 +65,8 @@ vlc_module_begin ()
     add_float_with_range( FILTER_PREFIX "sigma", 2., SIGMA_MIN, SIGMA_MAX,
                           SIGMA_TEXT, SIGMA_LONGTEXT,
                           false )
+    add_integer_with_range( FILTER_PREFIX "threads", 1, 0, 16,
+                            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
 
     set_callbacks( Create, Destroy )
 vlc_module_end ()
@@ -75,52 +77,31 @@ vlc_module_end ()
 static picture_t *Filter( filter_t *, picture_t * );
 
 static const char *const ppsz_filter_options[] = {
-    "sigma", NULL
+    "sigma", "threads", NULL
 };
 
-/* Comment this to use floats instead of integers (faster for bigger sigma
- * values)
- * For sigma = 2 ints are faster
- * For sigma = 4 floats are faster
- */
-#define DONT_USE_FLOATS
-
-#ifdef DONT_USE_FLOATS
-#   define type_t int
-#else
-#   define type_t float
-#endif
-
 typedef struct
 {
     double f_sigma;
-    int i_dim;
+    struct slice_pool *p_slices;
 
-    type_t *pt_distribution;
-    type_t *pt_buffer;
-    type_t *pt_scale;
+    /* Horizontal and vertical kernels of each plane, scaled to its
+     * subsampling */
+    struct conv_kernel kernels[PICTURE_PLANE_MAX][2];
+    int16_t coefs[PICTURE_PLANE_MAX][2][2*CONV_MAX_RADIUS+1];
 } filter_sys_t;
 
-static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
+static void gaussianblur_InitKernels( filter_sys_t *p_sys,
+                                      const vlc_chroma_description_t *p_dsc )
 {
-    double f_sigma = p_sys->f_sigma;
-    int i_dim = (int)(3.*f_sigma);
-    type_t *pt_distribution = xmalloc( (2*i_dim+1) * sizeof( type_t ) );
-
-    for( int x = -i_dim; x <= i_dim; x++ )
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
     {
-        const float f_distribution = sqrt( exp(-(x*x)/(f_sigma*f_sigma) ) / (2.*M_PI*f_sigma*f_sigma) );
-#ifdef DONT_USE_FLOATS
-        const float f_factor = 1 << 8;
-#else
-        const float f_factor = 1;
-#endif
+        const double f_h = p_sys->f_sigma * p_dsc->p[i].w.num / p_dsc->p[i].w.den;
+        const double f_v = p_sys->f_sigma * p_dsc->p[i].h.num / p_dsc->p[i].h.den;
 
-        pt_distribution[i_dim+x] = (type_t)( f_distribution * f_factor );
-        //printf("%f\n",(float)pt_distribution[i_dim+x]);
+        ConvKernelGaussian( &p_sys->kernels[i][0], p_sys->coefs[i][0], f_h );
+        ConvKernelGaussian( &p_sys->kernels[i][1], p_sys->coefs[i][1], f_v );
     }
-    p_sys->i_dim = i_dim;
-    p_sys->pt_distribution = pt_distribution;
 }
 
 static int Create( vlc_object_t *p_this )
@@ -147,6 +128,11 @@ static int Create( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_filter->fmt_in.video.i_chroma );
+    if( p_dsc == NULL )
+        return VLC_EGENERIC;
+
     filter_sys_t *p_sys = malloc( sizeof( filter_sys_t ) );
     if( p_sys == NULL )
         return VLC_ENOMEM;
@@ -162,14 +148,18 @@ static int Create( vlc_object_t *p_this )
     if( p_sys->f_sigma <= 0. )
     {
         msg_Err( p_filter, "sigma must be greater than zero" );
+        free( p_sys );
         return VLC_EGENERIC;
     }
-    gaussianblur_InitDistribution( p_sys );
-    msg_Dbg( p_filter, "gaussian distribution is %d pixels wide",
-             p_sys->i_dim*2+1 );
+    gaussianblur_InitKernels( p_sys, p_dsc );
+    msg_Dbg( p_filter, "gaussian distribution is %u pixels wide",
+             p_sys->kernels[Y_PLANE][0].radius*2+1 );
 
-    p_sys->pt_buffer = NULL;
-    p_sys->pt_scale = NULL;
+    p_sys->p_slices = SlicePoolNew(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "threads" ) );
+    if( p_sys->p_slices != NULL )
+        msg_Dbg( p_filter, "using %u threads",
+                 SlicePoolCount( p_sys->p_slices ) );
 
     return VLC_SUCCESS;
 }
@@ -179,9 +169,7 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    free( p_sys->pt_distribution );
-    free( p_sys->pt_buffer );
-    free( p_sys->pt_scale );
+    SlicePoolDelete( p_sys->p_slices );
 
     free( p_sys );
 }
@@ -190,10 +178,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
     filter_sys_t *p_sys = p_filter->p_sys;
-    const int i_dim = p_sys->i_dim;
-    type_t *pt_buffer;
-    type_t *pt_scale;
-    const type_t *pt_distribution = p_sys->pt_distribution;
 
     if( !p_pic ) return NULL;
 
@@ -203,93 +187,17 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_Release( p_pic );
         return NULL;
     }
-    if( !p_sys->pt_buffer )
-    {
-        p_sys->pt_buffer = realloc_or_free( p_sys->pt_buffer,
-                               p_pic->p[Y_PLANE].i_visible_lines *
-                               p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
-    }
-
-    pt_buffer = p_sys->pt_buffer;
-    if( !p_sys->pt_scale )
-    {
-        const int i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
-        const int i_pitch = p_pic->p[Y_PLANE].i_pitch;
-
-        p_sys->pt_scale = xmalloc( i_visible_lines * i_pitch * sizeof( type_t ) );
-        pt_scale = p_sys->pt_scale;
-
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-
-                for( int y = __MAX( -i_dim, -i_line );
-                     y <= __MIN( i_dim, i_visible_lines - i_line - 1 );
-                     y++ )
-                {
-                    for( int x = __MAX( -i_dim, -i_col );
-                         x <= __MIN( i_dim, i_visible_pitch - i_col + 1 );
-                         x++ )
-                    {
-                        t_value += pt_distribution[y+i_dim] *
-                                   pt_distribution[x+i_dim];
-                    }
-                }
-                pt_scale[i_line*i_pitch+i_col] = t_value;
-            }
-        }
-    }
 
-    pt_scale = p_sys->pt_scale;
     for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-
-        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
-        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
-
-        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
-        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
-
-        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
-        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
-
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int x = __MAX( -i_dim, -i_col*(x_factor+1) );
-                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
-                     x++ )
-                {
-                    t_value += pt_distribution[x+i_dim] *
-                               p_in[c+(x>>x_factor)];
-                }
-                pt_buffer[c] = t_value;
-            }
-        }
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
+        if( ConvolveSeparable( p_sys->p_slices, &p_outpic->p[i_plane],
+                               &p_pic->p[i_plane],
+                               &p_sys->kernels[i_plane][0],
+                               &p_sys->kernels[i_plane][1] ) )
         {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
-                {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
-                }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
-            }
+            picture_Release( p_outpic );
+            picture_Release( p_pic );
+            return NULL;
         }
     }
 
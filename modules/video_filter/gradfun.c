@@ -158,6 +158,9 @@ static int Open(vlc_object_t *object)
 
     filter->p_sys           = sys;
     filter->pf_video_filter = Filter;
+    /* Rows are blurred before any of them is overwritten */
+    filter->b_inplace = video_format_IsSimilar(&filter->fmt_in.video,
+                                               &filter->fmt_out.video);
     return VLC_SUCCESS;
 }
 
@@ -210,7 +213,7 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         if (__MIN(w, h) > 2 * r && cfg->buf) {
             filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
                          w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
+        } else if (dst != src) {
             plane_CopyPixels(dstp, srcp);
         }
     }
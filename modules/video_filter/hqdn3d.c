@@ -28,15 +28,25 @@
 # include "config.h"
 #endif
 
+#ifdef HQDN3D_TEST
+# undef NDEBUG
+#endif
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
+#include "slice_pool.h"
 
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
 
 #include "hqdn3d.h"
 
+#ifndef HQDN3D_TEST
 /*****************************************************************************
  * Local protypes
  *****************************************************************************/
@@ -73,6 +83,8 @@ vlc_module_begin()
             LUMA_TEMP_TEXT, LUMA_TEMP_TEXT, false)
     add_float_with_range(FILTER_PREFIX "chroma-temp", 4.5, 0.0, 254.0,
             CHROMA_TEMP_TEXT, CHROMA_TEMP_TEXT, false)
+    add_integer_with_range(FILTER_PREFIX "threads", 1, 0, 16,
+            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true)
 
     add_shortcut("hqdn3d")
 
@@ -80,9 +92,170 @@ vlc_module_begin()
 vlc_module_end()
 
 static const char *const filter_options[] = {
-    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", NULL
+    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", "threads", NULL
 };
+#endif
+
+typedef void (*denoise_line_t)(const unsigned int *, const unsigned char *,
+                               unsigned char *, unsigned int *,
+                               unsigned short *, int, const int *,
+                               const int *);
+
+#ifdef HAVE_AVX2_INTRINSICS
+/*****************************************************************************
+ * SIMD versions of deNoiseLine_c()
+ *
+ * The columns are independent, so that pixels are processed side by side,
+ * with the same 32-bits arithmetic as the C version. The coefficient tables
+ * are looked up one pixel at a time with SSE4.1, and gathered with AVX2.
+ *****************************************************************************/
+VLC_SSE4_1
+static inline __m128i LowPassMul_sse4(__m128i PrevMul, __m128i CurrMul,
+                                      const int *Coef)
+{
+    __m128i d = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(PrevMul, CurrMul),
+                                             _mm_set1_epi32(0x10007FF)), 12);
+
+    return _mm_add_epi32(CurrMul,
+                         _mm_setr_epi32(Coef[_mm_extract_epi32(d, 0)],
+                                        Coef[_mm_extract_epi32(d, 1)],
+                                        Coef[_mm_extract_epi32(d, 2)],
+                                        Coef[_mm_extract_epi32(d, 3)]));
+}
+
+VLC_SSE4_1
+static void deNoiseLine_sse4(const unsigned int *LineCur,
+                             const unsigned char *Frame,
+                             unsigned char *FrameDest,
+                             unsigned int *LineAnt, unsigned short *FrameAnt,
+                             int W, const int *Vertical, const int *Temporal)
+{
+    long X = 0;
+
+    for (; X + 4 <= W; X += 4)
+    {
+        __m128i PixelDst;
+
+        if (LineCur)
+        {
+            PixelDst = _mm_loadu_si128((const __m128i *)&LineCur[X]);
+            if (Vertical)
+                PixelDst = LowPassMul_sse4(
+                    _mm_loadu_si128((const __m128i *)&LineAnt[X]), PixelDst,
+                    Vertical);
+            _mm_storeu_si128((__m128i *)&LineAnt[X], PixelDst);
+        }
+        else
+        {
+            uint32_t pixels;
+
+            memcpy(&pixels, &Frame[X], 4);
+            PixelDst = _mm_slli_epi32(
+                _mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixels)), 16);
+        }
+
+        if (Temporal)
+        {
+            __m128i Ant = _mm_cvtepu16_epi32(
+                _mm_loadl_epi64((const __m128i *)&FrameAnt[X]));
+
+            PixelDst = LowPassMul_sse4(_mm_slli_epi32(Ant, 8), PixelDst,
+                                       Temporal);
+            Ant = _mm_and_si128(_mm_srli_epi32(
+                _mm_add_epi32(PixelDst, _mm_set1_epi32(0x1000007F)), 8),
+                _mm_set1_epi32(0xFFFF));
+            _mm_storel_epi64((__m128i *)&FrameAnt[X],
+                             _mm_packus_epi32(Ant, Ant));
+        }
+
+        __m128i Dst = _mm_and_si128(_mm_srli_epi32(
+            _mm_add_epi32(PixelDst, _mm_set1_epi32(0x10007FFF)), 16),
+            _mm_set1_epi32(0xFF));
+        uint32_t pixels;
+
+        Dst = _mm_packus_epi32(Dst, Dst);
+        pixels = _mm_cvtsi128_si32(_mm_packus_epi16(Dst, Dst));
+        memcpy(&FrameDest[X], &pixels, 4);
+    }
+
+    if (X < W)
+        deNoiseLine_c(LineCur ? &LineCur[X] : NULL, &Frame[X], &FrameDest[X],
+                      &LineAnt[X], &FrameAnt[X], W - X, Vertical, Temporal);
+}
+
+VLC_AVX2
+static inline __m256i LowPassMul_avx2(__m256i PrevMul, __m256i CurrMul,
+                                      const int *Coef)
+{
+    __m256i d = _mm256_srli_epi32(
+        _mm256_add_epi32(_mm256_sub_epi32(PrevMul, CurrMul),
+                         _mm256_set1_epi32(0x10007FF)), 12);
+
+    return _mm256_add_epi32(CurrMul, _mm256_i32gather_epi32(Coef, d, 4));
+}
+
+VLC_AVX2
+static inline __m128i Pack32To16_avx2(__m256i v)
+{
+    return _mm_packus_epi32(_mm256_castsi256_si128(v),
+                            _mm256_extracti128_si256(v, 1));
+}
+
+VLC_AVX2
+static void deNoiseLine_avx2(const unsigned int *LineCur,
+                             const unsigned char *Frame,
+                             unsigned char *FrameDest,
+                             unsigned int *LineAnt, unsigned short *FrameAnt,
+                             int W, const int *Vertical, const int *Temporal)
+{
+    long X = 0;
+
+    for (; X + 8 <= W; X += 8)
+    {
+        __m256i PixelDst;
+
+        if (LineCur)
+        {
+            PixelDst = _mm256_loadu_si256((const __m256i *)&LineCur[X]);
+            if (Vertical)
+                PixelDst = LowPassMul_avx2(
+                    _mm256_loadu_si256((const __m256i *)&LineAnt[X]),
+                    PixelDst, Vertical);
+            _mm256_storeu_si256((__m256i *)&LineAnt[X], PixelDst);
+        }
+        else
+            PixelDst = _mm256_slli_epi32(_mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i *)&Frame[X])), 16);
+
+        if (Temporal)
+        {
+            __m256i Ant = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128((const __m128i *)&FrameAnt[X]));
+
+            PixelDst = LowPassMul_avx2(_mm256_slli_epi32(Ant, 8), PixelDst,
+                                       Temporal);
+            Ant = _mm256_and_si256(_mm256_srli_epi32(
+                _mm256_add_epi32(PixelDst, _mm256_set1_epi32(0x1000007F)), 8),
+                _mm256_set1_epi32(0xFFFF));
+            _mm_storeu_si128((__m128i *)&FrameAnt[X], Pack32To16_avx2(Ant));
+        }
+
+        __m256i Dst = _mm256_and_si256(_mm256_srli_epi32(
+            _mm256_add_epi32(PixelDst, _mm256_set1_epi32(0x10007FFF)), 16),
+            _mm256_set1_epi32(0xFF));
+        __m128i Dst16 = Pack32To16_avx2(Dst);
+
+        _mm_storel_epi64((__m128i *)&FrameDest[X],
+                         _mm_packus_epi16(Dst16, Dst16));
+    }
+
+    if (X < W)
+        deNoiseLine_c(LineCur ? &LineCur[X] : NULL, &Frame[X], &FrameDest[X],
+                      &LineAnt[X], &FrameAnt[X], W - X, Vertical, Temporal);
+}
+#endif
 
+#ifndef HQDN3D_TEST
 /*****************************************************************************
  * filter_sys_t
  *****************************************************************************/
@@ -92,11 +265,117 @@ typedef struct
     int w[3], h[3];
 
     struct vf_priv_s cfg;
+    denoise_line_t line;
+    struct slice_pool *slices;
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
 } filter_sys_t;
 
+/*****************************************************************************
+ * Denoise
+ *****************************************************************************/
+struct denoise_plane
+{
+    const filter_sys_t *sys;
+    const plane_t *src;
+    plane_t *dst;
+    unsigned short *FrameAnt;
+    int W, H;
+    const int *Horizontal, *Vertical, *Temporal;
+};
+
+/* The horizontal low-pass is split in bands of lines */
+static void DenoiseHorizontalSlice(void *opaque, unsigned slice,
+                                   unsigned count)
+{
+    const struct denoise_plane *p = opaque;
+    const uint8_t *src = p->src->p_pixels;
+    const int pitch = p->src->i_pitch;
+    unsigned int *Spatial = p->sys->cfg.Spatial;
+    unsigned start, end;
+
+    SliceLines(p->H, slice, count, 4, &start, &end);
+
+    unsigned y = start;
+    for (; y + 4 <= end; y += 4)
+        deNoiseHorizontal4(&src[y * pitch], pitch, &Spatial[y * p->W], p->W,
+                           p->W, p->Horizontal);
+    for (; y < end; y++)
+        deNoiseHorizontal(&src[y * pitch], &Spatial[y * p->W], p->W,
+                          p->Horizontal);
+}
+
+/* The vertical and temporal low-passes are split in bands of columns, as
+ * each line depends on the one above */
+static void DenoiseVerticalSlice(void *opaque, unsigned slice, unsigned count)
+{
+    const struct denoise_plane *p = opaque;
+    const struct vf_priv_s *cfg = &p->sys->cfg;
+    unsigned start, end;
+
+    /* Keep bands of different threads in separate cache lines */
+    SliceLines(p->W, slice, count, 64, &start, &end);
+    if (start >= end)
+        return;
+
+    for (int y = 0; y < p->H; y++)
+        p->sys->line(p->Horizontal ? &cfg->Spatial[y * p->W + start] : NULL,
+                     &p->src->p_pixels[y * p->src->i_pitch + start],
+                     &p->dst->p_pixels[y * p->dst->i_pitch + start],
+                     &cfg->Line[start], &p->FrameAnt[y * p->W + start],
+                     end - start, y > 0 ? p->Vertical : NULL, p->Temporal);
+}
+
+static void DenoisePlane(filter_sys_t *sys, const plane_t *src, plane_t *dst,
+                         unsigned short *FrameAnt, int W, int H,
+                         const int *Spatial, const int *Temporal)
+{
+    struct denoise_plane p = {
+        .sys = sys, .src = src, .dst = dst, .FrameAnt = FrameAnt,
+        .W = W, .H = H, .Horizontal = Spatial, .Vertical = Spatial,
+        .Temporal = Temporal,
+    };
+
+    /* Same shortcuts as the original filter: without spatial strength,
+     * only the temporal low-pass is applied (whatever its strength) */
+    if (!Spatial[0])
+        p.Horizontal = p.Vertical = NULL;
+    else if (!Temporal[0])
+        p.Temporal = NULL;
+
+    if (sys->slices == NULL)
+    {
+        /* Both passes four lines at a time, while the lines are in cache */
+        unsigned int *LineCur = sys->cfg.Line + W;
+
+        for (int y = 0; y < H; y++)
+        {
+            const unsigned char *Frame = &src->p_pixels[y * src->i_pitch];
+            unsigned int *Filtered = NULL;
+
+            if (p.Horizontal)
+            {
+                if (y % 4 == 0 && y + 4 <= H)
+                    deNoiseHorizontal4(Frame, src->i_pitch, LineCur, W, W,
+                                       p.Horizontal);
+                else if (y >= H - H % 4)
+                    deNoiseHorizontal(Frame, &LineCur[(y % 4) * W], W,
+                                      p.Horizontal);
+                Filtered = &LineCur[(y % 4) * W];
+            }
+            sys->line(Filtered, Frame, &dst->p_pixels[y * dst->i_pitch],
+                      sys->cfg.Line, &FrameAnt[y * W], W,
+                      y > 0 ? p.Vertical : NULL, p.Temporal);
+        }
+        return;
+    }
+
+    if (p.Horizontal)
+        SlicePoolRun(sys->slices, DenoiseHorizontalSlice, &p);
+    SlicePoolRun(sys->slices, DenoiseVerticalSlice, &p);
+}
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -109,7 +388,7 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
+    int wmax = 0, hmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -136,8 +415,10 @@ static int Open(vlc_object_t *this)
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        if (sys->h[i] > hmax) hmax = sys->h[i];
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    /* Vertical history, and horizontally filtered lines */
+    cfg->Line = malloc(5*wmax*sizeof(unsigned int));
     if (!cfg->Line) {
         free(sys);
         return VLC_ENOMEM;
@@ -146,6 +427,27 @@ static int Open(vlc_object_t *this)
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
 
+    sys->slices = SlicePoolNew(var_InheritInteger(filter,
+                                                  FILTER_PREFIX "threads"));
+    if (sys->slices != NULL) {
+        /* Horizontally filtered plane */
+        cfg->Spatial = malloc(wmax*hmax*sizeof(unsigned int));
+        if (!cfg->Spatial) {
+            SlicePoolDelete(sys->slices);
+            free(cfg->Line);
+            free(sys);
+            return VLC_ENOMEM;
+        }
+        msg_Dbg(filter, "using %u threads", SlicePoolCount(sys->slices));
+    }
+
+    sys->line = deNoiseLine_c;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        sys->line = deNoiseLine_avx2;
+    else if (vlc_CPU_SSE4_1())
+        sys->line = deNoiseLine_sse4;
+#endif
 
     vlc_mutex_init( &sys->coefs_mutex );
     sys->b_recalc_coefs = true;
@@ -179,9 +481,11 @@ static void Close(vlc_object_t *this)
     var_DelCallback( filter, FILTER_PREFIX "luma-temp", DenoiseCallback, sys );
     var_DelCallback( filter, FILTER_PREFIX "chroma-temp", DenoiseCallback, sys );
 
+    SlicePoolDelete(sys->slices);
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
+    free(cfg->Spatial);
     free(cfg->Line);
     free(sys);
 }
@@ -218,30 +522,20 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; ++i) {
+        if (!cfg->Frame[i]) {
+            cfg->Frame[i] = deNoiseHistory(src->p[i].p_pixels,
+                                           sys->w[i], sys->h[i],
+                                           src->p[i].i_pitch);
+            if (unlikely(!cfg->Frame[i])) {
+                picture_Release( src );
+                picture_Release( dst );
+                return NULL;
+            }
+        }
+        DenoisePlane(sys, &src->p[i], &dst->p[i], cfg->Frame[i],
+                     sys->w[i], sys->h[i],
+                     cfg->Coefs[i ? 2 : 0], cfg->Coefs[i ? 3 : 1]);
     }
 
     return CopyInfoAndRelease(dst, src);
@@ -272,3 +566,151 @@ static int DenoiseCallback( vlc_object_t *p_this, char const *psz_var,
 
     return VLC_SUCCESS;
 }
+
+#else /* HQDN3D_TEST */
+/*
+ * The SIMD line functions are compared bit for bit against deNoiseLine_c(),
+ * with and without each low-pass, from the horizontal low-pass of random
+ * lines and random histories. The horizontal low-pass of four lines at once
+ * is compared against the one of each line.
+ */
+#include <assert.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static unsigned Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static const struct {
+    const char *name;
+    denoise_line_t line;
+    unsigned cpu;
+} impls[] = {
+    { "C", deNoiseLine_c, 0 },
+#ifdef HAVE_AVX2_INTRINSICS
+    { "SSE4.1", deNoiseLine_sse4, VLC_CPU_SSE4_1 },
+    { "AVX2", deNoiseLine_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static bool Supported(size_t i)
+{
+    return (vlc_CPU() & impls[i].cpu) == impls[i].cpu;
+}
+
+static int Coefs[2][512*16+1];
+
+static int Test(int W, bool spatial, bool vertical, bool temporal)
+{
+    const int *Spatial = Coefs[0], *Temporal = Coefs[1];
+    unsigned char *Frame = malloc(4 * W);
+    unsigned int *Lines = malloc(4 * W * sizeof (*Lines));
+    unsigned int *LineAnt = malloc(W * sizeof (*LineAnt));
+    unsigned short *FrameAnt = malloc(W * sizeof (*FrameAnt));
+    unsigned char *Ref = malloc(W), *Dst = malloc(W);
+    int ret = 0;
+
+    assert(Frame && Lines && LineAnt && FrameAnt && Ref && Dst);
+
+    for (int i = 0; i < 4 * W; i++)
+        Frame[i] = Random();
+    deNoiseHorizontal4(Frame, W, Lines, W, W, Spatial);
+
+    for (int i = 0; i < 4 && ret == 0; i++)
+    {
+        deNoiseHorizontal(&Frame[i * W], LineAnt, W, Spatial);
+        if (memcmp(LineAnt, &Lines[i * W], W * sizeof (*LineAnt)))
+        {
+            fprintf(stderr, "horizontal width %d line %d: mismatch\n", W, i);
+            ret = -1;
+        }
+    }
+
+    /* The second line is the vertical history of the first one, the third
+     * line the temporal history, with the rounding bits of a previous
+     * low-pass */
+    unsigned short *History = deNoiseHistory(&Frame[2 * W], W, 1, W);
+    assert(History != NULL);
+    for (int x = 0; x < W; x++)
+        History[x] |= Random() & 0xFF;
+
+    unsigned int *RefLine = malloc(W * sizeof (*RefLine));
+    unsigned short *RefAnt = malloc(W * sizeof (*RefAnt));
+    assert(RefLine && RefAnt);
+
+    memcpy(RefLine, &Lines[W], W * sizeof (*RefLine));
+    memcpy(RefAnt, History, W * sizeof (*RefAnt));
+    deNoiseLine_c(spatial ? Lines : NULL, Frame, Ref, RefLine, RefAnt, W,
+                  vertical ? Spatial : NULL, temporal ? Temporal : NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls) && ret == 0; i++)
+    {
+        if (!Supported(i))
+            continue;
+
+        memcpy(LineAnt, &Lines[W], W * sizeof (*LineAnt));
+        memcpy(FrameAnt, History, W * sizeof (*FrameAnt));
+        memset(Dst, 0xA5, W);
+        impls[i].line(spatial ? Lines : NULL, Frame, Dst, LineAnt, FrameAnt,
+                      W, vertical ? Spatial : NULL,
+                      temporal ? Temporal : NULL);
+
+        if (memcmp(Dst, Ref, W)
+         || memcmp(LineAnt, RefLine, W * sizeof (*LineAnt))
+         || memcmp(FrameAnt, RefAnt, W * sizeof (*FrameAnt)))
+        {
+            fprintf(stderr, "%s width %d spatial %d vertical %d "
+                    "temporal %d: mismatch\n", impls[i].name, W, spatial,
+                    vertical, temporal);
+            ret = -1;
+        }
+    }
+
+    free(RefAnt);
+    free(RefLine);
+    free(History);
+    free(Dst);
+    free(Ref);
+    free(FrameAnt);
+    free(LineAnt);
+    free(Lines);
+    free(Frame);
+    return ret;
+}
+
+int main(void)
+{
+    static const double strengths[][2] = {
+        { 4.0, 6.0 }, { 3.0, 4.5 }, { 0.5, 254.0 }, { 30.0, 1.0 },
+        { 254.0, 100.0 },
+    };
+    static const int widths[] = { 67, 100, 333, 720, 1921 };
+
+    alarm(60);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls); i++)
+        if (!Supported(i))
+            fprintf(stderr, "WARNING: could not test %s\n", impls[i].name);
+
+    for (size_t s = 0; s < ARRAY_SIZE(strengths); s++)
+    {
+        PrecalcCoefs(Coefs[0], strengths[s][0]);
+        PrecalcCoefs(Coefs[1], strengths[s][1]);
+
+        for (unsigned flags = 0; flags < 8; flags++)
+        {
+            for (int W = 1; W <= 40; W++)
+                if (Test(W, flags & 1, flags & 2, flags & 4))
+                    return 1;
+            for (size_t w = 0; w < ARRAY_SIZE(widths); w++)
+                if (Test(widths[w], flags & 1, flags & 2, flags & 4))
+                    return 1;
+        }
+    }
+    return 0;
+}
+#endif
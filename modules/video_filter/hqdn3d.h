@@ -31,147 +31,106 @@
 //===========================================================================//
 
 struct vf_priv_s {
-        int Coefs[4][512*16];
+        /* The index reaches 512*16 when the previous frame is white and the
+         * current pixel black */
+        int Coefs[4][512*16+1];
         unsigned int *Line;
+        unsigned int *Spatial;
         unsigned short *Frame[3];
 };
 
 
 /***************************************************************************/
 
-static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, int* Coef){
+static inline unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, const int* Coef){
 //    int dMul= (PrevMul&0xFFFFFF)-(CurrMul&0xFFFFFF);
     int dMul= PrevMul-CurrMul;
     unsigned int d=((dMul+0x10007FF)>>12);
     return CurrMul + Coef[d];
 }
 
-static void deNoiseTemporal(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
-                    int *Temporal)
+/* Horizontal low-pass of one line. Each line is independent of the others. */
+static void deNoiseHorizontal(
+                    const unsigned char *Frame,  // mpi->planes[x] line
+                    unsigned int *LineDest,      // W words
+                    int W,
+                    const int *Horizontal)
 {
-    unsigned int PixelDst;
+    /* First pixel on each line doesn't have previous pixel */
+    unsigned int PixelAnt = LineDest[0] = Frame[0]<<16;
 
-    for (long Y = 0; Y < H; Y++){
-        for (long X = 0; X < W; X++){
-            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
-            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-        }
-        Frame += sStride;
-        FrameDest += dStride;
-        FrameAnt += W;
-    }
+    for (long X = 1; X < W; X++)
+        LineDest[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
 }
 
-static void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+/* Same as deNoiseHorizontal() on four lines at once, so that the
+ * dependencies between successive pixels of each line overlap. */
+static void deNoiseHorizontal4(
+                    const unsigned char *Frame, long sStride,
+                    unsigned int *LineDest, long dStride,
+                    int W,
+                    const int *Horizontal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
+    unsigned int PixelAnt[4];
 
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    for (int i = 0; i < 4; i++)
+        PixelAnt[i] = LineDest[i*dStride] = Frame[i*sStride]<<16;
 
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
-
-    for (long Y = 1; Y < H; Y++){
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
-    }
+    for (long X = 1; X < W; X++)
+        for (int i = 0; i < 4; i++)
+            LineDest[i*dStride+X] = PixelAnt[i] =
+                LowPassMul(PixelAnt[i], Frame[i*sStride+X]<<16, Horizontal);
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+/* Vertical and temporal low-pass of (part of) one line. Each column is
+ * independent of the others.
+ *
+ * If LineCur is NULL, there is no spatial low-pass, otherwise it is the output
+ * of deNoiseHorizontal() for this line, and LineAnt holds the vertical history
+ * of each column. Vertical is NULL on the first line, which has no top
+ * neighbor. Temporal is NULL if there is no temporal low-pass. */
+static void deNoiseLine_c(
+                    const unsigned int *LineCur,
+                    const unsigned char *Frame,  // mpi->planes[x] line
+                    unsigned char *FrameDest,    // dmpi->planes[x] line
+                    unsigned int *LineAnt,
+                    unsigned short *FrameAnt,    // previous frame line
+                    int W,
+                    const int *Vertical, const int *Temporal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-        if(!FrameAnt)
-            return;
-        for (long Y = 0; Y < H; Y++){
-            unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
-            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
+    for (long X = 0; X < W; X++){
+        unsigned int PixelDst;
+
+        if (LineCur){
+            PixelDst = LineCur[X];
+            if (Vertical)
+                PixelDst = LowPassMul(LineAnt[X], PixelDst, Vertical);
+            LineAnt[X] = PixelDst;
         }
-    }
+        else
+            PixelDst = Frame[X]<<16;
 
-    if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
-        return;
-    }
-
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        if (Temporal){
+            PixelDst = LowPassMul(FrameAnt[X]<<8, PixelDst, Temporal);
+            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        }
         FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
+}
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
+static unsigned short *deNoiseHistory(const unsigned char *Frame,
+                                      int W, int H, int sStride)
+{
+    unsigned short *FrameAnt = malloc(W*H*sizeof(unsigned short));
+    if (!FrameAnt)
+        return NULL;
+
+    for (long Y = 0; Y < H; Y++){
+        unsigned short* dst=&FrameAnt[Y*W];
+        const unsigned char* src=Frame+Y*sStride;
+        for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
     }
+    return FrameAnt;
 }
 
 
@@ -77,6 +77,8 @@ static int Create( vlc_object_t *p_this )
         return VLC_EGENERIC;
 
     p_filter->pf_video_filter = Filter;
+    p_filter->b_inplace = video_format_IsSimilar( &p_filter->fmt_in.video,
+                                                  &p_filter->fmt_out.video );
     return VLC_SUCCESS;
 }
 
@@ -116,9 +118,10 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     {
         /* We don't want to invert the alpha plane */
         i_planes = p_pic->i_planes - 1;
-        memcpy(
-            p_outpic->p[A_PLANE].p_pixels, p_pic->p[A_PLANE].p_pixels,
-            p_pic->p[A_PLANE].i_pitch *  p_pic->p[A_PLANE].i_lines );
+        if( p_outpic != p_pic )
+            memcpy(
+                p_outpic->p[A_PLANE].p_pixels, p_pic->p[A_PLANE].p_pixels,
+                p_pic->p[A_PLANE].i_pitch *  p_pic->p[A_PLANE].i_lines );
     }
     else
     {
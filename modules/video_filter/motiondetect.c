@@ -30,10 +30,13 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
-#include <vlc_sout.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "filter_event_info.h"
+#include "slice_pool.h"
+#include "convolution.h"
+#include "framediff.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -41,6 +44,20 @@
 static int  Create    ( vlc_object_t * );
 static void Destroy   ( vlc_object_t * );
 
+#define DOWNSCALE_TEXT N_("Analysis block size")
+#define DOWNSCALE_LONGTEXT N_("Side of the blocks of pixels compared as a " \
+    "whole. Larger blocks are faster to analyse, but miss the smaller " \
+    "moving shapes.")
+
+#define THRESHOLD_TEXT N_("Threshold")
+#define THRESHOLD_LONGTEXT N_("Smoothed mean luma difference above which " \
+    "an area is considered as moving.")
+
+#define DRAW_TEXT N_("Draw moving areas")
+#define DRAW_LONGTEXT N_("Draw a rectangle around each moving area. The " \
+    "areas are reported through the \"" VIDEO_FILTER_EVENT_VARIABLE "\" " \
+    "variable in any case.")
+
 #define FILTER_PREFIX "motiondetect-"
 
 vlc_module_begin ()
@@ -50,6 +67,15 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     set_capability( "video filter", 0 )
 
+    add_integer_with_range( FILTER_PREFIX "downscale", 1, 1,
+                            FRAMEDIFF_MAX_SCALE,
+                            DOWNSCALE_TEXT, DOWNSCALE_LONGTEXT, false )
+    add_integer_with_range( FILTER_PREFIX "threshold", 13, 0, 254,
+                            THRESHOLD_TEXT, THRESHOLD_LONGTEXT, false )
+    add_bool( FILTER_PREFIX "draw", true, DRAW_TEXT, DRAW_LONGTEXT, false )
+    add_integer_with_range( FILTER_PREFIX "threads", 1, 0, 16,
+                            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
+
     add_shortcut( "motion" )
     set_callbacks( Create, Destroy )
 vlc_module_end ()
@@ -59,26 +85,37 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 static picture_t *Filter( filter_t *, picture_t * );
-static void GaussianConvolution( uint32_t *, uint32_t *, int, int, int );
-static int FindShapes( uint32_t *, uint32_t *, int, int, int,
-                       int *, int *, int *, int *, int *);
-static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size );
-#define NUM_COLORS (5000)
+
+static const char *const ppsz_filter_options[] = {
+    "downscale", "threshold", "draw", "threads", NULL
+};
+
+/* Binomial smoothing of the differences, to remove the noise */
+static const int16_t smooth_coefs[] = {
+    1 << (CONV_BITS - 4), 4 << (CONV_BITS - 4), 6 << (CONV_BITS - 4),
+    4 << (CONV_BITS - 4), 1 << (CONV_BITS - 4),
+};
+static const struct conv_kernel smooth_kernel = { 2, smooth_coefs };
 
 typedef struct
 {
-    bool is_yuv_planar;
+    int i_y_offset;
+    unsigned i_scale;
+    uint8_t i_threshold;
+    bool b_draw;
+    struct slice_pool *p_slices;
+
     picture_t *p_old;
-    uint32_t *p_buf;
-    uint32_t *p_buf2;
-
-    /* */
-    int i_colors;
-    int colors[NUM_COLORS];
-    int color_x_min[NUM_COLORS];
-    int color_x_max[NUM_COLORS];
-    int color_y_min[NUM_COLORS];
-    int color_y_max[NUM_COLORS];
+
+    /* Differences of the blocks and their smoothed version */
+    plane_t diff;
+    plane_t smooth;
+    uint8_t *p_maps;
+    struct framediff_labeller *p_labeller;
+
+    /* Moving areas of the last picture, in pixels */
+    video_filter_event_info_t event_info;
+    int i_region_alloc;
 } filter_sys_t;
 
 /*****************************************************************************
@@ -89,16 +126,17 @@ static int Create( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     const video_format_t *p_fmt = &p_filter->fmt_in.video;
     filter_sys_t *p_sys;
-    bool is_yuv_planar;
+    int i_y_offset, i_u_offset, i_v_offset;
 
     switch( p_fmt->i_chroma )
     {
         CASE_PLANAR_YUV
-            is_yuv_planar = true;
+            i_y_offset = 0;
             break;
 
         CASE_PACKED_YUV_422
-            is_yuv_planar = false;
+            GetPackedYuvOffsets( p_fmt->i_chroma,
+                                 &i_y_offset, &i_u_offset, &i_v_offset );
             break;
 
         default:
@@ -106,25 +144,66 @@ static int Create( vlc_object_t *p_this )
                      (char*)&(p_fmt->i_chroma) );
             return VLC_EGENERIC;
     }
-    p_filter->pf_video_filter = Filter;
 
     /* Allocate structure */
     p_filter->p_sys = p_sys = malloc( sizeof( filter_sys_t ) );
     if( p_filter->p_sys == NULL )
         return VLC_ENOMEM;
 
-    p_sys->is_yuv_planar = is_yuv_planar;
+    config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->i_y_offset = i_y_offset;
+    p_sys->i_scale = VLC_CLIP(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "downscale" ),
+        1, FRAMEDIFF_MAX_SCALE );
+    p_sys->i_threshold = VLC_CLIP(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "threshold" ), 0, 254 );
+    p_sys->b_draw = var_CreateGetBool( p_filter, FILTER_PREFIX "draw" );
     p_sys->p_old = NULL;
-    p_sys->p_buf  = calloc( p_fmt->i_width * p_fmt->i_height, sizeof(*p_sys->p_buf) );
-    p_sys->p_buf2 = calloc( p_fmt->i_width * p_fmt->i_height, sizeof(*p_sys->p_buf) );
 
-    if( !p_sys->p_buf || !p_sys->p_buf2 )
+    /* The maps cover the whole picture, the visible area is set for each
+     * picture */
+    const unsigned i_width = __MAX( p_fmt->i_width / p_sys->i_scale, 1 );
+    const unsigned i_height = __MAX( p_fmt->i_height / p_sys->i_scale, 1 );
+
+    p_sys->p_maps = malloc( 2 * i_width * i_height );
+    p_sys->p_labeller = FrameDiffLabellerNew();
+    if( !p_sys->p_maps || !p_sys->p_labeller )
     {
-        free( p_sys->p_buf2 );
-        free( p_sys->p_buf );
+        if( p_sys->p_labeller )
+            FrameDiffLabellerDelete( p_sys->p_labeller );
+        free( p_sys->p_maps );
+        free( p_sys );
         return VLC_ENOMEM;
     }
 
+    for( int i = 0; i < 2; i++ )
+    {
+        plane_t *p_map = i == 0 ? &p_sys->diff : &p_sys->smooth;
+
+        p_map->p_pixels = &p_sys->p_maps[i * i_width * i_height];
+        p_map->i_lines = p_map->i_visible_lines = i_height;
+        p_map->i_pitch = p_map->i_visible_pitch = i_width;
+        p_map->i_pixel_pitch = 1;
+    }
+
+    p_sys->p_slices = SlicePoolNew(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "threads" ) );
+    if( p_sys->p_slices != NULL )
+        msg_Dbg( p_filter, "using %u threads",
+                 SlicePoolCount( p_sys->p_slices ) );
+
+    /* Publish the moving areas, as done by the OpenCV filters */
+    p_sys->event_info.p_region = NULL;
+    p_sys->event_info.i_region_size = 0;
+    p_sys->i_region_alloc = 0;
+    var_Create( p_filter, VIDEO_FILTER_EVENT_VARIABLE,
+                VLC_VAR_ADDRESS | VLC_VAR_DOINHERIT );
+    var_SetAddress( p_filter, VIDEO_FILTER_EVENT_VARIABLE,
+                    &p_sys->event_info );
+
+    p_filter->pf_video_filter = Filter;
     return VLC_SUCCESS;
 }
 
@@ -136,123 +215,185 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    free( p_sys->p_buf2 );
-    free( p_sys->p_buf );
+    var_Destroy( p_filter, VIDEO_FILTER_EVENT_VARIABLE );
+    free( p_sys->event_info.p_region );
+    SlicePoolDelete( p_sys->p_slices );
+    FrameDiffLabellerDelete( p_sys->p_labeller );
+    free( p_sys->p_maps );
     if( p_sys->p_old )
         picture_Release( p_sys->p_old );
     free( p_sys );
 }
 
-
 /*****************************************************************************
- * Filter YUV Planar/Packed
+ * Moving areas
  *****************************************************************************/
-static void PreparePlanar( filter_t *p_filter, picture_t *p_inpic )
+static bool Overlap( const video_filter_region_info_t *a,
+                     const video_filter_region_info_t *b )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-    const video_format_t *p_fmt = &p_filter->fmt_in.video;
-
-    uint8_t *p_oldpix   = p_sys->p_old->p[Y_PLANE].p_pixels;
-    const int i_old_pitch = p_sys->p_old->p[Y_PLANE].i_pitch;
+    return __MAX( a->i_x, b->i_x ) < __MIN( a->i_x + a->i_width,
+                                            b->i_x + b->i_width ) - 1
+        && __MAX( a->i_y, b->i_y ) < __MIN( a->i_y + a->i_height,
+                                            b->i_y + b->i_height ) - 1;
+}
 
-    const uint8_t *p_inpix = p_inpic->p[Y_PLANE].p_pixels;
-    const int i_src_pitch = p_inpic->p[Y_PLANE].i_pitch;
+static int AddRegion( filter_sys_t *p_sys,
+                      const struct framediff_region *p_region )
+{
+    video_filter_event_info_t *p_info = &p_sys->event_info;
+    const int i_scale = p_sys->i_scale;
 
-    /**
-     * Substract Y planes
-     */
-    for( unsigned y = 0; y < p_fmt->i_height; y++ )
+    if( p_info->i_region_size >= p_sys->i_region_alloc )
     {
-        for( unsigned x = 0; x < p_fmt->i_width; x++ )
-            p_sys->p_buf2[y*p_fmt->i_width+x] = abs( p_inpix[y*i_src_pitch+x] - p_oldpix[y*i_old_pitch+x] );
+        const int i_alloc = __MAX( 16, 2 * p_sys->i_region_alloc );
+        video_filter_region_info_t *p_region_info =
+            realloc( p_info->p_region, i_alloc * sizeof( *p_region_info ) );
+        if( !p_region_info )
+            return VLC_ENOMEM;
+        p_info->p_region = p_region_info;
+        p_sys->i_region_alloc = i_alloc;
     }
 
-    int i_chroma_dx;
-    int i_chroma_dy;
-    switch( p_inpic->format.i_chroma )
-    {
-        case VLC_CODEC_I420:
-        case VLC_CODEC_J420:
-        case VLC_CODEC_YV12:
-            i_chroma_dx = 2;
-            i_chroma_dy = 2;
-            break;
+    p_info->p_region[p_info->i_region_size++] = (video_filter_region_info_t) {
+        .i_x = p_region->x * i_scale,
+        .i_y = p_region->y * i_scale,
+        .i_width = p_region->width * i_scale,
+        .i_height = p_region->height * i_scale,
+    };
+    return VLC_SUCCESS;
+}
 
-        case VLC_CODEC_I422:
-        case VLC_CODEC_J422:
-            i_chroma_dx = 2;
-            i_chroma_dy = 1;
-            break;
+/**
+ * Finds the areas of the luma plane which changed since the last picture,
+ * in event_info. The chroma is not compared, motion rarely changes it alone.
+ */
+static int FindShapes( filter_sys_t *p_sys, const plane_t *p_cur,
+                       const plane_t *p_old )
+{
+    video_filter_event_info_t *p_info = &p_sys->event_info;
+    const int i_scale = p_sys->i_scale;
+    const int i_size = p_cur->i_pixel_pitch;
+    plane_t cur = *p_cur, old = *p_old;
+
+    /* Analyse whole blocks, within the allocated maps */
+    const int i_width = __MIN( cur.i_visible_pitch / i_size / i_scale,
+                               p_sys->diff.i_pitch );
+    const int i_height = __MIN( cur.i_visible_lines / i_scale,
+                                p_sys->diff.i_lines );
+
+    p_info->i_region_size = 0;
+    if( i_width <= 0 || i_height <= 0 )
+        return VLC_SUCCESS;
+
+    cur.i_visible_pitch = old.i_visible_pitch = i_width * i_scale * i_size;
+    cur.i_visible_lines = old.i_visible_lines = i_height * i_scale;
+    p_sys->diff.i_visible_pitch = p_sys->smooth.i_visible_pitch = i_width;
+    p_sys->diff.i_visible_lines = p_sys->smooth.i_visible_lines = i_height;
 
-        default:
-            msg_Warn( p_filter, "Not taking chroma into account" );
-            return;
-    }
+    /**
+     * Compare the blocks, and apply some smoothing to remove noise
+     */
+    const struct framediff_region *p_regions;
+    size_t i_count;
+
+    if( FrameDiffPlane( p_sys->p_slices, &p_sys->diff, &cur, &old,
+                        i_scale, p_sys->i_y_offset )
+     || ConvolveSeparable( p_sys->p_slices, &p_sys->smooth, &p_sys->diff,
+                           &smooth_kernel, &smooth_kernel )
+     || FrameDiffLabel( p_sys->p_labeller, &p_sys->smooth,
+                        p_sys->i_threshold, &p_regions, &i_count ) )
+        return VLC_ENOMEM;
 
-    const uint8_t *p_inpix_u = p_inpic->p[U_PLANE].p_pixels;
-    const uint8_t *p_inpix_v = p_inpic->p[V_PLANE].p_pixels;
-    const int i_src_pitch_u = p_inpic->p[U_PLANE].i_pitch;
-    const int i_src_pitch_v = p_inpic->p[V_PLANE].i_pitch;
+    for( size_t i = 0; i < i_count; i++ )
+        if( AddRegion( p_sys, &p_regions[i] ) )
+            return VLC_ENOMEM;
 
-    const uint8_t *p_oldpix_u = p_sys->p_old->p[U_PLANE].p_pixels;
-    const uint8_t *p_oldpix_v = p_sys->p_old->p[V_PLANE].p_pixels;
-    const int i_old_pitch_u = p_sys->p_old->p[U_PLANE].i_pitch;
-    const int i_old_pitch_v = p_sys->p_old->p[V_PLANE].i_pitch;
+    /**
+     * Merge overlapping rectangles (there can be more than 1 moving shape
+     * in 1 rectangle)
+     */
+    video_filter_region_info_t *p_region = p_info->p_region;
 
-    for( unsigned y = 0; y < p_fmt->i_height/i_chroma_dy; y++ )
+    for( int i = 0; i < p_info->i_region_size; i++ )
     {
-        for( unsigned x = 0; x < p_fmt->i_width/i_chroma_dx; x ++ )
+        if( p_region[i].i_width == 0 )
+            continue;
+        for( int j = 0; j < p_info->i_region_size; j++ )
         {
-            const int d = abs( p_inpix_u[y*i_src_pitch_u+x] - p_oldpix_u[y*i_old_pitch_u+x] ) +
-                          abs( p_inpix_v[y*i_src_pitch_v+x] - p_oldpix_v[y*i_old_pitch_v+x] );
-
-            for( int j = 0; j < i_chroma_dy; j++ )
-            {
-                for( int i = 0; i < i_chroma_dx; i++ )
-                    p_sys->p_buf2[i_chroma_dy*p_fmt->i_width*j + i_chroma_dx*i] = d;
-            }
+            if( j == i || p_region[j].i_width == 0
+             || !Overlap( &p_region[i], &p_region[j] ) )
+                continue;
+
+            const int i_x = __MIN( p_region[i].i_x, p_region[j].i_x );
+            const int i_y = __MIN( p_region[i].i_y, p_region[j].i_y );
+
+            p_region[i].i_width = __MAX( p_region[i].i_x + p_region[i].i_width,
+                                         p_region[j].i_x + p_region[j].i_width )
+                                - i_x;
+            p_region[i].i_height = __MAX( p_region[i].i_y + p_region[i].i_height,
+                                          p_region[j].i_y + p_region[j].i_height )
+                                 - i_y;
+            p_region[i].i_x = i_x;
+            p_region[i].i_y = i_y;
+            p_region[j].i_width = 0;
+            j = -1; /* the grown rectangle may overlap the previous ones */
         }
     }
+
+    /**
+     * Drop the tiny shapes, and number the others
+     */
+    int i_regions = 0;
+
+    for( int i = 0; i < p_info->i_region_size; i++ )
+    {
+        if( p_region[i].i_width == 0
+         || ( p_region[i].i_width - 1 ) * ( p_region[i].i_height - 1 ) < 16 )
+            continue;
+        p_region[i_regions] = p_region[i];
+        p_region[i_regions].i_id = i_regions;
+        i_regions++;
+    }
+    p_info->i_region_size = i_regions;
+    return VLC_SUCCESS;
 }
 
-static int PreparePacked( filter_t *p_filter, picture_t *p_inpic, int *pi_pix_offset )
+static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+    const video_filter_event_info_t *p_info = &p_sys->event_info;
 
-    int i_y_offset, i_u_offset, i_v_offset;
-    if( GetPackedYuvOffsets( p_fmt->i_chroma,
-                             &i_y_offset, &i_u_offset, &i_v_offset ) )
+    for( int i = 0; i < p_info->i_region_size; i++ )
     {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&p_fmt->i_chroma );
-        return VLC_EGENERIC;
-    }
-    *pi_pix_offset = i_y_offset;
+        const video_filter_region_info_t *p_region = &p_info->p_region[i];
+        const int color_x_min = p_region->i_x;
+        const int color_x_max = p_region->i_x + p_region->i_width - 1;
+        const int color_y_min = p_region->i_y;
+        const int color_y_max = p_region->i_y + p_region->i_height - 1;
+        int x, y;
 
-    /* Substract all planes at once */
-    uint8_t *p_oldpix   = p_sys->p_old->p[Y_PLANE].p_pixels;
-    const int i_old_pitch = p_sys->p_old->p[Y_PLANE].i_pitch;
+        y = color_y_min;
+        for( x = color_x_min; x <= color_x_max; x++ )
+            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
 
-    const uint8_t *p_inpix = p_inpic->p[Y_PLANE].p_pixels;
-    const int i_src_pitch = p_inpic->p[Y_PLANE].i_pitch;
+        y = color_y_max;
+        for( x = color_x_min; x <= color_x_max; x++ )
+            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
 
-    for( unsigned y = 0; y < p_fmt->i_height; y++ )
-    {
-        for( unsigned x = 0; x < p_fmt->i_width; x+=2 )
-        {
-            int d;
-            d = abs( p_inpix[y*i_src_pitch+2*x+i_u_offset] - p_oldpix[y*i_old_pitch+2*x+i_u_offset] ) +
-                abs( p_inpix[y*i_src_pitch+2*x+i_v_offset] - p_oldpix[y*i_old_pitch+2*x+i_v_offset] );
+        x = color_x_min;
+        for( y = color_y_min; y <= color_y_max; y++ )
+            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
 
-            for( int i = 0; i < 2; i++ )
-                p_sys->p_buf2[y*p_fmt->i_width+x+i] =
-                    abs( p_inpix[y*i_src_pitch+2*(x+i)+i_y_offset] - p_oldpix[y*i_old_pitch+2*(x+i)+i_y_offset] ) + d;
-        }
+        x = color_x_max;
+        for( y = color_y_min; y <= color_y_max; y++ )
+            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
     }
-    return VLC_SUCCESS;
+    msg_Dbg( p_filter, "Counted %d moving shapes.", p_info->i_region_size );
 }
 
+/*****************************************************************************
+ * Filter YUV Planar/Packed
+ *****************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_inpic )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -274,33 +415,28 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_inpic )
         goto exit;
     }
 
-    int i_pix_offset;
-    int i_pix_size;
-    if( p_sys->is_yuv_planar )
-    {
-        PreparePlanar( p_filter, p_inpic );
-        i_pix_offset = 0;
-        i_pix_size = 1;
-    }
-    else
-    {
-        if( PreparePacked( p_filter, p_inpic, &i_pix_offset ) )
-            goto exit;
-        i_pix_size = 2;
-    }
-
     /**
      * Get the areas where movement was detected
      */
-    const video_format_t *p_fmt = &p_filter->fmt_in.video;
-    p_sys->i_colors = FindShapes( p_sys->p_buf2, p_sys->p_buf, p_fmt->i_width, p_fmt->i_width, p_fmt->i_height,
-                                  p_sys->colors, p_sys->color_x_min, p_sys->color_x_max, p_sys->color_y_min, p_sys->color_y_max );
+    const int i_had_regions = p_sys->event_info.i_region_size;
+
+    if( FindShapes( p_sys, &p_inpic->p[Y_PLANE], &p_sys->p_old->p[Y_PLANE] ) )
+    {
+        msg_Warn( p_filter, "Cannot find the moving shapes" );
+        p_sys->event_info.i_region_size = 0;
+    }
 
     /**
-     * Count final number of shapes
-     * Draw rectangles (there can be more than 1 moving shape in 1 rectangle)
+     * Report the moving shapes, and the end of the motion. The regions are
+     * only valid during the callbacks.
      */
-    Draw( p_filter, &p_outpic->p[Y_PLANE].p_pixels[i_pix_offset], p_outpic->p[Y_PLANE].i_pitch, i_pix_size );
+    if( p_sys->event_info.i_region_size > 0 || i_had_regions > 0 )
+        var_TriggerCallback( p_filter, VIDEO_FILTER_EVENT_VARIABLE );
+
+    if( p_sys->b_draw )
+        Draw( p_filter, &p_outpic->p[Y_PLANE].p_pixels[p_sys->i_y_offset],
+              p_outpic->p[Y_PLANE].i_pitch,
+              p_outpic->p[Y_PLANE].i_pixel_pitch );
 
     /* We're done. Lets keep a copy of the picture */
     picture_Release( p_sys->p_old );
@@ -310,246 +446,3 @@ exit:
     picture_Release( p_inpic );
     return p_outpic;
 }
-
-
-/*****************************************************************************
- * Gaussian Convolution
- *****************************************************************************
- *    Gaussian convolution ( sigma == 1.4 )
- *
- *    |  2  4  5  4  2  |   |  2  4  4  4  2 |
- *    |  4  9 12  9  4  |   |  4  8 12  8  4 |
- *    |  5 12 15 12  5  | ~ |  4 12 16 12  4 |
- *    |  4  9 12  9  4  |   |  4  8 12  8  4 |
- *    |  2  4  5  4  2  |   |  2  4  4  4  2 |
- *****************************************************************************/
-static void GaussianConvolution( uint32_t *p_inpix, uint32_t *p_smooth,
-                                 int i_src_pitch, int i_num_lines,
-                                 int i_src_visible )
-{
-    /* A bit overkill but ... simpler */
-    memset( p_smooth, 0, sizeof(*p_smooth) * i_src_pitch * i_num_lines );
-
-    for( int y = 2; y < i_num_lines - 2; y++ )
-    {
-        for( int x = 2; x < i_src_visible - 2; x++ )
-        {
-            p_smooth[y*i_src_visible+x] = (uint32_t)(
-              /* 2 rows up */
-                ( p_inpix[(y-2)*i_src_pitch+x-2] )
-              + ((p_inpix[(y-2)*i_src_pitch+x-1]
-              +   p_inpix[(y-2)*i_src_pitch+x]
-              +   p_inpix[(y-2)*i_src_pitch+x+1])<<1 )
-              + ( p_inpix[(y-2)*i_src_pitch+x+2] )
-              /* 1 row up */
-              + ((p_inpix[(y-1)*i_src_pitch+x-2]
-              + ( p_inpix[(y-1)*i_src_pitch+x-1]<<1 )
-              + ( p_inpix[(y-1)*i_src_pitch+x]*3 )
-              + ( p_inpix[(y-1)*i_src_pitch+x+1]<<1 )
-              +   p_inpix[(y-1)*i_src_pitch+x+2]
-              /* */
-              +   p_inpix[y*i_src_pitch+x-2]
-              + ( p_inpix[y*i_src_pitch+x-1]*3 )
-              + ( p_inpix[y*i_src_pitch+x]<<2 )
-              + ( p_inpix[y*i_src_pitch+x+1]*3 )
-              +   p_inpix[y*i_src_pitch+x+2]
-              /* 1 row down */
-              +   p_inpix[(y+1)*i_src_pitch+x-2]
-              + ( p_inpix[(y+1)*i_src_pitch+x-1]<<1 )
-              + ( p_inpix[(y+1)*i_src_pitch+x]*3 )
-              + ( p_inpix[(y+1)*i_src_pitch+x+1]<<1 )
-              +   p_inpix[(y+1)*i_src_pitch+x+2] )<<1 )
-              /* 2 rows down */
-              + ( p_inpix[(y+2)*i_src_pitch+x-2] )
-              + ((p_inpix[(y+2)*i_src_pitch+x-1]
-              +   p_inpix[(y+2)*i_src_pitch+x]
-              +   p_inpix[(y+2)*i_src_pitch+x+1])<<1 )
-              + ( p_inpix[(y+2)*i_src_pitch+x+2] )
-              ) >> 6 /* 115 */;
-        }
-    }
-}
-
-/*****************************************************************************
- *
- *****************************************************************************/
-static int FindShapes( uint32_t *p_diff, uint32_t *p_smooth,
-                       int i_pitch, int i_visible, int i_lines,
-                       int *colors,
-                       int *color_x_min, int *color_x_max,
-                       int *color_y_min, int *color_y_max )
-{
-    int last = 1;
-
-    /**
-     * Apply some smoothing to remove noise
-     */
-    GaussianConvolution( p_diff, p_smooth, i_pitch, i_lines, i_visible );
-
-    /**
-     * Label the shapes and build the labels dependencies list
-     */
-    for( int j = 0; j < i_pitch; j++ )
-    {
-        p_smooth[j] = 0;
-        p_smooth[(i_lines-1)*i_pitch+j] = 0;
-    }
-    for( int i = 1; i < i_lines-1; i++ )
-    {
-        int j;
-        p_smooth[i*i_pitch] = 0;
-        for( j = 1; j < i_pitch-1; j++ )
-        {
-            if( p_smooth[i*i_pitch+j] > 15 )
-            {
-                if( p_smooth[(i-1)*i_pitch+j-1] )
-                {
-                    p_smooth[i*i_pitch+j] = p_smooth[(i-1)*i_pitch+j-1];
-                }
-                else if( p_smooth[(i-1)*i_pitch+j] )
-                    p_smooth[i*i_pitch+j] = p_smooth[(i-1)*i_pitch+j];
-                else if( p_smooth[i*i_pitch+j-1] )
-                    p_smooth[i*i_pitch+j] = p_smooth[i*i_pitch+j-1];
-                else
-                {
-                    if( last < NUM_COLORS )
-                    {
-                        p_smooth[i*i_pitch+j] = last;
-                        colors[last] = last;
-                        last++;
-                    }
-                }
-                #define CHECK( A ) \
-                if( p_smooth[A] && p_smooth[A] != p_smooth[i*i_pitch+j] ) \
-                { \
-                    if( p_smooth[A] < p_smooth[i*i_pitch+j] ) \
-                        colors[p_smooth[i*i_pitch+j]] = p_smooth[A]; \
-                    else \
-                        colors[p_smooth[A]] = p_smooth[i*i_pitch+j]; \
-                }
-                CHECK( i*i_pitch+j-1 );
-                CHECK( (i-1)*i_pitch+j-1 );
-                CHECK( (i-1)*i_pitch+j );
-                CHECK( (i-1)*i_pitch+j+1 );
-                #undef CHECK
-            }
-            else
-            {
-                p_smooth[i*i_pitch+j] = 0;
-            }
-        }
-        p_smooth[i*i_pitch+j] = 0;
-    }
-
-    /**
-     * Initialise empty rectangle list
-     */
-    for( int i = 1; i < last; i++ )
-    {
-        color_x_min[i] = -1;
-        color_x_max[i] = -1;
-        color_y_min[i] = -1;
-        color_y_max[i] = -1;
-    }
-
-    /**
-     * Compute rectangle coordinates
-     */
-    for( int i = 0; i < i_pitch * i_lines; i++ )
-    {
-        if( p_smooth[i] )
-        {
-            while( colors[p_smooth[i]] != (int)p_smooth[i] )
-                p_smooth[i] = colors[p_smooth[i]];
-            if( color_x_min[p_smooth[i]] == -1 )
-            {
-                color_x_min[p_smooth[i]] =
-                color_x_max[p_smooth[i]] = i % i_pitch;
-                color_y_min[p_smooth[i]] =
-                color_y_max[p_smooth[i]] = i / i_pitch;
-            }
-            else
-            {
-                int x = i % i_pitch, y = i / i_pitch;
-                if( x < color_x_min[p_smooth[i]] )
-                    color_x_min[p_smooth[i]] = x;
-                if( x > color_x_max[p_smooth[i]] )
-                    color_x_max[p_smooth[i]] = x;
-                if( y < color_y_min[p_smooth[i]] )
-                    color_y_min[p_smooth[i]] = y;
-                if( y > color_y_max[p_smooth[i]] )
-                    color_y_max[p_smooth[i]] = y;
-            }
-        }
-    }
-
-    /**
-     * Merge overlaping rectangles
-     */
-    for( int i = 1; i < last; i++ )
-    {
-        if( colors[i] != i ) continue;
-        if( color_x_min[i] == -1 ) continue;
-        for( int j = i+1; j < last; j++ )
-        {
-            if( colors[j] != j ) continue;
-            if( color_x_min[j] == -1 ) continue;
-            if( __MAX( color_x_min[i], color_x_min[j] ) < __MIN( color_x_max[i], color_x_max[j] ) &&
-                __MAX( color_y_min[i], color_y_min[j] ) < __MIN( color_y_max[i], color_y_max[j] ) )
-            {
-                color_x_min[i] = __MIN( color_x_min[i], color_x_min[j] );
-                color_x_max[i] = __MAX( color_x_max[i], color_x_max[j] );
-                color_y_min[i] = __MIN( color_y_min[i], color_y_min[j] );
-                color_y_max[i] = __MAX( color_y_max[i], color_y_max[j] );
-                color_x_min[j] = -1;
-                j = 0;
-            }
-        }
-    }
-
-    return last;
-}
-
-static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size )
-{
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    int j = 0;
-
-    for( int i = 1; i < p_sys->i_colors; i++ )
-    {
-        int x, y;
-
-        if( p_sys->colors[i] != i )
-            continue;
-
-        const int color_x_min = p_sys->color_x_min[i];
-        const int color_x_max = p_sys->color_x_max[i];
-        const int color_y_min = p_sys->color_y_min[i];
-        const int color_y_max = p_sys->color_y_max[i];
-
-        if( color_x_min == -1 )
-            continue;
-        if( ( color_y_max - color_y_min ) * ( color_x_max - color_x_min ) < 16 )
-            continue;
-
-        j++;
-
-        y = color_y_min;
-        for( x = color_x_min; x <= color_x_max; x++ )
-            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
-
-        y = color_y_max;
-        for( x = color_x_min; x <= color_x_max; x++ )
-            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
-
-        x = color_x_min;
-        for( y = color_y_min; y <= color_y_max; y++ )
-            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
-
-        x = color_x_max;
-        for( y = color_y_min; y <= color_y_max; y++ )
-            p_pix[y*i_pix_pitch+x*i_pix_size] = 0xff;
-    }
-    msg_Dbg( p_filter, "Counted %d moving shapes.", j );
-}
@@ -1,6 +1,7 @@
 /*****************************************************************************
  * scale.c: video scaling module for YUVP/A, I420 and RGBA pictures
- *  Uses the low quality "nearest neighbour" algorithm.
+ *  Uses separable bilinear or bicubic filters, or the nearest neighbour
+ *  for palettized pictures.
  *****************************************************************************
  * Copyright (C) 2003-2007 VLC authors and VideoLAN
  *
@@ -34,21 +35,64 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#include "slice_pool.h"
+#include "scaler.h"
+
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#define MODE_TEXT N_("Scaling mode")
+#define MODE_LONGTEXT N_("Interpolation used to resize the pictures.")
+
+static const int pi_mode_values[] = { SCALE_BILINEAR, SCALE_BICUBIC };
+static const char *const ppsz_mode_descriptions[] =
+{ N_("Bilinear"), N_("Bicubic") };
+
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_capability( "video converter", 10 )
-    set_callback( OpenFilter )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_callbacks( OpenFilter, CloseFilter )
+    add_integer( "scale-mode", SCALE_BICUBIC, MODE_TEXT, MODE_LONGTEXT, true )
+        change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer_with_range( "scale-threads", 1, 0, 16,
+                            SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
 vlc_module_end ()
 
+/* Smaller pictures are scaled by the calling thread alone, as waking the
+ * workers up would cost more than it saves */
+#define SLICE_MIN_PIXELS (256 * 256)
+
+typedef struct
+{
+    enum scale_kernel kernel;
+    struct slice_pool *slices;
+
+    /* Horizontal and vertical filters of each plane, for the last sizes */
+    struct scale_filter h[PICTURE_PLANE_MAX];
+    struct scale_filter v[PICTURE_PLANE_MAX];
+} filter_sys_t;
+
+static bool IsSupported( vlc_fourcc_t i_chroma )
+{
+    return i_chroma == VLC_CODEC_YUVP ||
+           i_chroma == VLC_CODEC_YUVA ||
+           i_chroma == VLC_CODEC_I420 ||
+           i_chroma == VLC_CODEC_YV12 ||
+           i_chroma == VLC_CODEC_RGB32 ||
+           i_chroma == VLC_CODEC_RGBA ||
+           i_chroma == VLC_CODEC_ARGB ||
+           i_chroma == VLC_CODEC_BGRA;
+}
+
 /*****************************************************************************
  * OpenFilter: probe the filter and return score
  *****************************************************************************/
@@ -56,14 +100,7 @@ static int OpenFilter( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t*)p_this;
 
-    if( ( p_filter->fmt_in.video.i_chroma != VLC_CODEC_YUVP &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_YUVA &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_I420 &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_YV12 &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
-          p_filter->fmt_in.video.i_chroma != VLC_CODEC_BGRA ) ||
+    if( !IsSupported( p_filter->fmt_in.video.i_chroma ) ||
         p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
     {
         return VLC_EGENERIC;
@@ -72,26 +109,134 @@ static int OpenFilter( vlc_object_t *p_this )
     if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
         return VLC_EGENERIC;
 
+    filter_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->kernel = var_InheritInteger( p_filter, "scale-mode" );
+    if( p_sys->kernel != SCALE_BILINEAR )
+        p_sys->kernel = SCALE_BICUBIC;
+    p_sys->slices = SlicePoolNew( var_InheritInteger( p_filter,
+                                                      "scale-threads" ) );
+
 #warning Converter cannot (really) change output format.
     video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+    p_filter->p_sys = p_sys;
     p_filter->pf_video_filter = Filter;
 
-    msg_Dbg( p_filter, "%ix%i -> %ix%i", p_filter->fmt_in.video.i_width,
-             p_filter->fmt_in.video.i_height, p_filter->fmt_out.video.i_width,
-             p_filter->fmt_out.video.i_height );
+    msg_Dbg( p_filter, "%ix%i -> %ix%i, %u threads",
+             p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
+             p_filter->fmt_out.video.i_width, p_filter->fmt_out.video.i_height,
+             SlicePoolCount( p_sys->slices ) );
 
     return VLC_SUCCESS;
 }
 
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        ScaleFilterClean( &p_sys->h[i] );
+        ScaleFilterClean( &p_sys->v[i] );
+    }
+    SlicePoolDelete( p_sys->slices );
+    free( p_sys );
+}
+
+/* Reuses the coefficients as long as the sizes do not change, as the
+ * subpicture unit scales each region with the same filter */
+static int GetScaleFilter( filter_sys_t *p_sys, struct scale_filter *p_filter,
+                           int i_src, int i_dst )
+{
+    if( p_filter->pos != NULL && p_filter->src_size == i_src &&
+        p_filter->dst_size == i_dst && p_filter->kernel == p_sys->kernel )
+        return VLC_SUCCESS;
+
+    ScaleFilterClean( p_filter );
+    return ScaleFilterInit( p_filter, i_src, i_dst, p_sys->kernel );
+}
+
+static int ScalePicture( filter_sys_t *p_sys, picture_t *p_dst,
+                         const picture_t *p_src )
+{
+    for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+    {
+        const plane_t *p_src_plane = &p_src->p[i_plane];
+        plane_t *p_dst_plane = &p_dst->p[i_plane];
+        const int i_src_width  = p_src_plane->i_visible_pitch
+                               / p_src_plane->i_pixel_pitch;
+        const int i_src_height = p_src_plane->i_visible_lines;
+        const int i_dst_width  = p_dst_plane->i_visible_pitch
+                               / p_dst_plane->i_pixel_pitch;
+        const int i_dst_height = p_dst_plane->i_visible_lines;
+
+        if( i_src_width <= 0 || i_src_height <= 0 ||
+            i_dst_width <= 0 || i_dst_height <= 0 )
+            continue;
+
+        struct scale_filter *h = &p_sys->h[i_plane];
+        struct scale_filter *v = &p_sys->v[i_plane];
+
+        if( GetScaleFilter( p_sys, h, i_src_width, i_dst_width ) ||
+            GetScaleFilter( p_sys, v, i_src_height, i_dst_height ) )
+            return VLC_ENOMEM;
+
+        struct slice_pool *p_slices =
+            i_dst_width * i_dst_height >= SLICE_MIN_PIXELS ? p_sys->slices
+                                                           : NULL;
+        if( ScalePlane( p_slices, p_dst_plane, p_src_plane, h, v ) )
+            return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Palette indexes cannot be interpolated */
+static void ScaleNearest( picture_t *p_dst, const picture_t *p_src )
+{
+    const plane_t *p_src_plane = &p_src->p[0];
+    plane_t *p_dst_plane = &p_dst->p[0];
+    const int i_src_width  = p_src_plane->i_visible_pitch;
+    const int i_src_height = p_src_plane->i_visible_lines;
+    const int i_dst_width  = p_dst_plane->i_visible_pitch;
+    const int i_dst_height = p_dst_plane->i_visible_lines;
+
+    if( i_src_width <= 0 || i_src_height <= 0 )
+        return;
+
+    for( int y = 0; y < i_dst_height; y++ )
+    {
+        const int i_src_y = ( 2 * y + 1 ) * i_src_height / ( 2 * i_dst_height );
+        const uint8_t *p_src_line = &p_src_plane->p_pixels[i_src_y
+                                                * p_src_plane->i_pitch];
+        uint8_t *p_dst_line = &p_dst_plane->p_pixels[y * p_dst_plane->i_pitch];
+
+        for( int x = 0; x < i_dst_width; x++ )
+            p_dst_line[x] =
+                p_src_line[( 2 * x + 1 ) * i_src_width / ( 2 * i_dst_width )];
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
     picture_t *p_pic_dst;
 
     if( !p_pic ) return NULL;
 
+    /* The subpicture unit changes the formats between pictures */
+    if( !IsSupported( p_filter->fmt_in.video.i_chroma ) ||
+        p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
 #warning Converter cannot (really) change output format.
     video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
 
@@ -103,98 +248,14 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         return NULL;
     }
 
-    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_BGRA &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 )
-    {
-        for( int i_plane = 0; i_plane < p_pic_dst->i_planes; i_plane++ )
-        {
-            const int i_src_pitch    = p_pic->p[i_plane].i_pitch;
-            const int i_dst_pitch    = p_pic_dst->p[i_plane].i_pitch;
-            const int i_src_height   = p_filter->fmt_in.video.i_height;
-            const int i_src_width    = p_filter->fmt_in.video.i_width;
-            const int i_dst_height   = p_filter->fmt_out.video.i_height;
-            const int i_dst_width    = p_filter->fmt_out.video.i_width;
-            const int i_dst_visible_lines =
-                                       p_pic_dst->p[i_plane].i_visible_lines;
-            const int i_dst_visible_pitch =
-                                       p_pic_dst->p[i_plane].i_visible_pitch;
-            const int i_dst_hidden_pitch  = i_dst_pitch - i_dst_visible_pitch;
-#define SHIFT_SIZE 16
-            const int i_height_coef  = ( i_src_height << SHIFT_SIZE )
-                                       / i_dst_height;
-            const int i_width_coef   = ( i_src_width << SHIFT_SIZE )
-                                       / i_dst_width;
-            const int i_src_height_1 = i_src_height - 1;
-            const int i_src_width_1  = i_src_width - 1;
-
-            uint8_t *p_src = p_pic->p[i_plane].p_pixels;
-            uint8_t *p_dst = p_pic_dst->p[i_plane].p_pixels;
-            uint8_t *p_dstendline = p_dst + i_dst_visible_pitch;
-            const uint8_t *p_dstend = p_dst + i_dst_visible_lines*i_dst_pitch;
-
-            const int i_shift_height = i_dst_height / i_src_height;
-            const int i_shift_width = i_dst_width / i_src_width;
-
-            int l = 1<<(SHIFT_SIZE-i_shift_height);
-            for( ; p_dst < p_dstend;
-                 p_dst += i_dst_hidden_pitch,
-                 p_dstendline += i_dst_pitch, l += i_height_coef )
-            {
-                int k = 1<<(SHIFT_SIZE-i_shift_width);
-                uint8_t *p_srcl = p_src
-                       + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*i_src_pitch);
-
-                for( ; p_dst < p_dstendline; p_dst++, k += i_width_coef )
-                {
-                    *p_dst = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
-                }
-            }
-        }
-    }
-    else /* RGBA */
+    if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_YUVP )
+        ScaleNearest( p_pic_dst, p_pic );
+    else if( ScalePicture( p_sys, p_pic_dst, p_pic ) != VLC_SUCCESS )
     {
-        const int i_src_pitch = p_pic->p->i_pitch;
-        const int i_dst_pitch = p_pic_dst->p->i_pitch;
-        const int i_src_height   = p_filter->fmt_in.video.i_height;
-        const int i_src_width    = p_filter->fmt_in.video.i_width;
-        const int i_dst_height   = p_filter->fmt_out.video.i_height;
-        const int i_dst_width    = p_filter->fmt_out.video.i_width;
-        const int i_dst_visible_lines =
-                                   p_pic_dst->p->i_visible_lines;
-        const int i_dst_visible_pitch =
-                                   p_pic_dst->p->i_visible_pitch;
-        const int i_dst_hidden_pitch  = i_dst_pitch - i_dst_visible_pitch;
-        const int i_height_coef  = ( i_src_height << SHIFT_SIZE )
-                                   / i_dst_height;
-        const int i_width_coef   = ( i_src_width << SHIFT_SIZE )
-                                   / i_dst_width;
-        const int i_src_height_1 = i_src_height - 1;
-        const int i_src_width_1  = i_src_width - 1;
-
-        uint32_t *p_src = (uint32_t*)p_pic->p->p_pixels;
-        uint32_t *p_dst = (uint32_t*)p_pic_dst->p->p_pixels;
-        uint32_t *p_dstendline = p_dst + (i_dst_visible_pitch>>2);
-        const uint32_t *p_dstend = p_dst + i_dst_visible_lines*(i_dst_pitch>>2);
-
-        const int i_shift_height = i_dst_height / i_src_height;
-        const int i_shift_width = i_dst_width / i_src_width;
-
-        int l = 1<<(SHIFT_SIZE-i_shift_height);
-        for( ; p_dst < p_dstend;
-             p_dst += (i_dst_hidden_pitch>>2),
-             p_dstendline += (i_dst_pitch>>2),
-             l += i_height_coef )
-        {
-            int k = 1<<(SHIFT_SIZE-i_shift_width);
-            uint32_t *p_srcl = p_src
-                    + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*(i_src_pitch>>2));
-            for( ; p_dst < p_dstendline; p_dst++, k += i_width_coef )
-            {
-                *p_dst = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
-            }
-        }
+        msg_Err( p_filter, "cannot allocate the scaling buffers" );
+        picture_Release( p_pic_dst );
+        picture_Release( p_pic );
+        return NULL;
     }
 
     picture_CopyProperties( p_pic_dst, p_pic );
@@ -0,0 +1,951 @@
+/*****************************************************************************
+ * scaler.c: separable resampling of 8-bits planes
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef SCALER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
+#include "slice_pool.h"
+#include "scaler.h"
+
+/* The horizontal pass keeps SCALE_INTER_BITS fractional bits in its 16-bits
+ * output. The overshoot of the bicubic kernel stays within 16 bits. */
+#define SCALE_INTER_BITS 6
+#define SCALE_HSHIFT (SCALE_BITS - SCALE_INTER_BITS)
+#define SCALE_VSHIFT (SCALE_BITS + SCALE_INTER_BITS)
+
+/* The tables are padded to a multiple of SCALE_ALIGN output samples, so that
+ * the SIMD functions need not care about the end of the lines */
+#define SCALE_ALIGN 8
+
+/* The coefficients are stored by blocks of SCALE_ALIGN outputs. Within a
+ * block, each pair of taps is stored for all the outputs in turn. */
+static inline size_t CoefIndex(int x, unsigned t, unsigned taps)
+{
+    return ((x / SCALE_ALIGN) * taps + (t & ~1u)) * SCALE_ALIGN
+         + (x % SCALE_ALIGN) * 2 + (t & 1);
+}
+
+static inline int32_t CoefPair(const int16_t *coefs)
+{
+    return (uint16_t)coefs[0] | ((uint32_t)(uint16_t)coefs[1] << 16);
+}
+
+/* Line functions. All versions give the same results.
+ *
+ * The horizontal functions read the padded source line from pixel
+ * pos[x] to pos[x] + taps - 1 for each output pixel x, and may write the
+ * samples of the outputs up to the next multiple of SCALE_ALIGN. The one
+ * variant handles one sample per pixel, the four variant four interleaved
+ * samples.
+ *
+ * The vertical function reads 2 * pairs rows of w samples. */
+struct scale_funcs
+{
+    void (*hline1)(int16_t *dst, const uint8_t *src, int w, const int *pos,
+                   const int16_t *coefs, unsigned taps);
+    void (*hline4)(int16_t *dst, const uint8_t *src, int w, const int *pos,
+                   const int16_t *coefs, unsigned taps);
+    void (*vline)(uint8_t *dst, const int16_t *const *rows, int w,
+                  const int16_t *coefs, unsigned pairs);
+};
+
+static void HLine1_c(int16_t *dst, const uint8_t *src, int w, const int *pos,
+                     const int16_t *coefs, unsigned taps)
+{
+    for (int x = 0; x < w; x++)
+    {
+        const uint8_t *p = &src[pos[x]];
+        int32_t sum = 1 << (SCALE_HSHIFT - 1);
+
+        for (unsigned t = 0; t < taps; t++)
+            sum += coefs[CoefIndex(x, t, taps)] * p[t];
+        dst[x] = VLC_CLIP(sum >> SCALE_HSHIFT, INT16_MIN, INT16_MAX);
+    }
+}
+
+static void HLine4_c(int16_t *dst, const uint8_t *src, int w, const int *pos,
+                     const int16_t *coefs, unsigned taps)
+{
+    for (int x = 0; x < w; x++)
+    {
+        const uint8_t *p = &src[4 * pos[x]];
+
+        for (int c = 0; c < 4; c++)
+        {
+            int32_t sum = 1 << (SCALE_HSHIFT - 1);
+
+            for (unsigned t = 0; t < taps; t++)
+                sum += coefs[CoefIndex(x, t, taps)] * p[4 * t + c];
+            dst[4 * x + c] = VLC_CLIP(sum >> SCALE_HSHIFT,
+                                      INT16_MIN, INT16_MAX);
+        }
+    }
+}
+
+static void VLine_c(uint8_t *dst, const int16_t *const *rows, int w,
+                    const int16_t *coefs, unsigned pairs)
+{
+    for (int x = 0; x < w; x++)
+    {
+        int32_t sum = 1 << (SCALE_VSHIFT - 1);
+
+        for (unsigned i = 0; i < 2 * pairs; i++)
+            sum += coefs[i] * rows[i][x];
+        dst[x] = VLC_CLIP(sum >> SCALE_VSHIFT, 0, 255);
+    }
+}
+
+static const struct scale_funcs scale_c = { HLine1_c, HLine4_c, VLine_c };
+
+/* Filters the samples left over by the SIMD loops, from x to w */
+static void VLineTail(uint8_t *dst, const int16_t *const *rows, int x, int w,
+                      const int16_t *coefs, unsigned pairs)
+{
+    const int16_t *tail[SCALE_MAX_TAPS];
+
+    for (unsigned i = 0; i < 2 * pairs; i++)
+        tail[i] = &rows[i][x];
+    VLine_c(&dst[x], tail, w - x, coefs, pairs);
+}
+
+/* Two horizontally adjacent source pixels, as one 16-bits word */
+static inline uint32_t PixelPair(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Source pixels of the tap pair of 8 outputs, in the order of the
+ * coefficients */
+VLC_SSE2
+static inline __m128i GatherPairs_sse2(const uint8_t *src, const int *pos,
+                                       unsigned t)
+{
+    src += t;
+    return _mm_set_epi32(
+        PixelPair(&src[pos[6]]) | (PixelPair(&src[pos[7]]) << 16),
+        PixelPair(&src[pos[4]]) | (PixelPair(&src[pos[5]]) << 16),
+        PixelPair(&src[pos[2]]) | (PixelPair(&src[pos[3]]) << 16),
+        PixelPair(&src[pos[0]]) | (PixelPair(&src[pos[1]]) << 16));
+}
+
+VLC_SSE2
+static void HLine1_sse2(int16_t *dst, const uint8_t *src, int w,
+                        const int *pos, const int16_t *coefs, unsigned taps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (SCALE_HSHIFT - 1));
+
+    for (int x = 0; x < w; x += 8)
+    {
+        const int16_t *c = &coefs[x * taps];
+        __m128i lo = round, hi = round;
+
+        for (unsigned t = 0; t < taps; t += 2, c += 16)
+        {
+            __m128i p = GatherPairs_sse2(src, &pos[x], t);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi8(p, zero),
+                               _mm_load_si128((const __m128i *)&c[0])));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi8(p, zero),
+                               _mm_load_si128((const __m128i *)&c[8])));
+        }
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm_packs_epi32(_mm_srai_epi32(lo, SCALE_HSHIFT),
+                                         _mm_srai_epi32(hi, SCALE_HSHIFT)));
+    }
+}
+
+/* Four channels of one output pixel */
+VLC_SSE2
+static inline __m128i HPixel4_sse2(const uint8_t *src, int x, const int *pos,
+                                   const int16_t *coefs, unsigned taps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const uint8_t *p = &src[4 * pos[x]];
+    __m128i sum = _mm_set1_epi32(1 << (SCALE_HSHIFT - 1));
+
+    for (unsigned t = 0; t < taps; t += 2)
+    {
+        __m128i v = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&p[4 * t]), zero);
+
+        /* Interleave the channels of both pixels */
+        v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v,
+                  _mm_set1_epi32(CoefPair(&coefs[CoefIndex(x, t, taps)]))));
+    }
+    return _mm_srai_epi32(sum, SCALE_HSHIFT);
+}
+
+VLC_SSE2
+static void HLine4_sse2(int16_t *dst, const uint8_t *src, int w,
+                        const int *pos, const int16_t *coefs, unsigned taps)
+{
+    for (int x = 0; x < w; x += 2)
+        _mm_storeu_si128((__m128i *)&dst[4 * x], _mm_packs_epi32(
+            HPixel4_sse2(src, x, pos, coefs, taps),
+            HPixel4_sse2(src, x + 1, pos, coefs, taps)));
+}
+
+VLC_SSE2
+static void VLine_sse2(uint8_t *dst, const int16_t *const *rows, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m128i round = _mm_set1_epi32(1 << (SCALE_VSHIFT - 1));
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m128i c = _mm_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m128i a = _mm_loadu_si128((const __m128i *)&rows[2 * i][x]);
+            __m128i b = _mm_loadu_si128((const __m128i *)&rows[2 * i + 1][x]);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+        }
+        __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, SCALE_VSHIFT),
+                                    _mm_srai_epi32(hi, SCALE_VSHIFT));
+        _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(v, v));
+    }
+    if (x < w)
+        VLineTail(dst, rows, x, w, coefs, pairs);
+}
+
+static const struct scale_funcs scale_sse2 = {
+    HLine1_sse2, HLine4_sse2, VLine_sse2,
+};
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void HLine1_avx2(int16_t *dst, const uint8_t *src, int w,
+                        const int *pos, const int16_t *coefs, unsigned taps)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (SCALE_HSHIFT - 1));
+
+    for (int x = 0; x < w; x += 8)
+    {
+        const int16_t *c = &coefs[x * taps];
+        __m256i sum = round;
+
+        for (unsigned t = 0; t < taps; t += 2, c += 16)
+        {
+            __m256i p = _mm256_cvtepu8_epi16(GatherPairs_sse2(src, &pos[x], t));
+
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p,
+                      _mm256_load_si256((const __m256i *)c)));
+        }
+        sum = _mm256_srai_epi32(sum, SCALE_HSHIFT);
+        sum = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum, sum), 0x08);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm256_castsi256_si128(sum));
+    }
+}
+
+/* Four channels of two adjacent output pixels, one per lane */
+VLC_AVX2
+static inline __m256i HPixels4_avx2(const uint8_t *src, int x,
+                                    const int *pos, const int16_t *coefs,
+                                    unsigned taps)
+{
+    const uint8_t *p0 = &src[4 * pos[x]];
+    const uint8_t *p1 = &src[4 * pos[x + 1]];
+    __m256i sum = _mm256_set1_epi32(1 << (SCALE_HSHIFT - 1));
+
+    for (unsigned t = 0; t < taps; t += 2)
+    {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)&p0[4 * t]),
+            _mm_loadl_epi64((const __m128i *)&p1[4 * t])));
+        const int32_t c0 = CoefPair(&coefs[CoefIndex(x, t, taps)]);
+        const int32_t c1 = CoefPair(&coefs[CoefIndex(x + 1, t, taps)]);
+
+        v = _mm256_unpacklo_epi16(v, _mm256_srli_si256(v, 8));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v,
+                  _mm256_setr_epi32(c0, c0, c0, c0, c1, c1, c1, c1)));
+    }
+    return _mm256_srai_epi32(sum, SCALE_HSHIFT);
+}
+
+VLC_AVX2
+static void HLine4_avx2(int16_t *dst, const uint8_t *src, int w,
+                        const int *pos, const int16_t *coefs, unsigned taps)
+{
+    for (int x = 0; x < w; x += 4)
+    {
+        __m256i v = _mm256_packs_epi32(
+            HPixels4_avx2(src, x, pos, coefs, taps),
+            HPixels4_avx2(src, x + 2, pos, coefs, taps));
+
+        /* Lanes hold pixels x, x + 2 and x + 1, x + 3 */
+        _mm256_storeu_si256((__m256i *)&dst[4 * x],
+                            _mm256_permute4x64_epi64(v, 0xD8));
+    }
+}
+
+VLC_AVX2
+static void VLine_avx2(uint8_t *dst, const int16_t *const *rows, int w,
+                       const int16_t *coefs, unsigned pairs)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (SCALE_VSHIFT - 1));
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m256i lo = round, hi = round;
+
+        for (unsigned i = 0; i < pairs; i++)
+        {
+            const __m256i c = _mm256_set1_epi32(CoefPair(&coefs[2 * i]));
+            __m256i a = _mm256_loadu_si256((const __m256i *)&rows[2 * i][x]);
+            __m256i b = _mm256_loadu_si256(
+                (const __m256i *)&rows[2 * i + 1][x]);
+
+            lo = _mm256_add_epi32(lo,
+                    _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+            hi = _mm256_add_epi32(hi,
+                    _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+        }
+        __m256i v = _mm256_packs_epi32(_mm256_srai_epi32(lo, SCALE_VSHIFT),
+                                       _mm256_srai_epi32(hi, SCALE_VSHIFT));
+        v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm256_castsi256_si128(v));
+    }
+    if (x < w)
+        VLineTail(dst, rows, x, w, coefs, pairs);
+}
+
+static const struct scale_funcs scale_avx2 = {
+    HLine1_avx2, HLine4_avx2, VLine_avx2,
+};
+#endif
+
+static const struct scale_funcs *ScaleGetFuncs(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return &scale_avx2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return &scale_sse2;
+#endif
+    return &scale_c;
+}
+
+/*****************************************************************************
+ * Coefficients
+ *****************************************************************************/
+static double ScaleKernel(enum scale_kernel kernel, double x)
+{
+    x = fabs(x);
+    if (kernel == SCALE_BILINEAR)
+        return x < 1. ? 1. - x : 0.;
+
+    /* Keys cubic convolution, with a = -0.5 */
+    if (x < 1.)
+        return (1.5 * x - 2.5) * x * x + 1.;
+    if (x < 2.)
+        return ((-.5 * x + 2.5) * x - 4.) * x + 2.;
+    return 0.;
+}
+
+int ScaleFilterInit(struct scale_filter *filter, int src_size, int dst_size,
+                    enum scale_kernel kernel)
+{
+    const double support = kernel == SCALE_BICUBIC ? 2. : 1.;
+    const double ratio = (double)src_size / dst_size;
+    /* The kernel is stretched when downscaling, to average all the source
+     * samples */
+    double stretch = __MAX(ratio, 1.);
+
+    assert(src_size > 0 && dst_size > 0);
+
+    if (2. * ceil(support * stretch) > SCALE_MAX_TAPS)
+        stretch = SCALE_MAX_TAPS / (2. * support);
+
+    const double radius = support * stretch;
+    const double half_taps = ceil(radius);
+    const unsigned taps = 2 * (unsigned)half_taps;
+    const int aligned = (dst_size + SCALE_ALIGN - 1) & ~(SCALE_ALIGN - 1);
+
+    filter->src_size = src_size;
+    filter->dst_size = dst_size;
+    filter->kernel = kernel;
+    filter->taps = taps;
+    filter->pos = malloc(aligned * sizeof (*filter->pos));
+    filter->coefs = aligned_alloc(32, aligned * taps * sizeof (int16_t));
+    if (unlikely(filter->pos == NULL || filter->coefs == NULL))
+        return VLC_ENOMEM;
+
+    memset(filter->coefs, 0, aligned * taps * sizeof (int16_t));
+
+    for (int x = 0; x < dst_size; x++)
+    {
+        /* Align the centers of the first and last pixels */
+        const double center = (x + .5) * ratio - .5;
+        const double left = floor(center - radius);
+        const int start = (int)left + 1;
+        double weights[SCALE_MAX_TAPS];
+        double sum = 0.;
+        unsigned largest = 0;
+        int total = 0;
+
+        for (unsigned t = 0; t < taps; t++)
+        {
+            weights[t] = ScaleKernel(kernel, (start + (int)t - center)
+                                             / stretch);
+            sum += weights[t];
+            if (weights[t] > weights[largest])
+                largest = t;
+        }
+
+        for (unsigned t = 0; t < taps; t++)
+        {
+            int16_t *coef = &filter->coefs[CoefIndex(x, t, taps)];
+
+            *coef = lround(weights[t] / sum * (1 << SCALE_BITS));
+            total += *coef;
+        }
+        /* Round so that a uniform area stays uniform */
+        filter->coefs[CoefIndex(x, largest, taps)] +=
+            (1 << SCALE_BITS) - total;
+        filter->pos[x] = start;
+    }
+
+    /* The padding outputs read valid pixels, with null coefficients */
+    for (int x = dst_size; x < aligned; x++)
+        filter->pos[x] = filter->pos[dst_size - 1];
+
+    return VLC_SUCCESS;
+}
+
+void ScaleFilterClean(struct scale_filter *filter)
+{
+    free(filter->pos);
+    aligned_free(filter->coefs);
+    filter->pos = NULL;
+    filter->coefs = NULL;
+}
+
+/*****************************************************************************
+ * Slices
+ *
+ * Each slice works on its own band of lines, with its own line buffers.
+ * Source lines shared by two bands are filtered horizontally by both.
+ *****************************************************************************/
+static const uint8_t *ScaleLine(const plane_t *p, int y, int lines)
+{
+    return &p->p_pixels[VLC_CLIP(y, 0, lines - 1) * p->i_pitch];
+}
+
+/* Fills a line with pad border pixels replicated on each side */
+static void ScalePadLine(uint8_t *pad, const uint8_t *src, int w,
+                         unsigned size, unsigned border)
+{
+    if (size == 1)
+    {
+        memset(pad, src[0], border);
+        memcpy(pad + border, src, w);
+        memset(pad + border + w, src[w - 1], border);
+        return;
+    }
+
+    for (unsigned i = 0; i < border; i++)
+    {
+        memcpy(&pad[i * size], src, size);
+        memcpy(&pad[(border + w + i) * size], &src[(w - 1) * size], size);
+    }
+    memcpy(pad + border * size, src, w * size);
+}
+
+struct scale_render
+{
+    const struct scale_funcs *funcs;
+    const plane_t *src;
+    plane_t *dst;
+    const struct scale_filter *h, *v;
+    unsigned size;     /* samples per pixel */
+    uint8_t *scratch;
+    size_t pad_size;   /* bytes of the padded source line */
+    size_t ring_pitch; /* samples of each horizontally filtered line */
+    size_t slice_size; /* bytes of the buffers of each slice */
+};
+
+static void ScaleSlice(void *opaque, unsigned slice, unsigned count)
+{
+    const struct scale_render *s = opaque;
+    const struct scale_filter *h = s->h, *v = s->v;
+    const unsigned taps = v->taps;
+    void (*hline)(int16_t *, const uint8_t *, int, const int *,
+                  const int16_t *, unsigned) =
+        s->size == 4 ? s->funcs->hline4 : s->funcs->hline1;
+    unsigned start, end;
+
+    SliceLines(v->dst_size, slice, count, 1, &start, &end);
+    if (start >= end)
+        return;
+
+    uint8_t *pad = s->scratch + slice * s->slice_size;
+    int16_t *ring = (int16_t *)(pad + s->pad_size);
+    const int16_t *rows[SCALE_MAX_TAPS];
+    int16_t coefs[SCALE_MAX_TAPS];
+    int next = v->pos[start];
+
+    /* The horizontal output of source line r is kept in slot
+     * (r + taps) % taps, until the last output line depending on it.
+     * Source lines are never needed again once skipped. */
+    for (unsigned y = start; y < end; y++)
+    {
+        const int first = v->pos[y];
+
+        for (next = __MAX(next, first); next < first + (int)taps; next++)
+        {
+            ScalePadLine(pad, ScaleLine(s->src, next, v->src_size),
+                         h->src_size, s->size, h->taps);
+            hline(&ring[((next + taps) % taps) * s->ring_pitch],
+                  pad + h->taps * s->size, h->dst_size, h->pos, h->coefs,
+                  h->taps);
+        }
+
+        for (unsigned i = 0; i < taps; i++)
+        {
+            rows[i] = &ring[((first + i + taps) % taps) * s->ring_pitch];
+            coefs[i] = v->coefs[CoefIndex(y, i, taps)];
+        }
+
+        s->funcs->vline(&s->dst->p_pixels[y * s->dst->i_pitch], rows,
+                        h->dst_size * s->size, coefs, taps / 2);
+    }
+}
+
+static int ScalePlaneWith(const struct scale_funcs *funcs,
+                          struct slice_pool *pool, plane_t *dst,
+                          const plane_t *src, const struct scale_filter *h,
+                          const struct scale_filter *v)
+{
+    const unsigned size = src->i_pixel_pitch;
+    struct scale_render s = {
+        .funcs = funcs, .src = src, .dst = dst, .h = h, .v = v, .size = size,
+    };
+
+    assert(size == 1 || size == 4);
+    assert(dst->i_pixel_pitch == src->i_pixel_pitch);
+    assert(h->src_size * (int)size <= src->i_visible_pitch
+        && v->src_size <= src->i_visible_lines);
+    assert(h->dst_size * (int)size <= dst->i_visible_pitch
+        && v->dst_size <= dst->i_visible_lines);
+
+    s.pad_size = ((h->src_size + 2 * h->taps) * size + 63) & ~(size_t)63;
+    s.ring_pitch = (((h->dst_size + SCALE_ALIGN - 1) & ~(SCALE_ALIGN - 1))
+                    * size + 31) & ~(size_t)31;
+    s.slice_size = s.pad_size + v->taps * s.ring_pitch * sizeof (int16_t);
+    s.slice_size = (s.slice_size + 63) & ~(size_t)63;
+
+    s.scratch = aligned_alloc(64, SlicePoolCount(pool) * s.slice_size);
+    if (unlikely(s.scratch == NULL))
+        return VLC_ENOMEM;
+
+    SlicePoolRun(pool, ScaleSlice, &s);
+    aligned_free(s.scratch);
+    return VLC_SUCCESS;
+}
+
+int ScalePlane(struct slice_pool *pool, plane_t *dst, const plane_t *src,
+               const struct scale_filter *h, const struct scale_filter *v)
+{
+    return ScalePlaneWith(ScaleGetFuncs(), pool, dst, src, h, v);
+}
+
+#ifdef SCALER_TEST
+/*
+ * The SIMD line functions are compared bit for bit against the C ones, the C
+ * ones against a direct evaluation of the separable filter, and slices
+ * against the calling thread alone. The kernels must preserve uniform
+ * areas, and copy the source when the size does not change.
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static unsigned Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+struct test_plane
+{
+    plane_t plane;
+    uint8_t *buf;
+};
+
+static void PlaneInit(struct test_plane *p, int w, int h, unsigned size,
+                      int fill)
+{
+    const int pitch = w * size + Random() % 40;
+
+    p->buf = malloc(pitch * h + 1);
+    assert(p->buf != NULL);
+    for (int i = 0; i < pitch * h + 1; i++)
+        p->buf[i] = fill < 0 ? (int)Random() : fill;
+
+    p->plane.p_pixels = p->buf;
+    p->plane.i_pitch = pitch;
+    p->plane.i_lines = h;
+    p->plane.i_visible_pitch = w * size;
+    p->plane.i_visible_lines = h;
+    p->plane.i_pixel_pitch = size;
+}
+
+static bool PlaneEqual(const plane_t *a, const plane_t *b)
+{
+    for (int y = 0; y < a->i_visible_lines; y++)
+        if (memcmp(&a->p_pixels[y * a->i_pitch],
+                   &b->p_pixels[y * b->i_pitch], a->i_visible_pitch))
+            return false;
+    return true;
+}
+
+static void RefScale(plane_t *dst, const plane_t *src,
+                     const struct scale_filter *h,
+                     const struct scale_filter *v)
+{
+    const int size = src->i_pixel_pitch;
+
+    for (int y = 0; y < v->dst_size; y++)
+        for (int x = 0; x < h->dst_size * size; x++)
+        {
+            int32_t sum = 1 << (SCALE_VSHIFT - 1);
+
+            for (unsigned i = 0; i < v->taps; i++)
+            {
+                const uint8_t *line = ScaleLine(src, v->pos[y] + i,
+                                                v->src_size);
+                int32_t hsum = 1 << (SCALE_HSHIFT - 1);
+
+                for (unsigned j = 0; j < h->taps; j++)
+                {
+                    int sx = VLC_CLIP(h->pos[x / size] + (int)j, 0,
+                                      h->src_size - 1);
+
+                    hsum += h->coefs[CoefIndex(x / size, j, h->taps)]
+                          * line[sx * size + x % size];
+                }
+                sum += v->coefs[CoefIndex(y, i, v->taps)]
+                     * VLC_CLIP(hsum >> SCALE_HSHIFT, INT16_MIN, INT16_MAX);
+            }
+            dst->p_pixels[y * dst->i_pitch + x] =
+                VLC_CLIP(sum >> SCALE_VSHIFT, 0, 255);
+        }
+}
+
+static const struct
+{
+    const char *name;
+    const struct scale_funcs *funcs;
+    unsigned cpu;
+} impls[] = {
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", &scale_sse2, VLC_CPU_SSE2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", &scale_avx2, VLC_CPU_AVX2 },
+#endif
+};
+
+static bool Supported(size_t i)
+{
+    return (vlc_CPU() & impls[i].cpu) == impls[i].cpu;
+}
+
+static int TestScale(struct slice_pool *pool, int sw, int sh, int dw, int dh,
+                     unsigned size, enum scale_kernel kernel)
+{
+    struct scale_filter h = { 0 }, v = { 0 };
+    struct test_plane src, ref, dst;
+    int ret = 0;
+
+    if (ScaleFilterInit(&h, sw, dw, kernel) != VLC_SUCCESS
+     || ScaleFilterInit(&v, sh, dh, kernel) != VLC_SUCCESS)
+        abort();
+    assert(h.taps <= SCALE_MAX_TAPS && v.taps <= SCALE_MAX_TAPS);
+
+    PlaneInit(&src, sw, sh, size, -1);
+    PlaneInit(&ref, dw, dh, size, 0xA5);
+    PlaneInit(&dst, dw, dh, size, 0xA5);
+
+    RefScale(&ref.plane, &src.plane, &h, &v);
+    if (ScalePlaneWith(&scale_c, NULL, &dst.plane, &src.plane, &h,
+                       &v) != VLC_SUCCESS
+     || !PlaneEqual(&ref.plane, &dst.plane))
+    {
+        fprintf(stderr, "C %dx%d -> %dx%d size %u mismatch\n", sw, sh, dw, dh,
+                size);
+        ret = -1;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls) && ret == 0; i++)
+    {
+        if (!Supported(i))
+            continue;
+        memset(dst.buf, 0xA5, dst.plane.i_pitch * dh);
+        ScalePlaneWith(impls[i].funcs, pool, &dst.plane, &src.plane, &h, &v);
+        if (!PlaneEqual(&ref.plane, &dst.plane))
+        {
+            fprintf(stderr, "%s %dx%d -> %dx%d size %u %u threads "
+                    "mismatch\n", impls[i].name, sw, sh, dw, dh, size,
+                    SlicePoolCount(pool));
+            ret = -1;
+        }
+    }
+
+    /* Nothing is written outside of the visible area */
+    for (int y = 0; y < dh && ret == 0; y++)
+        for (int x = dw * size; x < dst.plane.i_pitch; x++)
+            if (dst.plane.p_pixels[y * dst.plane.i_pitch + x] != 0xA5)
+            {
+                fprintf(stderr, "%dx%d -> %dx%d overflows\n", sw, sh, dw, dh);
+                ret = -1;
+                break;
+            }
+
+    /* The size does not change: the source is copied */
+    if (sw == dw && sh == dh && ret == 0 && !PlaneEqual(&src.plane,
+                                                       &dst.plane))
+    {
+        fprintf(stderr, "%dx%d identity mismatch\n", sw, sh);
+        ret = -1;
+    }
+
+    free(dst.buf);
+    free(ref.buf);
+    free(src.buf);
+    ScaleFilterClean(&v);
+    ScaleFilterClean(&h);
+    return ret;
+}
+
+static int TestUniform(int sw, int sh, int dw, int dh,
+                       enum scale_kernel kernel)
+{
+    struct scale_filter h = { 0 }, v = { 0 };
+    struct test_plane src, dst;
+    const uint8_t value = Random();
+    int ret = 0;
+
+    if (ScaleFilterInit(&h, sw, dw, kernel) != VLC_SUCCESS
+     || ScaleFilterInit(&v, sh, dh, kernel) != VLC_SUCCESS)
+        abort();
+
+    PlaneInit(&src, sw, sh, 1, value);
+    PlaneInit(&dst, dw, dh, 1, value ^ 0xFF);
+    ScalePlane(NULL, &dst.plane, &src.plane, &h, &v);
+
+    for (int y = 0; y < dh && ret == 0; y++)
+        for (int x = 0; x < dw; x++)
+            if (dst.plane.p_pixels[y * dst.plane.i_pitch + x] != value)
+            {
+                fprintf(stderr, "%dx%d -> %dx%d not uniform\n", sw, sh, dw,
+                        dh);
+                ret = -1;
+                break;
+            }
+
+    free(dst.buf);
+    free(src.buf);
+    ScaleFilterClean(&v);
+    ScaleFilterClean(&h);
+    return ret;
+}
+
+int main(void)
+{
+    static const enum scale_kernel kernels[] = {
+        SCALE_BILINEAR, SCALE_BICUBIC,
+    };
+
+    alarm(60);
+
+    for (size_t i = 0; i < ARRAY_SIZE(impls); i++)
+        if (!Supported(i))
+            fprintf(stderr, "WARNING: could not test %s\n", impls[i].name);
+
+    for (unsigned threads = 1; threads <= 4; threads++)
+    {
+        struct slice_pool *pool = SlicePoolNew(threads);
+
+        for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+            for (unsigned size = 1; size <= 4; size += 3)
+            {
+                for (int i = 0; i < 40; i++)
+                    if (TestScale(pool, 1 + Random() % 50, 1 + Random() % 20,
+                                  1 + Random() % 50, 1 + Random() % 20, size,
+                                  kernels[k]))
+                        return 1;
+
+                if (TestScale(pool, 37, 11, 37, 11, size, kernels[k])
+                 || TestScale(pool, 1, 1, 63, 17, size, kernels[k])
+                 || TestScale(pool, 400, 300, 7, 5, size, kernels[k])
+                 || TestScale(pool, 720, 60, 1211, 101, size, kernels[k]))
+                    return 1;
+            }
+
+        SlicePoolDelete(pool);
+    }
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+        if (TestUniform(53, 29, 120, 71, kernels[k])
+         || TestUniform(120, 71, 53, 29, kernels[k])
+         || TestUniform(1000, 3, 10, 3, kernels[k]))
+            return 1;
+
+    return 0;
+}
+#endif
+
+#ifdef SCALER_BENCH
+/*
+ * Measures the frame rate of the bicubic upscaling of I420 pictures from
+ * 1080p to 2160p, and of an RGBA subtitle line, for each implementation and
+ * an increasing number of threads.
+ */
+#include <stdio.h>
+#include <vlc_tick.h>
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, int width, int height)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, chroma);
+    video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    if (pic == NULL)
+        abort();
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_pitch * pic->p[i].i_lines; j++)
+            pic->p[i].p_pixels[j] = j * 7 + (j >> 11);
+    return pic;
+}
+
+static void Bench(const char *name, const struct scale_funcs *funcs,
+                  unsigned threads, const char *op, picture_t *src,
+                  picture_t *dst)
+{
+    struct slice_pool *pool = SlicePoolNew(threads);
+    struct scale_filter h[PICTURE_PLANE_MAX], v[PICTURE_PLANE_MAX];
+    vlc_tick_t start = vlc_tick_now(), elapsed;
+    unsigned frames = 0;
+
+    for (int i = 0; i < src->i_planes; i++)
+        if (ScaleFilterInit(&h[i], src->p[i].i_visible_pitch
+                                   / src->p[i].i_pixel_pitch,
+                            dst->p[i].i_visible_pitch
+                                   / dst->p[i].i_pixel_pitch,
+                            SCALE_BICUBIC) != VLC_SUCCESS
+         || ScaleFilterInit(&v[i], src->p[i].i_visible_lines,
+                            dst->p[i].i_visible_lines,
+                            SCALE_BICUBIC) != VLC_SUCCESS)
+            abort();
+
+    do
+    {
+        for (int i = 0; i < src->i_planes; i++)
+            ScalePlaneWith(funcs, pool, &dst->p[i], &src->p[i], &h[i], &v[i]);
+        frames++;
+        elapsed = vlc_tick_now() - start;
+    }
+    while (elapsed < VLC_TICK_FROM_MS(500));
+
+    printf("%-6s %-8s %7u %9.1f\n", name, op, SlicePoolCount(pool),
+           frames / secf_from_vlc_tick(elapsed));
+
+    for (int i = 0; i < src->i_planes; i++)
+    {
+        ScaleFilterClean(&v[i]);
+        ScaleFilterClean(&h[i]);
+    }
+    SlicePoolDelete(pool);
+}
+
+static void BenchAll(unsigned threads, const char *op, picture_t *src,
+                     picture_t *dst)
+{
+    Bench("C", &scale_c, threads, op, src, dst);
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        Bench("SSE2", &scale_sse2, threads, op, src, dst);
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        Bench("AVX2", &scale_avx2, threads, op, src, dst);
+#endif
+}
+
+int main(void)
+{
+    const unsigned max_threads = __MAX(vlc_GetCPUCount(), 1);
+    picture_t *video_src = NewPicture(VLC_CODEC_I420, 1920, 1080);
+    picture_t *video_dst = NewPicture(VLC_CODEC_I420, 3840, 2160);
+    picture_t *sub_src = NewPicture(VLC_CODEC_RGBA, 720, 64);
+    picture_t *sub_dst = NewPicture(VLC_CODEC_RGBA, 2160, 192);
+
+    printf("%-6s %-8s %7s %9s\n", "impl", "op", "threads", "frames/s");
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        BenchAll(threads, "i420 x2", video_src, video_dst);
+        BenchAll(threads, "rgba x3", sub_src, sub_dst);
+    }
+
+    picture_Release(sub_dst);
+    picture_Release(sub_src);
+    picture_Release(video_dst);
+    picture_Release(video_src);
+    return 0;
+}
+#endif
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * scaler.h: separable resampling of 8-bits planes
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_SCALER_H
+#define VLC_VIDEO_FILTER_SCALER_H 1
+
+/**
+ * \file
+ * Resampling of the visible area of 8-bits planes with a separable kernel,
+ * in C, SSE2 and AVX2, split in slices over a slice pool.
+ *
+ * Planes have either one sample per pixel, or four interleaved samples
+ * (packed RGBA and the like), filtered independently. The borders are
+ * replicated.
+ */
+
+struct slice_pool;
+
+/** Number of fractional bits of the fixed-point coefficients */
+#define SCALE_BITS 14
+
+/** Largest number of taps of a filter, limiting the quality of strong
+ * downscaling */
+#define SCALE_MAX_TAPS 32
+
+enum scale_kernel
+{
+    SCALE_BILINEAR,
+    SCALE_BICUBIC,
+};
+
+/**
+ * Precomputed coefficients resampling one dimension.
+ */
+struct scale_filter
+{
+    int src_size;
+    int dst_size;
+    enum scale_kernel kernel;
+    unsigned taps;     /**< even number of taps of each output sample */
+    int *pos;          /**< first source sample of each output sample */
+    int16_t *coefs;    /**< taps, scaled by 1 << SCALE_BITS, in the order
+                            of the SIMD functions */
+};
+
+/**
+ * Computes the coefficients resampling src_size samples to dst_size ones.
+ *
+ * The filter must be cleaned even on error.
+ *
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int ScaleFilterInit(struct scale_filter *filter, int src_size, int dst_size,
+                    enum scale_kernel kernel);
+
+/**
+ * Releases the coefficients of a filter.
+ *
+ * A zero-initialized filter may be cleaned.
+ */
+void ScaleFilterClean(struct scale_filter *filter);
+
+/**
+ * Resamples a plane horizontally then vertically.
+ *
+ * The widths of the filters are in pixels, i.e. i_visible_pitch divided by
+ * i_pixel_pitch, which must be 1 or 4 and the same for both planes. The
+ * planes must not overlap.
+ *
+ * @return VLC_SUCCESS or VLC_ENOMEM
+ */
+int ScalePlane(struct slice_pool *pool, plane_t *dst, const plane_t *src,
+               const struct scale_filter *h, const struct scale_filter *v);
+
+#endif
@@ -144,6 +144,8 @@ static int Create( vlc_object_t *p_this )
     var_AddCallback( p_filter, CFG_PREFIX "intensity", FilterCallback, NULL );
 
     p_filter->pf_video_filter = Filter;
+    p_filter->b_inplace = video_format_IsSimilar( &p_filter->fmt_in.video,
+                                                  &p_filter->fmt_out.video );
 
     return VLC_SUCCESS;
 }
@@ -43,10 +43,11 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "slice_pool.h"
+#include "convolution.h"
 
 #define SIG_TEXT N_("Sharpen strength (0-2)")
 #define SIG_LONGTEXT N_("Set the Sharpen strength, between 0 and 2. Defaults to 0.05.")
-
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -73,12 +74,14 @@ vlc_module_begin ()
     add_float_with_range( FILTER_PREFIX "sigma", 0.05, 0.0, 2.0,
         SIG_TEXT, SIG_LONGTEXT, false )
     change_safe()
+    add_integer_with_range( FILTER_PREFIX "threads", 1, 0, 16,
+        SLICE_THREADS_TEXT, SLICE_THREADS_LONGTEXT, true )
     add_shortcut( "sharpen" )
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "sigma", NULL
+    "sigma", "threads", NULL
 };
 
 /*****************************************************************************
@@ -91,6 +94,7 @@ static const char *const ppsz_filter_options[] = {
 typedef struct
 {
     atomic_int sigma;
+    struct slice_pool *slices;
 } filter_sys_t;
 
 /*****************************************************************************
@@ -130,6 +134,9 @@ static int Create( vlc_object_t *p_this )
     var_AddCallback( p_filter, FILTER_PREFIX "sigma",
                      SharpenCallback, p_sys );
 
+    p_sys->slices = SlicePoolNew(
+        var_CreateGetInteger( p_filter, FILTER_PREFIX "threads" ) );
+
     return VLC_SUCCESS;
 }
 
@@ -145,6 +152,7 @@ static void Destroy( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     var_DelCallback( p_filter, FILTER_PREFIX "sigma", SharpenCallback, p_sys );
+    SlicePoolDelete( p_sys->slices );
     free( p_sys );
 }
 
@@ -222,7 +230,22 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     if (!IS_YUV_420_10BITS(p_pic->format.i_chroma))
-        SHARPEN_FRAME(255, uint8_t);
+    {
+        struct conv_3x3 kernel = {
+            .coefs = { { v1, v1, v1, v1, 1 << v2, v1, v1, v1, v1 } },
+            .count = 1,
+            .gain = atomic_load(&p_sys->sigma) >> (20 - CONV_BITS),
+            .add_source = true,
+        };
+
+        if( Convolve3x3( p_sys->slices, &p_outpic->p[Y_PLANE],
+                         &p_pic->p[Y_PLANE], &kernel ) )
+        {
+            picture_Release( p_outpic );
+            picture_Release( p_pic );
+            return NULL;
+        }
+    }
     else
         SHARPEN_FRAME(1023, uint16_t);
 
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * slice_pool.c : thread pool for slice-parallel video filters
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+
+#include "slice_pool.h"
+
+#define SLICE_POOL_MAX_THREADS 16
+
+struct slice_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* slices were posted, or the pool is stopping */
+    vlc_cond_t done; /* the last slice was run */
+
+    void (*run)(void *, unsigned, unsigned);
+    void *opaque;
+    unsigned next; /* first slice not taken yet */
+    unsigned pending; /* slices not run yet */
+    bool quit;
+
+    unsigned count; /* slices, i.e. workers plus the caller */
+    vlc_thread_t threads[];
+};
+
+static void *SliceWorker(void *data)
+{
+    struct slice_pool *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    while (!pool->quit)
+    {
+        if (pool->next >= pool->count)
+        {
+            vlc_cond_wait(&pool->wait, &pool->lock);
+            continue;
+        }
+
+        unsigned slice = pool->next++;
+
+        vlc_mutex_unlock(&pool->lock);
+        pool->run(pool->opaque, slice, pool->count);
+        vlc_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0)
+            vlc_cond_signal(&pool->done);
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+struct slice_pool *SlicePoolNew(unsigned threads)
+{
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    threads = __MIN(threads, SLICE_POOL_MAX_THREADS);
+    if (threads <= 1)
+        return NULL;
+
+    struct slice_pool *pool = malloc(sizeof (*pool)
+                                     + (threads - 1) * sizeof (vlc_thread_t));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->next = threads; /* no slices until all the workers are started */
+    pool->pending = 0;
+    pool->quit = false;
+    pool->count = 1;
+
+    vlc_mutex_lock(&pool->lock);
+    while (pool->count < threads
+        && vlc_clone(&pool->threads[pool->count - 1], SliceWorker, pool,
+                     VLC_THREAD_PRIORITY_VIDEO) == 0)
+        pool->count++;
+    pool->next = pool->count;
+    vlc_mutex_unlock(&pool->lock);
+
+    if (pool->count == 1)
+    {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void SlicePoolDelete(struct slice_pool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    vlc_mutex_lock(&pool->lock);
+    pool->quit = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i + 1 < pool->count; i++)
+        vlc_join(pool->threads[i], NULL);
+    free(pool);
+}
+
+unsigned SlicePoolCount(const struct slice_pool *pool)
+{
+    return pool != NULL ? pool->count : 1;
+}
+
+void SlicePoolRun(struct slice_pool *pool,
+                  void (*run)(void *opaque, unsigned slice, unsigned count),
+                  void *opaque)
+{
+    if (pool == NULL)
+    {
+        run(opaque, 0, 1);
+        return;
+    }
+
+    vlc_mutex_lock(&pool->lock);
+    assert(pool->next == pool->count && pool->pending == 0);
+    pool->run = run;
+    pool->opaque = opaque;
+    pool->next = 0;
+    pool->pending = pool->count;
+    vlc_cond_broadcast(&pool->wait);
+
+    /* Run slices along with the workers */
+    while (pool->next < pool->count)
+    {
+        unsigned slice = pool->next++;
+
+        vlc_mutex_unlock(&pool->lock);
+        run(opaque, slice, pool->count);
+        vlc_mutex_lock(&pool->lock);
+        pool->pending--;
+    }
+
+    while (pool->pending > 0)
+        vlc_cond_wait(&pool->done, &pool->lock);
+    vlc_mutex_unlock(&pool->lock);
+}
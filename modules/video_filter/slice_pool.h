@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * slice_pool.h : thread pool for slice-parallel video filters
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_SLICE_POOL_H
+#define VLC_VIDEO_FILTER_SLICE_POOL_H 1
+
+/**
+ * \file
+ * Runs the slices of a picture on a set of worker threads.
+ *
+ * A filter splits its work into as many slices as the pool has threads, and
+ * each slice is run once, either by a worker or by the calling thread. The
+ * slices of a picture must not write to the same lines.
+ *
+ * A NULL pool is valid and runs the single slice on the calling thread, so
+ * that filters need not care whether threading is enabled.
+ */
+
+struct slice_pool;
+
+/* Texts of the "threads" option of the filters, passed to SlicePoolNew() */
+#define SLICE_THREADS_TEXT N_("Threads")
+#define SLICE_THREADS_LONGTEXT N_("Number of threads processing each " \
+    "picture (0 for one per CPU).")
+
+/**
+ * Creates a pool.
+ *
+ * @param threads number of threads including the caller, 0 for one per CPU
+ * @return a pool, or NULL if only one thread is requested or on error
+ */
+struct slice_pool *SlicePoolNew(unsigned threads);
+
+/**
+ * Destroys a pool, joining all its threads.
+ */
+void SlicePoolDelete(struct slice_pool *pool);
+
+/**
+ * Returns the number of slices run by SlicePoolRun().
+ */
+unsigned SlicePoolCount(const struct slice_pool *pool);
+
+/**
+ * Runs all the slices and waits for them to complete.
+ *
+ * The pool is not reentrant: it must only be used by one thread at a time.
+ *
+ * @param run callback invoked once for each slice index in [0, count)
+ */
+void SlicePoolRun(struct slice_pool *pool,
+                  void (*run)(void *opaque, unsigned slice, unsigned count),
+                  void *opaque);
+
+/**
+ * Computes the range [*start, *end) of the lines of a slice.
+ *
+ * Slice boundaries are multiples of align lines (except for the last one).
+ */
+static inline void SliceLines(unsigned lines, unsigned slice, unsigned count,
+                              unsigned align, unsigned *start, unsigned *end)
+{
+    unsigned blocks = (lines + align - 1) / align;
+
+    *start = __MIN(lines, (blocks * slice / count) * align);
+    *end = __MIN(lines, (blocks * (slice + 1) / count) * align);
+}
+
+#endif
@@ -28,6 +28,7 @@
 # include <vlc_atomic.h>
 # include <vlc_viewpoint.h>
 # include "../clock/clock.h"
+# include "../misc/latency.h"
 
 /* Max input rate factor (1/4 -> 4) */
 # define AOUT_MAX_INPUT_RATE (4)
@@ -75,6 +76,7 @@ typedef struct
         vlc_tick_t first_pts;
     } sync;
     vlc_tick_t original_pts;
+    vlc_tick_t original_date; /**< Reception date of the original_pts block */
 
     int requested_stereo_mode; /**< Requested stereo mode set by the user */
 
@@ -96,6 +98,8 @@ typedef struct
 
     atomic_uint buffers_lost;
     atomic_uint buffers_played;
+    struct vlc_latency_recorder queued;
+    struct vlc_latency_recorder late;
     atomic_uchar restart;
 
     vlc_atomic_rc_t rc;
@@ -150,7 +154,9 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *, int profile,
                 struct vlc_clock_t *clock, const audio_replay_gain_t *);
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *aout, block_t *block);
-void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *);
+void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *,
+                           struct vlc_latency_histogram *,
+                           struct vlc_latency_histogram *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, vlc_tick_t i_date);
 void aout_DecChangeRate(audio_output_t *aout, float rate);
 void aout_DecChangeDelay(audio_output_t *aout, vlc_tick_t delay);
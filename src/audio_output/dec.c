@@ -37,6 +37,7 @@
 #include "aout_internal.h"
 #include "clock/clock.h"
 #include "libvlc.h"
+#include "misc/trace.h"
 
 static void aout_Drain(audio_output_t *aout)
 {
@@ -129,6 +130,8 @@ error:
 
     atomic_init (&owner->buffers_lost, 0);
     atomic_init (&owner->buffers_played, 0);
+    vlc_latency_recorder_Init (&owner->queued);
+    vlc_latency_recorder_Init (&owner->late);
     atomic_store_explicit(&owner->vp.update, true, memory_order_relaxed);
     return 0;
 }
@@ -323,6 +326,8 @@ void aout_RequestRetiming(audio_output_t *aout, vlc_tick_t system_ts,
     if (unlikely(drift == INT64_MAX) || owner->bitexact)
         return; /* cf. INT64_MAX comment in aout_DecPlay() */
 
+    vlc_latency_recorder_Add (&owner->late, drift);
+
     /* Late audio output.
      * This can happen due to insufficient caching, scheduling jitter
      * or bug in the decoder. Ideally, the output would seek backward. But that
@@ -438,6 +443,7 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
          * of the first block that has been filtered. Indeed, aout filters may
          * need more than one block to output a new one. */
         owner->original_pts = block->i_pts;
+        owner->original_date = vlc_tick_now();
     }
 
     if (owner->filters)
@@ -450,7 +456,9 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
             vlc_mutex_unlock (&owner->vp.lock);
         }
 
+        vlc_tracer_Begin("aout filters");
         block = aout_FiltersPlay(owner->filters, block, owner->sync.rate);
+        vlc_tracer_End("aout filters");
         if (block == NULL)
             return ret;
     }
@@ -488,7 +496,10 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
     }
     /* Output */
     owner->sync.discontinuity = false;
+    vlc_latency_recorder_Add(&owner->queued, system_now - owner->original_date);
+    vlc_tracer_Begin("aout play");
     aout->play(aout, block, play_date);
+    vlc_tracer_End("aout play");
 
     atomic_fetch_add_explicit(&owner->buffers_played, 1, memory_order_relaxed);
     return ret;
@@ -501,7 +512,9 @@ drop:
 }
 
 void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
-                           unsigned *restrict played)
+                           unsigned *restrict played,
+                           struct vlc_latency_histogram *queued,
+                           struct vlc_latency_histogram *late)
 {
     aout_owner_t *owner = aout_owner (aout);
 
@@ -509,6 +522,10 @@ void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
                                      memory_order_relaxed);
     *played = atomic_exchange_explicit(&owner->buffers_played, 0,
                                        memory_order_relaxed);
+    if (queued != NULL)
+        vlc_latency_recorder_GetReset(&owner->queued, queued);
+    if (late != NULL)
+        vlc_latency_recorder_GetReset(&owner->late, late);
 }
 
 void aout_DecChangePause (audio_output_t *aout, bool paused, vlc_tick_t date)
@@ -51,6 +51,8 @@
 #include "resource.h"
 
 #include "../video_output/vout_internal.h"
+#include "../misc/trace.h"
+#include "../misc/latency.h"
 
 /*
  * Possibles values set in p_owner->reload atomic
@@ -95,6 +97,16 @@ struct vlc_input_decoder_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Latency statistics (NULL if disabled) */
+    struct vlc_es_latency_recorder *latency;
+    /* Dates at which the queued blocks entered the fifo, in order; blocks
+     * queued while this is full are undated (protected by the fifo lock) */
+#define DECODER_QUEUE_DATES 64
+    vlc_tick_t queue_dates[DECODER_QUEUE_DATES];
+    size_t queue_dates_first;
+    size_t queue_dates_count;
+    size_t queue_undated;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -194,6 +206,52 @@ static inline vlc_input_decoder_t *dec_get_owner( decoder_t *p_dec )
     return container_of( p_dec, vlc_input_decoder_t, dec );
 }
 
+/* Must be called with the fifo locked */
+static void DecoderQueueDates( vlc_input_decoder_t *p_owner, block_t *p_block )
+{
+    if( p_owner->latency == NULL )
+        return;
+
+    vlc_tick_t now = vlc_tick_now();
+
+    for( ; p_block != NULL; p_block = p_block->p_next )
+    {
+        if( p_owner->queue_undated == 0
+         && p_owner->queue_dates_count < DECODER_QUEUE_DATES )
+        {
+            size_t i = (p_owner->queue_dates_first
+                        + p_owner->queue_dates_count++) % DECODER_QUEUE_DATES;
+            p_owner->queue_dates[i] = now;
+        }
+        else
+            p_owner->queue_undated++;
+    }
+}
+
+/* Must be called with the fifo locked */
+static vlc_tick_t DecoderDequeueDate( vlc_input_decoder_t *p_owner )
+{
+    if( p_owner->queue_dates_count > 0 )
+    {
+        vlc_tick_t date = p_owner->queue_dates[p_owner->queue_dates_first];
+
+        p_owner->queue_dates_first =
+            (p_owner->queue_dates_first + 1) % DECODER_QUEUE_DATES;
+        p_owner->queue_dates_count--;
+        return date;
+    }
+    if( p_owner->queue_undated > 0 )
+        p_owner->queue_undated--;
+    return VLC_TICK_INVALID;
+}
+
+/* Must be called with the fifo locked */
+static void DecoderResetDates( vlc_input_decoder_t *p_owner )
+{
+    p_owner->queue_dates_count = 0;
+    p_owner->queue_undated = 0;
+}
+
 /**
  * Load a decoder module
  */
@@ -1130,7 +1188,16 @@ static void ModuleThread_UpdateStatVideo( vlc_input_decoder_t *p_owner,
     unsigned vout_lost = 0;
     if( p_owner->p_vout != NULL )
     {
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
+        struct vlc_latency_histogram queued = { 0 }, late = { 0 };
+        bool stats = p_owner->latency != NULL;
+
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost,
+                                stats ? &queued : NULL, stats ? &late : NULL );
+        if( stats )
+        {
+            vlc_latency_recorder_Merge( &p_owner->latency->output, &queued );
+            vlc_latency_recorder_Merge( &p_owner->latency->lateness, &late );
+        }
     }
     if (lost) vout_lost++;
 
@@ -1142,7 +1209,9 @@ static void ModuleThread_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
     assert( p_pic );
     vlc_input_decoder_t *p_owner = dec_get_owner( p_dec );
 
+    vlc_tracer_BeginPicture( "play video", p_pic->date );
     int success = ModuleThread_PlayVideo( p_owner, p_pic );
+    vlc_tracer_End( "play video" );
 
     ModuleThread_UpdateStatVideo( p_owner, success != VLC_SUCCESS );
 }
@@ -1265,7 +1334,16 @@ static void ModuleThread_UpdateStatAudio( vlc_input_decoder_t *p_owner,
     unsigned aout_lost = 0;
     if( p_owner->p_aout != NULL )
     {
-        aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played );
+        struct vlc_latency_histogram queued = { 0 }, late = { 0 };
+        bool stats = p_owner->latency != NULL;
+
+        aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played,
+                               stats ? &queued : NULL, stats ? &late : NULL );
+        if( stats )
+        {
+            vlc_latency_recorder_Merge( &p_owner->latency->output, &queued );
+            vlc_latency_recorder_Merge( &p_owner->latency->lateness, &late );
+        }
     }
     if (lost) aout_lost++;
 
@@ -1276,7 +1354,9 @@ static void ModuleThread_QueueAudio( decoder_t *p_dec, block_t *p_aout_buf )
 {
     vlc_input_decoder_t *p_owner = dec_get_owner( p_dec );
 
+    vlc_tracer_BeginPicture( "play audio", p_aout_buf->i_pts );
     int success = ModuleThread_PlayAudio( p_owner, p_aout_buf );
+    vlc_tracer_End( "play audio" );
 
     ModuleThread_UpdateStatAudio( p_owner, success != VLC_SUCCESS );
 }
@@ -1344,7 +1424,16 @@ static void DecoderThread_DecodeBlock( vlc_input_decoder_t *p_owner, block_t *p_
 {
     decoder_t *p_dec = &p_owner->dec;
 
+    vlc_tick_t start = p_owner->latency != NULL ? vlc_tick_now() : 0;
+
+    vlc_tracer_BeginPicture( "decode", p_block != NULL ? p_block->i_pts
+                                                       : VLC_TICK_INVALID );
     int ret = p_dec->pf_decode( p_dec, p_block );
+    vlc_tracer_End( "decode" );
+
+    if( p_owner->latency != NULL && p_block != NULL )
+        vlc_latency_recorder_Add( &p_owner->latency->decode,
+                                  vlc_tick_now() - start );
     switch( ret )
     {
         case VLCDEC_SUCCESS:
@@ -1714,7 +1803,14 @@ static void *DecoderThread( void *p_data )
         vlc_cond_signal( &p_owner->wait_fifo );
 
         block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
-        if( p_block == NULL )
+        if( p_block != NULL )
+        {
+            vlc_tick_t date = DecoderDequeueDate( p_owner );
+            if( date != VLC_TICK_INVALID )
+                vlc_latency_recorder_Add( &p_owner->latency->queue,
+                                          vlc_tick_now() - date );
+        }
+        else
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
@@ -1825,6 +1921,12 @@ CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_resource = p_resource;
     p_owner->cbs = cbs;
     p_owner->cbs_userdata = cbs_userdata;
+    p_owner->latency = NULL;
+    if( cbs != NULL && cbs->get_latency_recorder != NULL )
+        p_owner->latency = cbs->get_latency_recorder( p_owner, cbs_userdata );
+    p_owner->queue_dates_first = 0;
+    p_owner->queue_dates_count = 0;
+    p_owner->queue_undated = 0;
     p_owner->p_aout = NULL;
     p_owner->p_vout = NULL;
     p_owner->vout_thread_started = false;
@@ -2225,6 +2327,7 @@ void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, block_t *p_block,
             msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
             block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            DecoderResetDates( p_owner );
             p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
@@ -2237,6 +2340,7 @@ void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, block_t *p_block,
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
+    DecoderQueueDates( p_owner, p_block );
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
@@ -2298,6 +2402,7 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    DecoderResetDates( p_owner );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
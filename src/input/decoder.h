@@ -48,6 +48,9 @@ struct vlc_input_decoder_callbacks {
     int (*get_attachments)(vlc_input_decoder_t *decoder,
                            input_attachment_t ***ppp_attachment,
                            void *userdata);
+    /* Latency statistics recorder, or NULL (queried once at creation) */
+    struct vlc_es_latency_recorder *
+        (*get_latency_recorder)(vlc_input_decoder_t *decoder, void *userdata);
 };
 
 vlc_input_decoder_t *
@@ -410,6 +410,33 @@ decoder_get_attachments(vlc_input_decoder_t *decoder,
     return input_GetAttachments(p_sys->p_input, ppp_attachment);
 }
 
+static struct vlc_es_latency_recorder *
+decoder_get_latency_recorder(vlc_input_decoder_t *decoder, void *userdata)
+{
+    (void) decoder;
+
+    es_out_id_t *id = userdata;
+    es_out_t *out = id->out;
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    if (!p_sys->p_input)
+        return NULL;
+
+    struct input_stats *stats = input_priv(p_sys->p_input)->stats;
+    if (!stats)
+        return NULL;
+
+    switch (id->fmt.i_cat)
+    {
+        case VIDEO_ES:
+            return &stats->video_latency;
+        case AUDIO_ES:
+            return &stats->audio_latency;
+        default:
+            return NULL;
+    }
+}
+
 static const struct vlc_input_decoder_callbacks decoder_cbs = {
     .on_vout_started = decoder_on_vout_started,
     .on_vout_stopped = decoder_on_vout_stopped,
@@ -417,6 +444,7 @@ static const struct vlc_input_decoder_callbacks decoder_cbs = {
     .on_new_video_stats = decoder_on_new_video_stats,
     .on_new_audio_stats = decoder_on_new_audio_stats,
     .get_attachments = decoder_get_attachments,
+    .get_latency_recorder = decoder_get_latency_recorder,
 };
 
 /*****************************************************************************
@@ -42,6 +42,7 @@
 #include "item.h"
 #include "resource.h"
 #include "stream.h"
+#include "misc/trace.h"
 
 #include <vlc_aout.h>
 #include <vlc_sout.h>
@@ -547,7 +548,11 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed )
     }
 
     if( i_ret == VLC_DEMUXER_SUCCESS )
+    {
+        vlc_tracer_Begin( "demux" );
         i_ret = demux_Demux( p_demux );
+        vlc_tracer_End( "demux" );
+    }
 
     i_ret = i_ret > 0 ? VLC_DEMUXER_SUCCESS : ( i_ret < 0 ? VLC_DEMUXER_EGENERIC : VLC_DEMUXER_EOF);
 
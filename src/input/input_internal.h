@@ -34,6 +34,7 @@
 #include <libvlc.h>
 #include "input_interface.h"
 #include "misc/interrupt.h"
+#include "misc/latency.h"
 
 struct input_stats;
 
@@ -730,6 +731,8 @@ struct input_stats {
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    struct vlc_es_latency_recorder video_latency;
+    struct vlc_es_latency_recorder audio_latency;
 };
 
 struct input_stats *input_stats_Create(void);
@@ -1277,26 +1277,69 @@ void input_item_node_Delete( input_item_node_t *p_node )
     free( p_node );
 }
 
-input_item_node_t *input_item_node_AppendItem( input_item_node_t *p_node, input_item_t *p_item )
+/* Creates the node of a subitem, which is preparsed one level less deep than
+ * its parent */
+static input_item_node_t *input_item_node_CreateChild( int i_preparse_depth,
+                                                       input_item_t *p_item )
 {
-    int i_preparse_depth;
     input_item_node_t *p_new_child = input_item_node_Create( p_item );
     if( !p_new_child ) return NULL;
 
-    vlc_mutex_lock( &p_node->p_item->lock );
-    i_preparse_depth = p_node->p_item->i_preparse_depth;
-    vlc_mutex_unlock( &p_node->p_item->lock );
-
     vlc_mutex_lock( &p_item->lock );
     p_item->i_preparse_depth = i_preparse_depth > 0 ?
                                i_preparse_depth -1 :
                                i_preparse_depth;
     vlc_mutex_unlock( &p_item->lock );
+    return p_new_child;
+}
+
+static int input_item_node_GetPreparseDepth( input_item_node_t *p_node )
+{
+    vlc_mutex_lock( &p_node->p_item->lock );
+    int i_preparse_depth = p_node->p_item->i_preparse_depth;
+    vlc_mutex_unlock( &p_node->p_item->lock );
+    return i_preparse_depth;
+}
+
+input_item_node_t *input_item_node_AppendItem( input_item_node_t *p_node, input_item_t *p_item )
+{
+    input_item_node_t *p_new_child =
+        input_item_node_CreateChild( input_item_node_GetPreparseDepth( p_node ),
+                                     p_item );
+    if( !p_new_child ) return NULL;
 
     input_item_node_AppendNode( p_node, p_new_child );
     return p_new_child;
 }
 
+int input_item_node_AppendItems( input_item_node_t *p_node,
+                                 input_item_t *const *pp_items,
+                                 size_t i_items )
+{
+    if( i_items == 0 )
+        return VLC_SUCCESS;
+    if( unlikely(i_items > (size_t)(INT_MAX - p_node->i_children)) )
+        return VLC_ENOMEM;
+
+    input_item_node_t **pp_children =
+        realloc( p_node->pp_children,
+                 (p_node->i_children + i_items) * sizeof(*pp_children) );
+    if( unlikely(pp_children == NULL) )
+        return VLC_ENOMEM;
+    p_node->pp_children = pp_children;
+
+    int i_preparse_depth = input_item_node_GetPreparseDepth( p_node );
+    for( size_t i = 0; i < i_items; i++ )
+    {
+        input_item_node_t *p_new_child =
+            input_item_node_CreateChild( i_preparse_depth, pp_items[i] );
+        if( unlikely(p_new_child == NULL) )
+            return VLC_ENOMEM;
+        pp_children[p_node->i_children++] = p_new_child;
+    }
+    return VLC_SUCCESS;
+}
+
 void input_item_node_AppendNode( input_item_node_t *p_parent,
                                  input_item_node_t *p_child )
 {
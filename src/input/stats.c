@@ -67,6 +67,8 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    vlc_es_latency_recorder_Init(&stats->video_latency);
+    vlc_es_latency_recorder_Init(&stats->audio_latency);
     return stats;
 }
 
@@ -108,6 +110,10 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+
+    /* Latencies */
+    vlc_es_latency_recorder_Get(&stats->video_latency, &st->video_latency);
+    vlc_es_latency_recorder_Get(&stats->audio_latency, &st->audio_latency);
 }
 
 /** Update a counter element with new values
@@ -89,6 +89,12 @@ static const char *const ppsz_snap_formats[] =
     "This is the verbosity level (0=only errors and " \
     "standard messages, 1=warnings, 2=debug).")
 
+#define LOG_ASYNC_TEXT N_("Asynchronous logging")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Pass messages to the logger from a dedicated thread. Messages are " \
+    "queued in a bounded buffer; they are dropped and counted if it " \
+    "overflows.")
+
 #define OPEN_TEXT N_("Default stream")
 #define OPEN_LONGTEXT N_( \
     "This stream will always be opened at VLC startup." )
@@ -1134,6 +1140,37 @@ static const char *const ppsz_prefres[] = {
 #define ONEINSTANCEWHENSTARTEDFROMFILE_TEXT N_( \
     "Use only one instance when started from file manager")
 
+#define BLOCK_POOL_TEXT N_("Pool data block allocations")
+#define BLOCK_POOL_LONGTEXT N_( \
+    "Recycle the memory of small and medium data blocks through per-thread " \
+    "caches. This reduces the allocation overhead of high bitrate or " \
+    "multi-program streams, at the expense of some cached memory.")
+
+#define PICTURE_CACHE_TEXT N_("Picture buffer cache size (MiB)")
+#define PICTURE_CACHE_LONGTEXT N_( \
+    "Keep up to this amount of released picture buffers, and reuse them " \
+    "for new pictures of the same format. This avoids remapping large " \
+    "frames whenever a decoder or a video output is restarted, e.g. on " \
+    "resolution changes. 0 disables the cache.")
+
+#define PICTURE_HUGE_PAGES_TEXT N_("Use huge pages for pictures")
+#define PICTURE_HUGE_PAGES_LONGTEXT N_( \
+    "Back large picture buffers with explicit huge pages, if the system " \
+    "has reserved some. This reduces TLB misses with high resolution " \
+    "video.")
+
+#define COPY_THREADS_TEXT N_("Surface copy threads")
+#define COPY_THREADS_LONGTEXT N_( \
+    "Number of threads copying each large (4K and above) video surface " \
+    "between the video memory and the system memory. 0 uses one thread per " \
+    "CPU, up to 8. 1 copies on the calling thread only.")
+
+#define TRACE_FILE_TEXT N_("Trace file")
+#define TRACE_FILE_LONGTEXT N_( \
+    "Record the timeline of the demux, decode, output and display stages " \
+    "into this file, in the Chrome trace event format. The file is written " \
+    "when VLC exits.")
+
 #define HPRIORITY_TEXT N_("Increase the priority of the process")
 #define HPRIORITY_LONGTEXT N_( \
     "Increasing the priority of the process will very likely improve your " \
@@ -2145,6 +2182,17 @@ vlc_module_begin ()
 
     set_section( N_("Performance options"), NULL )
 
+    add_bool( "block-pool", false, BLOCK_POOL_TEXT,
+              BLOCK_POOL_LONGTEXT, true )
+    add_integer_with_range( "picture-cache", 0, 0, 4096, PICTURE_CACHE_TEXT,
+                            PICTURE_CACHE_LONGTEXT, true )
+    add_bool( "picture-huge-pages", false, PICTURE_HUGE_PAGES_TEXT,
+              PICTURE_HUGE_PAGES_LONGTEXT, true )
+    add_integer_with_range( "copy-threads", 1, 0, 8, COPY_THREADS_TEXT,
+                            COPY_THREADS_LONGTEXT, true )
+    add_savefile( "trace-file", NULL, TRACE_FILE_TEXT, TRACE_FILE_LONGTEXT )
+        change_volatile ()
+
 #if defined (LIBVLC_USE_PTHREAD)
     add_obsolete_bool( "rt-priority" ) /* since 4.0.0 */
     add_obsolete_integer( "rt-offset" ) /* since 4.0.0 */
@@ -2246,6 +2294,8 @@ vlc_module_begin ()
                  false )
         change_short('v')
         change_volatile ()
+    add_bool( "log-async", false, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT,
+              true )
     add_obsolete_string( "verbose-objects" ) /* since 2.1.0 */
 #if !defined(_WIN32) && !defined(__OS2__)
     add_obsolete_bool( "daemon" ) /* since 4.0.0 */
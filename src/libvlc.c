@@ -42,6 +42,8 @@
 #include "config/configuration.h"
 #include "preparser/preparser.h"
 #include "media_source/media_source.h"
+#include "misc/picture.h"
+#include "misc/trace.h"
 
 #include <stdio.h>                                              /* sprintf() */
 #include <string.h>
@@ -54,6 +56,7 @@
 #include <vlc_interface.h>
 
 #include <vlc_actions.h>
+#include <vlc_block.h>
 #include <vlc_charset.h>
 #include <vlc_dialog.h>
 #include <vlc_keystore.h>
@@ -191,6 +194,18 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
 
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
+    /* The block pool is process-wide: one instance is enough to enable it */
+    if( var_InheritBool( p_libvlc, "block-pool" ) )
+        block_PoolEnable( true );
+
+    /* Likewise, the picture allocator is process-wide */
+    unsigned cache_mib = var_InheritInteger( p_libvlc, "picture-cache" );
+    bool huge_pages = var_InheritBool( p_libvlc, "picture-huge-pages" );
+    if( cache_mib > 0 || huge_pages )
+        picture_AllocatorSetup( (size_t)cache_mib << 20, huge_pages );
+
+    vlc_tracer_Init( p_libvlc );
+
     if( var_InheritBool( p_libvlc, "media-library") )
     {
         priv->p_media_library = libvlc_MlCreate( p_libvlc );
@@ -406,12 +421,19 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if ( priv->p_media_library )
         libvlc_MlRelease( priv->p_media_library );
 
+    /* Unmap the cached picture buffers, now that the outputs are gone */
+    if( var_InheritInteger( p_libvlc, "picture-cache" ) > 0
+     || var_InheritBool( p_libvlc, "picture-huge-pages" ) )
+        picture_AllocatorSetup( 0, false );
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    vlc_tracer_Deinit( p_libvlc );
+
     vlc_LogDestroy(p_libvlc->obj.logger);
     /* Free module bank. It is refcounted, so we call this each time  */
     module_EndBank (true);
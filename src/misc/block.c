@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_list.h>
 
 #ifndef NDEBUG
 static void block_Check (block_t *block)
@@ -105,6 +106,330 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*** Block pool ***/
+
+/* Pooled blocks are allocated (header included) in power-of-two size
+ * classes. Each thread keeps one magazine of free blocks per class, and
+ * exchanges full magazines with a global depot. */
+#define BLOCK_POOL_MIN_SHIFT  9 /* 512 bytes */
+#define BLOCK_POOL_CLASSES   10 /* up to 256 KiB */
+#define BLOCK_POOL_ROUNDS    16 /* blocks per magazine */
+#define BLOCK_POOL_DEPOT_MAX (8 << 20) /* bytes per size class in the depot */
+
+struct block_magazine
+{
+    struct block_magazine *next;
+    unsigned count;
+    block_t *rounds[BLOCK_POOL_ROUNDS];
+};
+
+struct block_pool_cache
+{
+    struct block_magazine *mags[BLOCK_POOL_CLASSES];
+    /* Only written by the owner thread, read by block_PoolGetStats() */
+    atomic_uint_least64_t hits;
+    atomic_uint_least64_t misses;
+    atomic_size_t bytes;
+    struct vlc_list node;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct block_magazine *full[BLOCK_POOL_CLASSES];
+    unsigned full_count[BLOCK_POOL_CLASSES];
+    struct block_magazine *empty;
+    struct vlc_list caches;
+    /* Counters of the exited threads, and bytes held by the depot */
+    uint64_t hits;
+    uint64_t misses;
+    size_t bytes;
+} block_depot = {
+    .lock = VLC_STATIC_MUTEX,
+    .caches = VLC_LIST_INITIALIZER(&block_depot.caches),
+};
+
+static atomic_bool block_pool_enabled = ATOMIC_VAR_INIT(false);
+static vlc_once_t block_pool_once = VLC_STATIC_ONCE;
+static vlc_threadvar_t block_pool_key;
+static bool block_pool_has_key;
+
+static void block_pool_Add(atomic_uint_least64_t *counter, uint_least64_t n)
+{
+    /* Single writer: no need for an atomic read-modify-write */
+    atomic_store_explicit(counter,
+        atomic_load_explicit(counter, memory_order_relaxed) + n,
+        memory_order_relaxed);
+}
+
+static void block_pool_SetBytes(struct block_pool_cache *cache, size_t bytes)
+{
+    atomic_store_explicit(&cache->bytes, bytes, memory_order_relaxed);
+}
+
+static size_t block_pool_GetBytes(struct block_pool_cache *cache)
+{
+    return atomic_load_explicit(&cache->bytes, memory_order_relaxed);
+}
+
+static void block_pool_Flush(struct block_magazine *mag)
+{
+    while (mag->count > 0)
+        free(mag->rounds[--mag->count]);
+}
+
+static void block_pool_DeleteCache(void *data)
+{
+    struct block_pool_cache *cache = data;
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        struct block_magazine *mag = cache->mags[i];
+
+        if (mag != NULL)
+        {
+            block_pool_Flush(mag);
+            free(mag);
+        }
+    }
+
+    vlc_mutex_lock(&block_depot.lock);
+    block_depot.hits += atomic_load_explicit(&cache->hits,
+                                             memory_order_relaxed);
+    block_depot.misses += atomic_load_explicit(&cache->misses,
+                                               memory_order_relaxed);
+    vlc_list_remove(&cache->node);
+    vlc_mutex_unlock(&block_depot.lock);
+    free(cache);
+}
+
+static void block_pool_Init(void)
+{
+    block_pool_has_key = vlc_threadvar_create(&block_pool_key,
+                                              block_pool_DeleteCache) == 0;
+}
+
+static struct block_pool_cache *block_pool_GetCache(void)
+{
+    vlc_once(&block_pool_once, block_pool_Init);
+    if (unlikely(!block_pool_has_key))
+        return NULL;
+
+    struct block_pool_cache *cache = vlc_threadvar_get(block_pool_key);
+    if (likely(cache != NULL))
+        return cache;
+
+    cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+        cache->mags[i] = NULL;
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->bytes, 0);
+
+    vlc_mutex_lock(&block_depot.lock);
+    vlc_list_append(&cache->node, &block_depot.caches);
+    vlc_mutex_unlock(&block_depot.lock);
+
+    if (unlikely(vlc_threadvar_set(block_pool_key, cache)))
+    {
+        block_pool_DeleteCache(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void block_pool_Release(block_t *block)
+{
+    const size_t size = sizeof (*block) + block->i_size;
+    const unsigned i = ctz(size) - BLOCK_POOL_MIN_SHIFT;
+
+    assert(block->p_start == (unsigned char *)(block + 1));
+    assert((size & (size - 1)) == 0 && i < BLOCK_POOL_CLASSES);
+
+    struct block_pool_cache *cache = NULL;
+
+    if (atomic_load_explicit(&block_pool_enabled, memory_order_relaxed))
+        cache = block_pool_GetCache();
+    if (cache == NULL)
+    {
+        free(block);
+        return;
+    }
+
+    struct block_magazine *mag = cache->mags[i];
+
+    if (mag == NULL)
+    {
+        mag = malloc(sizeof (*mag));
+        if (unlikely(mag == NULL))
+        {
+            free(block);
+            return;
+        }
+        mag->count = 0;
+        cache->mags[i] = mag;
+    }
+    else if (mag->count == BLOCK_POOL_ROUNDS)
+    {   /* Hand the full magazine over to the depot */
+        const size_t bytes = BLOCK_POOL_ROUNDS * size;
+        struct block_magazine *empty = NULL;
+
+        vlc_mutex_lock(&block_depot.lock);
+        if (block_depot.full_count[i] < BLOCK_POOL_DEPOT_MAX / bytes)
+        {
+            empty = block_depot.empty;
+            if (empty != NULL)
+                block_depot.empty = empty->next;
+            else
+                empty = malloc(sizeof (*empty));
+
+            if (likely(empty != NULL))
+            {
+                mag->next = block_depot.full[i];
+                block_depot.full[i] = mag;
+                block_depot.full_count[i]++;
+                block_depot.bytes += bytes;
+            }
+        }
+        vlc_mutex_unlock(&block_depot.lock);
+
+        if (empty != NULL)
+        {
+            empty->count = 0;
+            cache->mags[i] = mag = empty;
+        }
+        else /* The depot is full: give the memory back */
+            block_pool_Flush(mag);
+        block_pool_SetBytes(cache, block_pool_GetBytes(cache) - bytes);
+    }
+
+    mag->rounds[mag->count++] = block;
+    block_pool_SetBytes(cache, block_pool_GetBytes(cache) + size);
+}
+
+static const struct vlc_block_callbacks block_pool_cbs =
+{
+    block_pool_Release,
+};
+
+static block_t *block_pool_Alloc(size_t alloc)
+{
+    const size_t max = (size_t)1 << (BLOCK_POOL_MIN_SHIFT
+                                     + BLOCK_POOL_CLASSES - 1);
+    if (alloc > max)
+        return NULL;
+
+    unsigned i = 0;
+    if (alloc > ((size_t)1 << BLOCK_POOL_MIN_SHIFT))
+        i = (sizeof (unsigned long long) * 8) - clz(alloc - 1ULL)
+            - BLOCK_POOL_MIN_SHIFT;
+
+    const size_t size = (size_t)1 << (BLOCK_POOL_MIN_SHIFT + i);
+    struct block_pool_cache *cache = block_pool_GetCache();
+    block_t *b;
+
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    struct block_magazine *mag = cache->mags[i];
+
+    if (mag == NULL || mag->count == 0)
+    {   /* Take a full magazine from the depot */
+        vlc_mutex_lock(&block_depot.lock);
+        struct block_magazine *full = block_depot.full[i];
+        if (full != NULL)
+        {
+            block_depot.full[i] = full->next;
+            block_depot.full_count[i]--;
+            block_depot.bytes -= full->count * size;
+            if (mag != NULL)
+            {
+                mag->next = block_depot.empty;
+                block_depot.empty = mag;
+            }
+            cache->mags[i] = mag = full;
+        }
+        vlc_mutex_unlock(&block_depot.lock);
+
+        if (full != NULL)
+            block_pool_SetBytes(cache, block_pool_GetBytes(cache)
+                                       + full->count * size);
+    }
+
+    if (mag != NULL && mag->count > 0)
+    {
+        b = mag->rounds[--mag->count];
+        block_pool_SetBytes(cache, block_pool_GetBytes(cache) - size);
+        block_pool_Add(&cache->hits, 1);
+    }
+    else
+    {
+        b = malloc(size);
+        if (unlikely(b == NULL))
+            return NULL;
+        block_pool_Add(&cache->misses, 1);
+    }
+
+    return block_Init(b, &block_pool_cbs, b + 1, size - sizeof (*b));
+}
+
+void block_PoolEnable(bool enable)
+{
+    atomic_store_explicit(&block_pool_enabled, enable, memory_order_relaxed);
+
+    if (enable)
+        return;
+
+    /* Give the depot memory back. Per-thread magazines are released as the
+     * threads exit (or as their blocks are released). */
+    vlc_mutex_lock(&block_depot.lock);
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        struct block_magazine *mag;
+
+        while ((mag = block_depot.full[i]) != NULL)
+        {
+            block_depot.full[i] = mag->next;
+            block_pool_Flush(mag);
+            free(mag);
+        }
+        block_depot.full_count[i] = 0;
+    }
+
+    for (struct block_magazine *mag = block_depot.empty, *next;
+         mag != NULL; mag = next)
+    {
+        next = mag->next;
+        free(mag);
+    }
+    block_depot.empty = NULL;
+    block_depot.bytes = 0;
+    vlc_mutex_unlock(&block_depot.lock);
+}
+
+void block_PoolGetStats(struct vlc_block_pool_stats *restrict stats)
+{
+    struct block_pool_cache *cache;
+
+    vlc_mutex_lock(&block_depot.lock);
+    stats->hits = block_depot.hits;
+    stats->misses = block_depot.misses;
+    stats->bytes_cached = block_depot.bytes;
+
+    vlc_list_foreach(cache, &block_depot.caches, node)
+    {
+        stats->hits += atomic_load_explicit(&cache->hits,
+                                            memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&cache->misses,
+                                              memory_order_relaxed);
+        stats->bytes_cached += block_pool_GetBytes(cache);
+    }
+    vlc_mutex_unlock(&block_depot.lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -119,11 +444,19 @@ block_t *block_Alloc (size_t size)
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b = NULL;
+
+    if (atomic_load_explicit(&block_pool_enabled, memory_order_relaxed))
+        b = block_pool_Alloc(alloc);
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+
+        block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+    }
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
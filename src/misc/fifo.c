@@ -233,3 +233,212 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * Internal state for single-producer single-consumer block queues
+ *
+ * The producer and consumer indices are free-running 32-bits counters.
+ * A thread only takes the lock to sleep when the queue is full or empty, and
+ * the other thread only takes it to wake it up when it has flagged itself as
+ * waiting. The wait is a condition variable, so that it is a cancellation
+ * point on every platform.
+ */
+struct vlc_spsc_fifo
+{
+    block_t           **ring;
+    unsigned            mask;
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait;
+
+    /* Written by the producer */
+    struct
+    {
+        atomic_uint     tail; /**< Count of queued blocks */
+        atomic_size_t   bytes; /**< Count of queued bytes */
+        atomic_bool     waiting; /**< Producer waits for room */
+    } in;
+    unsigned char       pad[64];
+    /* Written by the consumer */
+    struct
+    {
+        atomic_uint     head; /**< Count of dequeued blocks */
+        atomic_size_t   bytes; /**< Count of dequeued bytes */
+        atomic_bool     waiting; /**< Consumer waits for data */
+    } out;
+};
+
+vlc_spsc_fifo_t *vlc_spsc_fifo_New(size_t capacity)
+{
+    if (capacity < 2)
+        capacity = 2;
+    if (unlikely(capacity > (1u << 30)))
+        return NULL;
+
+    unsigned size = 1u << (32 - vlc_clz(capacity - 1));
+    vlc_spsc_fifo_t *fifo = malloc(sizeof (*fifo));
+    if (unlikely(fifo == NULL))
+        return NULL;
+
+    fifo->ring = malloc(size * sizeof (*fifo->ring));
+    if (unlikely(fifo->ring == NULL))
+    {
+        free(fifo);
+        return NULL;
+    }
+
+    fifo->mask = size - 1;
+    vlc_mutex_init(&fifo->lock);
+    vlc_cond_init(&fifo->wait);
+    atomic_init(&fifo->in.tail, 0);
+    atomic_init(&fifo->in.bytes, 0);
+    atomic_init(&fifo->in.waiting, false);
+    atomic_init(&fifo->out.head, 0);
+    atomic_init(&fifo->out.bytes, 0);
+    atomic_init(&fifo->out.waiting, false);
+    return fifo;
+}
+
+void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *fifo)
+{
+    unsigned head = atomic_load_explicit(&fifo->out.head,
+                                         memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&fifo->in.tail,
+                                         memory_order_acquire);
+
+    while (head != tail)
+        block_Release(fifo->ring[head++ & fifo->mask]);
+
+    free(fifo->ring);
+    free(fifo);
+}
+
+static void vlc_spsc_fifo_Wake(vlc_spsc_fifo_t *fifo)
+{
+    vlc_mutex_lock(&fifo->lock);
+    vlc_cond_signal(&fifo->wait);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static void vlc_spsc_fifo_CancelQueue(void *data)
+{
+    vlc_spsc_fifo_t *fifo = data;
+
+    atomic_store_explicit(&fifo->in.waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static void vlc_spsc_fifo_CancelDequeue(void *data)
+{
+    vlc_spsc_fifo_t *fifo = data;
+
+    atomic_store_explicit(&fifo->out.waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+/* The cancellable waits are kept out of the queuing and dequeuing loops, so
+ * that no local variable of those lives across the cleanup handler setup */
+static void vlc_spsc_fifo_WaitRoom(vlc_spsc_fifo_t *fifo, unsigned head)
+{
+    vlc_mutex_lock(&fifo->lock);
+    atomic_store(&fifo->in.waiting, true);
+    vlc_cleanup_push(vlc_spsc_fifo_CancelQueue, fifo);
+    while (atomic_load(&fifo->out.head) == head)
+        vlc_cond_wait(&fifo->wait, &fifo->lock);
+    vlc_cleanup_pop();
+    atomic_store_explicit(&fifo->in.waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static void vlc_spsc_fifo_WaitData(vlc_spsc_fifo_t *fifo, unsigned tail)
+{
+    vlc_mutex_lock(&fifo->lock);
+    atomic_store(&fifo->out.waiting, true);
+    vlc_cleanup_push(vlc_spsc_fifo_CancelDequeue, fifo);
+    while (atomic_load(&fifo->in.tail) == tail)
+        vlc_cond_wait(&fifo->wait, &fifo->lock);
+    vlc_cleanup_pop();
+    atomic_store_explicit(&fifo->out.waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+void vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *fifo, block_t *block)
+{
+    unsigned tail = atomic_load_explicit(&fifo->in.tail,
+                                         memory_order_relaxed);
+    size_t bytes = atomic_load_explicit(&fifo->in.bytes,
+                                        memory_order_relaxed);
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+        unsigned head;
+
+        while (tail - (head = atomic_load(&fifo->out.head)) > fifo->mask)
+            vlc_spsc_fifo_WaitRoom(fifo, head); /* Full */
+
+        block->p_next = NULL;
+        fifo->ring[tail & fifo->mask] = block;
+        bytes += block->i_buffer;
+        atomic_store_explicit(&fifo->in.bytes, bytes, memory_order_relaxed);
+        atomic_store(&fifo->in.tail, ++tail);
+        block = next;
+    }
+
+    if (atomic_load(&fifo->out.waiting))
+        vlc_spsc_fifo_Wake(fifo);
+}
+
+static block_t *vlc_spsc_fifo_Pop(vlc_spsc_fifo_t *fifo, unsigned head)
+{
+    block_t *block = fifo->ring[head & fifo->mask];
+    size_t bytes = atomic_load_explicit(&fifo->out.bytes,
+                                        memory_order_relaxed);
+
+    atomic_store_explicit(&fifo->out.bytes, bytes + block->i_buffer,
+                          memory_order_release);
+    atomic_store(&fifo->out.head, head + 1);
+
+    if (atomic_load(&fifo->in.waiting))
+        vlc_spsc_fifo_Wake(fifo);
+    return block;
+}
+
+block_t *vlc_spsc_fifo_TryDequeue(vlc_spsc_fifo_t *fifo)
+{
+    unsigned head = atomic_load_explicit(&fifo->out.head,
+                                         memory_order_relaxed);
+
+    if (atomic_load_explicit(&fifo->in.tail, memory_order_acquire) == head)
+        return NULL;
+    return vlc_spsc_fifo_Pop(fifo, head);
+}
+
+block_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *fifo)
+{
+    unsigned head = atomic_load_explicit(&fifo->out.head,
+                                         memory_order_relaxed);
+
+    vlc_testcancel();
+
+    while (atomic_load_explicit(&fifo->in.tail, memory_order_acquire) == head)
+        vlc_spsc_fifo_WaitData(fifo, head); /* Empty */
+
+    return vlc_spsc_fifo_Pop(fifo, head);
+}
+
+size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *fifo)
+{
+    unsigned head = atomic_load(&fifo->out.head);
+    unsigned tail = atomic_load(&fifo->in.tail);
+
+    return tail - head;
+}
+
+size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *fifo)
+{
+    /* Read the consumer side first, so that the difference cannot wrap */
+    size_t out = atomic_load_explicit(&fifo->out.bytes, memory_order_acquire);
+    size_t in = atomic_load_explicit(&fifo->in.bytes, memory_order_acquire);
+
+    return in - out;
+}
@@ -40,6 +40,8 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+    picture_t *inplace; /**< Input picture to reuse as output buffer */
+    picture_t *allocated; /**< Last intermediate picture allocated */
 } chained_filter_t;
 
 /* */
@@ -100,6 +102,15 @@ static picture_t *filter_chain_VideoBufferNew( filter_t *filter )
 {
     picture_t *pic;
     chained_filter_t *chained = container_of(filter, chained_filter_t, filter);
+
+    if( chained->inplace != NULL )
+    {   /* The filter will overwrite its input picture */
+        pic = picture_Hold( chained->inplace );
+        chained->inplace = NULL;
+        chained->allocated = pic;
+        return pic;
+    }
+
     if( chained->next != NULL )
     {
         // HACK as intermediate filters may not have the same video format as
@@ -110,6 +121,7 @@ static picture_t *filter_chain_VideoBufferNew( filter_t *filter )
         filter->owner = saved_owner;
         if( pic == NULL )
             msg_Err( filter, "Failed to allocate picture" );
+        chained->allocated = pic;
     }
     else
     {
@@ -275,6 +287,8 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    chained->inplace = NULL;
+    chained->allocated = NULL;
 
     msg_Dbg( chain->obj, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -422,14 +436,39 @@ vlc_video_context *filter_chain_GetVideoCtxOut(const filter_chain_t *p_chain)
     return p_chain->vctx_in;
 }
 
+/**
+ * Whether a filter may overwrite its input picture
+ *
+ * The picture must have been allocated by the chain for the previous filter,
+ * and not be referenced anywhere else. The output of the last filter is
+ * allocated by the chain owner, unless it has no allocator.
+ */
+static bool FilterCanProcessInPlace( const chained_filter_t *f,
+                                     const picture_t *pic, bool owned )
+{
+    const filter_chain_t *chain = f->filter.owner.sys;
+
+    return owned && f->filter.b_inplace
+        && (f->next != NULL || chain->parent_video_owner.video == NULL)
+        && atomic_load_explicit( &pic->refs, memory_order_relaxed ) == 1;
+}
+
 static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic )
 {
+    bool owned = false;
+
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+
+        f->allocated = NULL;
+        if( FilterCanProcessInPlace( f, p_pic, owned ) )
+            f->inplace = p_pic;
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        f->inplace = NULL;
         if( !p_pic )
             break;
+        owned = p_pic == f->allocated;
         if( f->pending )
         {
             msg_Warn( p_filter, "dropping pictures" );
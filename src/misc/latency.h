@@ -0,0 +1,157 @@
+/*****************************************************************************
+ * latency.h: lock-free latency histogram recorder
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_LATENCY_H
+# define LIBVLC_LATENCY_H 1
+
+# include <stdatomic.h>
+# include <vlc_input_item.h>
+
+/* NOTE: The fields are atomic on their own: a snapshot taken while samples
+ * are recorded may be off by a few samples, which is irrelevant for
+ * statistics. */
+struct vlc_latency_recorder
+{
+    atomic_uint_least64_t count;
+    atomic_int_least64_t sum;
+    atomic_uint_least64_t negative;
+    atomic_uint_least64_t buckets[VLC_LATENCY_BUCKETS];
+};
+
+static inline void vlc_latency_recorder_Init(struct vlc_latency_recorder *r)
+{
+    atomic_init(&r->count, 0);
+    atomic_init(&r->sum, 0);
+    atomic_init(&r->negative, 0);
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        atomic_init(&r->buckets[i], 0);
+}
+
+static inline unsigned vlc_latency_bucket(vlc_tick_t value)
+{
+    uint64_t us = value > 0 ? US_FROM_VLC_TICK(value) : 0;
+
+    if (us < 2)
+        return 0;
+
+    unsigned i = (sizeof (unsigned long long) * 8 - 1)
+               - clz((unsigned long long)us);
+    return i < VLC_LATENCY_BUCKETS ? i : VLC_LATENCY_BUCKETS - 1;
+}
+
+/**
+ * Records one sample.
+ */
+static inline void vlc_latency_recorder_Add(struct vlc_latency_recorder *r,
+                                            vlc_tick_t value)
+{
+    atomic_uint_least64_t *bucket = value < 0 ? &r->negative
+                                  : &r->buckets[vlc_latency_bucket(value)];
+
+    atomic_fetch_add_explicit(bucket, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->sum, value, memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->count, 1, memory_order_relaxed);
+}
+
+/**
+ * Adds a histogram to the recorder.
+ */
+static inline void
+vlc_latency_recorder_Merge(struct vlc_latency_recorder *r,
+                           const struct vlc_latency_histogram *h)
+{
+    if (h->count == 0)
+        return;
+
+    if (h->negative != 0)
+        atomic_fetch_add_explicit(&r->negative, h->negative,
+                                  memory_order_relaxed);
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        if (h->buckets[i] != 0)
+            atomic_fetch_add_explicit(&r->buckets[i], h->buckets[i],
+                                      memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->sum, h->sum, memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->count, h->count, memory_order_relaxed);
+}
+
+/**
+ * Copies the recorded samples into a histogram.
+ */
+static inline void vlc_latency_recorder_Get(struct vlc_latency_recorder *r,
+                                            struct vlc_latency_histogram *h)
+{
+    h->count = atomic_load_explicit(&r->count, memory_order_relaxed);
+    h->sum = atomic_load_explicit(&r->sum, memory_order_relaxed);
+    h->negative = atomic_load_explicit(&r->negative, memory_order_relaxed);
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        h->buckets[i] = atomic_load_explicit(&r->buckets[i],
+                                             memory_order_relaxed);
+}
+
+/**
+ * Moves the recorded samples into a histogram, adding to its contents.
+ */
+static inline void
+vlc_latency_recorder_GetReset(struct vlc_latency_recorder *r,
+                              struct vlc_latency_histogram *h)
+{
+    if (atomic_load_explicit(&r->count, memory_order_relaxed) == 0)
+        return;
+
+    h->count += atomic_exchange_explicit(&r->count, 0, memory_order_relaxed);
+    h->sum += atomic_exchange_explicit(&r->sum, 0, memory_order_relaxed);
+    h->negative += atomic_exchange_explicit(&r->negative, 0,
+                                            memory_order_relaxed);
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        h->buckets[i] += atomic_exchange_explicit(&r->buckets[i], 0,
+                                                  memory_order_relaxed);
+}
+
+/**
+ * Latency recorders of the decoding pipeline of elementary streams
+ */
+struct vlc_es_latency_recorder
+{
+    struct vlc_latency_recorder queue;
+    struct vlc_latency_recorder decode;
+    struct vlc_latency_recorder output;
+    struct vlc_latency_recorder lateness;
+};
+
+static inline void
+vlc_es_latency_recorder_Init(struct vlc_es_latency_recorder *r)
+{
+    vlc_latency_recorder_Init(&r->queue);
+    vlc_latency_recorder_Init(&r->decode);
+    vlc_latency_recorder_Init(&r->output);
+    vlc_latency_recorder_Init(&r->lateness);
+}
+
+static inline void
+vlc_es_latency_recorder_Get(struct vlc_es_latency_recorder *r,
+                            struct vlc_es_latency *latency)
+{
+    vlc_latency_recorder_Get(&r->queue, &latency->queue);
+    vlc_latency_recorder_Get(&r->decode, &latency->decode);
+    vlc_latency_recorder_Get(&r->output, &latency->output);
+    vlc_latency_recorder_Get(&r->lateness, &latency->lateness);
+}
+
+#endif
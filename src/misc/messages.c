@@ -439,6 +439,198 @@ static struct vlc_logger *vlc_LogModuleCreate(vlc_object_t *parent)
     return &module->frontend;
 }
 
+/**
+ * Asynchronous message log.
+ *
+ * A message log that formats messages into a bounded lock-free ring on the
+ * emitting thread, and passes them on to its backend from a dedicated thread.
+ * Producers never block: messages are dropped and counted if the ring is full.
+ */
+#define LOG_ASYNC_SLOTS 256 /* must be a power of two */
+#define LOG_ASYNC_MSG_SIZE 256
+
+struct vlc_log_async_slot {
+    atomic_size_t seq;
+    int type;
+    vlc_log_t meta;
+    char *msg_alloc; /**< Heap copy of messages too long for msg */
+    char module[32];
+    char msg[LOG_ASYNC_MSG_SIZE];
+};
+
+struct vlc_logger_async {
+    struct vlc_logger frontend;
+    struct vlc_logger *backend;
+    vlc_thread_t thread;
+    size_t head; /**< Next slot to read (logger thread only) */
+    atomic_size_t tail; /**< Next slot to write */
+    atomic_uint wakeup;
+    atomic_bool sleeping;
+    atomic_bool dead;
+    atomic_size_t dropped;
+    struct vlc_log_async_slot slots[LOG_ASYNC_SLOTS];
+};
+
+static void vlc_vaLogAsync(void *d, int type, const vlc_log_t *item,
+                           const char *format, va_list ap)
+{
+    struct vlc_logger *logger = d;
+    struct vlc_logger_async *async =
+        container_of(logger, struct vlc_logger_async, frontend);
+    struct vlc_log_async_slot *slot;
+    size_t pos = atomic_load_explicit(&async->tail, memory_order_relaxed);
+
+    /* Claim a slot (bounded MPMC queue with per-slot sequence numbers) */
+    for (;;) {
+        slot = &async->slots[pos & (LOG_ASYNC_SLOTS - 1)];
+
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&async->tail, &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&async->dropped, 1,
+                                      memory_order_relaxed);
+            return;
+        } else
+            pos = atomic_load_explicit(&async->tail, memory_order_relaxed);
+    }
+
+    slot->type = type;
+    slot->meta = *item;
+    /* NOTE: The module name may live on the caller stack, copy it. */
+    snprintf(slot->module, sizeof (slot->module), "%s", item->psz_module);
+    slot->meta.psz_module = slot->module;
+    slot->meta.psz_header = item->psz_header ? strdup(item->psz_header)
+                                             : NULL;
+
+    va_list aq;
+    va_copy(aq, ap);
+    int len = vsnprintf(slot->msg, sizeof (slot->msg), format, aq);
+    va_end(aq);
+
+    slot->msg_alloc = NULL;
+    if (unlikely((size_t)len >= sizeof (slot->msg)) && len > 0
+     && vasprintf(&slot->msg_alloc, format, ap) == -1)
+        slot->msg_alloc = NULL;
+
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    atomic_fetch_add(&async->wakeup, 1);
+    if (atomic_load(&async->sleeping))
+        vlc_atomic_notify_one(&async->wakeup);
+}
+
+static bool vlc_LogAsyncDequeue(struct vlc_logger_async *async)
+{
+    struct vlc_logger *backend = async->backend;
+    size_t pos = async->head;
+    struct vlc_log_async_slot *slot =
+        &async->slots[pos & (LOG_ASYNC_SLOTS - 1)];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1)
+        return false; /* empty, or the producer is not done yet */
+
+    vlc_LogCallback(backend, slot->type, &slot->meta, "%s",
+                    (slot->msg_alloc != NULL) ? slot->msg_alloc : slot->msg);
+    free(slot->msg_alloc);
+    free((char *)slot->meta.psz_header);
+
+    atomic_store_explicit(&slot->seq, pos + LOG_ASYNC_SLOTS,
+                          memory_order_release);
+    async->head = pos + 1;
+    return true;
+}
+
+static void *vlc_LogAsyncThread(void *data)
+{
+    struct vlc_logger_async *async = data;
+
+    for (;;) {
+        unsigned wakeup = atomic_load(&async->wakeup);
+        bool dead = atomic_load(&async->dead);
+
+        while (vlc_LogAsyncDequeue(async));
+
+        size_t dropped = atomic_exchange_explicit(&async->dropped, 0,
+                                                  memory_order_relaxed);
+        if (dropped > 0) {
+            vlc_log_t meta = {
+                .i_object_id = (uintptr_t)(void *)async,
+                .psz_object_type = "logger",
+                .psz_module = "main",
+                .file = __FILE__,
+                .line = __LINE__,
+                .func = __func__,
+                .tid = vlc_thread_id(),
+            };
+
+            vlc_LogCallback(async->backend, VLC_MSG_WARN, &meta,
+                            "%zu log message(s) dropped", dropped);
+        }
+
+        if (dead)
+            break;
+
+        atomic_store(&async->sleeping, true);
+        vlc_atomic_wait(&async->wakeup, wakeup);
+        atomic_store(&async->sleeping, false);
+    }
+    return NULL;
+}
+
+static void vlc_LogAsyncClose(void *d)
+{
+    struct vlc_logger *logger = d;
+    struct vlc_logger_async *async =
+        container_of(logger, struct vlc_logger_async, frontend);
+    struct vlc_logger *backend = async->backend;
+
+    /* Flush: the thread drains the queue before it exits. */
+    atomic_store(&async->dead, true);
+    atomic_fetch_add(&async->wakeup, 1);
+    vlc_atomic_notify_one(&async->wakeup);
+    vlc_join(async->thread, NULL);
+
+    backend->ops->destroy(backend);
+    free(async);
+}
+
+static const struct vlc_logger_operations async_ops = {
+    vlc_vaLogAsync,
+    vlc_LogAsyncClose,
+};
+
+static struct vlc_logger *vlc_LogAsyncCreate(struct vlc_logger *backend)
+{
+    struct vlc_logger_async *async = malloc(sizeof (*async));
+    if (unlikely(async == NULL))
+        return NULL;
+
+    async->frontend.ops = &async_ops;
+    async->backend = backend;
+    async->head = 0;
+    atomic_init(&async->tail, 0);
+    atomic_init(&async->wakeup, 0);
+    atomic_init(&async->sleeping, false);
+    atomic_init(&async->dead, false);
+    atomic_init(&async->dropped, 0);
+    for (size_t i = 0; i < LOG_ASYNC_SLOTS; i++)
+        atomic_init(&async->slots[i].seq, i);
+
+    if (vlc_clone(&async->thread, vlc_LogAsyncThread, async,
+                  VLC_THREAD_PRIORITY_LOW)) {
+        free(async);
+        return NULL;
+    }
+    return &async->frontend;
+}
+
 /**
  * Initializes the messages logging subsystem and drain the early messages to
  * the configured log.
@@ -448,6 +640,11 @@ void vlc_LogInit(libvlc_int_t *vlc)
     struct vlc_logger *logger = vlc_LogModuleCreate(VLC_OBJECT(vlc));
     if (logger == NULL)
         logger = &discard_log;
+    else if (var_InheritBool(vlc, "log-async")) {
+        struct vlc_logger *async = vlc_LogAsyncCreate(logger);
+        if (async != NULL)
+            logger = async;
+    }
 
     vlc_LogSwitch(vlc->obj.logger, logger);
 }
@@ -34,6 +34,7 @@
 #include <limits.h>
 
 #include <vlc_common.h>
+#include <vlc_list.h>
 #include "picture.h"
 #include <vlc_image.h>
 #include <vlc_block.h>
@@ -60,6 +61,129 @@ static void picture_DestroyDummy( picture_t *p_picture )
     (void) p_picture;
 }
 
+/*** Picture buffer cache ***/
+
+/* Released buffers are kept, up to a total size, and handed back to
+ * allocations of the same size, most recently released first, so that
+ * re-creating a decoder or a picture pool does not map and fault in every
+ * frame again. Buffers are matched on their size only: a buffer may come
+ * back with another format of the same size, and its previous pixels. */
+struct picture_cached_buffer
+{
+    struct vlc_list node;
+    int fd;
+    void *base;
+    size_t size;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct vlc_list buffers;
+    size_t bytes;
+    atomic_size_t max;
+} picture_cache = {
+    .lock = VLC_STATIC_MUTEX,
+    .buffers = VLC_LIST_INITIALIZER(&picture_cache.buffers),
+};
+
+atomic_bool picture_huge_pages = false;
+
+static void picture_cache_Trim(struct vlc_list *trash, size_t max)
+{
+    while (picture_cache.bytes > max)
+    {
+        struct picture_cached_buffer *buf =
+            vlc_list_last_entry_or_null(&picture_cache.buffers,
+                                        struct picture_cached_buffer, node);
+        assert(buf != NULL);
+        vlc_list_remove(&buf->node);
+        picture_cache.bytes -= buf->size;
+        vlc_list_append(&buf->node, trash);
+    }
+}
+
+static void picture_cache_Free(struct vlc_list *trash)
+{
+    struct picture_cached_buffer *buf;
+
+    vlc_list_foreach(buf, trash, node)
+    {
+        picture_Deallocate(buf->fd, buf->base, buf->size);
+        free(buf);
+    }
+}
+
+static void *picture_cache_Get(int *restrict fdp, size_t size)
+{
+    struct picture_cached_buffer *buf, *found = NULL;
+
+    vlc_mutex_lock(&picture_cache.lock);
+    vlc_list_foreach(buf, &picture_cache.buffers, node)
+        if (buf->size == size)
+        {
+            vlc_list_remove(&buf->node);
+            picture_cache.bytes -= size;
+            found = buf;
+            break;
+        }
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    if (found == NULL)
+        return picture_Allocate(fdp, size);
+
+    void *base = found->base;
+
+    *fdp = found->fd;
+    free(found);
+    return base;
+}
+
+static void picture_cache_Put(int fd, void *base, size_t size)
+{
+    struct picture_cached_buffer *buf = NULL;
+    struct vlc_list trash;
+
+    if (size <= atomic_load_explicit(&picture_cache.max, memory_order_relaxed))
+        buf = malloc(sizeof (*buf));
+    if (buf == NULL)
+    {
+        picture_Deallocate(fd, base, size);
+        return;
+    }
+
+    buf->fd = fd;
+    buf->base = base;
+    buf->size = size;
+    vlc_list_init(&trash);
+
+    vlc_mutex_lock(&picture_cache.lock);
+    vlc_list_prepend(&buf->node, &picture_cache.buffers);
+    picture_cache.bytes += size;
+    picture_cache_Trim(&trash, atomic_load_explicit(&picture_cache.max,
+                                                    memory_order_relaxed));
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    picture_cache_Free(&trash);
+}
+
+void picture_AllocatorSetup(size_t cache_size, bool huge_pages)
+{
+    struct vlc_list trash;
+
+    vlc_list_init(&trash);
+    atomic_store_explicit(&picture_huge_pages, huge_pages,
+                          memory_order_relaxed);
+
+    vlc_mutex_lock(&picture_cache.lock);
+    atomic_store_explicit(&picture_cache.max, cache_size,
+                          memory_order_relaxed);
+    picture_cache_Trim(&trash, cache_size);
+    vlc_mutex_unlock(&picture_cache.lock);
+
+    picture_cache_Free(&trash);
+}
+
 /**
  * Destroys a picture allocated with picture_NewFromFormat().
  */
@@ -68,7 +192,7 @@ static void picture_DestroyFromFormat(picture_t *pic)
     picture_buffer_t *res = pic->p_sys;
 
     if (res != NULL)
-        picture_Deallocate(res->fd, res->base, res->size);
+        picture_cache_Put(res->fd, res->base, res->size);
 }
 
 VLC_WEAK void *picture_Allocate(int *restrict fdp, size_t size)
@@ -299,7 +423,7 @@ picture_t *picture_NewFromFormat(const video_format_t *restrict fmt)
     if (unlikely(pic_size >= PICTURE_SW_SIZE_MAX))
         goto error;
 
-    unsigned char *buf = picture_Allocate(&res->fd, pic_size);
+    unsigned char *buf = picture_cache_Get(&res->fd, pic_size);
     if (unlikely(buf == NULL))
         goto error;
 
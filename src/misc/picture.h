@@ -31,9 +31,22 @@ typedef struct
         void (*destroy)(picture_t *);
         void *opaque;
     } gc;
+    vlc_tick_t queued; /**< Date of queuing to the video output (statistics) */
 } picture_priv_t;
 
 void *picture_Allocate(int *, size_t);
 void picture_Deallocate(int, void *, size_t);
 
+/** Whether picture_Allocate() should try explicit huge pages */
+extern atomic_bool picture_huge_pages;
+
+/**
+ * Sets up the process-wide picture buffer allocator.
+ *
+ * @param cache_size maximum total size of released picture buffers kept for
+ *                   reuse [bytes] (0 disables the cache)
+ * @param huge_pages whether to back large buffers with explicit huge pages
+ */
+void picture_AllocatorSetup(size_t cache_size, bool huge_pages);
+
 picture_t * picture_InternalClone(picture_t *, void (*pf_destroy)(picture_t *), void *);
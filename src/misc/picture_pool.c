@@ -34,19 +34,23 @@
 #include <vlc_picture_pool.h>
 #include "picture.h"
 
-#define POOL_MAX (CHAR_BIT * sizeof (unsigned long long))
+#define POOL_WORD_BITS (CHAR_BIT * sizeof (unsigned long long))
 
-static_assert ((POOL_MAX & (POOL_MAX - 1)) == 0, "Not a power of two");
+struct picture_pool_slot {
+    picture_pool_t *pool;
+    picture_t      *picture;
+};
 
 struct picture_pool_t {
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
     bool               canceled;
-    unsigned long long available;
-    atomic_ushort      refs;
-    unsigned short     picture_count;
-    picture_t  *picture[];
+    unsigned           available_count;
+    atomic_uint        refs;
+    unsigned           picture_count;
+    struct picture_pool_slot *slot;
+    unsigned long long available[]; /**< bit map of the free pictures */
 };
 
 static void picture_pool_Destroy(picture_pool_t *pool)
@@ -55,67 +59,97 @@ static void picture_pool_Destroy(picture_pool_t *pool)
         return;
 
     atomic_thread_fence(memory_order_acquire);
-    aligned_free(pool);
+    free(pool);
 }
 
 void picture_pool_Release(picture_pool_t *pool)
 {
     for (unsigned i = 0; i < pool->picture_count; i++)
-        picture_Release(pool->picture[i]);
+        picture_Release(pool->slot[i].picture);
     picture_pool_Destroy(pool);
 }
 
 static void picture_pool_ReleasePicture(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
-    uintptr_t sys = (uintptr_t)priv->gc.opaque;
-    picture_pool_t *pool = (void *)(sys & ~(POOL_MAX - 1));
-    unsigned offset = sys & (POOL_MAX - 1);
-    picture_t *picture = pool->picture[offset];
+    struct picture_pool_slot *slot = priv->gc.opaque;
+    picture_pool_t *pool = slot->pool;
+    unsigned offset = slot - pool->slot;
+    unsigned long long bit = 1ULL << (offset % POOL_WORD_BITS);
 
-    picture_Release(picture);
+    picture_Release(slot->picture);
 
     vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
+    assert(!(pool->available[offset / POOL_WORD_BITS] & bit));
+    pool->available[offset / POOL_WORD_BITS] |= bit;
+    pool->available_count++;
     vlc_cond_signal(&pool->wait);
     vlc_mutex_unlock(&pool->lock);
 
     picture_pool_Destroy(pool);
 }
 
+/* Must be called with the lock held, and with a free picture */
+static unsigned picture_pool_Take(picture_pool_t *pool)
+{
+    unsigned long long *word = pool->available;
+
+    assert(pool->available_count > 0);
+    while (*word == 0)
+        word++;
+
+    unsigned i = ctz(*word);
+
+    *word &= ~(1ULL << i);
+    pool->available_count--;
+    return (word - pool->available) * POOL_WORD_BITS + i;
+}
+
 static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
                                             unsigned offset)
 {
-    picture_t *picture = pool->picture[offset];
-    uintptr_t sys = ((uintptr_t)pool) + offset;
-
-    return picture_InternalClone(picture, picture_pool_ReleasePicture,
-                                 (void*)sys);
+    struct picture_pool_slot *slot = &pool->slot[offset];
+    picture_t *clone = picture_InternalClone(slot->picture,
+                                             picture_pool_ReleasePicture,
+                                             slot);
+    if (clone != NULL) {
+        assert(clone->p_next == NULL);
+        atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
+    }
+    return clone;
 }
 
 picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
 {
-    if (unlikely(count > POOL_MAX))
-        return NULL;
-
+    const unsigned words = (count + POOL_WORD_BITS - 1) / POOL_WORD_BITS;
     picture_pool_t *pool;
-    size_t size = sizeof (*pool) + count * sizeof (picture_t *);
+    size_t size;
 
-    size += (-size) & (POOL_MAX - 1);
-    pool = aligned_alloc(POOL_MAX, size);
+    /* The reference count includes one reference per picture */
+    if (unlikely(count >= UINT_MAX)
+     || mul_overflow(count, sizeof (*pool->slot), &size)
+     || add_overflow(size, sizeof (*pool)
+                           + words * sizeof (*pool->available), &size))
+        return NULL;
+
+    pool = malloc(size);
     if (unlikely(pool == NULL))
         return NULL;
 
     vlc_mutex_init(&pool->lock);
     vlc_cond_init(&pool->wait);
-    if (count == POOL_MAX)
-        pool->available = ~0ULL;
-    else
-        pool->available = (1ULL << count) - 1;
+    pool->slot = (struct picture_pool_slot *)&pool->available[words];
+    for (unsigned i = 0; i < words; i++)
+        pool->available[i] = ~0ULL;
+    if (count % POOL_WORD_BITS)
+        pool->available[words - 1] = (1ULL << (count % POOL_WORD_BITS)) - 1;
+    pool->available_count = count;
     atomic_init(&pool->refs,  1);
     pool->picture_count = count;
-    memcpy(pool->picture, tab, count * sizeof (picture_t *));
+    for (unsigned i = 0; i < count; i++) {
+        pool->slot[i].pool = pool;
+        pool->slot[i].picture = tab[i];
+    }
     pool->canceled = false;
     return pool;
 }
@@ -169,41 +203,27 @@ error:
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    unsigned long long available;
-
     vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
-    available = pool->available;
+    assert(atomic_load_explicit(&pool->refs, memory_order_relaxed) > 0);
 
-    while (available != 0)
+    if (pool->available_count == 0 || unlikely(pool->canceled))
     {
-        int i = ctz(available);
-
-        if (unlikely(pool->canceled))
-            break;
-
-        pool->available &= ~(1ULL << i);
         vlc_mutex_unlock(&pool->lock);
-        available &= ~(1ULL << i);
-
-        picture_t *clone = picture_pool_ClonePicture(pool, i);
-        if (clone != NULL) {
-            assert(clone->p_next == NULL);
-            atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
-        }
-        return clone;
+        return NULL;
     }
 
+    unsigned i = picture_pool_Take(pool);
     vlc_mutex_unlock(&pool->lock);
-    return NULL;
+
+    return picture_pool_ClonePicture(pool, i);
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
     vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load_explicit(&pool->refs, memory_order_relaxed) > 0);
 
-    while (pool->available == 0)
+    while (pool->available_count == 0)
     {
         if (pool->canceled)
         {
@@ -213,22 +233,16 @@ picture_t *picture_pool_Wait(picture_pool_t *pool)
         vlc_cond_wait(&pool->wait, &pool->lock);
     }
 
-    int i = ctz(pool->available);
-    pool->available &= ~(1ULL << i);
+    unsigned i = picture_pool_Take(pool);
     vlc_mutex_unlock(&pool->lock);
 
-    picture_t *clone = picture_pool_ClonePicture(pool, i);
-    if (clone != NULL) {
-        assert(clone->p_next == NULL);
-        atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
-    }
-    return clone;
+    return picture_pool_ClonePicture(pool, i);
 }
 
 void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
 {
     vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load_explicit(&pool->refs, memory_order_relaxed) > 0);
 
     pool->canceled = canceled;
     if (canceled)
@@ -191,6 +191,8 @@ subpicture_region_private_t *subpicture_region_private_New( video_format_t *p_fm
     }
 
     p_private->p_picture = NULL;
+    p_private->p_source = NULL;
+    video_format_Init( &p_private->source_fmt, 0 );
     return p_private;
 }
 
@@ -198,6 +200,9 @@ void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
 {
     if( p_private->p_picture )
         picture_Release( p_private->p_picture );
+    if( p_private->p_source )
+        picture_Release( p_private->p_source );
+    video_format_Clean( &p_private->source_fmt );
     video_format_Clean( &p_private->fmt );
     free( p_private );
 }
@@ -23,6 +23,10 @@
 struct subpicture_region_private_t {
     video_format_t fmt;
     picture_t      *p_picture;
+
+    /* Source the cached picture was converted from */
+    picture_t      *p_source;
+    video_format_t source_fmt;
 };
 
 subpicture_region_t * subpicture_region_NewInternal( const video_format_t *p_fmt );
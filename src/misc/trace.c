@@ -0,0 +1,249 @@
+/*****************************************************************************
+ * trace.c: timeline tracing of the playback pipeline
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+
+#include "libvlc.h"
+#include "trace.h"
+
+#define TRACE_CHUNK_EVENTS 4096
+#define TRACE_MAX_CHUNKS   256 /* about 32 MiB in total */
+
+struct trace_event
+{
+    vlc_tick_t ts;
+    const char *name;
+    int64_t value;
+    char phase;
+};
+
+/* Each chunk is written by a single thread, and read once it is detached */
+struct trace_chunk
+{
+    struct trace_chunk *next;
+    unsigned long tid;
+    size_t count;
+    struct trace_event events[TRACE_CHUNK_EVENTS];
+};
+
+atomic_bool vlc_tracer_enabled = false;
+
+static vlc_mutex_t trace_lock = VLC_STATIC_MUTEX;
+static struct trace_chunk *trace_chunks = NULL;
+static size_t trace_chunk_count = 0;
+static libvlc_int_t *trace_owner = NULL;
+static char *trace_path = NULL;
+static atomic_uint trace_generation = 0;
+static atomic_size_t trace_dropped = 0;
+/* Threads between their check of the generation and the end of their
+ * append: the chunks must not be freed until they are done */
+static atomic_uint trace_writers = 0;
+/* Number of vlc_tracer_Deinit() calls waiting for the writers */
+static atomic_uint trace_draining = 0;
+
+static thread_local struct trace_chunk *trace_current = NULL;
+static thread_local unsigned trace_current_generation = 0;
+
+static struct trace_chunk *vlc_tracer_NewChunk(unsigned generation)
+{
+    struct trace_chunk *chunk = NULL;
+
+    vlc_mutex_lock(&trace_lock);
+    /* Do not hand out chunks from a trace that was already written */
+    if (trace_owner != NULL && trace_chunk_count < TRACE_MAX_CHUNKS
+     && atomic_load_explicit(&trace_generation,
+                             memory_order_relaxed) == generation)
+    {
+        chunk = malloc(sizeof (*chunk));
+        if (likely(chunk != NULL))
+        {
+            chunk->tid = vlc_thread_id();
+            chunk->count = 0;
+            chunk->next = trace_chunks;
+            trace_chunks = chunk;
+            trace_chunk_count++;
+        }
+    }
+    vlc_mutex_unlock(&trace_lock);
+    return chunk;
+}
+
+void vlc_tracer_Event(char phase, const char *name, int64_t value)
+{
+    vlc_tick_t now = vlc_tick_now();
+
+    /* Sequentially consistent with vlc_tracer_Deinit(): either it sees this
+     * writer and waits for it, or this writer sees the new generation and
+     * does not touch its detached chunk. */
+    atomic_fetch_add(&trace_writers, 1);
+
+    unsigned generation = atomic_load(&trace_generation);
+    struct trace_chunk *chunk = trace_current;
+
+    if (chunk == NULL || trace_current_generation != generation
+     || chunk->count == TRACE_CHUNK_EVENTS)
+    {
+        trace_current = chunk = vlc_tracer_NewChunk(generation);
+        trace_current_generation = generation;
+        if (chunk == NULL)
+        {
+            atomic_fetch_add_explicit(&trace_dropped, 1,
+                                      memory_order_relaxed);
+            goto out;
+        }
+    }
+
+    struct trace_event *ev = &chunk->events[chunk->count++];
+
+    ev->ts = now;
+    ev->name = name;
+    ev->value = value;
+    ev->phase = phase;
+out:
+    if (atomic_fetch_sub(&trace_writers, 1) == 1
+     && unlikely(atomic_load(&trace_draining) != 0))
+        vlc_atomic_notify_all(&trace_writers);
+}
+
+void vlc_tracer_Init(libvlc_int_t *vlc)
+{
+    char *path = var_InheritString(vlc, "trace-file");
+    if (path == NULL)
+        return;
+
+    vlc_mutex_lock(&trace_lock);
+    if (trace_owner == NULL)
+    {
+        trace_owner = vlc;
+        trace_path = path;
+        path = NULL;
+        atomic_store_explicit(&trace_dropped, 0, memory_order_relaxed);
+        atomic_store(&vlc_tracer_enabled, true);
+    }
+    vlc_mutex_unlock(&trace_lock);
+
+    if (path != NULL)
+    {
+        msg_Warn(vlc, "tracing already enabled by another instance");
+        free(path);
+    }
+    else
+        msg_Dbg(vlc, "tracing to %s", trace_path);
+}
+
+static int vlc_tracer_Write(FILE *stream, const struct trace_chunk *chunks)
+{
+    const char *sep = "\n";
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", stream);
+
+    for (const struct trace_chunk *chunk = chunks; chunk != NULL;
+         chunk = chunk->next)
+        for (size_t i = 0; i < chunk->count; i++)
+        {
+            const struct trace_event *ev = &chunk->events[i];
+
+            fprintf(stream, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,"
+                    "\"tid\":%lu,\"ts\":%"PRId64, sep, ev->name, ev->phase,
+                    chunk->tid, US_FROM_VLC_TICK(ev->ts));
+            if (ev->phase == 'C')
+                fprintf(stream, ",\"args\":{\"value\":%"PRId64"}",
+                        ev->value);
+            else if (ev->phase == 'B' && ev->value != VLC_TICK_INVALID)
+                fprintf(stream, ",\"args\":{\"picture\":%"PRId64"}",
+                        US_FROM_VLC_TICK(ev->value));
+            fputc('}', stream);
+            sep = ",\n";
+        }
+
+    fputs("\n]}\n", stream);
+    return ferror(stream) ? -1 : 0;
+}
+
+void vlc_tracer_Deinit(libvlc_int_t *vlc)
+{
+    vlc_mutex_lock(&trace_lock);
+    if (trace_owner != vlc)
+    {
+        vlc_mutex_unlock(&trace_lock);
+        return;
+    }
+
+    atomic_store(&vlc_tracer_enabled, false);
+    /* Invalidate the per-thread chunk pointers */
+    atomic_fetch_add(&trace_generation, 1);
+
+    struct trace_chunk *chunks = trace_chunks;
+    char *path = trace_path;
+
+    trace_chunks = NULL;
+    trace_chunk_count = 0;
+    trace_owner = NULL;
+    trace_path = NULL;
+    vlc_mutex_unlock(&trace_lock);
+
+    /* Threads of other instances may still be appending to the chunks */
+    unsigned writers;
+
+    atomic_fetch_add(&trace_draining, 1);
+    while ((writers = atomic_load(&trace_writers)) != 0)
+        vlc_atomic_wait(&trace_writers, writers);
+    atomic_fetch_sub(&trace_draining, 1);
+
+    size_t dropped = atomic_load_explicit(&trace_dropped,
+                                          memory_order_relaxed);
+    if (dropped > 0)
+        msg_Warn(vlc, "%zu trace event(s) dropped", dropped);
+
+    FILE *stream = vlc_fopen(path, "wt");
+    if (stream != NULL)
+    {
+        int val = vlc_tracer_Write(stream, chunks);
+
+        if (fclose(stream))
+            val = -1;
+        if (val)
+            msg_Err(vlc, "cannot write trace file %s", path);
+        else
+            msg_Dbg(vlc, "trace written to %s", path);
+    }
+    else
+        msg_Err(vlc, "cannot create trace file %s: %s", path,
+                vlc_strerror_c(errno));
+
+    while (chunks != NULL)
+    {
+        struct trace_chunk *next = chunks->next;
+
+        free(chunks);
+        chunks = next;
+    }
+    free(path);
+}
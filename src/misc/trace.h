@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * trace.h: timeline tracing of the playback pipeline
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_TRACE_H
+# define LIBVLC_TRACE_H 1
+
+# include <stdatomic.h>
+
+/**
+ * \defgroup tracer Pipeline tracer
+ * \ingroup misc
+ *
+ * Records timestamped events into per-thread buffers, and writes them out in
+ * the Chrome trace event JSON format (readable by chrome://tracing and
+ * Perfetto) when the instance that enabled tracing is destroyed.
+ *
+ * Tracing is process-wide, and enabled by the "trace-file" option. When it is
+ * disabled, each trace point costs one relaxed atomic load.
+ *
+ * Event names must be string literals: they are stored by reference and
+ * written out without escaping.
+ * @{
+ */
+
+extern atomic_bool vlc_tracer_enabled;
+
+void vlc_tracer_Event(char phase, const char *name, int64_t value);
+
+/**
+ * Opens a duration event on the calling thread.
+ *
+ * Must be matched by vlc_tracer_End() with the same name on the same thread.
+ */
+static inline void vlc_tracer_Begin(const char *name)
+{
+    if (unlikely(atomic_load_explicit(&vlc_tracer_enabled,
+                                      memory_order_relaxed)))
+        vlc_tracer_Event('B', name, VLC_TICK_INVALID);
+}
+
+/**
+ * Opens a duration event processing a picture or an audio buffer.
+ *
+ * The date is written as the "picture" argument of the event, so that the
+ * stages of the pipeline can be correlated for each picture. It is the
+ * stream timestamp of the picture, as in picture_t.date.
+ */
+static inline void vlc_tracer_BeginPicture(const char *name, vlc_tick_t date)
+{
+    if (unlikely(atomic_load_explicit(&vlc_tracer_enabled,
+                                      memory_order_relaxed)))
+        vlc_tracer_Event('B', name, date);
+}
+
+/**
+ * Closes the innermost duration event of the calling thread.
+ */
+static inline void vlc_tracer_End(const char *name)
+{
+    if (unlikely(atomic_load_explicit(&vlc_tracer_enabled,
+                                      memory_order_relaxed)))
+        vlc_tracer_Event('E', name, 0);
+}
+
+/**
+ * Records the value of a counter.
+ */
+static inline void vlc_tracer_Counter(const char *name, int64_t value)
+{
+    if (unlikely(atomic_load_explicit(&vlc_tracer_enabled,
+                                      memory_order_relaxed)))
+        vlc_tracer_Event('C', name, value);
+}
+
+/**
+ * Starts tracing if the "trace-file" option is set and no other instance is
+ * tracing already.
+ */
+void vlc_tracer_Init(libvlc_int_t *);
+
+/**
+ * Stops tracing and writes the trace file, if this instance started tracing.
+ *
+ * All threads of the instance must have been joined. The threads of other
+ * instances still appending an event are waited for.
+ */
+void vlc_tracer_Deinit(libvlc_int_t *);
+
+/** @} */
+
+#endif
@@ -27,9 +27,6 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <float.h>
 #include <math.h>
@@ -67,7 +64,8 @@ typedef struct variable_ops_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    const char * psz_name; /**< The variable unique name */
+    uint32_t     i_hash;   /**< Hash of the name */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -96,6 +94,8 @@ struct variable_t
     callback_entry_t    *value_callbacks;
     /** Registered list callbacks */
     callback_entry_t    *list_callbacks;
+
+    char         name[]; /**< Storage for psz_name */
 };
 
 static int CmpBool( vlc_value_t v, vlc_value_t w )
@@ -136,23 +136,113 @@ int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
 string_ops = { CmpString,  DupString, FreeString, },
 coords_ops = { NULL,       DupDummy,  FreeDummy,  };
 
-static int varcmp( const void *a, const void *b )
+/* FNV-1a */
+static uint32_t VarHash( const char *psz_name )
+{
+    uint32_t h = 2166136261u;
+
+    for( const unsigned char *p = (const unsigned char *)psz_name; *p; p++ )
+        h = (h ^ *p) * 16777619u;
+    return h;
+}
+
+/**
+ * Finds the slot of a variable, or the empty slot where it would be inserted.
+ * The table must be allocated; it is never more than half full, so the probe
+ * sequence always ends.
+ */
+static size_t FindSlot( const vlc_object_internals_t *priv,
+                        const char *psz_name, uint32_t hash )
 {
-    const variable_t *va = a, *vb = b;
+    size_t i = hash & priv->var_mask;
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+    for( ;; )
+    {
+        const variable_t *var = priv->var_table[i];
+
+        if( var == NULL
+         || (var->i_hash == hash && strcmp( var->psz_name, psz_name ) == 0) )
+            return i;
+        i = (i + 1) & priv->var_mask;
+    }
+}
+
+static variable_t *LookupLocked( vlc_object_internals_t *priv,
+                                 const char *psz_name, uint32_t hash )
+{
+    if( priv->var_table == NULL )
+        return NULL;
+    return priv->var_table[FindSlot( priv, psz_name, hash )];
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    void **pp_var;
+    uint32_t hash = VarHash( psz_name );
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    return LookupLocked( priv, psz_name, hash );
+}
+
+/**
+ * Makes room for one more variable, keeping the load factor at most 1/2.
+ */
+static int Reserve( vlc_object_internals_t *priv )
+{
+    size_t size = priv->var_table != NULL ? priv->var_mask + 1 : 0;
+
+    if( (priv->var_count + 1) * 2 <= size )
+        return VLC_SUCCESS;
+
+    size_t newsize = size ? size * 2 : 16;
+    variable_t **table = calloc( newsize, sizeof (*table) );
+    if( unlikely(table == NULL) )
+        return VLC_ENOMEM;
+
+    for( size_t i = 0; i < size; i++ )
+    {
+        variable_t *var = priv->var_table[i];
+        if( var == NULL )
+            continue;
+
+        size_t j = var->i_hash & (newsize - 1);
+        while( table[j] != NULL )
+            j = (j + 1) & (newsize - 1);
+        table[j] = var;
+    }
+
+    free( priv->var_table );
+    priv->var_table = table;
+    priv->var_mask = newsize - 1;
+    return VLC_SUCCESS;
+}
+
+/**
+ * Removes a variable from the table, shifting back the entries of its probe
+ * sequence so that no tombstone is needed.
+ */
+static void Remove( vlc_object_internals_t *priv, const variable_t *var )
+{
+    const size_t mask = priv->var_mask;
+    size_t i = FindSlot( priv, var->psz_name, var->i_hash );
+
+    assert( priv->var_table[i] == var );
+    priv->var_table[i] = NULL;
+    priv->var_count--;
+
+    for( size_t j = (i + 1) & mask; priv->var_table[j] != NULL;
+         j = (j + 1) & mask )
+    {
+        size_t home = priv->var_table[j]->i_hash & mask;
+
+        /* Move the entry back if its home slot is not within (i, j] */
+        if( ((j - home) & mask) >= ((j - i) & mask) )
+        {
+            priv->var_table[i] = priv->var_table[j];
+            priv->var_table[j] = NULL;
+            i = j;
+        }
+    }
 }
 
 static void Destroy( variable_t *p_var )
@@ -167,7 +257,6 @@ static void Destroy( variable_t *p_var )
     free(p_var->choices);
     free(p_var->choices_text);
 
-    free( p_var->psz_name );
     free( p_var->psz_text );
     while (unlikely(p_var->value_callbacks != NULL))
     {
@@ -290,11 +379,14 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
 {
     assert( p_this );
 
-    variable_t *p_var = calloc( 1, sizeof( *p_var ) );
+    size_t namelen = strlen( psz_name ) + 1;
+    variable_t *p_var = calloc( 1, sizeof( *p_var ) + namelen );
     if( p_var == NULL )
         return VLC_ENOMEM;
 
-    p_var->psz_name = strdup( psz_name );
+    memcpy( p_var->name, psz_name, namelen );
+    p_var->psz_name = p_var->name;
+    p_var->i_hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -352,23 +444,30 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    void **pp_var;
-    variable_t *p_oldvar;
-    int ret = VLC_SUCCESS;
+    variable_t **pp_var, *p_oldvar;
+    int ret;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
+    ret = Reserve( p_priv );
+    if( unlikely(ret != VLC_SUCCESS) )
+        goto out;
+
+    pp_var = &p_priv->var_table[FindSlot( p_priv, p_var->psz_name,
+                                          p_var->i_hash )];
+    if( (p_oldvar = *pp_var) == NULL ) /* Variable create */
+    {
+        *pp_var = p_var;
+        p_priv->var_count++;
         p_var = NULL; /* Variable created */
+    }
     else /* Variable already exists */
     {
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
         p_oldvar->i_usage++;
         p_oldvar->i_type |= i_type & VLC_VAR_ISCOMMAND;
     }
+out:
     vlc_mutex_unlock( &p_priv->var_lock );
 
     /* If we did not need to create a new variable, free everything... */
@@ -392,7 +491,7 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     else if( --p_var->i_usage == 0 )
     {
         assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        Remove( p_priv, p_var );
     }
     else
     {
@@ -405,17 +504,19 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
         Destroy( p_var );
 }
 
-static void CleanupVar( void *var )
-{
-    Destroy( var );
-}
-
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    if( priv->var_table != NULL )
+        for( size_t i = 0; i <= priv->var_mask; i++ )
+            if( priv->var_table[i] != NULL )
+                Destroy( priv->var_table[i] );
+
+    free( priv->var_table );
+    priv->var_table = NULL;
+    priv->var_mask = 0;
+    priv->var_count = 0;
 }
 
 int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
@@ -721,8 +822,8 @@ int (var_Set)(vlc_object_t *p_this, const char *psz_name, vlc_value_t val)
     return var_SetChecked( p_this, psz_name, 0, val );
 }
 
-int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
-                     int expected_type, vlc_value_t *p_val)
+static int GetChecked(vlc_object_t *p_this, const char *psz_name,
+                      uint32_t hash, int expected_type, vlc_value_t *p_val)
 {
     assert( p_this );
 
@@ -730,7 +831,8 @@ int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
     variable_t *p_var;
     int err = VLC_SUCCESS;
 
-    p_var = Lookup( p_this, psz_name );
+    vlc_mutex_lock( &p_priv->var_lock );
+    p_var = LookupLocked( p_priv, psz_name, hash );
     if( p_var != NULL )
     {
         assert( expected_type == 0 ||
@@ -750,6 +852,13 @@ int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
     return err;
 }
 
+int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
+                     int expected_type, vlc_value_t *p_val)
+{
+    return GetChecked( p_this, psz_name, VarHash( psz_name ), expected_type,
+                       p_val );
+}
+
 int (var_Get)(vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val)
 {
     return var_GetChecked( p_this, psz_name, 0, p_val );
@@ -1037,10 +1146,12 @@ int (var_LocationParse)(vlc_object_t *obj, const char *mrl, const char *pref)
 int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
                  vlc_value_t *p_val )
 {
+    const uint32_t hash = VarHash( psz_name );
+
     i_type &= VLC_VAR_CLASS;
     for (vlc_object_t *obj = p_this; obj != NULL; obj = vlc_object_parent(obj))
     {
-        if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
+        if( GetChecked( obj, psz_name, hash, i_type, p_val ) == VLC_SUCCESS )
             return VLC_SUCCESS;
     }
 
@@ -1135,19 +1246,9 @@ error:
     return VLC_EGENERIC;
 }
 
-static thread_local void *twalk_ctx;
-
-static void TwalkGetNames(const void *data, const VISIT which, const int depth)
+static int NameCmp(const void *a, const void *b)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *var = *(const variable_t **)data;
-    DECL_ARRAY(char *) *names = twalk_ctx;
-    char *dup = strdup(var->psz_name);
-    if (dup != NULL)
-        ARRAY_APPEND(*names, dup);
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
 }
 
 char **var_GetAllNames(vlc_object_t *obj)
@@ -1157,13 +1258,23 @@ char **var_GetAllNames(vlc_object_t *obj)
     DECL_ARRAY(char *) names;
     ARRAY_INIT(names);
 
-    twalk_ctx = &names;
     vlc_mutex_lock(&priv->var_lock);
-    twalk(priv->var_root, TwalkGetNames);
+    if (priv->var_table != NULL)
+        for (size_t i = 0; i <= priv->var_mask; i++)
+        {
+            const variable_t *var = priv->var_table[i];
+            if (var == NULL)
+                continue;
+
+            char *dup = strdup(var->psz_name);
+            if (dup != NULL)
+                ARRAY_APPEND(names, dup);
+        }
     vlc_mutex_unlock(&priv->var_lock);
 
     if (names.i_size == 0)
         return NULL;
+    qsort(names.p_elems, names.i_size, sizeof (char *), NameCmp);
     ARRAY_APPEND(names, NULL);
     return names.p_elems;
 }
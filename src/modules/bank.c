@@ -45,6 +45,8 @@
 #include <vlc_modules.h>
 #include <vlc_fs.h>
 #include <vlc_block.h>
+#include <vlc_cpu.h>
+#include <vlc_vector.h>
 #include "libvlc.h"
 #include "config/configuration.h"
 #include "modules/modules.h"
@@ -284,6 +286,16 @@ typedef enum
     CACHE_WRITE_FILE = 0x4,
 } cache_mode_t;
 
+/** Plug-in file found by the directory scan */
+struct plugin_file
+{
+    char *abspath;
+    char *relpath;
+    int64_t mtime;
+    uint64_t size;
+    vlc_plugin_t *plugin; /**< Cached or loaded plug-in, NULL if none */
+};
+
 typedef struct module_bank
 {
     vlc_object_t *obj;
@@ -293,64 +305,166 @@ typedef struct module_bank
     size_t        size;
     vlc_plugin_t **plugins;
     vlc_plugin_t *cache;
+
+    struct VLC_VECTOR(struct plugin_file) files; /**< In scan order */
+    size_t        pending; /**< Files not in the cache */
 } module_bank_t;
 
 /**
  * Scans a plug-in from a file.
+ *
+ * The plug-in is looked up in the cache. If it is not there, it is queued
+ * to be loaded by LoadPluginFiles().
  */
 static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
                                const char *relpath, const struct stat *st)
 {
-    vlc_plugin_t *plugin = NULL;
+    struct plugin_file file =
+    {
+        .abspath = strdup(abspath),
+        .relpath = strdup(relpath),
+        .mtime = st->st_mtime,
+        .size = st->st_size,
+        .plugin = NULL,
+    };
+
+    if (unlikely(file.abspath == NULL || file.relpath == NULL))
+        goto error;
 
     /* Check our plugins cache first then load plugin if needed */
     if (bank->mode & CACHE_READ_FILE)
     {
-        plugin = vlc_cache_lookup(&bank->cache, relpath);
+        vlc_plugin_t *plugin = vlc_cache_lookup(&bank->cache, relpath);
 
         if (plugin != NULL
-         && (plugin->mtime != (int64_t)st->st_mtime
-          || plugin->size != (uint64_t)st->st_size))
+         && (plugin->mtime != file.mtime || plugin->size != file.size))
         {
             msg_Err(bank->obj, "stale plugins cache: modified %s",
                     plugin->abspath);
             vlc_plugin_destroy(plugin);
             plugin = NULL;
         }
+        file.plugin = plugin;
     }
 
-    if (plugin == NULL)
+    if (!vlc_vector_push(&bank->files, file))
     {
-        char *path = strdup(relpath);
-        if (path == NULL)
-            return -1;
+        if (file.plugin != NULL)
+            vlc_plugin_destroy(file.plugin);
+        goto error;
+    }
+
+    if (file.plugin == NULL)
+        bank->pending++;
+    return 0;
+error:
+    free(file.relpath);
+    free(file.abspath);
+    return -1;
+}
 
-        plugin = module_InitDynamic(bank->obj, abspath, true);
+/** Maximum number of threads loading plug-ins */
+#define LOAD_MAX_THREADS 16
 
-        if (plugin != NULL)
-        {
-            plugin->path = path;
-            plugin->mtime = st->st_mtime;
-            plugin->size = st->st_size;
-        }
-        else free(path);
+struct plugin_loader
+{
+    module_bank_t *bank;
+    atomic_size_t next;
+};
+
+static void *LoadPluginThread(void *data)
+{
+    struct plugin_loader *loader = data;
+    module_bank_t *bank = loader->bank;
+
+    for (;;)
+    {
+        size_t i = atomic_fetch_add_explicit(&loader->next, 1,
+                                             memory_order_relaxed);
+        if (i >= bank->files.size)
+            break;
+
+        struct plugin_file *file = &bank->files.data[i];
+        if (file->plugin != NULL)
+            continue; /* found in the cache */
+
+        vlc_plugin_t *plugin = module_InitDynamic(bank->obj, file->abspath,
+                                                  true);
+        if (plugin == NULL)
+            continue;
+
+        /* The relative path moves into the plug-in */
+        plugin->path = file->relpath;
+        plugin->mtime = file->mtime;
+        plugin->size = file->size;
+        file->relpath = NULL;
+        file->plugin = plugin;
     }
+    return NULL;
+}
 
-    if (plugin == NULL)
-        return -1;
+/**
+ * Loads the plug-ins missing from the cache, then adds all the scanned
+ * plug-ins to the bank.
+ *
+ * Loading shared objects and running their descriptors is spread over
+ * several threads. The plug-ins are then stored in scan order, regardless of
+ * which thread loaded them first.
+ *
+ * \return the number of plug-ins that were not found in the cache
+ */
+static size_t LoadPluginFiles(module_bank_t *bank)
+{
+    struct plugin_loader loader = { .bank = bank };
+    vlc_thread_t threads[LOAD_MAX_THREADS - 1];
+    size_t nthreads = 0;
 
-    vlc_plugin_store(plugin);
+    atomic_init(&loader.next, 0);
 
-    if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
+    if (bank->pending > 0)
     {
-        bank->plugins = xrealloc(bank->plugins,
-                                 (bank->size + 1) * sizeof (vlc_plugin_t *));
-        bank->plugins[bank->size] = plugin;
-        bank->size++;
+        size_t max = vlc_GetCPUCount();
+        if (max > LOAD_MAX_THREADS)
+            max = LOAD_MAX_THREADS;
+        if (max > bank->pending)
+            max = bank->pending;
+
+        /* The calling thread is one of the loaders */
+        while (nthreads + 1 < max
+            && !vlc_clone(&threads[nthreads], LoadPluginThread, &loader,
+                          VLC_THREAD_PRIORITY_LOW))
+            nthreads++;
+
+        LoadPluginThread(&loader);
+
+        for (size_t i = 0; i < nthreads; i++)
+            vlc_join(threads[i], NULL);
     }
 
-    /* TODO: deal with errors */
-    return  0;
+    size_t loaded = 0;
+
+    /* Add entries to the to-be-saved cache */
+    bank->plugins = xrealloc(bank->plugins,
+                             (bank->size + bank->files.size)
+                             * sizeof (vlc_plugin_t *));
+
+    for (size_t i = 0; i < bank->files.size; i++)
+    {
+        struct plugin_file *file = &bank->files.data[i];
+        vlc_plugin_t *plugin = file->plugin;
+
+        if (plugin != NULL)
+        {
+            if (file->relpath == NULL) /* moved by LoadPluginThread() */
+                loaded++;
+            vlc_plugin_store(plugin);
+            bank->plugins[bank->size++] = plugin;
+        }
+        free(file->relpath);
+        free(file->abspath);
+    }
+    vlc_vector_clear(&bank->files);
+    return loaded;
 }
 
 /**
@@ -449,12 +563,24 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
     else
         msg_Dbg(bank.obj, "ignoring plugins cache file");
 
+    vlc_vector_init(&bank.files);
+
     if (mode & CACHE_SCAN_DIR)
     {
         msg_Dbg(obj, "recursively browsing `%s'", bank.base);
 
         /* Don't go deeper than 5 subdirectories */
         AllocatePluginDir(&bank, 5, path, NULL);
+
+        size_t loaded = LoadPluginFiles(&bank);
+
+        /* Regenerate a missing or stale cache, so that the next start
+         * does not need to load the plug-ins again */
+        if ((mode & CACHE_READ_FILE) && loaded > 0)
+        {
+            msg_Dbg(obj, "%zu plug-in(s) not in cache", loaded);
+            mode |= CACHE_WRITE_FILE;
+        }
     }
 
     /* Deal with unmatched cache entries from cache file */
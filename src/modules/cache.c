@@ -56,7 +56,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 36
+#define CACHE_SUBVERSION_NUM 37
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -178,7 +178,50 @@ static int vlc_cache_load_align(size_t align, block_t *file)
     if (vlc_cache_load_align(alignof(t), file)) \
         goto error
 
-static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
+/*
+ * The modules and configuration items of a cached plug-in, and their tables
+ * of pointers, are carved out of a single allocation, the size of which is
+ * stored in the cache. Strings and integer choices are used in place from
+ * the memory-mapped cache file.
+ */
+struct vlc_cache_arena
+{
+    unsigned char *base;
+    size_t size;
+    size_t used;
+};
+
+static size_t vlc_cache_arena_round(size_t size)
+{
+    const size_t align = alignof (max_align_t);
+
+    return (size + align - 1) & ~(align - 1);
+}
+
+static void *vlc_cache_arena_alloc(struct vlc_cache_arena *arena, size_t size)
+{
+    if (size == 0)
+        return NULL;
+
+    size = vlc_cache_arena_round(size);
+    if (size > arena->size - arena->used)
+        return NULL;
+
+    void *ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+#define LOAD_TABLE(a,n) \
+    do \
+    { \
+        (a) = vlc_cache_arena_alloc(arena, sizeof (*(a)) * (n)); \
+        if ((n) > 0 && (a) == NULL) \
+            goto error; \
+    } while (0)
+
+static int vlc_cache_load_config(module_config_t *cfg, block_t *file,
+                                 struct vlc_cache_arena *arena)
 {
     LOAD_IMMEDIATE (cfg->i_type);
     LOAD_IMMEDIATE (cfg->i_short);
@@ -199,14 +242,12 @@ static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
         cfg->orig.psz = (char *)psz;
         cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
 
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
+        LOAD_TABLE (cfg->list.psz, cfg->list_count);
         for (unsigned i = 0; i < cfg->list_count; i++)
         {
             LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
+            if (cfg->list.psz[i] == NULL) /* NULL -> empty string */
+                cfg->list.psz[i] = "";
         }
     }
     else
@@ -224,21 +265,21 @@ static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
         LOAD_ARRAY(cfg->list.i, cfg->list_count);
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
+    LOAD_TABLE (cfg->list_text, cfg->list_count);
     for (unsigned i = 0; i < cfg->list_count; i++)
     {
         LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
+        if (cfg->list_text[i] == NULL) /* NULL -> empty string */
+            cfg->list_text[i] = "";
     }
 
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file,
+                                        struct vlc_cache_arena *arena)
 {
     uint16_t lines;
 
@@ -246,17 +287,9 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
     LOAD_IMMEDIATE (lines);
 
     /* Allocate memory */
+    LOAD_TABLE (plugin->conf.items, lines);
     if (lines)
-    {
-        plugin->conf.items = calloc(sizeof (module_config_t), lines);
-        if (unlikely(plugin->conf.items == NULL))
-        {
-            plugin->conf.size = 0;
-            return -1;
-        }
-    }
-    else
-        plugin->conf.items = NULL;
+        memset(plugin->conf.items, 0, sizeof (module_config_t) * lines);
 
     plugin->conf.size = lines;
 
@@ -265,7 +298,7 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
     {
         module_config_t *item = plugin->conf.items + i;
 
-        if (vlc_cache_load_config(item, file))
+        if (vlc_cache_load_config(item, file, arena))
             return -1;
 
         if (CONFIG_ITEM(item->i_type))
@@ -279,14 +312,16 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
 
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file,
+                                 struct vlc_cache_arena *arena)
 {
-    module_t *module = vlc_module_create(plugin);
-    if (unlikely(module == NULL))
-        return -1;
+    module_t *module;
+
+    LOAD_TABLE(module, 1);
+    vlc_module_init(plugin, module);
 
     LOAD_STRING(module->psz_shortname);
     LOAD_STRING(module->psz_longname);
@@ -297,8 +332,7 @@ static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
         goto error;
     else
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
+        LOAD_TABLE(module->pp_shortcuts, module->i_shortcuts);
         for (unsigned j = 0; j < module->i_shortcuts; j++)
             LOAD_STRING(module->pp_shortcuts[j]);
     }
@@ -318,14 +352,29 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
+    uint32_t modules, size;
     LOAD_IMMEDIATE(modules);
+    LOAD_IMMEDIATE(size);
+
+    /* Sanity check: the arena is much smaller than the cache record */
+    if (size > file->i_buffer * 16)
+        goto error;
+
+    struct vlc_cache_arena arena = { .base = NULL, .size = size, .used = 0 };
+
+    if (size > 0)
+    {
+        arena.base = malloc(size);
+        if (unlikely(arena.base == NULL))
+            goto error;
+        plugin->arena = arena.base;
+    }
 
     for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+        if (vlc_cache_load_module(plugin, file, &arena))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
+    if (vlc_cache_load_plugin_config(plugin, file, &arena))
         goto error;
 
     LOAD_STRING(plugin->textdomain);
@@ -583,6 +632,44 @@ error:
     return -1;
 }
 
+/**
+ * Computes the size of the allocation holding the modules and configuration
+ * of a plug-in, once loaded back from the cache.
+ */
+static uint32_t CacheArenaSize(const vlc_plugin_t *plugin)
+{
+    size_t size = 0;
+
+    for (const module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+    {
+        size += vlc_cache_arena_round(sizeof (*module));
+        if (module->i_shortcuts > 0)
+            size += vlc_cache_arena_round(module->i_shortcuts
+                                          * sizeof (*module->pp_shortcuts));
+    }
+
+    if (plugin->conf.size > 0)
+        size += vlc_cache_arena_round(plugin->conf.size
+                                      * sizeof (*plugin->conf.items));
+
+    for (size_t i = 0; i < plugin->conf.size; i++)
+    {
+        const module_config_t *cfg = plugin->conf.items + i;
+
+        if (cfg->list_count == 0)
+            continue;
+        if (IsConfigStringType(cfg->i_type))
+            size += vlc_cache_arena_round(cfg->list_count
+                                          * sizeof (*cfg->list.psz));
+        size += vlc_cache_arena_round(cfg->list_count
+                                      * sizeof (*cfg->list_text));
+    }
+
+    return size;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
     uint32_t i_file_size = 0;
@@ -610,8 +697,10 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     {
         const vlc_plugin_t *plugin = cache[i];
         uint32_t count = plugin->modules_count;
+        uint32_t size = CacheArenaSize(plugin);
 
         SAVE_IMMEDIATE(count);
+        SAVE_IMMEDIATE(size);
 
         for (module_t *module = plugin->module;
              module != NULL;
@@ -663,7 +752,9 @@ void CacheSave(vlc_object_t *p_this, const char *dir,
         goto out;
     }
 
-    if (CacheSaveBank(file, entries, n))
+    /* Make sure the data hits the disk before the file is renamed, so that
+     * a crash cannot leave a truncated cache behind. */
+    if (CacheSaveBank(file, entries, n) || fsync(fileno(file)))
     {
         msg_Warn (p_this, "cannot write %s: %s", tmpname,
                   vlc_strerror_c(errno));
@@ -43,6 +43,11 @@ module_t *vlc_module_create(vlc_plugin_t *plugin)
     if (module == NULL)
         return NULL;
 
+    return vlc_module_init(plugin, module);
+}
+
+module_t *vlc_module_init(vlc_plugin_t *plugin, module_t *module)
+{
     /* NOTE XXX: For backward compatibility with preferences UIs, the first
      * module must stay first. That defines under which module, the
      * configuration items of the plugin belong. The order of the following
@@ -109,6 +114,7 @@ vlc_plugin_t *vlc_plugin_create(void)
     atomic_init(&plugin->handle, 0);
     plugin->abspath = NULL;
     plugin->path = NULL;
+    plugin->arena = NULL;
 #endif
     plugin->module = NULL;
 
@@ -127,10 +133,26 @@ void vlc_plugin_destroy(vlc_plugin_t *plugin)
     assert(!plugin->unloadable || atomic_load(&plugin->handle) == 0);
 #endif
 
-    if (plugin->module != NULL)
-        vlc_module_destroy(plugin->module);
+#ifdef HAVE_DYNAMIC_PLUGINS
+    if (plugin->arena != NULL)
+    {   /* Modules and configuration items were decoded from the cache */
+        for (size_t i = 0; i < plugin->conf.size; i++)
+        {
+            module_config_t *item = plugin->conf.items + i;
+
+            if (IsConfigStringType(item->i_type))
+                free(item->value.psz);
+        }
+        free(plugin->arena);
+    }
+    else
+#endif
+    {
+        if (plugin->module != NULL)
+            vlc_module_destroy(plugin->module);
 
-    config_Free(plugin->conf.items, plugin->conf.size);
+        config_Free(plugin->conf.items, plugin->conf.size);
+    }
 #ifdef HAVE_DYNAMIC_PLUGINS
     free(plugin->abspath);
     free(plugin->path);
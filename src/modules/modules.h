@@ -53,6 +53,7 @@ typedef struct vlc_plugin_t
     char *path; /**< Relative path (within plug-in directory) */
     int64_t mtime; /**< Last modification time */
     uint64_t size; /**< File size */
+    void *arena; /**< Modules and configuration decoded from the cache */
 #endif
 } vlc_plugin_t;
 
@@ -101,6 +102,7 @@ struct module_t
 vlc_plugin_t *vlc_plugin_create(void);
 void vlc_plugin_destroy(vlc_plugin_t *);
 module_t *vlc_module_create(vlc_plugin_t *);
+module_t *vlc_module_init(vlc_plugin_t *, module_t *);
 void vlc_module_destroy (module_t *);
 
 vlc_plugin_t *vlc_plugin_describe(vlc_plugin_cb);
@@ -29,6 +29,7 @@
 #include "notify.h"
 #include "playlist.h"
 #include "preparse.h"
+#include "sort.h"
 
 void
 vlc_playlist_ClearItems(vlc_playlist_t *playlist)
@@ -261,6 +262,107 @@ vlc_playlist_MediaToItems(vlc_playlist_t *playlist, input_item_t *const media[],
     return VLC_SUCCESS;
 }
 
+/**
+ * Move the item at index to its sorted position, in "keep sorted" mode.
+ *
+ * Return the new index of the item.
+ */
+static size_t
+vlc_playlist_MoveToSortedIndex(vlc_playlist_t *playlist, size_t index)
+{
+    assert(playlist->sort.count);
+
+    playlist_item_vector_t *items = &playlist->items;
+    vlc_playlist_item_t *item = items->data[index];
+
+    size_t target;
+    if (index > 0
+     && vlc_playlist_CompareItems(playlist, item, items->data[index - 1]) < 0)
+        target = vlc_playlist_FindSortedIndex(playlist, item, 0, index - 1);
+    else if (index + 1 < items->size
+     && vlc_playlist_CompareItems(playlist, item, items->data[index + 1]) > 0)
+        /* the item itself is removed before its insertion at the target */
+        target = vlc_playlist_FindSortedIndex(playlist, item, index + 2,
+                                              items->size) - 1;
+    else
+        /* already at the right place */
+        return index;
+
+    vlc_vector_move_slice(items, index, 1, target);
+    vlc_playlist_ItemsMoved(playlist, index, 1, target);
+    return target;
+}
+
+/**
+ * Insert items at their sorted position, in "keep sorted" mode.
+ *
+ * The new items are sorted, then inserted by contiguous ranges: all the new
+ * items which belong between the same two existing items are inserted (and
+ * notified) at once.
+ */
+static int
+vlc_playlist_InsertSorted(vlc_playlist_t *playlist,
+                          input_item_t *const media[], size_t count)
+{
+    assert(playlist->sort.count);
+
+    vlc_playlist_item_t **items = vlc_alloc(count, sizeof(*items));
+    if (unlikely(!items))
+        return VLC_ENOMEM;
+
+    int ret = vlc_playlist_MediaToItems(playlist, media, count, items);
+    if (ret != VLC_SUCCESS)
+    {
+        free(items);
+        return ret;
+    }
+
+    ret = vlc_playlist_ComputeSortKeys(playlist, items, count);
+    if (ret == VLC_SUCCESS)
+        ret = vlc_playlist_SortItemArray(playlist, items, count);
+
+    size_t i = 0;
+    size_t index = 0;
+    while (ret == VLC_SUCCESS && i < count)
+    {
+        index = vlc_playlist_FindSortedIndex(playlist, items[i], index,
+                                             playlist->items.size);
+
+        /* all the new items lower than the existing item at index belong to
+         * the same range */
+        size_t n = 1;
+        if (index < playlist->items.size)
+        {
+            vlc_playlist_item_t *next = playlist->items.data[index];
+            while (i + n < count
+                && vlc_playlist_CompareItems(playlist, items[i + n], next) < 0)
+                ++n;
+        }
+        else
+            n = count - i;
+
+        if (!vlc_vector_insert_all(&playlist->items, index, &items[i], n))
+        {
+            ret = VLC_ENOMEM;
+            break;
+        }
+
+        vlc_playlist_ItemsInserted(playlist, index, n);
+        index += n;
+        i += n;
+    }
+
+    /* release the items which have not been inserted (on error) */
+    for (size_t j = i; j < count; ++j)
+        vlc_playlist_item_Release(items[j]);
+    free(items);
+
+    if (i)
+        vlc_player_InvalidateNextMedia(playlist->player);
+
+    return ret;
+}
+
 int
 vlc_playlist_Insert(vlc_playlist_t *playlist, size_t index,
                     input_item_t *const media[], size_t count)
@@ -268,6 +370,9 @@ vlc_playlist_Insert(vlc_playlist_t *playlist, size_t index,
     vlc_playlist_AssertLocked(playlist);
     assert(index <= playlist->items.size);
 
+    if (playlist->sort.count)
+        return vlc_playlist_InsertSorted(playlist, media, count);
+
     /* make space in the vector */
     if (!vlc_vector_insert_hole(&playlist->items, index, count))
         return VLC_ENOMEM;
@@ -296,6 +401,9 @@ vlc_playlist_Move(vlc_playlist_t *playlist, size_t index, size_t count,
     assert(index + count <= playlist->items.size);
     assert(target + count <= playlist->items.size);
 
+    /* the playlist will not be sorted anymore */
+    vlc_playlist_ClearSortCriteria(playlist);
+
     vlc_vector_move_slice(&playlist->items, index, count, target);
 
     vlc_playlist_ItemsMoved(playlist, index, count, target);
@@ -335,6 +443,13 @@ vlc_playlist_Replace(vlc_playlist_t *playlist, size_t index,
     if (!item)
         return VLC_ENOMEM;
 
+    if (playlist->sort.count
+     && vlc_playlist_ComputeSortKeys(playlist, &item, 1) != VLC_SUCCESS)
+    {
+        vlc_playlist_item_Release(item);
+        return VLC_ENOMEM;
+    }
+
     if (playlist->order == VLC_PLAYLIST_PLAYBACK_ORDER_RANDOM)
     {
         randomizer_Remove(&playlist->randomizer,
@@ -358,6 +473,27 @@ vlc_playlist_Expand(vlc_playlist_t *playlist, size_t index,
 
     if (count == 0)
         vlc_playlist_RemoveOne(playlist, index);
+    else if (playlist->sort.count)
+    {
+        int ret = vlc_playlist_Replace(playlist, index, media[0]);
+        if (ret != VLC_SUCCESS)
+            return ret;
+
+        bool is_current = (ssize_t) index == playlist->current;
+        vlc_playlist_MoveToSortedIndex(playlist, index);
+
+        if (count > 1)
+        {
+            ret = vlc_playlist_InsertSorted(playlist, &media[1], count - 1);
+            if (ret != VLC_SUCCESS)
+                return ret;
+        }
+
+        if (is_current)
+            vlc_playlist_SetCurrentMedia(playlist, playlist->current);
+        else
+            vlc_player_InvalidateNextMedia(playlist->player);
+    }
     else
     {
         int ret = vlc_playlist_Replace(playlist, index, media[0]);
@@ -390,3 +526,21 @@ vlc_playlist_Expand(vlc_playlist_t *playlist, size_t index,
 
     return VLC_SUCCESS;
 }
+
+void
+vlc_playlist_UpdateSortedItem(vlc_playlist_t *playlist, size_t index)
+{
+    vlc_playlist_AssertLocked(playlist);
+    assert(index < playlist->items.size);
+
+    if (!playlist->sort.count)
+        return;
+
+    vlc_playlist_item_t *item = playlist->items.data[index];
+    if (vlc_playlist_ComputeSortKeys(playlist, &item, 1) != VLC_SUCCESS)
+        /* keep the previous keys, the item will just not move */
+        return;
+
+    vlc_playlist_MoveToSortedIndex(playlist, index);
+    vlc_player_InvalidateNextMedia(playlist->player);
+}
@@ -33,4 +33,9 @@ int
 vlc_playlist_Expand(vlc_playlist_t *playlist, size_t index,
                     input_item_t *const media[], size_t count);
 
+/* recompute the sort keys of an item whose metadata changed, and move it to
+ * its sorted position if the playlist is kept sorted */
+void
+vlc_playlist_UpdateSortedItem(vlc_playlist_t *playlist, size_t index);
+
 #endif
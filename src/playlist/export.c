@@ -31,24 +31,68 @@
 #include <vlc_fs.h>
 #include <vlc_modules.h>
 #include <vlc_url.h>
+#include "item.h"
 #include "playlist.h"
 #include "libvlc.h"
 
+/* size of the stdio buffer of the exported file */
+#define EXPORT_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Snapshot of the playlist content.
+ *
+ * The items are held, so that the export may run without the playlist lock.
+ */
 struct vlc_playlist_view
 {
-    vlc_playlist_t *playlist;
+    vlc_playlist_item_t **items;
+    size_t count;
 };
 
+static int
+vlc_playlist_view_Init(struct vlc_playlist_view *view,
+                       vlc_playlist_t *playlist)
+{
+    vlc_playlist_AssertLocked(playlist);
+
+    view->count = playlist->items.size;
+    if (!view->count)
+    {
+        view->items = NULL;
+        return VLC_SUCCESS;
+    }
+
+    view->items = vlc_alloc(view->count, sizeof(*view->items));
+    if (unlikely(!view->items))
+        return VLC_ENOMEM;
+
+    memcpy(view->items, playlist->items.data,
+           view->count * sizeof(*view->items));
+    for (size_t i = 0; i < view->count; ++i)
+        vlc_playlist_item_Hold(view->items[i]);
+
+    return VLC_SUCCESS;
+}
+
+static void
+vlc_playlist_view_Clean(struct vlc_playlist_view *view)
+{
+    for (size_t i = 0; i < view->count; ++i)
+        vlc_playlist_item_Release(view->items[i]);
+    free(view->items);
+}
+
 size_t
 vlc_playlist_view_Count(struct vlc_playlist_view *view)
 {
-    return vlc_playlist_Count(view->playlist);
+    return view->count;
 }
 
 vlc_playlist_item_t *
 vlc_playlist_view_Get(struct vlc_playlist_view *view, size_t index)
 {
-    return vlc_playlist_Get(view->playlist, index);
+    assert(index < view->count);
+    return view->items[index];
 }
 
 int
@@ -64,9 +108,19 @@ vlc_playlist_Export(struct vlc_playlist *playlist, const char *filename,
     if (!export)
         return VLC_ENOMEM;
 
-    int ret = VLC_EGENERIC;
+    struct vlc_playlist_view playlist_view;
+    int ret = vlc_playlist_view_Init(&playlist_view, playlist);
+    if (ret != VLC_SUCCESS)
+    {
+        vlc_object_delete(export);
+        return ret;
+    }
+
+    /* the export works on the snapshot, do not block the playlist (and the
+     * player) while writing */
+    vlc_playlist_Unlock(playlist);
 
-    struct vlc_playlist_view playlist_view = { .playlist = playlist };
+    ret = VLC_EGENERIC;
 
     export->playlist_view = &playlist_view;
     export->base_url = vlc_path2uri(filename, NULL);
@@ -75,16 +129,18 @@ vlc_playlist_Export(struct vlc_playlist *playlist, const char *filename,
     {
         msg_Err(export, "Could not create playlist file %s, %s",
                 filename, vlc_strerror_c(errno));
-        goto close_file;
+        goto out;
     }
 
+    setvbuf(export->file, NULL, _IOFBF, EXPORT_BUFFER_SIZE);
+
     // this will actually export
     module_t *module = module_need(export, "playlist export", type, true);
 
     if (!module)
     {
         msg_Err(export, "Could not export playlist");
-        goto out;
+        goto close_file;
     }
 
     module_unneed(export, module);
@@ -96,9 +152,18 @@ vlc_playlist_Export(struct vlc_playlist *playlist, const char *filename,
                 vlc_strerror_c(errno));
 
 close_file:
-    fclose(export->file);
+    if (fclose(export->file) && ret == VLC_SUCCESS)
+    {
+        /* the buffered data could not be flushed */
+        msg_Err(export, "Could not write playlist file: %s",
+                vlc_strerror_c(errno));
+        ret = VLC_EGENERIC;
+    }
 out:
    free(export->base_url);
    vlc_object_delete(export);
+
+   vlc_playlist_Lock(playlist);
+   vlc_playlist_view_Clean(&playlist_view);
    return ret;
 }
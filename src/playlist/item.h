@@ -31,6 +31,8 @@ struct vlc_playlist_item
     input_item_t *media;
     uint64_t id;
     vlc_atomic_rc_t rc;
+    /* cached sort keys, only set in "keep sorted" mode */
+    struct vlc_playlist_item_meta *sort_meta;
 };
 
 /* _New() is private, it is called when inserting new media in the playlist */
@@ -58,6 +58,7 @@ vlc_playlist_AddListener(vlc_playlist_t *playlist,
 
     listener->cbs = cbs;
     listener->userdata = userdata;
+    listener->async = NULL;
     vlc_list_append(&listener->node, &playlist->listeners);
 
     if (notify_current_state)
@@ -66,6 +67,9 @@ vlc_playlist_AddListener(vlc_playlist_t *playlist,
     return listener;
 }
 
+static void
+vlc_playlist_async_listener_Delete(struct vlc_playlist_async_listener *async);
+
 void
 vlc_playlist_RemoveListener(vlc_playlist_t *playlist,
                             vlc_playlist_listener_id *listener)
@@ -75,6 +79,8 @@ vlc_playlist_RemoveListener(vlc_playlist_t *playlist,
     vlc_playlist_AssertLocked(playlist); VLC_UNUSED(playlist);
 
     vlc_list_remove(&listener->node);
+    if (listener->async)
+        vlc_playlist_async_listener_Delete(listener->async);
     free(listener);
 }
 
@@ -133,3 +139,691 @@ vlc_playlist_NotifyMediaUpdated(vlc_playlist_t *playlist, input_item_t *media)
     vlc_playlist_Notify(playlist, on_items_updated, index,
                         &playlist->items.data[index], 1);
 }
+
+/* Recorded events */
+
+static inline bool
+vlc_playlist_event_HasRange(enum vlc_playlist_event_type type)
+{
+    return type <= VLC_PLAYLIST_EVENT_ITEMS_UPDATED;
+}
+
+static void
+vlc_playlist_event_Clean(struct vlc_playlist_event *event)
+{
+    if (vlc_playlist_event_HasRange(event->type) && event->range.items)
+    {
+        for (size_t i = 0; i < event->range.count; ++i)
+            vlc_playlist_item_Release(event->range.items[i]);
+        free(event->range.items);
+    }
+}
+
+static void
+vlc_playlist_event_vector_Clean(playlist_event_vector_t *events)
+{
+    for (size_t i = 0; i < events->size; ++i)
+        vlc_playlist_event_Clean(&events->data[i]);
+    vlc_vector_clear(events);
+}
+
+/**
+ * Merge a slice of items into the items of a range event.
+ *
+ * The items of the slice overwrite the existing items at the same indices.
+ */
+static bool
+vlc_playlist_event_MergeItems(struct vlc_playlist_event *last,
+                              struct vlc_playlist_event *event)
+{
+    size_t begin = __MIN(last->range.index, event->range.index);
+    size_t end = __MAX(last->range.index + last->range.count,
+                       event->range.index + event->range.count);
+
+    vlc_playlist_item_t **items = vlc_alloc(end - begin, sizeof(*items));
+    if (unlikely(!items))
+        return false;
+
+    memcpy(&items[last->range.index - begin], last->range.items,
+           last->range.count * sizeof(*items));
+    for (size_t i = 0; i < event->range.count; ++i)
+    {
+        size_t index = event->range.index - begin + i;
+        size_t last_index = event->range.index + i;
+        if (last_index >= last->range.index
+         && last_index < last->range.index + last->range.count)
+            /* overwritten by a more recent update */
+            vlc_playlist_item_Release(items[index]);
+        items[index] = event->range.items[i];
+    }
+
+    free(last->range.items);
+    free(event->range.items);
+    last->range.items = items;
+    last->range.index = begin;
+    last->range.count = end - begin;
+    return true;
+}
+
+/**
+ * Try to merge a range event into the last recorded range event.
+ *
+ * On success, the event is consumed.
+ */
+static bool
+vlc_playlist_event_Merge(struct vlc_playlist_event *last,
+                         struct vlc_playlist_event *event)
+{
+    size_t last_begin = last->range.index;
+    size_t last_end = last->range.index + last->range.count;
+
+    switch (event->type)
+    {
+        case VLC_PLAYLIST_EVENT_ITEMS_ADDED:
+        {
+            if (last->type != VLC_PLAYLIST_EVENT_ITEMS_ADDED
+             || event->range.index < last_begin
+             || event->range.index > last_end)
+                return false;
+
+            /* insertion inside (or next to) the slice previously added */
+            size_t count = last->range.count + event->range.count;
+            vlc_playlist_item_t **items =
+                vlc_reallocarray(last->range.items, count, sizeof(*items));
+            if (unlikely(!items))
+                return false;
+
+            size_t offset = event->range.index - last_begin;
+            memmove(&items[offset + event->range.count], &items[offset],
+                    (last->range.count - offset) * sizeof(*items));
+            memcpy(&items[offset], event->range.items,
+                   event->range.count * sizeof(*items));
+            free(event->range.items);
+
+            last->range.items = items;
+            last->range.count = count;
+            return true;
+        }
+        case VLC_PLAYLIST_EVENT_ITEMS_REMOVED:
+            if (last->type != VLC_PLAYLIST_EVENT_ITEMS_REMOVED)
+                return false;
+            if (event->range.index == last_begin)
+                /* the following slice has been removed */
+                last->range.count += event->range.count;
+            else if (event->range.index + event->range.count == last_begin)
+            {
+                /* the preceding slice has been removed */
+                last->range.index = event->range.index;
+                last->range.count += event->range.count;
+            }
+            else
+                return false;
+            return true;
+        case VLC_PLAYLIST_EVENT_ITEMS_UPDATED:
+            if (last->type == VLC_PLAYLIST_EVENT_ITEMS_ADDED
+             && event->range.index >= last_begin
+             && event->range.index + event->range.count <= last_end)
+            {
+                /* the added items are not notified yet: replace them by the
+                 * updated ones */
+                size_t offset = event->range.index - last_begin;
+                for (size_t i = 0; i < event->range.count; ++i)
+                {
+                    vlc_playlist_item_Release(last->range.items[offset + i]);
+                    last->range.items[offset + i] = event->range.items[i];
+                }
+                free(event->range.items);
+                return true;
+            }
+            if (last->type != VLC_PLAYLIST_EVENT_ITEMS_UPDATED
+             || event->range.index > last_end
+             || event->range.index + event->range.count < last_begin)
+                return false;
+            return vlc_playlist_event_MergeItems(last, event);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Append an event to a vector, merging it with the previous one if possible.
+ *
+ * The event is consumed in all cases. Return false if it could not be
+ * recorded.
+ */
+static bool
+vlc_playlist_event_vector_Push(playlist_event_vector_t *events,
+                               struct vlc_playlist_event *event)
+{
+    if (event->type == VLC_PLAYLIST_EVENT_ITEMS_RESET)
+    {
+        /* the previous changes of the content are superseded */
+        size_t kept = 0;
+        for (size_t i = 0; i < events->size; ++i)
+        {
+            if (vlc_playlist_event_HasRange(events->data[i].type))
+                vlc_playlist_event_Clean(&events->data[i]);
+            else
+                events->data[kept++] = events->data[i];
+        }
+        vlc_vector_remove_slice_noshrink(events, kept, events->size - kept);
+    }
+    else
+    {
+        /* the state changes (current index, has_prev...) recorded since the
+         * last change of the content are skipped: they only reflect the
+         * state after this change, so they can be kept after the merged
+         * event */
+        size_t i = events->size;
+        while (i && !vlc_playlist_event_HasRange(events->data[i - 1].type))
+        {
+            struct vlc_playlist_event *last = &events->data[i - 1];
+            if (last->type == event->type)
+            {
+                /* only the last value matters */
+                *last = *event;
+                return true;
+            }
+            --i;
+        }
+
+        if (i && vlc_playlist_event_HasRange(event->type)
+              && vlc_playlist_event_Merge(&events->data[i - 1], event))
+            return true;
+    }
+
+    if (!vlc_vector_push(events, *event))
+    {
+        vlc_playlist_event_Clean(event);
+        return false;
+    }
+    return true;
+}
+
+static void
+vlc_playlist_RecordItems(struct vlc_playlist_event_sink *sink,
+                         enum vlc_playlist_event_type type, size_t index,
+                         vlc_playlist_item_t *const items[], size_t count)
+{
+    struct vlc_playlist_event event = {
+        .type = type,
+        .range = { .index = index, .count = count },
+    };
+
+    if (count)
+    {
+        event.range.items = vlc_alloc(count, sizeof(*items));
+        if (unlikely(!event.range.items))
+        {
+            sink->overflow = true;
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            vlc_playlist_item_Hold(items[i]);
+            event.range.items[i] = items[i];
+        }
+    }
+
+    sink->push(sink, &event);
+}
+
+static void
+vlc_playlist_RecordRange(struct vlc_playlist_event_sink *sink,
+                         enum vlc_playlist_event_type type, size_t index,
+                         size_t count, size_t target)
+{
+    struct vlc_playlist_event event = {
+        .type = type,
+        .range = {
+            .items = NULL,
+            .index = index,
+            .count = count,
+            .target = target,
+        },
+    };
+    sink->push(sink, &event);
+}
+
+static void
+recorder_on_items_reset(vlc_playlist_t *playlist,
+                        vlc_playlist_item_t *const items[], size_t count,
+                        void *userdata)
+{
+    VLC_UNUSED(playlist);
+    vlc_playlist_RecordItems(userdata, VLC_PLAYLIST_EVENT_ITEMS_RESET, 0,
+                             items, count);
+}
+
+static void
+recorder_on_items_added(vlc_playlist_t *playlist, size_t index,
+                        vlc_playlist_item_t *const items[], size_t count,
+                        void *userdata)
+{
+    VLC_UNUSED(playlist);
+    vlc_playlist_RecordItems(userdata, VLC_PLAYLIST_EVENT_ITEMS_ADDED, index,
+                             items, count);
+}
+
+static void
+recorder_on_items_moved(vlc_playlist_t *playlist, size_t index, size_t count,
+                        size_t target, void *userdata)
+{
+    VLC_UNUSED(playlist);
+    vlc_playlist_RecordRange(userdata, VLC_PLAYLIST_EVENT_ITEMS_MOVED, index,
+                             count, target);
+}
+
+static void
+recorder_on_items_removed(vlc_playlist_t *playlist, size_t index,
+                          size_t count, void *userdata)
+{
+    VLC_UNUSED(playlist);
+    vlc_playlist_RecordRange(userdata, VLC_PLAYLIST_EVENT_ITEMS_REMOVED, index,
+                             count, 0);
+}
+
+static void
+recorder_on_items_updated(vlc_playlist_t *playlist, size_t index,
+                          vlc_playlist_item_t *const items[], size_t count,
+                          void *userdata)
+{
+    VLC_UNUSED(playlist);
+    vlc_playlist_RecordItems(userdata, VLC_PLAYLIST_EVENT_ITEMS_UPDATED,
+                             index, items, count);
+}
+
+static void
+recorder_on_playback_repeat_changed(vlc_playlist_t *playlist,
+                                    enum vlc_playlist_playback_repeat repeat,
+                                    void *userdata)
+{
+    VLC_UNUSED(playlist);
+    struct vlc_playlist_event_sink *sink = userdata;
+    struct vlc_playlist_event event = {
+        .type = VLC_PLAYLIST_EVENT_PLAYBACK_REPEAT_CHANGED,
+        .repeat = repeat,
+    };
+    sink->push(sink, &event);
+}
+
+static void
+recorder_on_playback_order_changed(vlc_playlist_t *playlist,
+                                   enum vlc_playlist_playback_order order,
+                                   void *userdata)
+{
+    VLC_UNUSED(playlist);
+    struct vlc_playlist_event_sink *sink = userdata;
+    struct vlc_playlist_event event = {
+        .type = VLC_PLAYLIST_EVENT_PLAYBACK_ORDER_CHANGED,
+        .order = order,
+    };
+    sink->push(sink, &event);
+}
+
+static void
+recorder_on_current_index_changed(vlc_playlist_t *playlist, ssize_t index,
+                                  void *userdata)
+{
+    VLC_UNUSED(playlist);
+    struct vlc_playlist_event_sink *sink = userdata;
+    struct vlc_playlist_event event = {
+        .type = VLC_PLAYLIST_EVENT_CURRENT_INDEX_CHANGED,
+        .current = index,
+    };
+    sink->push(sink, &event);
+}
+
+static void
+recorder_on_has_prev_changed(vlc_playlist_t *playlist, bool has_prev,
+                             void *userdata)
+{
+    VLC_UNUSED(playlist);
+    struct vlc_playlist_event_sink *sink = userdata;
+    struct vlc_playlist_event event = {
+        .type = VLC_PLAYLIST_EVENT_HAS_PREV_CHANGED,
+        .value = has_prev,
+    };
+    sink->push(sink, &event);
+}
+
+static void
+recorder_on_has_next_changed(vlc_playlist_t *playlist, bool has_next,
+                             void *userdata)
+{
+    VLC_UNUSED(playlist);
+    struct vlc_playlist_event_sink *sink = userdata;
+    struct vlc_playlist_event event = {
+        .type = VLC_PLAYLIST_EVENT_HAS_NEXT_CHANGED,
+        .value = has_next,
+    };
+    sink->push(sink, &event);
+}
+
+const struct vlc_playlist_callbacks vlc_playlist_recorder = {
+    .on_items_reset = recorder_on_items_reset,
+    .on_items_added = recorder_on_items_added,
+    .on_items_moved = recorder_on_items_moved,
+    .on_items_removed = recorder_on_items_removed,
+    .on_items_updated = recorder_on_items_updated,
+    .on_playback_repeat_changed = recorder_on_playback_repeat_changed,
+    .on_playback_order_changed = recorder_on_playback_order_changed,
+    .on_current_index_changed = recorder_on_current_index_changed,
+    .on_has_prev_changed = recorder_on_has_prev_changed,
+    .on_has_next_changed = recorder_on_has_next_changed,
+};
+
+static void
+vlc_playlist_event_PushCopy(struct vlc_playlist_event_sink *sink,
+                            const struct vlc_playlist_event *event)
+{
+    if (vlc_playlist_event_HasRange(event->type) && event->range.items)
+    {
+        /* hold the items for the copy */
+        vlc_playlist_RecordItems(sink, event->type, event->range.index,
+                                 event->range.items, event->range.count);
+        return;
+    }
+
+    struct vlc_playlist_event copy = *event;
+    sink->push(sink, &copy);
+}
+
+/* call the callback of a single listener matching a recorded event */
+static void
+vlc_playlist_event_Call(vlc_playlist_t *playlist,
+                        const struct vlc_playlist_callbacks *cbs,
+                        void *userdata, const struct vlc_playlist_event *event)
+{
+#define CALL(event, ...) \
+    if (cbs->event) \
+        cbs->event(playlist, ##__VA_ARGS__, userdata); \
+    break
+
+    switch (event->type)
+    {
+        case VLC_PLAYLIST_EVENT_ITEMS_RESET:
+            CALL(on_items_reset, event->range.items, event->range.count);
+        case VLC_PLAYLIST_EVENT_ITEMS_ADDED:
+            CALL(on_items_added, event->range.index, event->range.items,
+                 event->range.count);
+        case VLC_PLAYLIST_EVENT_ITEMS_MOVED:
+            CALL(on_items_moved, event->range.index, event->range.count,
+                 event->range.target);
+        case VLC_PLAYLIST_EVENT_ITEMS_REMOVED:
+            CALL(on_items_removed, event->range.index, event->range.count);
+        case VLC_PLAYLIST_EVENT_ITEMS_UPDATED:
+            CALL(on_items_updated, event->range.index, event->range.items,
+                 event->range.count);
+        case VLC_PLAYLIST_EVENT_PLAYBACK_REPEAT_CHANGED:
+            CALL(on_playback_repeat_changed, event->repeat);
+        case VLC_PLAYLIST_EVENT_PLAYBACK_ORDER_CHANGED:
+            CALL(on_playback_order_changed, event->order);
+        case VLC_PLAYLIST_EVENT_CURRENT_INDEX_CHANGED:
+            CALL(on_current_index_changed, event->current);
+        case VLC_PLAYLIST_EVENT_HAS_PREV_CHANGED:
+            CALL(on_has_prev_changed, event->value);
+        case VLC_PLAYLIST_EVENT_HAS_NEXT_CHANGED:
+            CALL(on_has_next_changed, event->value);
+        default:
+            vlc_assert_unreachable();
+    }
+#undef CALL
+}
+
+struct vlc_playlist_async_listener
+{
+    struct vlc_playlist_event_sink sink;
+    vlc_playlist_t *playlist;
+    vlc_playlist_listener_id *listener;
+    const struct vlc_playlist_callbacks *cbs;
+    void *userdata;
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    playlist_event_vector_t events;
+    bool resyncing; /**< the current state is being pushed */
+    /* the current state was pushed during the delivery of a transaction
+     * (protected by the playlist lock) */
+    bool resynced;
+    bool stopping;
+
+    vlc_thread_t thread;
+};
+
+/* Transactions */
+
+static void
+vlc_playlist_transaction_Push(struct vlc_playlist_event_sink *sink,
+                              struct vlc_playlist_event *event)
+{
+    struct vlc_playlist_transaction *transaction =
+        container_of(sink, struct vlc_playlist_transaction, sink);
+
+    if (!vlc_playlist_event_vector_Push(&transaction->events, event))
+        sink->overflow = true;
+}
+
+void
+vlc_playlist_transaction_Init(struct vlc_playlist_transaction *transaction)
+{
+    transaction->sink.push = vlc_playlist_transaction_Push;
+    transaction->sink.overflow = false;
+    transaction->depth = 0;
+    vlc_vector_init(&transaction->events);
+}
+
+void
+vlc_playlist_transaction_Destroy(struct vlc_playlist_transaction *transaction)
+{
+    assert(!transaction->depth);
+    assert(!transaction->events.size);
+    vlc_vector_destroy(&transaction->events);
+}
+
+void
+vlc_playlist_BeginTransaction(vlc_playlist_t *playlist)
+{
+    vlc_playlist_AssertLocked(playlist);
+    playlist->transaction.depth++;
+}
+
+void
+vlc_playlist_EndTransaction(vlc_playlist_t *playlist)
+{
+    vlc_playlist_AssertLocked(playlist);
+
+    struct vlc_playlist_transaction *transaction = &playlist->transaction;
+    assert(transaction->depth);
+    if (--transaction->depth)
+        return;
+
+    if (unlikely(transaction->sink.overflow))
+    {
+        /* some events are missing, notify the whole state instead */
+        vlc_playlist_event_vector_Clean(&transaction->events);
+        transaction->sink.overflow = false;
+
+        vlc_playlist_listener_id *listener;
+        vlc_playlist_listener_foreach(listener, playlist)
+            vlc_playlist_NotifyCurrentState(playlist, listener);
+        return;
+    }
+
+    vlc_playlist_listener_id *listener;
+    vlc_playlist_listener_foreach(listener, playlist)
+        if (listener->async)
+            listener->async->resynced = false;
+
+    for (size_t i = 0; i < transaction->events.size; ++i)
+    {
+        const struct vlc_playlist_event *event = &transaction->events.data[i];
+        vlc_playlist_listener_foreach(listener, playlist)
+        {
+            if (listener->async)
+            {
+                /* once its queue overflowed, the asynchronous listener got
+                 * the current state, which includes the remaining events */
+                if (listener->async->resynced)
+                    continue;
+                /* the asynchronous listener needs its own copy */
+                vlc_playlist_event_PushCopy(
+                        vlc_playlist_async_listener_GetSink(listener->async),
+                        event);
+            }
+            else
+                vlc_playlist_event_Call(playlist, listener->cbs,
+                                        listener->userdata, event);
+        }
+    }
+
+    vlc_playlist_event_vector_Clean(&transaction->events);
+}
+
+/* Asynchronous listeners */
+
+struct vlc_playlist_event_sink *
+vlc_playlist_async_listener_GetSink(struct vlc_playlist_async_listener *async)
+{
+    return &async->sink;
+}
+
+static void
+vlc_playlist_async_listener_Push(struct vlc_playlist_event_sink *sink,
+                                 struct vlc_playlist_event *event)
+{
+    struct vlc_playlist_async_listener *async =
+        container_of(sink, struct vlc_playlist_async_listener, sink);
+
+    vlc_mutex_lock(&async->lock);
+    /* the events not consumed yet by the listener thread are merged */
+    if (!vlc_playlist_event_vector_Push(&async->events, event))
+        sink->overflow = true;
+
+    /* Some events are missing: replace the pending events by the whole
+     * state. This is done here rather than from the listener thread, which
+     * cannot lock the playlist (it is joined with the playlist locked). */
+    bool resync = sink->overflow && !async->resyncing;
+    if (resync)
+    {
+        vlc_playlist_event_vector_Clean(&async->events);
+        sink->overflow = false;
+        async->resyncing = true;
+    }
+    vlc_cond_signal(&async->wait);
+    vlc_mutex_unlock(&async->lock);
+
+    if (unlikely(resync))
+    {
+        /* the playlist is locked by the caller of the recorder */
+        vlc_playlist_AssertLocked(async->playlist);
+        /* if this fails again, the next event will trigger a new resync */
+        vlc_playlist_NotifyCurrentState(async->playlist, async->listener);
+
+        vlc_mutex_lock(&async->lock);
+        async->resyncing = false;
+        vlc_mutex_unlock(&async->lock);
+        async->resynced = true;
+    }
+}
+
+static void *
+vlc_playlist_async_listener_Run(void *data)
+{
+    struct vlc_playlist_async_listener *async = data;
+    playlist_event_vector_t events = VLC_VECTOR_INITIALIZER;
+
+    vlc_mutex_lock(&async->lock);
+    for (;;)
+    {
+        while (!async->events.size && !async->stopping)
+            vlc_cond_wait(&async->wait, &async->lock);
+
+        if (async->stopping)
+            break;
+
+        /* take all the pending events at once */
+        playlist_event_vector_t tmp = events;
+        events = async->events;
+        async->events = tmp;
+        vlc_mutex_unlock(&async->lock);
+
+        for (size_t i = 0; i < events.size; ++i)
+            vlc_playlist_event_Call(async->playlist, async->cbs,
+                                    async->userdata, &events.data[i]);
+        vlc_playlist_event_vector_Clean(&events);
+
+        vlc_mutex_lock(&async->lock);
+    }
+    vlc_mutex_unlock(&async->lock);
+
+    vlc_vector_destroy(&events);
+    return NULL;
+}
+
+vlc_playlist_listener_id *
+vlc_playlist_AddAsyncListener(vlc_playlist_t *playlist,
+                              const struct vlc_playlist_callbacks *cbs,
+                              void *userdata, bool notify_current_state)
+{
+    vlc_playlist_AssertLocked(playlist);
+
+    vlc_playlist_listener_id *listener = malloc(sizeof(*listener));
+    if (unlikely(!listener))
+        return NULL;
+
+    struct vlc_playlist_async_listener *async = malloc(sizeof(*async));
+    if (unlikely(!async))
+    {
+        free(listener);
+        return NULL;
+    }
+
+    async->sink.push = vlc_playlist_async_listener_Push;
+    async->sink.overflow = false;
+    async->playlist = playlist;
+    async->listener = listener;
+    async->cbs = cbs;
+    async->userdata = userdata;
+    vlc_mutex_init(&async->lock);
+    vlc_cond_init(&async->wait);
+    vlc_vector_init(&async->events);
+    async->resyncing = false;
+    async->resynced = false;
+    async->stopping = false;
+
+    if (vlc_clone(&async->thread, vlc_playlist_async_listener_Run, async,
+                  VLC_THREAD_PRIORITY_LOW))
+    {
+        vlc_vector_destroy(&async->events);
+        free(async);
+        free(listener);
+        return NULL;
+    }
+
+    listener->cbs = cbs;
+    listener->userdata = userdata;
+    listener->async = async;
+    vlc_list_append(&listener->node, &playlist->listeners);
+
+    if (notify_current_state)
+        vlc_playlist_NotifyCurrentState(playlist, listener);
+
+    return listener;
+}
+
+static void
+vlc_playlist_async_listener_Delete(struct vlc_playlist_async_listener *async)
+{
+    vlc_mutex_lock(&async->lock);
+    async->stopping = true;
+    vlc_cond_signal(&async->wait);
+    vlc_mutex_unlock(&async->lock);
+
+    vlc_join(async->thread, NULL);
+
+    /* the events not delivered yet are dropped */
+    vlc_playlist_event_vector_Clean(&async->events);
+    vlc_vector_destroy(&async->events);
+    free(async);
+}
@@ -23,14 +23,84 @@
 
 #include <vlc_common.h>
 #include <vlc_list.h>
+#include <vlc_playlist.h>
+#include <vlc_vector.h>
 
 typedef struct vlc_playlist vlc_playlist_t;
 
+enum vlc_playlist_event_type
+{
+    VLC_PLAYLIST_EVENT_ITEMS_RESET,
+    VLC_PLAYLIST_EVENT_ITEMS_ADDED,
+    VLC_PLAYLIST_EVENT_ITEMS_MOVED,
+    VLC_PLAYLIST_EVENT_ITEMS_REMOVED,
+    VLC_PLAYLIST_EVENT_ITEMS_UPDATED,
+    VLC_PLAYLIST_EVENT_PLAYBACK_REPEAT_CHANGED,
+    VLC_PLAYLIST_EVENT_PLAYBACK_ORDER_CHANGED,
+    VLC_PLAYLIST_EVENT_CURRENT_INDEX_CHANGED,
+    VLC_PLAYLIST_EVENT_HAS_PREV_CHANGED,
+    VLC_PLAYLIST_EVENT_HAS_NEXT_CHANGED,
+};
+
+/**
+ * Recorded playlist event, to be delivered later (at the end of a
+ * transaction, or from the thread of an asynchronous listener).
+ *
+ * The items (if any) are held by the event.
+ */
+struct vlc_playlist_event
+{
+    enum vlc_playlist_event_type type;
+    union {
+        struct {
+            vlc_playlist_item_t **items; /* NULL for moved and removed */
+            size_t index;
+            size_t count;
+            size_t target; /* only for moved */
+        } range;
+        enum vlc_playlist_playback_repeat repeat;
+        enum vlc_playlist_playback_order order;
+        ssize_t current;
+        bool value; /* has_prev or has_next */
+    };
+};
+
+typedef struct VLC_VECTOR(struct vlc_playlist_event) playlist_event_vector_t;
+
+/**
+ * Destination of recorded events.
+ *
+ * The recorder callbacks (vlc_playlist_recorder) convert the callback
+ * arguments to a vlc_playlist_event, and push it to the sink passed as
+ * userdata.
+ */
+struct vlc_playlist_event_sink
+{
+    /* the sink takes ownership of the event */
+    void (*push)(struct vlc_playlist_event_sink *sink,
+                 struct vlc_playlist_event *event);
+    /* set if an event could not be recorded (allocation failure) */
+    bool overflow;
+};
+
+extern const struct vlc_playlist_callbacks vlc_playlist_recorder;
+
+struct vlc_playlist_transaction
+{
+    struct vlc_playlist_event_sink sink;
+    unsigned depth; /**< nesting level, 0 if no transaction is in progress */
+    playlist_event_vector_t events;
+};
+
+struct vlc_playlist_async_listener;
+
 struct vlc_playlist_listener_id
 {
     const struct vlc_playlist_callbacks *cbs;
     void *userdata;
     struct vlc_list node; /**< node of vlc_playlist.listeners */
+    /* NULL for listeners notified synchronously */
+    struct vlc_playlist_async_listener *async;
 };
 
 struct vlc_playlist_state {
@@ -42,20 +112,44 @@ struct vlc_playlist_state {
 #define vlc_playlist_listener_foreach(listener, playlist) \
     vlc_list_foreach(listener, &(playlist)->listeners, node)
 
+/* asynchronous listeners receive a copy of the event in their queue */
 #define vlc_playlist_NotifyListener(playlist, listener, event, ...) \
 do { \
     if (listener->cbs->event) \
-        listener->cbs->event(playlist, ##__VA_ARGS__, listener->userdata); \
+    { \
+        if (listener->async) \
+            vlc_playlist_recorder.event(playlist, ##__VA_ARGS__, \
+                    vlc_playlist_async_listener_GetSink(listener->async)); \
+        else \
+            listener->cbs->event(playlist, ##__VA_ARGS__, listener->userdata); \
+    } \
 } while (0)
 
+/* during a transaction, events are recorded to be delivered at its end */
 #define vlc_playlist_Notify(playlist, event, ...) \
 do { \
     vlc_playlist_AssertLocked(playlist); \
-    vlc_playlist_listener_id *listener; \
-    vlc_playlist_listener_foreach(listener, playlist) \
-        vlc_playlist_NotifyListener(playlist, listener, event, ##__VA_ARGS__); \
+    if ((playlist)->transaction.depth) \
+        vlc_playlist_recorder.event(playlist, ##__VA_ARGS__, \
+                                    &(playlist)->transaction.sink); \
+    else \
+    { \
+        vlc_playlist_listener_id *listener; \
+        vlc_playlist_listener_foreach(listener, playlist) \
+            vlc_playlist_NotifyListener(playlist, listener, event, \
+                                        ##__VA_ARGS__); \
+    } \
 } while(0)
 
+struct vlc_playlist_event_sink *
+vlc_playlist_async_listener_GetSink(struct vlc_playlist_async_listener *async);
+
+void
+vlc_playlist_transaction_Init(struct vlc_playlist_transaction *transaction);
+
+void
+vlc_playlist_transaction_Destroy(struct vlc_playlist_transaction *transaction);
+
 void
 vlc_playlist_state_Save(vlc_playlist_t *playlist,
                         struct vlc_playlist_state *state);
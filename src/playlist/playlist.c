@@ -29,6 +29,7 @@
 #include "content.h"
 #include "item.h"
 #include "player.h"
+#include "sort.h"
 
 vlc_playlist_t *
 vlc_playlist_New(vlc_object_t *parent)
@@ -50,9 +51,12 @@ vlc_playlist_New(vlc_object_t *parent)
     playlist->has_prev = false;
     playlist->has_next = false;
     vlc_list_init(&playlist->listeners);
+    vlc_playlist_transaction_Init(&playlist->transaction);
     playlist->repeat = VLC_PLAYLIST_PLAYBACK_REPEAT_NONE;
     playlist->order = VLC_PLAYLIST_PLAYBACK_ORDER_NORMAL;
     playlist->idgen = 0;
+    playlist->sort.criteria = NULL;
+    playlist->sort.count = 0;
 #ifdef TEST_PLAYLIST
     playlist->libvlc = NULL;
     playlist->auto_preparse = false;
@@ -72,7 +76,9 @@ vlc_playlist_Delete(vlc_playlist_t *playlist)
 
     vlc_playlist_PlayerDestroy(playlist);
     randomizer_Destroy(&playlist->randomizer);
+    vlc_playlist_ClearSortCriteria(playlist);
     vlc_playlist_ClearItems(playlist);
+    vlc_playlist_transaction_Destroy(&playlist->transaction);
     free(playlist);
 }
 
@@ -25,6 +25,7 @@
 #include <vlc_playlist.h>
 #include <vlc_vector.h>
 #include "../player/player.h"
+#include "notify.h"
 #include "randomizer.h"
 
 typedef struct input_item_t input_item_t;
@@ -58,9 +59,15 @@ struct vlc_playlist
     bool has_prev;
     bool has_next;
     struct vlc_list listeners; /**< list of vlc_playlist_listener_id.node */
+    struct vlc_playlist_transaction transaction;
     enum vlc_playlist_playback_repeat repeat;
     enum vlc_playlist_playback_order order;
     uint64_t idgen;
+    struct {
+        /* criteria of the "keep sorted" mode (count is 0 if disabled) */
+        struct vlc_playlist_sort_criterion *criteria;
+        size_t count;
+    } sort;
 };
 
 /* Also disable vlc_assert_locked in tests since the symbol is not exported */
@@ -56,7 +56,11 @@ vlc_playlist_ExpandItem(vlc_playlist_t *playlist, size_t index,
     media_vector_t flatten = VLC_VECTOR_INITIALIZER;
     vlc_playlist_CollectChildren(playlist, &flatten, node);
 
+    /* the expansion may generate many events (especially if the playlist is
+     * kept sorted), notify them at once */
+    vlc_playlist_BeginTransaction(playlist);
     int ret = vlc_playlist_Expand(playlist, index, flatten.data, flatten.size);
+    vlc_playlist_EndTransaction(playlist);
     vlc_vector_destroy(&flatten);
 
     return ret;
@@ -101,8 +105,11 @@ on_preparse_ended(input_item_t *media,
     vlc_playlist_Lock(playlist);
     ssize_t index = vlc_playlist_IndexOfMedia(playlist, media);
     if (index != -1)
+    {
         vlc_playlist_Notify(playlist, on_items_updated, index,
                             &playlist->items.data[index], 1);
+        vlc_playlist_UpdateSortedItem(playlist, index);
+    }
     vlc_playlist_Unlock(playlist);
 }
 
@@ -28,6 +28,7 @@
 #include "item.h"
 #include "notify.h"
 #include "playlist.h"
+#include "sort.h"
 
 void
 vlc_playlist_Shuffle(vlc_playlist_t *playlist)
@@ -37,6 +38,9 @@ vlc_playlist_Shuffle(vlc_playlist_t *playlist)
         /* we use size_t (unsigned), so the following loop would be incorrect */
         return;
 
+    /* the playlist will not be sorted anymore */
+    vlc_playlist_ClearSortCriteria(playlist);
+
     vlc_playlist_item_t *current = playlist->current != -1
                                  ? playlist->items.data[playlist->current]
                                  : NULL;
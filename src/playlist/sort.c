@@ -22,13 +22,14 @@
 # include "config.h"
 #endif
 
+#include <ctype.h>
 #include <vlc_common.h>
 #include <vlc_rand.h>
-#include <vlc_sort.h>
 #include "control.h"
 #include "item.h"
 #include "notify.h"
 #include "playlist.h"
+#include "sort.h"
 
 /**
  * Struct containing a copy of (parsed) media metadata, used for sorting
@@ -53,12 +54,39 @@ struct vlc_playlist_item_meta {
     bool has_rating;
 };
 
+/**
+ * Compute the collation key of a string.
+ *
+ * The string is case-folded, then transformed by strxfrm() so that comparing
+ * two keys with strcmp() gives the same result as strcoll() on the folded
+ * strings. The keys are computed only once per item, instead of once per
+ * comparison.
+ */
+static char *
+vlc_playlist_item_meta_NewCollationKey(const char *str)
+{
+    char *folded = strdup(str);
+    if (unlikely(!folded))
+        return NULL;
+
+    for (char *p = folded; *p; ++p)
+        *p = tolower((unsigned char) *p);
+
+    size_t len = strxfrm(NULL, folded, 0);
+    char *key = malloc(len + 1);
+    if (likely(key))
+        strxfrm(key, folded, len + 1);
+
+    free(folded);
+    return key;
+}
+
 static int
 vlc_playlist_item_meta_CopyString(const char **to, const char *from)
 {
     if (from)
     {
-        *to = strdup(from);
+        *to = vlc_playlist_item_meta_NewCollationKey(from);
         if (unlikely(!*to))
             return VLC_ENOMEM;
     }
@@ -212,7 +240,7 @@ vlc_playlist_item_meta_New(vlc_playlist_item_t *item,
     return meta;
 }
 
-static void
+void
 vlc_playlist_item_meta_Delete(struct vlc_playlist_item_meta *meta)
 {
     vlc_playlist_item_meta_DestroyFields(meta);
@@ -222,8 +250,9 @@ vlc_playlist_item_meta_Delete(struct vlc_playlist_item_meta *meta)
 static inline int
 CompareStrings(const char *a, const char *b)
 {
+    /* a and b are collation keys */
     if (a && b)
-        return strcasecmp(a, b);
+        return strcmp(a, b);
     if (!a && !b)
         return 0;
     return a ? 1 : -1;
@@ -290,22 +319,26 @@ CompareMetaByKey(const struct vlc_playlist_item_meta *a,
      }
 }
 
-/* context for qsort_r() */
+/* below this number of items per thread, sorting is not parallelized */
+#define SORT_MIN_ITEMS_PER_THREAD 4096
+#define SORT_MAX_THREADS 16
+/* runs shorter than this are sorted by insertion */
+#define SORT_INSERTION_RUN 16
+
 struct sort_request
 {
     const struct vlc_playlist_sort_criterion *criteria;
     size_t count;
+    vlc_playlist_item_t *const *items;
+    struct vlc_playlist_item_meta **array;
+    struct vlc_playlist_item_meta **tmp;
 };
 
 static int
-compare_meta(const void *lhs, const void *rhs, void *userdata)
+CompareMeta(const struct vlc_playlist_item_meta *a,
+            const struct vlc_playlist_item_meta *b,
+            const struct sort_request *req)
 {
-    struct sort_request *req = userdata;
-    const struct vlc_playlist_item_meta *a =
-            *(const struct vlc_playlist_item_meta **) lhs;
-    const struct vlc_playlist_item_meta *b =
-            *(const struct vlc_playlist_item_meta **) rhs;
-
     for (size_t i = 0; i < req->count; ++i)
     {
         const struct vlc_playlist_sort_criterion *criterion = &req->criteria[i];
@@ -321,70 +354,309 @@ compare_meta(const void *lhs, const void *rhs, void *userdata)
     return 0;
 }
 
+/**
+ * Merge the sorted runs src[begin..mid) and src[mid..end) into dst.
+ *
+ * On equality, the item from the left run is taken first, so that the merge
+ * is stable.
+ */
+static void
+MergeRuns(struct vlc_playlist_item_meta **dst,
+          struct vlc_playlist_item_meta *const *src,
+          size_t begin, size_t mid, size_t end,
+          const struct sort_request *req)
+{
+    size_t i = begin;
+    size_t j = mid;
+    size_t k = begin;
+
+    while (i < mid && j < end)
+        dst[k++] = CompareMeta(src[j], src[i], req) < 0 ? src[j++] : src[i++];
+
+    while (i < mid)
+        dst[k++] = src[i++];
+    while (j < end)
+        dst[k++] = src[j++];
+}
+
+/**
+ * Stable bottom-up merge sort of array[0..count), using tmp as scratch space.
+ */
+static void
+MergeSort(struct vlc_playlist_item_meta **array,
+          struct vlc_playlist_item_meta **tmp, size_t count,
+          const struct sort_request *req)
+{
+    /* insertion sort of small runs */
+    for (size_t begin = 0; begin < count; begin += SORT_INSERTION_RUN)
+    {
+        size_t end = begin + SORT_INSERTION_RUN;
+        if (end > count)
+            end = count;
+        for (size_t i = begin + 1; i < end; ++i)
+        {
+            struct vlc_playlist_item_meta *meta = array[i];
+            size_t j = i;
+            while (j > begin && CompareMeta(meta, array[j - 1], req) < 0)
+            {
+                array[j] = array[j - 1];
+                --j;
+            }
+            array[j] = meta;
+        }
+    }
+
+    struct vlc_playlist_item_meta **src = array;
+    struct vlc_playlist_item_meta **dst = tmp;
+    for (size_t width = SORT_INSERTION_RUN; width < count; width *= 2)
+    {
+        for (size_t begin = 0; begin < count; begin += 2 * width)
+        {
+            size_t mid = begin + width;
+            size_t end = mid + width;
+            if (mid > count)
+                mid = count;
+            if (end > count)
+                end = count;
+            MergeRuns(dst, src, begin, mid, end, req);
+        }
+        struct vlc_playlist_item_meta **swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != array)
+        memcpy(array, src, count * sizeof(*array));
+}
+
+struct sort_worker
+{
+    vlc_thread_t thread;
+    const struct sort_request *req;
+    /* range of items handled by this worker */
+    size_t begin;
+    size_t mid; /* only for merge workers */
+    size_t end;
+    struct vlc_playlist_item_meta **src; /* only for merge workers */
+    struct vlc_playlist_item_meta **dst; /* only for merge workers */
+    int ret;
+};
+
+static void
+sort_worker_BuildAndSort(struct sort_worker *worker)
+{
+    const struct sort_request *req = worker->req;
+
+    for (size_t i = worker->begin; i < worker->end; ++i)
+    {
+        req->array[i] = vlc_playlist_item_meta_New(req->items[i],
+                                                   req->criteria, req->count);
+        if (unlikely(!req->array[i]))
+        {
+            worker->ret = VLC_ENOMEM;
+            return;
+        }
+    }
+
+    MergeSort(&req->array[worker->begin], &req->tmp[worker->begin],
+              worker->end - worker->begin, req);
+    worker->ret = VLC_SUCCESS;
+}
+
+static void *
+sort_worker_BuildAndSortThread(void *data)
+{
+    sort_worker_BuildAndSort(data);
+    return NULL;
+}
+
+static void
+sort_worker_Merge(struct sort_worker *worker)
+{
+    MergeRuns(worker->dst, worker->src, worker->begin, worker->mid,
+              worker->end, worker->req);
+}
+
+static void *
+sort_worker_MergeThread(void *data)
+{
+    sort_worker_Merge(data);
+    return NULL;
+}
+
+/**
+ * Run nworkers jobs, the last one in the calling thread.
+ *
+ * If a thread cannot be created, its job is run synchronously.
+ */
+static void
+sort_RunWorkers(struct sort_worker workers[], size_t nworkers,
+                void *(*entry)(void *))
+{
+    bool started[SORT_MAX_THREADS] = { false };
+
+    for (size_t i = 0; i + 1 < nworkers; ++i)
+        started[i] = !vlc_clone(&workers[i].thread, entry, &workers[i],
+                                VLC_THREAD_PRIORITY_LOW);
+
+    for (size_t i = 0; i < nworkers; ++i)
+        if (!started[i])
+            entry(&workers[i]);
+
+    for (size_t i = 0; i + 1 < nworkers; ++i)
+        if (started[i])
+            vlc_join(workers[i].thread, NULL);
+}
+
+static size_t
+sort_GetThreadCount(size_t size)
+{
+    size_t nthreads = vlc_GetCPUCount();
+    if (nthreads > SORT_MAX_THREADS)
+        nthreads = SORT_MAX_THREADS;
+    if (nthreads > size / SORT_MIN_ITEMS_PER_THREAD)
+        nthreads = size / SORT_MIN_ITEMS_PER_THREAD;
+    return nthreads ? nthreads : 1;
+}
+
 static void
 vlc_playlist_DeleteMetaArray(struct vlc_playlist_item_meta *array[],
                              size_t count)
 {
     for (size_t i = 0; i < count; ++i)
-        vlc_playlist_item_meta_Delete(array[i]);
+        if (array[i])
+            vlc_playlist_item_meta_Delete(array[i]);
     free(array);
 }
 
+/**
+ * Build the sort keys of all the items and sort them.
+ *
+ * The playlist is split into one chunk per thread. Each thread computes the
+ * keys of its chunk and sorts it, then the sorted chunks are merged pairwise
+ * (in parallel) until only one remains.
+ */
 static struct vlc_playlist_item_meta **
-vlc_playlist_NewMetaArray(vlc_playlist_t *playlist,
+vlc_playlist_NewSortedMetaArray(vlc_playlist_t *playlist,
         const struct vlc_playlist_sort_criterion criteria[], size_t count)
 {
-    struct vlc_playlist_item_meta **array =
-            vlc_alloc(playlist->items.size, sizeof(*array));
+    size_t size = playlist->items.size;
 
+    /* assume that NULL representation is all-zeros */
+    struct vlc_playlist_item_meta **array = calloc(size, sizeof(*array));
     if (unlikely(!array))
         return NULL;
 
-    size_t i;
-    for (i = 0; i < playlist->items.size; ++i)
+    struct vlc_playlist_item_meta **tmp = vlc_alloc(size, sizeof(*tmp));
+    if (unlikely(!tmp))
     {
-        array[i] = vlc_playlist_item_meta_New(playlist->items.data[i],
-                                              criteria, count);
-        if (unlikely(!array[i]))
-            break;
+        free(array);
+        return NULL;
     }
 
-    if (i < playlist->items.size)
+    struct sort_request req = {
+        .criteria = criteria,
+        .count = count,
+        .items = playlist->items.data,
+        .array = array,
+        .tmp = tmp,
+    };
+
+    struct sort_worker workers[SORT_MAX_THREADS];
+    size_t bounds[SORT_MAX_THREADS + 1];
+    size_t nruns = sort_GetThreadCount(size);
+
+    for (size_t i = 0; i < nruns; ++i)
     {
-        /* allocation failure */
-        vlc_playlist_DeleteMetaArray(array, i);
-        return NULL;
+        workers[i].req = &req;
+        workers[i].begin = size * i / nruns;
+        workers[i].end = size * (i + 1) / nruns;
+        bounds[i] = workers[i].begin;
+    }
+    bounds[nruns] = size;
+
+    sort_RunWorkers(workers, nruns, sort_worker_BuildAndSortThread);
+
+    for (size_t i = 0; i < nruns; ++i)
+    {
+        if (unlikely(workers[i].ret != VLC_SUCCESS))
+        {
+            vlc_playlist_DeleteMetaArray(array, size);
+            free(tmp);
+            return NULL;
+        }
     }
 
-    return array;
+    struct vlc_playlist_item_meta **src = array;
+    struct vlc_playlist_item_meta **dst = tmp;
+    while (nruns > 1)
+    {
+        size_t nmerges = nruns / 2;
+        for (size_t i = 0; i < nmerges; ++i)
+        {
+            workers[i].begin = bounds[2 * i];
+            workers[i].mid = bounds[2 * i + 1];
+            workers[i].end = bounds[2 * i + 2];
+            workers[i].src = src;
+            workers[i].dst = dst;
+        }
+
+        sort_RunWorkers(workers, nmerges, sort_worker_MergeThread);
+
+        if (nruns % 2)
+        {
+            /* the last run has no pair, keep it as is */
+            size_t begin = bounds[nruns - 1];
+            memcpy(&dst[begin], &src[begin], (size - begin) * sizeof(*dst));
+        }
+
+        for (size_t i = 0; i < nmerges; ++i)
+            bounds[i] = bounds[2 * i];
+        if (nruns % 2)
+            bounds[nmerges] = bounds[nruns - 1];
+        nruns = (nruns + 1) / 2;
+        bounds[nruns] = size;
+
+        struct vlc_playlist_item_meta **swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    free(dst);
+    return src;
 }
 
-int
-vlc_playlist_Sort(vlc_playlist_t *playlist,
-                  const struct vlc_playlist_sort_criterion criteria[],
-                  size_t count)
+static int
+vlc_playlist_SortImpl(vlc_playlist_t *playlist,
+                      const struct vlc_playlist_sort_criterion criteria[],
+                      size_t count, bool keep_sorted)
 {
-    assert(count > 0);
-    vlc_playlist_AssertLocked(playlist);
-
     vlc_playlist_item_t *current = playlist->current != -1
                                  ? playlist->items.data[playlist->current]
                                  : NULL;
 
     struct vlc_playlist_item_meta **array =
-        vlc_playlist_NewMetaArray(playlist, criteria, count);
+        vlc_playlist_NewSortedMetaArray(playlist, criteria, count);
     if (unlikely(!array))
         return VLC_ENOMEM;
 
-    struct sort_request req = { criteria, count };
-
-    vlc_qsort(array, playlist->items.size, sizeof(*array), compare_meta, &req);
-
     /* apply the sorting result to the playlist */
     for (size_t i = 0; i < playlist->items.size; ++i)
-        playlist->items.data[i] = array[i]->item;
+    {
+        vlc_playlist_item_t *item = array[i]->item;
+        playlist->items.data[i] = item;
+        if (keep_sorted)
+        {
+            /* keep the sort keys for further sorted insertions */
+            assert(!item->sort_meta);
+            item->sort_meta = array[i];
+        }
+    }
 
-    vlc_playlist_DeleteMetaArray(array, playlist->items.size);
+    if (keep_sorted)
+        free(array);
+    else
+        vlc_playlist_DeleteMetaArray(array, playlist->items.size);
 
     struct vlc_playlist_state state;
     if (current)
@@ -403,3 +675,155 @@ vlc_playlist_Sort(vlc_playlist_t *playlist,
 
     return VLC_SUCCESS;
 }
+
+int
+vlc_playlist_Sort(vlc_playlist_t *playlist,
+                  const struct vlc_playlist_sort_criterion criteria[],
+                  size_t count)
+{
+    assert(count > 0);
+    vlc_playlist_AssertLocked(playlist);
+
+    vlc_playlist_ClearSortCriteria(playlist);
+    return vlc_playlist_SortImpl(playlist, criteria, count, false);
+}
+
+int
+vlc_playlist_SetKeepSorted(vlc_playlist_t *playlist,
+                           const struct vlc_playlist_sort_criterion criteria[],
+                           size_t count)
+{
+    vlc_playlist_AssertLocked(playlist);
+
+    vlc_playlist_ClearSortCriteria(playlist);
+    if (!count)
+        return VLC_SUCCESS;
+
+    struct vlc_playlist_sort_criterion *copy =
+        vlc_alloc(count, sizeof(*copy));
+    if (unlikely(!copy))
+        return VLC_ENOMEM;
+    memcpy(copy, criteria, count * sizeof(*copy));
+
+    int ret = vlc_playlist_SortImpl(playlist, copy, count, true);
+    if (unlikely(ret != VLC_SUCCESS))
+    {
+        free(copy);
+        return ret;
+    }
+
+    playlist->sort.criteria = copy;
+    playlist->sort.count = count;
+    return VLC_SUCCESS;
+}
+
+void
+vlc_playlist_ClearSortCriteria(vlc_playlist_t *playlist)
+{
+    if (!playlist->sort.count)
+        return;
+
+    vlc_playlist_item_t *item;
+    vlc_vector_foreach(item, &playlist->items)
+    {
+        if (item->sort_meta)
+        {
+            vlc_playlist_item_meta_Delete(item->sort_meta);
+            item->sort_meta = NULL;
+        }
+    }
+
+    free(playlist->sort.criteria);
+    playlist->sort.criteria = NULL;
+    playlist->sort.count = 0;
+}
+
+int
+vlc_playlist_ComputeSortKeys(vlc_playlist_t *playlist,
+                             vlc_playlist_item_t *const items[], size_t count)
+{
+    assert(playlist->sort.count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        struct vlc_playlist_item_meta *meta =
+            vlc_playlist_item_meta_New(items[i], playlist->sort.criteria,
+                                       playlist->sort.count);
+        if (unlikely(!meta))
+            return VLC_ENOMEM;
+
+        if (items[i]->sort_meta)
+            vlc_playlist_item_meta_Delete(items[i]->sort_meta);
+        items[i]->sort_meta = meta;
+    }
+    return VLC_SUCCESS;
+}
+
+int
+vlc_playlist_SortItemArray(vlc_playlist_t *playlist,
+                           vlc_playlist_item_t *items[], size_t count)
+{
+    struct vlc_playlist_item_meta **array = vlc_alloc(count, sizeof(*array));
+    if (unlikely(!array))
+        return VLC_ENOMEM;
+
+    struct vlc_playlist_item_meta **tmp = vlc_alloc(count, sizeof(*tmp));
+    if (unlikely(!tmp))
+    {
+        free(array);
+        return VLC_ENOMEM;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        assert(items[i]->sort_meta);
+        array[i] = items[i]->sort_meta;
+    }
+
+    struct sort_request req = {
+        .criteria = playlist->sort.criteria,
+        .count = playlist->sort.count,
+    };
+    MergeSort(array, tmp, count, &req);
+
+    for (size_t i = 0; i < count; ++i)
+        items[i] = array[i]->item;
+
+    free(tmp);
+    free(array);
+    return VLC_SUCCESS;
+}
+
+int
+vlc_playlist_CompareItems(vlc_playlist_t *playlist,
+                          const vlc_playlist_item_t *a,
+                          const vlc_playlist_item_t *b)
+{
+    assert(a->sort_meta && b->sort_meta);
+
+    struct sort_request req = {
+        .criteria = playlist->sort.criteria,
+        .count = playlist->sort.count,
+    };
+    return CompareMeta(a->sort_meta, b->sort_meta, &req);
+}
+
+size_t
+vlc_playlist_FindSortedIndex(vlc_playlist_t *playlist,
+                             const vlc_playlist_item_t *item,
+                             size_t begin, size_t end)
+{
+    assert(begin <= end && end <= playlist->items.size);
+
+    /* upper bound, so that equal items keep their insertion order */
+    while (begin < end)
+    {
+        size_t mid = begin + (end - begin) / 2;
+        if (vlc_playlist_CompareItems(playlist, item,
+                                      playlist->items.data[mid]) < 0)
+            end = mid;
+        else
+            begin = mid + 1;
+    }
+    return begin;
+}
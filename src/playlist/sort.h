@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * playlist/sort.h
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_PLAYLIST_SORT_H
+#define VLC_PLAYLIST_SORT_H
+
+#include <vlc_common.h>
+
+typedef struct vlc_playlist vlc_playlist_t;
+typedef struct vlc_playlist_item vlc_playlist_item_t;
+struct vlc_playlist_item_meta;
+
+/* called by vlc_playlist_item_Release() to destroy the cached sort keys */
+void
+vlc_playlist_item_meta_Delete(struct vlc_playlist_item_meta *meta);
+
+/* "keep sorted" mode, the criteria are stored in playlist->sort */
+
+/* disable the "keep sorted" mode and drop the cached sort keys */
+void
+vlc_playlist_ClearSortCriteria(vlc_playlist_t *playlist);
+
+/* (re)compute the sort keys of items for the current criteria */
+int
+vlc_playlist_ComputeSortKeys(vlc_playlist_t *playlist,
+                             vlc_playlist_item_t *const items[], size_t count);
+
+/* stable sort of an array of items having their sort keys computed */
+int
+vlc_playlist_SortItemArray(vlc_playlist_t *playlist,
+                           vlc_playlist_item_t *items[], size_t count);
+
+/* compare two items by their cached sort keys */
+int
+vlc_playlist_CompareItems(vlc_playlist_t *playlist,
+                          const vlc_playlist_item_t *a,
+                          const vlc_playlist_item_t *b);
+
+/* return the index in [begin, end) of the playlist where item must be
+ * inserted to keep it sorted (after all the items equal to it) */
+size_t
+vlc_playlist_FindSortedIndex(vlc_playlist_t *playlist,
+                             const vlc_playlist_item_t *item,
+                             size_t begin, size_t end);
+
+#endif
@@ -2349,6 +2349,250 @@ test_sort(void)
     vlc_playlist_Delete(playlist);
 }
 
+static void
+test_sort_stable(void)
+{
+    vlc_playlist_t *playlist = vlc_playlist_New(NULL);
+    assert(playlist);
+
+    /* enough items to sort in parallel */
+    enum { COUNT = 50000 };
+    input_item_t **media = vlc_alloc(COUNT, sizeof(*media));
+    assert(media);
+    CreateDummyMediaArray(media, COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+        media[i]->i_duration = (i * 7919) % 13;
+
+    int ret = vlc_playlist_Append(playlist, media, COUNT);
+    assert(ret == VLC_SUCCESS);
+
+    struct vlc_playlist_sort_criterion criteria[] = {
+        { VLC_PLAYLIST_SORT_KEY_DURATION, VLC_PLAYLIST_SORT_ORDER_ASCENDING },
+    };
+    vlc_playlist_Sort(playlist, criteria, 1);
+
+    assert(vlc_playlist_Count(playlist) == COUNT);
+    for (size_t i = 1; i < COUNT; ++i)
+    {
+        input_item_t *prev = vlc_playlist_Get(playlist, i - 1)->media;
+        input_item_t *cur = vlc_playlist_Get(playlist, i)->media;
+        assert(prev->i_duration <= cur->i_duration);
+        if (prev->i_duration == cur->i_duration)
+            /* the initial order must be kept for equal items */
+            assert(atoi(prev->psz_name + 5) < atoi(cur->psz_name + 5));
+    }
+
+    DestroyMediaArray(media, COUNT);
+    free(media);
+    vlc_playlist_Delete(playlist);
+}
+
+static void
+test_keep_sorted(void)
+{
+    vlc_playlist_t *playlist = vlc_playlist_New(NULL);
+    assert(playlist);
+
+    input_item_t *media[10];
+    CreateDummyMediaArray(media, 10);
+    media[0]->i_duration = 40;
+    media[1]->i_duration = 10;
+    media[2]->i_duration = 30;
+    media[3]->i_duration = 20;
+    media[4]->i_duration = 5;
+    media[5]->i_duration = 25;
+    media[6]->i_duration = 26;
+    media[7]->i_duration = 50;
+    media[8]->i_duration = 15;
+    media[9]->i_duration = 45;
+
+    int ret = vlc_playlist_Append(playlist, media, 4);
+    assert(ret == VLC_SUCCESS);
+
+    struct vlc_playlist_sort_criterion criteria[] = {
+        { VLC_PLAYLIST_SORT_KEY_DURATION, VLC_PLAYLIST_SORT_ORDER_ASCENDING },
+    };
+    ret = vlc_playlist_SetKeepSorted(playlist, criteria, 1);
+    assert(ret == VLC_SUCCESS);
+
+    EXPECT_AT(0, 1);
+    EXPECT_AT(1, 3);
+    EXPECT_AT(2, 2);
+    EXPECT_AT(3, 0);
+
+    struct vlc_playlist_callbacks cbs = {
+        .on_items_added = callback_on_items_added,
+    };
+
+    struct callback_ctx ctx = CALLBACK_CTX_INITIALIZER;
+    vlc_playlist_listener_id *listener =
+            vlc_playlist_AddListener(playlist, &cbs, &ctx, false);
+    assert(listener);
+
+    /* the requested index is ignored */
+    ret = vlc_playlist_Insert(playlist, 2, &media[4], 4);
+    assert(ret == VLC_SUCCESS);
+    assert(vlc_playlist_Count(playlist) == 8);
+
+    EXPECT_AT(0, 4);
+    EXPECT_AT(1, 1);
+    EXPECT_AT(2, 3);
+    EXPECT_AT(3, 5);
+    EXPECT_AT(4, 6);
+    EXPECT_AT(5, 2);
+    EXPECT_AT(6, 0);
+    EXPECT_AT(7, 7);
+
+    /* one notification per contiguous range */
+    assert(ctx.vec_items_added.size == 3);
+    assert(ctx.vec_items_added.data[0].index == 0);
+    assert(ctx.vec_items_added.data[0].count == 1);
+    assert(ctx.vec_items_added.data[1].index == 3);
+    assert(ctx.vec_items_added.data[1].count == 2);
+    assert(ctx.vec_items_added.data[2].index == 7);
+    assert(ctx.vec_items_added.data[2].count == 1);
+
+    /* expand the current item (media 0) to media 8 and 9 */
+    input_item_node_t *root = input_item_node_Create(media[0]);
+    for (int i = 0; i < 2; ++i)
+    {
+        input_item_node_t *node = input_item_node_AppendItem(root,
+                                                             media[i + 8]);
+        assert(node);
+    }
+
+    playlist->current = 6;
+    playlist->has_prev = true;
+    playlist->has_next = true;
+
+    ret = vlc_playlist_ExpandItem(playlist, 6, root);
+    assert(ret == VLC_SUCCESS);
+    assert(vlc_playlist_Count(playlist) == 9);
+
+    EXPECT_AT(0, 4);
+    EXPECT_AT(1, 1);
+    EXPECT_AT(2, 8);
+    EXPECT_AT(3, 3);
+    EXPECT_AT(4, 5);
+    EXPECT_AT(5, 6);
+    EXPECT_AT(6, 2);
+    EXPECT_AT(7, 9);
+    EXPECT_AT(8, 7);
+
+    /* the current item has been replaced and moved */
+    assert(playlist->current == 2);
+
+    /* shuffling disables the mode */
+    vlc_playlist_Shuffle(playlist);
+    assert(playlist->sort.count == 0);
+
+    input_item_node_Delete(root);
+    callback_ctx_destroy(&ctx);
+    vlc_playlist_RemoveListener(playlist, listener);
+    DestroyMediaArray(media, 10);
+    vlc_playlist_Delete(playlist);
+}
+
+static void
+callback_on_items_updated_count(vlc_playlist_t *playlist, size_t index,
+                                vlc_playlist_item_t *const items[],
+                                size_t count, void *userdata)
+{
+    VLC_UNUSED(playlist); VLC_UNUSED(index); VLC_UNUSED(items);
+    size_t *updated = userdata;
+    *updated += count;
+}
+
+static void
+test_transaction(void)
+{
+    vlc_playlist_t *playlist = vlc_playlist_New(NULL);
+    assert(playlist);
+
+    input_item_t *media[8];
+    CreateDummyMediaArray(media, 8);
+
+    struct vlc_playlist_callbacks cbs = {
+        .on_items_added = callback_on_items_added,
+        .on_items_removed = callback_on_items_removed,
+    };
+
+    struct callback_ctx ctx = CALLBACK_CTX_INITIALIZER;
+    vlc_playlist_listener_id *listener =
+            vlc_playlist_AddListener(playlist, &cbs, &ctx, false);
+    assert(listener);
+
+    vlc_playlist_BeginTransaction(playlist);
+
+    int ret = vlc_playlist_Append(playlist, &media[0], 3);
+    assert(ret == VLC_SUCCESS);
+    ret = vlc_playlist_Append(playlist, &media[3], 2);
+    assert(ret == VLC_SUCCESS);
+
+    /* nested transaction */
+    vlc_playlist_BeginTransaction(playlist);
+    ret = vlc_playlist_InsertOne(playlist, 1, media[5]);
+    assert(ret == VLC_SUCCESS);
+    vlc_playlist_EndTransaction(playlist);
+
+    /* not notified until the end of the outermost transaction */
+    assert(ctx.vec_items_added.size == 0);
+
+    vlc_playlist_EndTransaction(playlist);
+
+    /* the contiguous insertions are merged */
+    assert(ctx.vec_items_added.size == 1);
+    assert(ctx.vec_items_added.data[0].index == 0);
+    assert(ctx.vec_items_added.data[0].count == 6);
+
+    EXPECT_AT(0, 0);
+    EXPECT_AT(1, 5);
+    EXPECT_AT(2, 1);
+
+    vlc_playlist_BeginTransaction(playlist);
+    vlc_playlist_RemoveOne(playlist, 2);
+    vlc_playlist_RemoveOne(playlist, 2);
+    vlc_playlist_RemoveOne(playlist, 1);
+    assert(ctx.vec_items_removed.size == 0);
+    vlc_playlist_EndTransaction(playlist);
+
+    assert(ctx.vec_items_removed.size == 1);
+    assert(ctx.vec_items_removed.data[0].index == 1);
+    assert(ctx.vec_items_removed.data[0].count == 3);
+
+    assert(vlc_playlist_Count(playlist) == 3);
+    EXPECT_AT(0, 0);
+    EXPECT_AT(1, 3);
+    EXPECT_AT(2, 4);
+
+    /* the updates of items added in the same transaction are merged */
+    struct vlc_playlist_callbacks updated_cbs = {
+        .on_items_updated = callback_on_items_updated_count,
+    };
+    size_t updated = 0;
+    vlc_playlist_listener_id *updated_listener =
+            vlc_playlist_AddListener(playlist, &updated_cbs, &updated, false);
+    assert(updated_listener);
+
+    vlc_playlist_BeginTransaction(playlist);
+    ret = vlc_playlist_Append(playlist, &media[6], 2);
+    assert(ret == VLC_SUCCESS);
+    vlc_playlist_NotifyMediaUpdated(playlist, media[7]);
+    vlc_playlist_EndTransaction(playlist);
+
+    assert(updated == 0);
+    assert(ctx.vec_items_added.size == 2);
+    assert(ctx.vec_items_added.data[1].index == 3);
+    assert(ctx.vec_items_added.data[1].count == 2);
+    EXPECT_AT(4, 7);
+
+    vlc_playlist_RemoveListener(playlist, updated_listener);
+    callback_ctx_destroy(&ctx);
+    vlc_playlist_RemoveListener(playlist, listener);
+    DestroyMediaArray(media, 8);
+    vlc_playlist_Delete(playlist);
+}
+
 #undef EXPECT_AT
 
 int main(void)
@@ -2384,6 +2628,9 @@ int main(void)
     test_random();
     test_shuffle();
     test_sort();
+    test_sort_stable();
+    test_keep_sorted();
+    test_transaction();
     return 0;
 }
 
@@ -23,6 +23,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 #include <sys/mman.h>
 
@@ -30,28 +31,85 @@
 #include <vlc_fs.h>
 #include "misc/picture.h"
 
+/* Buffers of at least one (typical) huge page are rounded up to a whole
+ * number of huge pages, so that they can be backed by huge pages, whether
+ * explicit or transparent, without splitting the last one. */
+#define PICTURE_HUGE_PAGE_SIZE (UINT32_C(2) << 20)
+
+static size_t picture_MapSize(size_t size)
+{
+    if (size >= PICTURE_HUGE_PAGE_SIZE)
+        size = (size + PICTURE_HUGE_PAGE_SIZE - 1)
+               & ~(size_t)(PICTURE_HUGE_PAGE_SIZE - 1);
+    return size;
+}
+
+static void *picture_Map(int fd, size_t size)
+{
+    if (ftruncate(fd, size))
+        return NULL;
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return (base != MAP_FAILED) ? base : NULL;
+}
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MFD_HUGETLB)
+static void *picture_AllocateHuge(int *restrict fdp, size_t size)
+{
+    /* Fails unless the administrator reserved enough huge pages */
+    int fd = memfd_create(PACKAGE_NAME"-picture", MFD_CLOEXEC | MFD_HUGETLB);
+    if (fd == -1)
+        return NULL;
+
+    void *base = picture_Map(fd, size);
+    if (base == NULL)
+    {
+        vlc_close(fd);
+        return NULL;
+    }
+
+    *fdp = fd;
+    return base;
+}
+#endif
+
 void *picture_Allocate(int *restrict fdp, size_t size)
 {
+    size = picture_MapSize(size);
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MFD_HUGETLB)
+    if (size >= PICTURE_HUGE_PAGE_SIZE
+     && atomic_load_explicit(&picture_huge_pages, memory_order_relaxed))
+    {
+        void *base = picture_AllocateHuge(fdp, size);
+        if (base != NULL)
+            return base;
+    }
+#endif
+
     int fd = vlc_memfd();
     if (fd == -1)
         return NULL;
 
-    if (ftruncate(fd, size)) {
-error:
+    void *base = picture_Map(fd, size);
+    if (base == NULL)
+    {
         vlc_close(fd);
         return NULL;
     }
 
-    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (base == MAP_FAILED)
-        goto error;
-
+#ifdef MADV_HUGEPAGE
+    /* Only effective if shared memory transparent huge pages are enabled
+     * in "advise" mode (or better) */
+    if (size >= PICTURE_HUGE_PAGE_SIZE)
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
     *fdp = fd;
     return base;
 }
 
 void picture_Deallocate(int fd, void *base, size_t size)
 {
-    munmap(base, size);
+    munmap(base, picture_MapSize(size));
     vlc_close(fd);
 }
@@ -22,6 +22,7 @@
 # include "config.h"
 #endif
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #undef NDEBUG
@@ -29,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_tick.h>
 
 static const char text[] =
     "This is a test!\n"
@@ -86,11 +88,166 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_pool (void)
+{
+    static const size_t sizes[] = { 0, 1, 188, 1316, 4096, 65536, 1 << 20 };
+    struct vlc_block_pool_stats before, after;
+
+    block_PoolEnable (true);
+    block_PoolGetStats (&before);
+
+    for (int round = 0; round < 3; round++)
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+        {
+            block_t *block = block_Alloc (sizes[i]);
+            assert (block != NULL);
+            assert (block->i_buffer == sizes[i]);
+            assert (((uintptr_t)block->p_buffer % 32) == 0);
+            memset (block->p_buffer, 0x55, block->i_buffer);
+
+            block = block_Realloc (block, 16, block->i_buffer + 16);
+            assert (block != NULL);
+            block_Release (block);
+        }
+
+    block_PoolGetStats (&after);
+    assert (after.hits > before.hits);
+    assert (after.bytes_cached > 0);
+
+    block_PoolEnable (false);
+}
+
+static vlc_tick_t bench_block_Alloc (void)
+{
+    enum { BURST = 64, ROUNDS = 20000 };
+    block_t *blocks[BURST];
+    vlc_tick_t start = vlc_tick_now ();
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int i = 0; i < BURST; i++)
+        {   /* TS packets, PES and frames of various sizes */
+            blocks[i] = block_Alloc ((i & 1) ? 188 : 188 * 7 * (i % 16 + 1));
+            assert (blocks[i] != NULL);
+        }
+        for (int i = 0; i < BURST; i++)
+            block_Release (blocks[i]);
+    }
+    return vlc_tick_now () - start;
+}
+
+static void bench_block_pool (void)
+{
+    struct vlc_block_pool_stats stats;
+
+    vlc_tick_t heap = bench_block_Alloc ();
+
+    block_PoolEnable (true);
+    vlc_tick_t pool = bench_block_Alloc ();
+    block_PoolGetStats (&stats);
+    block_PoolEnable (false);
+
+    printf ("block_Alloc: malloc %"PRId64" us, pool %"PRId64" us "
+            "(%"PRIu64" hits, %"PRIu64" misses, %zu bytes cached)\n",
+            US_FROM_VLC_TICK(heap), US_FROM_VLC_TICK(pool),
+            stats.hits, stats.misses, stats.bytes_cached);
+}
+
+#define SPSC_BLOCKS 100000
+
+static void *spsc_fifo_Producer (void *data)
+{
+    vlc_spsc_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < SPSC_BLOCKS;)
+    {
+        /* Queue chains of various lengths */
+        block_t *chain = NULL, **pp = &chain;
+        unsigned n = (i % 5) + 1;
+
+        for (unsigned j = 0; j < n && i < SPSC_BLOCKS; j++, i++)
+        {
+            block_t *block = block_Alloc (i % 7);
+            assert (block != NULL);
+            block->i_dts = i;
+            *pp = block;
+            pp = &block->p_next;
+        }
+        vlc_spsc_fifo_Queue (fifo, chain);
+    }
+    return NULL;
+}
+
+static void *spsc_fifo_Consumer (void *data)
+{
+    vlc_spsc_fifo_t *fifo = data;
+
+    for (;;)
+        block_Release (vlc_spsc_fifo_Dequeue (fifo));
+    vlc_assert_unreachable ();
+}
+
+static void test_spsc_fifo (void)
+{
+    vlc_spsc_fifo_t *fifo = vlc_spsc_fifo_New (3);
+    assert (fifo != NULL);
+
+    /* Single thread */
+    assert (vlc_spsc_fifo_TryDequeue (fifo) == NULL);
+    block_t *a = block_Alloc (10), *b = block_Alloc (20);
+    assert (a != NULL && b != NULL);
+    a->p_next = b;
+    vlc_spsc_fifo_Queue (fifo, a);
+    assert (vlc_spsc_fifo_GetCount (fifo) == 2);
+    assert (vlc_spsc_fifo_GetBytes (fifo) == 30);
+    assert (vlc_spsc_fifo_Dequeue (fifo) == a);
+    assert (a->p_next == NULL);
+    block_Release (a);
+    assert (vlc_spsc_fifo_GetCount (fifo) == 1);
+    assert (vlc_spsc_fifo_GetBytes (fifo) == 20);
+
+    /* Producer and consumer threads, with a full FIFO most of the time */
+    vlc_thread_t th;
+    int val = vlc_clone (&th, spsc_fifo_Producer, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+
+    assert (vlc_spsc_fifo_Dequeue (fifo) == b);
+    block_Release (b);
+
+    for (unsigned i = 0; i < SPSC_BLOCKS; i++)
+    {
+        block_t *block = vlc_spsc_fifo_Dequeue (fifo);
+        assert (block->i_dts == (vlc_tick_t)i);
+        assert (block->i_buffer == i % 7);
+        assert (block->p_next == NULL);
+        block_Release (block);
+    }
+
+    vlc_join (th, NULL);
+    assert (vlc_spsc_fifo_GetCount (fifo) == 0);
+    assert (vlc_spsc_fifo_GetBytes (fifo) == 0);
+
+    /* A consumer waiting on an empty FIFO can be cancelled */
+    val = vlc_clone (&th, spsc_fifo_Consumer, fifo, VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+    vlc_spsc_fifo_Queue (fifo, block_Alloc (1));
+    vlc_cancel (th);
+    vlc_join (th, NULL);
+
+    /* Left-over blocks are released with the FIFO */
+    vlc_spsc_fifo_Queue (fifo, block_Alloc (1));
+    vlc_spsc_fifo_Delete (fifo);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_pool ();
+    bench_block_pool ();
+    test_spsc_fifo ();
     return 0;
 }
 
@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * latency.c: test for the latency histograms
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "../misc/latency.h"
+
+static void test_bucket(void)
+{
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(0)) == 0);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(1)) == 0);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(2)) == 1);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(3)) == 1);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(4)) == 2);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(1023)) == 9);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(1024)) == 10);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_MS(1)) == 9);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_SEC(1)) == 19);
+
+    /* Longer samples are counted in the last bucket */
+    unsigned last = VLC_LATENCY_BUCKETS - 1;
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(UINT64_C(1) << last)) == last);
+    assert(vlc_latency_bucket(VLC_TICK_FROM_US(UINT64_C(1) << 40)) == last);
+}
+
+static void test_recorder(void)
+{
+    struct vlc_latency_recorder rec;
+    struct vlc_latency_histogram h;
+
+    vlc_latency_recorder_Init(&rec);
+    vlc_latency_recorder_Get(&rec, &h);
+    assert(h.count == 0 && h.sum == 0 && h.negative == 0);
+    assert(vlc_latency_histogram_Percentile(&h, 500) == 0);
+
+    /* Negative samples are counted apart, not as zero */
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(-100));
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(-1));
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(0));
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(5));
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(6));
+    vlc_latency_recorder_Add(&rec, VLC_TICK_FROM_US(1000));
+
+    vlc_latency_recorder_Get(&rec, &h);
+    assert(h.count == 6);
+    assert(h.negative == 2);
+    assert(h.sum == VLC_TICK_FROM_US(910));
+    assert(h.buckets[0] == 1);
+    assert(h.buckets[2] == 2);
+    assert(h.buckets[9] == 1);
+
+    uint64_t total = h.negative;
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        total += h.buckets[i];
+    assert(total == h.count);
+
+    /* Percentiles are the upper bounds of their buckets, 0 if negative */
+    assert(vlc_latency_histogram_Percentile(&h, 250) == 0);
+    assert(vlc_latency_histogram_Percentile(&h, 500) == VLC_TICK_FROM_US(2));
+    assert(vlc_latency_histogram_Percentile(&h, 750) == VLC_TICK_FROM_US(8));
+    assert(vlc_latency_histogram_Percentile(&h, 999)
+           == VLC_TICK_FROM_US(1024));
+
+    /* Merging adds up, resetting moves the samples out */
+    vlc_latency_recorder_Merge(&rec, &h);
+    struct vlc_latency_histogram sum = { 0 };
+    vlc_latency_recorder_GetReset(&rec, &sum);
+    assert(sum.count == 12 && sum.negative == 4);
+    assert(sum.sum == VLC_TICK_FROM_US(1820));
+    assert(sum.buckets[2] == 4);
+
+    vlc_latency_recorder_Get(&rec, &h);
+    assert(h.count == 0 && h.sum == 0 && h.negative == 0);
+    for (unsigned i = 0; i < VLC_LATENCY_BUCKETS; i++)
+        assert(h.buckets[i] == 0);
+}
+
+int main(void)
+{
+    test_bucket();
+    test_recorder();
+    return 0;
+}
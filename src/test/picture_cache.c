@@ -0,0 +1,194 @@
+/*****************************************************************************
+ * picture_cache.c: test cases for the picture buffer allocator
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include "misc/picture.h"
+
+#define HUGETLBFS_MAGIC 0x958458f6
+
+const char vlc_module_name[] = "test_picture_cache";
+
+static video_format_t fmt;
+
+static int GetFd(const picture_t *pic)
+{
+    const picture_buffer_t *res = pic->p_sys;
+
+    assert(res != NULL && res->fd != -1);
+    return res->fd;
+}
+
+static bool IsOpen(int fd)
+{
+    if (fcntl(fd, F_GETFD) != -1)
+        return true;
+    assert(errno == EBADF);
+    return false;
+}
+
+static size_t GetSize(void)
+{
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    size_t size = ((const picture_buffer_t *)pic->p_sys)->size;
+    picture_Release(pic);
+    return size;
+}
+
+static void test_cache(void)
+{
+    picture_t *pics[3];
+    void *planes[3];
+    int fds[3];
+
+    /* Without a cache, released buffers are unmapped at once */
+    picture_AllocatorSetup(0, false);
+    pics[0] = picture_NewFromFormat(&fmt);
+    assert(pics[0] != NULL);
+    fds[0] = GetFd(pics[0]);
+    picture_Release(pics[0]);
+    assert(!IsOpen(fds[0]));
+
+    /* Room for two buffers */
+    picture_AllocatorSetup(2 * GetSize(), false);
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        pics[i] = picture_NewFromFormat(&fmt);
+        assert(pics[i] != NULL);
+        planes[i] = pics[i]->p[0].p_pixels;
+        fds[i] = GetFd(pics[i]);
+    }
+
+    for (unsigned i = 0; i < 3; i++)
+        picture_Release(pics[i]);
+
+    /* The least recently released buffer exceeded the budget */
+    assert(!IsOpen(fds[0]));
+    assert(IsOpen(fds[1]) && IsOpen(fds[2]));
+
+    /* The most recently released buffer comes back first */
+    pics[2] = picture_NewFromFormat(&fmt);
+    assert(pics[2] != NULL);
+    assert(pics[2]->p[0].p_pixels == planes[2]);
+    assert(GetFd(pics[2]) == fds[2]);
+
+    /* A buffer of another size is allocated anew, and not kept as it is
+     * larger than the whole cache */
+    video_format_t other = fmt;
+    other.i_width = other.i_visible_width = 3 * fmt.i_width;
+    pics[0] = picture_NewFromFormat(&other);
+    assert(pics[0] != NULL);
+    assert(pics[0]->p[0].p_pixels != planes[1]);
+    assert(IsOpen(fds[1]));
+    fds[0] = GetFd(pics[0]);
+    picture_Release(pics[0]);
+    assert(!IsOpen(fds[0]));
+
+    pics[1] = picture_NewFromFormat(&fmt);
+    assert(pics[1] != NULL);
+    assert(pics[1]->p[0].p_pixels == planes[1]);
+    assert(GetFd(pics[1]) == fds[1]);
+
+    for (unsigned i = 1; i < 3; i++)
+        picture_Release(pics[i]);
+    assert(IsOpen(fds[1]) && IsOpen(fds[2]));
+
+    /* Disabling the cache drains it */
+    picture_AllocatorSetup(0, false);
+    assert(!IsOpen(fds[1]) && !IsOpen(fds[2]));
+}
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MFD_HUGETLB)
+static unsigned long FreeHugePages(void)
+{
+    FILE *stream = fopen("/proc/meminfo", "re");
+    unsigned long pages = 0;
+    char line[128];
+
+    if (stream == NULL)
+        return 0;
+    while (fgets(line, sizeof (line), stream) != NULL)
+        if (sscanf(line, "HugePages_Free: %lu", &pages) == 1)
+            break;
+    fclose(stream);
+    return pages;
+}
+#endif
+
+static void test_huge(size_t size, bool huge)
+{
+    int fd;
+    unsigned char *buf = picture_Allocate(&fd, size);
+
+    assert(buf != NULL);
+    memset(buf, 0x5A, size);
+    assert(buf[size - 1] == 0x5A);
+
+    struct statfs st;
+    assert(fstatfs(fd, &st) == 0);
+    if (huge)
+        assert(st.f_type == HUGETLBFS_MAGIC);
+    else
+        assert(st.f_type != HUGETLBFS_MAGIC);
+
+    picture_Deallocate(fd, buf, size);
+    assert(!IsOpen(fd));
+}
+
+int main(void)
+{
+    video_format_Setup(&fmt, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    test_cache();
+
+    /* Huge pages are only used for large buffers, and if reserved */
+    const size_t small = 64 << 10, large = 5 << 20;
+    bool huge = false;
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MFD_HUGETLB)
+    huge = FreeHugePages() >= 3;
+#endif
+    if (!huge)
+        fprintf(stderr, "no free huge pages, testing the fallback\n");
+
+    picture_AllocatorSetup(0, true);
+    test_huge(small, false);
+    test_huge(large, huge);
+
+    picture_AllocatorSetup(0, false);
+    test_huge(large, false);
+    return 0;
+}
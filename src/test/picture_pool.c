@@ -108,6 +108,39 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void test_large(unsigned count)
+{
+    picture_t *pics[count];
+
+    pool = picture_pool_NewFromFormat(&fmt, count);
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == count);
+
+    for (unsigned i = 0; i < count; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+        for (unsigned j = 0; j < i; j++)
+            assert(pics[j]->p[0].p_pixels != pics[i]->p[0].p_pixels);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    /* Free pictures in the middle of the bit map */
+    for (unsigned i = 1; i < count; i += 3) {
+        void *plane = pics[i]->p[0].p_pixels;
+
+        picture_Release(pics[i]);
+        pics[i] = picture_pool_Wait(pool);
+        assert(pics[i] != NULL);
+        assert(pics[i]->p[0].p_pixels == plane);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    picture_pool_Release(pool);
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(pics[i]);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -124,6 +157,9 @@ int main(void)
 
     test(false);
     test(true);
+    test_large(64);
+    test_large(65);
+    test_large(200);
 
     return 0;
 }
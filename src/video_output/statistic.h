@@ -23,6 +23,7 @@
 #ifndef LIBVLC_VOUT_STATISTIC_H
 # define LIBVLC_VOUT_STATISTIC_H
 # include <stdatomic.h>
+# include "../misc/latency.h"
 
 /* NOTE: Both statistics are atomic on their own, so one might be older than
  * the other one. Currently, only one of them is updated at a time, so this
@@ -30,12 +31,16 @@
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+    struct vlc_latency_recorder queued;
+    struct vlc_latency_recorder late;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    vlc_latency_recorder_Init(&stat->queued);
+    vlc_latency_recorder_Init(&stat->late);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -45,11 +50,17 @@ static inline void vout_statistic_Clean(vout_statistic_t *stat)
 
 static inline void vout_statistic_GetReset(vout_statistic_t *stat,
                                            unsigned *restrict displayed,
-                                           unsigned *restrict lost)
+                                           unsigned *restrict lost,
+                                           struct vlc_latency_histogram *queued,
+                                           struct vlc_latency_histogram *late)
 {
     *displayed = atomic_exchange_explicit(&stat->displayed, 0,
                                           memory_order_relaxed);
     *lost = atomic_exchange_explicit(&stat->lost, 0, memory_order_relaxed);
+    if (queued != NULL)
+        vlc_latency_recorder_GetReset(&stat->queued, queued);
+    if (late != NULL)
+        vlc_latency_recorder_GetReset(&stat->late, late);
 }
 
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
@@ -64,4 +75,16 @@ static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
     atomic_fetch_add_explicit(&stat->lost, lost, memory_order_relaxed);
 }
 
+static inline void vout_statistic_AddQueued(vout_statistic_t *stat,
+                                            vlc_tick_t queued)
+{
+    vlc_latency_recorder_Add(&stat->queued, queued);
+}
+
+static inline void vout_statistic_AddLate(vout_statistic_t *stat,
+                                          vlc_tick_t late)
+{
+    vlc_latency_recorder_Add(&stat->late, late);
+}
+
 #endif
@@ -58,7 +58,9 @@
 #include "snapshot.h"
 #include "window.h"
 #include "../misc/variables.h"
+#include "../misc/picture.h"
 #include "../clock/clock.h"
+#include "../misc/trace.h"
 
 /* Maximum delay between 2 displayed pictures.
  * XXX it is needed for now but should be removed in the long term.
@@ -217,10 +219,13 @@ static void vout_UpdateWindowSizeLocked(vout_thread_t *vout)
 
 /* */
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost)
+                            unsigned *restrict lost,
+                            struct vlc_latency_histogram *queued,
+                            struct vlc_latency_histogram *late)
 {
     assert(!vout->p->dummy);
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, queued,
+                             late );
 }
 
 bool vout_IsEmpty(vout_thread_t *vout)
@@ -348,6 +353,8 @@ picture_t *vout_GetPicture(vout_thread_t *vout)
 void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
 {
     assert(!vout->p->dummy);
+    picture_priv_t *priv = container_of(picture, picture_priv_t, picture);
+    priv->queued = vlc_tick_now();
     picture->p_next = NULL;
     picture_fifo_Push(vout->p->decoder_fifo, picture);
     vout_control_Wake(&vout->p->control);
@@ -896,6 +903,11 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse,
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
 
             if (decoded) {
+                const picture_priv_t *priv =
+                    container_of(decoded, picture_priv_t, picture);
+                vout_statistic_AddQueued(&sys->statistic,
+                                         vlc_tick_now() - priv->queued);
+
                 if (is_late_dropped && !decoded->b_force) {
                     const vlc_tick_t date = vlc_tick_now();
                     const vlc_tick_t system_pts =
@@ -1222,7 +1234,11 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     const unsigned frame_rate_base = todisplay->format.i_frame_rate_base;
 
     if (vd->prepare != NULL)
+    {
+        vlc_tracer_BeginPicture("vout prepare", pts);
         vd->prepare(vd, todisplay, do_dr_spu ? subpic : NULL, system_pts);
+        vlc_tracer_End("vout prepare");
+    }
 
     vout_chrono_Stop(&sys->render);
 #if 0
@@ -1237,6 +1253,8 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     system_now = vlc_tick_now();
     if (!is_forced)
     {
+        vout_statistic_AddLate(&sys->statistic, system_now - system_pts);
+
         if (unlikely(system_now > system_pts))
         {
             /* vd->prepare took too much time. Tell the clock that the pts was
@@ -1246,8 +1264,10 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         else
         {
             /* Wait to reach system_pts */
+            vlc_tracer_Begin("vout wait");
             vlc_clock_Wait(sys->clock, system_now, pts, sys->rate,
                            VOUT_REDISPLAY_DELAY);
+            vlc_tracer_End("vout wait");
 
             /* Don't touch system_pts. Tell the clock that the pts was rendered
              * at the expected date */
@@ -1264,7 +1284,9 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
                           frame_rate, frame_rate_base);
 
     /* Display the direct buffer returned by vout_RenderPicture */
+    vlc_tracer_BeginPicture("vout display", pts);
     vout_display_Display(vd, todisplay);
+    vlc_tracer_End("vout display");
     vlc_mutex_unlock(&sys->display_lock);
 
     if (subpic)
@@ -1356,7 +1378,9 @@ static int ThreadDisplayPicture(vout_thread_t *vout, vlc_tick_t *deadline)
 
     /* display the picture immediately */
     bool is_forced = frame_by_frame || force_refresh || sys->displayed.current->b_force;
+    vlc_tracer_BeginPicture("vout render", sys->displayed.current->date);
     int ret = ThreadDisplayRenderPicture(vout, is_forced);
+    vlc_tracer_End("vout render");
     return force_refresh ? VLC_EGENERIC : ret;
 }
 
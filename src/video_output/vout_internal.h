@@ -326,9 +326,15 @@ void vout_MouseState(vout_thread_t *, const vlc_mouse_t *);
 
 /**
  * This function will return and reset internal statistics.
+ *
+ * The samples of the time pictures spent queued before the video output
+ * thread takes them, and of the display lateness, are added to the queued and
+ * late histograms respectively, if not NULL.
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost );
+                             unsigned *pi_lost,
+                             struct vlc_latency_histogram *queued,
+                             struct vlc_latency_histogram *late );
 
 /**
  * This function will force to display the next picture while paused
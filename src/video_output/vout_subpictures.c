@@ -42,6 +42,7 @@
 #include "../libvlc.h"
 #include "vout_internal.h"
 #include "../misc/subpicture.h"
+#include "../misc/trace.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -75,6 +76,9 @@ typedef struct VLC_VECTOR(struct spu_channel) spu_channel_vector;
 typedef struct VLC_VECTOR(subpicture_t *) spu_prerender_vector;
 #define SPU_CHROMALIST_COUNT 8
 
+/* Largest scaled region, in pixels, handled by the resizing module */
+#define SPU_RESIZE_MAX_PIXELS (1024 * 1024)
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     input_thread_t *input;
@@ -86,6 +90,7 @@ struct spu_private_t {
     vlc_mutex_t textlock;
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
+    filter_t *resize;           /**< resizing module for small regions */
     bool force_crop;                     /**< force cropping of subpicture */
     struct {
         int x;
@@ -126,6 +131,13 @@ struct spu_private_t {
         vlc_fourcc_t    chroma_list[SPU_CHROMALIST_COUNT+1];
     } prerender;
 
+    /* Statistics of the scaled/converted region cache */
+    struct {
+        uint64_t reuses;
+        uint64_t conversions;
+        uint64_t invalidations;
+    } region_cache;
+
     /* */
     vlc_tick_t          last_sort_date;
     vout_thread_t       *vout;
@@ -275,7 +287,8 @@ static filter_t *SpuRenderCreateAndLoadText(spu_t *spu)
 static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
                                              vlc_fourcc_t src_chroma,
                                              vlc_fourcc_t dst_chroma,
-                                             bool require_resize)
+                                             bool require_resize,
+                                             const char *name)
 {
     filter_t *scale = vlc_custom_create(object, sizeof(*scale), "scale");
     if (!scale)
@@ -295,7 +308,8 @@ static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
     scale->fmt_out.video.i_height =
     scale->fmt_out.video.i_visible_height = require_resize ? 16 : 32;
 
-    scale->p_module = module_need(scale, "video converter", NULL, false);
+    scale->p_module = module_need(scale, "video converter", name,
+                                  name != NULL);
     if (!scale->p_module)
     {
         vlc_object_delete(scale);
@@ -772,6 +786,47 @@ spu_SelectSubpictures(spu_t *spu, vlc_tick_t system_now,
 
 
 
+/**
+ * Checks whether the scaled/converted picture cached in a region still
+ * matches its source picture, format and palette, and the requested
+ * destination size and chroma.
+ */
+static bool SpuRegionPrivateIsValid(const subpicture_region_private_t *private,
+                                    const subpicture_region_t *region,
+                                    unsigned dst_width, unsigned dst_height,
+                                    vlc_fourcc_t dst_chroma)
+{
+    const video_format_t *src = &private->source_fmt;
+
+    if (private->p_source != region->p_picture)
+        return false;
+
+    if (private->fmt.i_visible_width  != dst_width ||
+        private->fmt.i_visible_height != dst_height ||
+        private->fmt.i_chroma         != dst_chroma)
+        return false;
+
+    if (src->i_chroma         != region->fmt.i_chroma ||
+        src->i_x_offset       != region->fmt.i_x_offset ||
+        src->i_y_offset       != region->fmt.i_y_offset ||
+        src->i_visible_width  != region->fmt.i_visible_width ||
+        src->i_visible_height != region->fmt.i_visible_height)
+        return false;
+
+    /* The palette may be changed in place (forced DVD palette) */
+    const video_palette_t *old_palette = src->p_palette;
+    const video_palette_t *new_palette = region->fmt.p_palette;
+    if ((old_palette == NULL) != (new_palette == NULL))
+        return false;
+    if (new_palette &&
+        (old_palette->i_entries != new_palette->i_entries ||
+         memcmp(old_palette->palette, new_palette->palette,
+                new_palette->i_entries * sizeof(new_palette->palette[0]))))
+        return false;
+
+    return true;
+}
+
 /**
  * It will transform the provided region into another region suitable for rendering.
  */
@@ -949,27 +1004,19 @@ static void SpuRenderRegion(spu_t *spu,
     {
         const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
         const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
+        /* YUVP is always expanded to the first chroma */
+        const vlc_fourcc_t dst_chroma = convert_chroma || using_palette ?
+                                        chroma_list[0] : region->fmt.i_chroma;
 
         /* Destroy the cache if unusable */
         if (region->p_private) {
-            subpicture_region_private_t *private = region->p_private;
-            bool is_changed = false;
-
-            /* Check resize changes */
-            if (dst_width  != private->fmt.i_visible_width ||
-                dst_height != private->fmt.i_visible_height)
-                is_changed = true;
-
-            /* Check forced palette changes */
-            if (changed_palette)
-                is_changed = true;
-
-            if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
-                is_changed = true;
-
-            if (is_changed) {
-                subpicture_region_private_Delete(private);
+            if (SpuRegionPrivateIsValid(region->p_private, region,
+                                        dst_width, dst_height, dst_chroma)) {
+                sys->region_cache.reuses++;
+            } else {
+                subpicture_region_private_Delete(region->p_private);
                 region->p_private = NULL;
+                sys->region_cache.invalidations++;
             }
         }
 
@@ -1020,21 +1067,44 @@ static void SpuRenderRegion(spu_t *spu,
                 scale->fmt_out.video.i_visible_height =
                     spu_scale_h(region->fmt.i_visible_height, scale_size);
 
-                picture = scale->pf_video_filter(scale, picture);
+                /* Resize small regions with the internal scaler, falling
+                 * back to the generic one if it cannot */
+                picture_t *resized = NULL;
+                if (sys->resize &&
+                    scale->fmt_in.video.i_chroma == scale->fmt_out.video.i_chroma &&
+                    dst_width * dst_height <= SPU_RESIZE_MAX_PIXELS) {
+                    filter_t *resize = sys->resize;
+
+                    resize->fmt_in.video  = scale->fmt_in.video;
+                    resize->fmt_out.video = scale->fmt_out.video;
+                    resized = resize->pf_video_filter(resize,
+                                                      picture_Hold(picture));
+                }
+
+                if (resized) {
+                    picture_Release(picture);
+                    picture = resized;
+                } else {
+                    picture = scale->pf_video_filter(scale, picture);
+                }
                 if (!picture)
                     msg_Err(spu, "scaling failed");
             }
 
             /* */
             if (picture) {
-                region->p_private = subpicture_region_private_New(&picture->format);
-                if (region->p_private) {
-                    region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
+                subpicture_region_private_t *private =
+                    subpicture_region_private_New(&picture->format);
+                if (private &&
+                    video_format_Copy(&private->source_fmt,
+                                      &region->fmt) == VLC_SUCCESS) {
+                    private->p_picture = picture;
+                    private->p_source = picture_Hold(region->p_picture);
+                    region->p_private = private;
+                    sys->region_cache.conversions++;
                 } else {
+                    if (private)
+                        subpicture_region_private_Delete(private);
                     picture_Release(picture);
                 }
             }
@@ -1046,6 +1116,13 @@ static void SpuRenderRegion(spu_t *spu,
             region_picture = region->p_private->p_picture;
         }
     }
+    else if (region->p_private)
+    {
+        /* Back to the source size and chroma, release the cached copy */
+        subpicture_region_private_Delete(region->p_private);
+        region->p_private = NULL;
+        sys->region_cache.invalidations++;
+    }
 
     /* Force cropping if requested */
     if (crop_requested) {
@@ -1580,6 +1657,12 @@ static void spu_Cleanup(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    if (sys->region_cache.conversions > 0)
+        msg_Dbg(spu, "region cache: %"PRIu64" conversions, %"PRIu64
+                " reuses, %"PRIu64" invalidations",
+                sys->region_cache.conversions, sys->region_cache.reuses,
+                sys->region_cache.invalidations);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1589,6 +1672,9 @@ static void spu_Cleanup(spu_t *spu)
     if (sys->scale)
         FilterRelease(sys->scale);
 
+    if (sys->resize)
+        FilterRelease(sys->resize);
+
     filter_chain_ForEach(sys->source_chain, SubSourceClean, spu);
     if (sys->vout)
         filter_chain_ForEach(sys->source_chain,
@@ -1692,12 +1778,21 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     /* XXX spu->p_scale is used for all conversion/scaling except yuvp to
      * yuva/rgba */
     sys->scale = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
-                                             VLC_CODEC_YUVA, VLC_CODEC_RGBA, true);
+                                             VLC_CODEC_YUVA, VLC_CODEC_RGBA, true,
+                                             NULL);
+
+    /* Small regions only needing a resize are better served by the
+     * internal scaler, as the setup of a generic converter for each new
+     * size costs more than the scaling itself. It is optional. */
+    sys->resize = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
+                                              VLC_CODEC_RGBA, VLC_CODEC_RGBA,
+                                              true, "scale");
 
     /* This one is used for YUVP to YUVA/RGBA without scaling
      * FIXME rename it */
     sys->scale_yuvp = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
-                                                  VLC_CODEC_YUVP, VLC_CODEC_YUVA, false);
+                                                  VLC_CODEC_YUVP, VLC_CODEC_YUVA, false,
+                                                  NULL);
 
 
     if (!sys->source_chain || !sys->filter_chain || !sys->text || !sys->scale
@@ -1898,6 +1993,8 @@ subpicture_t *spu_Render(spu_t *spu,
 {
     spu_private_t *sys = spu->p;
 
+    vlc_tracer_Begin("spu render");
+
     /* Update sub-source chain */
     vlc_mutex_lock(&sys->lock);
     char *chain_update = sys->source_chain_update;
@@ -1958,6 +2055,7 @@ subpicture_t *spu_Render(spu_t *spu,
     if (!subpicture_array)
     {
         vlc_mutex_unlock(&sys->lock);
+        vlc_tracer_End("spu render");
         return NULL;
     }
 
@@ -1996,6 +2094,7 @@ subpicture_t *spu_Render(spu_t *spu,
     free(subpicture_array);
     vlc_mutex_unlock(&sys->lock);
 
+    vlc_tracer_End("spu render");
     return render;
 }
 
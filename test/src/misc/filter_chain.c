@@ -0,0 +1,229 @@
+/*****************************************************************************
+ * filter_chain.c: test the in-place processing of video filter chains
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#define MODULE_NAME test_filter_chain
+#define MODULE_STRING "test_filter_chain"
+#undef __PLUGIN__
+
+#include <vlc/vlc.h>
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+
+#include <assert.h>
+
+const char vlc_module_name[] = MODULE_STRING;
+
+/* Number of pictures written into their input by the filters */
+static unsigned inplace;
+/* Extra reference to the output of the "test_copy" filter, if requested */
+static bool hold_copy;
+static picture_t *held;
+/* Pictures allocated by the chain owner */
+static unsigned owner_pictures;
+
+static picture_t *Filter(filter_t *filter, picture_t *pic)
+{
+    picture_t *out = filter_NewPicture(filter);
+    if (out == NULL)
+    {
+        picture_Release(pic);
+        return NULL;
+    }
+
+    out->p[0].p_pixels[0] = pic->p[0].p_pixels[0] + 1;
+    if (out == pic)
+        inplace++;
+    picture_Release(pic);
+
+    if (hold_copy && !filter->b_inplace)
+    {
+        assert(held == NULL);
+        held = picture_Hold(out);
+    }
+    return out;
+}
+
+static int Open(filter_t *filter, bool b_inplace)
+{
+    if (!video_format_IsSimilar(&filter->fmt_in.video,
+                                &filter->fmt_out.video))
+        return VLC_EGENERIC;
+
+    filter->pf_video_filter = Filter;
+    filter->b_inplace = b_inplace;
+    return VLC_SUCCESS;
+}
+
+static int OpenCopy(vlc_object_t *obj)
+{
+    return Open((filter_t *)obj, false);
+}
+
+static int OpenInPlace(vlc_object_t *obj)
+{
+    return Open((filter_t *)obj, true);
+}
+
+vlc_module_begin()
+    set_capability("video filter", 0)
+    set_callback(OpenCopy)
+    add_shortcut("test_copy")
+    add_submodule()
+        set_capability("video filter", 0)
+        set_callback(OpenInPlace)
+        add_shortcut("test_inplace")
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+
+VLC_EXPORT vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry),
+    NULL
+};
+
+static picture_t *OwnerNewPicture(filter_t *filter)
+{
+    owner_pictures++;
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static const struct filter_video_callbacks owner_cbs = {
+    OwnerNewPicture, NULL,
+};
+
+static filter_chain_t *ChainNew(vlc_object_t *obj, bool with_owner,
+                                const char *names)
+{
+    const filter_owner_t owner = {
+        .video = &owner_cbs,
+    };
+    es_format_t fmt;
+    video_format_t vfmt;
+
+    video_format_Init(&vfmt, VLC_CODEC_I420);
+    video_format_Setup(&vfmt, VLC_CODEC_I420, 64, 48, 64, 48, 1, 1);
+    es_format_InitFromVideo(&fmt, &vfmt);
+    video_format_Clean(&vfmt);
+
+    filter_chain_t *chain = filter_chain_NewVideo(obj, false,
+                                                  with_owner ? &owner : NULL);
+    assert(chain != NULL);
+    filter_chain_Reset(chain, &fmt, NULL, &fmt);
+    assert(filter_chain_AppendFromString(chain, names) >= 0);
+    es_format_Clean(&fmt);
+    return chain;
+}
+
+/* Runs a picture through a chain of count filters, and returns how many
+ * filters processed it in place. If keep is true, the caller keeps a
+ * reference to the input picture. */
+static unsigned ChainFilter(filter_chain_t *chain, unsigned count, bool keep)
+{
+    const es_format_t *fmt = filter_chain_GetFmtOut(chain);
+    picture_t *pic = picture_NewFromFormat(&fmt->video);
+    assert(pic != NULL);
+
+    pic->p[0].p_pixels[0] = 10;
+    if (keep)
+        picture_Hold(pic);
+    inplace = 0;
+
+    picture_t *out = filter_chain_VideoFilter(chain, pic);
+    assert(out != NULL);
+    assert(out != pic);
+    /* Each filter adds one, and the caller picture is left untouched */
+    assert(out->p[0].p_pixels[0] == 10 + count);
+    if (keep)
+    {
+        assert(pic->p[0].p_pixels[0] == 10);
+        picture_Release(pic);
+    }
+
+    picture_Release(out);
+    return inplace;
+}
+
+static void test_inplace(vlc_object_t *obj)
+{
+    filter_chain_t *chain;
+
+    /* The input picture belongs to the caller, even if it is not referenced
+     * elsewhere */
+    chain = ChainNew(obj, false, "test_inplace");
+    assert(ChainFilter(chain, 1, true) == 0);
+    assert(ChainFilter(chain, 1, false) == 0);
+    filter_chain_Delete(chain);
+
+    /* The input picture was allocated by the chain for the previous filter */
+    chain = ChainNew(obj, false, "test_copy:test_inplace");
+    assert(ChainFilter(chain, 2, true) == 1);
+    assert(ChainFilter(chain, 2, true) == 1);
+    filter_chain_Delete(chain);
+
+    /* ... but is referenced elsewhere */
+    hold_copy = true;
+    chain = ChainNew(obj, false, "test_copy:test_inplace");
+    assert(ChainFilter(chain, 2, true) == 0);
+    assert(held->p[0].p_pixels[0] == 11);
+    picture_Release(held);
+    held = NULL;
+    hold_copy = false;
+    filter_chain_Delete(chain);
+
+    /* The filter does not support in-place processing */
+    chain = ChainNew(obj, false, "test_copy:test_copy");
+    assert(ChainFilter(chain, 2, true) == 0);
+    filter_chain_Delete(chain);
+
+    /* The output of the last filter comes from the chain owner */
+    chain = ChainNew(obj, true, "test_copy:test_inplace");
+    assert(ChainFilter(chain, 2, true) == 0);
+    assert(owner_pictures == 1);
+    filter_chain_Delete(chain);
+
+    /* Intermediate filters still reuse their input */
+    chain = ChainNew(obj, true, "test_copy:test_inplace:test_inplace");
+    assert(ChainFilter(chain, 3, true) == 1);
+    assert(owner_pictures == 2);
+    filter_chain_Delete(chain);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_inplace(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
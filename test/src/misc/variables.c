@@ -444,6 +444,84 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_many( libvlc_int_t *p_libvlc )
+{
+    char name[32];
+
+    /* Enough variables to grow the table a few times, then punch holes in
+     * the probe sequences and check that every survivor is still found. */
+    for( int i = 0; i < 1000; i++ )
+    {
+        sprintf( name, "many-%d", i );
+        assert( var_Create( p_libvlc, name, VLC_VAR_INTEGER ) == VLC_SUCCESS );
+        var_SetInteger( p_libvlc, name, i );
+    }
+
+    for( int i = 0; i < 1000; i += 3 )
+    {
+        sprintf( name, "many-%d", i );
+        var_Destroy( p_libvlc, name );
+    }
+
+    for( int i = 0; i < 1000; i++ )
+    {
+        sprintf( name, "many-%d", i );
+        if( i % 3 )
+            assert( var_GetInteger( p_libvlc, name ) == i );
+        else
+            assert( var_Type( p_libvlc, name ) == 0 );
+    }
+
+    for( int i = 0; i < 1000; i++ )
+    {
+        sprintf( name, "many-%d", i );
+        if( i % 3 )
+            var_Destroy( p_libvlc, name );
+    }
+}
+
+#define BENCH_LOOPS 1000000
+
+static void bench( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *child = vlc_object_create( p_libvlc, sizeof (*child) );
+    vlc_object_t *grandchild = vlc_object_create( child, sizeof (*child) );
+    assert( child != NULL && grandchild != NULL );
+
+    var_Create( p_libvlc, "bench-int", VLC_VAR_INTEGER );
+
+    vlc_tick_t start = vlc_tick_now();
+    for( int i = 0; i < BENCH_LOOPS; i++ )
+        var_SetInteger( p_libvlc, "bench-int", i );
+    vlc_tick_t set = vlc_tick_now() - start;
+
+    int64_t sum = 0;
+    start = vlc_tick_now();
+    for( int i = 0; i < BENCH_LOOPS; i++ )
+        sum += var_GetInteger( p_libvlc, "bench-int" );
+    vlc_tick_t get = vlc_tick_now() - start;
+
+    start = vlc_tick_now();
+    for( int i = 0; i < BENCH_LOOPS; i++ )
+        sum += var_InheritInteger( grandchild, "bench-int" );
+    vlc_tick_t inherit = vlc_tick_now() - start;
+
+    start = vlc_tick_now();
+    for( int i = 0; i < BENCH_LOOPS; i++ )
+        sum += var_InheritBool( grandchild, "fullscreen" );
+    vlc_tick_t config = vlc_tick_now() - start;
+
+    assert( sum != 0 );
+    test_log( "%d iterations: set %"PRId64" us, get %"PRId64" us, "
+              "inherit %"PRId64" us, inherit from config %"PRId64" us\n",
+              BENCH_LOOPS, US_FROM_VLC_TICK(set), US_FROM_VLC_TICK(get),
+              US_FROM_VLC_TICK(inherit), US_FROM_VLC_TICK(config) );
+
+    var_Destroy( p_libvlc, "bench-int" );
+    vlc_object_delete( grandchild );
+    vlc_object_delete( child );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -481,6 +559,12 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     test_log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    test_log( "Testing many variables\n" );
+    test_many( p_libvlc );
+
+    test_log( "Benchmarking variable lookups\n" );
+    bench( p_libvlc );
 }
 
 